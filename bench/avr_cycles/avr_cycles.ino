@@ -0,0 +1,210 @@
+/**
+ * \file avr_cycles.ino
+ * \brief   Cycle benchmark of the libraries' hot paths on ATmega328P.
+ *          Intended to run under simavr with the board in harness.c (see run.sh),
+ *          but works on a real board as well. Cycles are counted with Timer1 running
+ *          at CPU clock; every result is printed as one JSON object per line.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include <avr/sleep.h>
+#include "max7219.h"
+#include "mcp402x.h"
+#include "i2c.h"
+
+extern "C" {
+    #include "utility/twi.h"
+}
+
+namespace
+{
+    constexpr uint8_t   runs            {32};
+    constexpr uint8_t   deviceAddress   {0x50};                     // memory-like device provided by harness.c
+
+    /**
+     * \brief Marks the phase in which harness.c measures TWI_vect (GPIOR0 is visible to the emulator).
+    **/
+    inline void markIsrPhase(const bool active)
+    {
+        GPIOR0 = active ? 1 : 0;
+    }
+
+    typedef struct
+    {
+        uint16_t    min;
+        uint16_t    max;
+        uint32_t    total;
+    } stats_t;
+
+    uint16_t    overhead    {0};
+
+    inline uint16_t stamp(void)
+    {
+        return TCNT1;
+    }
+
+    void add(stats_t &stats, const uint16_t start, const uint16_t end)
+    {
+        uint16_t cycles {(uint16_t)(end - start - overhead)};
+
+        stats.min = (cycles < stats.min) ? cycles : stats.min;
+        stats.max = (cycles > stats.max) ? cycles : stats.max;
+        stats.total += cycles;
+    }
+
+    void report(const char *name, const stats_t &stats)
+    {
+        Serial.print(F("{\"bench\":\""));
+        Serial.print(name);
+        Serial.print(F("\",\"min\":"));
+        Serial.print(stats.min);
+        Serial.print(F(",\"avg\":"));
+        Serial.print(stats.total / runs);
+        Serial.print(F(",\"max\":"));
+        Serial.print(stats.max);
+        Serial.print(F(",\"n\":"));
+        Serial.print(runs);
+        Serial.println(F("}"));
+    }
+
+    class BenchMax7219 : public Max7219
+    {
+    public:
+        using Max7219::Max7219;
+
+        void cmd(const uint16_t cmd)
+        {
+            sendCmd(cmd);
+        }
+    };
+
+    class BenchMcp402x : public Mcp402x
+    {
+    public:
+        using Mcp402x::Mcp402x;
+
+        void pulses(const uint8_t pulses)
+        {
+            pulse(pulses, UP, keepNV_t::NO);
+        }
+    };
+
+    Max7219NS::context_t    maxCtx      {};
+    Mcp402xNS::context_t    potCtx      {};
+    BenchMax7219            display     {maxCtx};
+    BenchMcp402x            pot         {potCtx};
+    uint8_t                 writeBuffer[1]  {0x00};
+    uint8_t                 readBuffer[16]  {};
+    I2C::context_t          i2cCtx      {&Wire, writeBuffer, readBuffer, deviceAddress, 1, 2, true, true};
+}
+
+void setup(void)
+{
+    stats_t stats;
+    uint16_t start;
+
+    Serial.begin(115200);
+    Wire.begin();
+    Wire.setClock(400000);
+    potCtx.csPin = 5;
+    potCtx.udPin = 6;
+    display.init();
+    pot.init();
+    Serial.flush();
+
+    TCCR1A = 0;
+    TCCR1B = _BV(CS10);                                             // Timer1 counts CPU cycles
+    TIMSK1 = 0;
+    TIMSK0 = 0;                                                     // no millis() interrupt inside measurements
+
+    start = stamp();
+    overhead = stamp() - start;
+
+    stats = {0xFFFF, 0, 0};
+    for (uint8_t run = 0; run < runs; run++)
+    {
+        start = stamp();
+        display.cmd(0x0100 | run);
+        add(stats, start, stamp());
+    }
+    report("Max7219::sendCmd", stats);
+
+    stats = {0xFFFF, 0, 0};
+    for (uint8_t run = 0; run < runs; run++)
+    {
+        start = stamp();
+        pot.pulses(1);
+        add(stats, start, stamp());
+    }
+    report("Mcp402x::pulse(1)", stats);
+
+    stats = {0xFFFF, 0, 0};
+    for (uint8_t run = 0; run < runs; run++)
+    {
+        start = stamp();
+        pot.pulses(8);
+        add(stats, start, stamp());
+    }
+    report("Mcp402x::pulse(8)", stats);
+
+    stats_t isr {0xFFFF, 0, 0};
+    twi_setPolledLength(0);                                         // every bus event goes through TWI_vect
+    for (uint8_t run = 0; run < runs; run++)
+    {
+        start = stamp();
+        twi_readFrom(deviceAddress, readBuffer, 2, true);
+        add(isr, start, stamp());
+    }
+    report("twi_readFrom(2) interrupt", isr);
+    twi_setPolledLength(TWI_POLLED_LENGTH);
+
+    stats_t raw {0xFFFF, 0, 0};
+    for (uint8_t run = 0; run < runs; run++)
+    {
+        start = stamp();
+        twi_readFrom(deviceAddress, readBuffer, 2, true);
+        add(raw, start, stamp());
+    }
+    report("twi_readFrom(2)", raw);
+
+    isr.min -= raw.min;
+    isr.max -= raw.max;
+    isr.total -= raw.total;
+    report("twi_readFrom(2) polling saves", isr);
+
+    stats = {0xFFFF, 0, 0};
+    for (uint8_t run = 0; run < runs; run++)
+    {
+        start = stamp();
+        I2C::readBytes(&i2cCtx);
+        add(stats, start, stamp());
+    }
+    report("I2C::readBytes(2)", stats);
+
+    stats.min -= raw.min;
+    stats.max -= raw.max;
+    stats.total -= raw.total;
+    report("I2C::readBytes overhead", stats);
+
+    i2cCtx.readLen = sizeof(readBuffer);
+    markIsrPhase(true);
+    for (uint8_t run = 0; run < runs; run++)
+    {
+        I2C::readBytes(&i2cCtx);
+    }
+    markIsrPhase(false);
+
+    Serial.flush();
+    cli();
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    sleep_enable();
+    sleep_cpu();                                                    // sleeping with interrupts off ends simulation
+}
+
+void loop(void)
+{
+}
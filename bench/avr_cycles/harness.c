@@ -0,0 +1,178 @@
+/**
+ * \file harness.c
+ * \brief   simavr board for avr_cycles.ino: ATmega328P at 16 MHz, UART0 forwarded to stdout,
+ *          a memory-like I2C device at address 0x50 and exact cycle accounting
+ *          of TWI_vect while the firmware sets GPIOR0: the whole handler, and the part
+ *          which keeps other interrupts blocked (until sei or reti).
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "sim_avr.h"
+#include "sim_core.h"
+#include "sim_elf.h"
+#include "avr_twi.h"
+#include "avr_uart.h"
+
+#define DEVICE_ADDRESS  (0x50 << 1)
+#define TWI_VECTOR      24
+#define GPIOR0_ADDRESS  0x3E
+
+typedef struct
+{
+    avr_irq_t  *irq;
+    uint8_t     memory[256];
+    uint8_t     pointer;
+    uint8_t     selected;
+    uint8_t     pointerSet;
+} device_t;
+
+static void uartOut(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    (void)irq;
+    (void)param;
+    putchar((int)value);
+}
+
+static void deviceHook(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    device_t           *dev = (device_t *)param;
+    avr_twi_msg_irq_t   msg;
+
+    (void)irq;
+    msg.u.v = value;
+
+    if (msg.u.twi.msg & TWI_COND_STOP)
+    {
+        dev->selected = 0;
+    }
+    if (msg.u.twi.msg & TWI_COND_START)
+    {
+        dev->selected = 0;
+        if ((msg.u.twi.addr & 0xFE) == DEVICE_ADDRESS)
+        {
+            dev->selected = msg.u.twi.addr;
+            dev->pointerSet = 0;
+            avr_raise_irq(dev->irq + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_ACK, dev->selected, 1));
+        }
+    }
+    if (dev->selected)
+    {
+        if (msg.u.twi.msg & TWI_COND_WRITE)
+        {
+            avr_raise_irq(dev->irq + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_ACK, dev->selected, 1));
+            if (!dev->pointerSet)
+            {
+                dev->pointer = msg.u.twi.data;
+                dev->pointerSet = 1;
+            } else
+            {
+                dev->memory[dev->pointer++] = msg.u.twi.data;
+            }
+        }
+        if (msg.u.twi.msg & TWI_COND_READ)
+        {
+            avr_raise_irq(dev->irq + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_READ, dev->selected, dev->memory[dev->pointer++]));
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    static const char  *names[] = {"device.twi.in", "device.twi.out"};
+    elf_firmware_t      firmware = {{0}};
+    device_t            device = {0};
+    avr_t              *avr;
+    uint32_t            flags = 0;
+    int                 state = cpu_Running;
+    int                 inIsr = 0;
+    uint16_t            isrSp = 0;
+    avr_cycle_count_t   isrStart = 0;
+    avr_cycle_count_t   isrCycles = 0;
+    uint32_t            isrCalls = 0;
+    uint16_t            isrMin = 0xFFFF;
+    uint16_t            isrMax = 0;
+    int                 blocking = 0;
+    uint32_t            blockedCycles = 0;
+    uint16_t            blockedMin = 0xFFFF;
+    uint16_t            blockedMax = 0;
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s firmware.elf\n", argv[0]);
+        return 1;
+    }
+    if (0 != elf_read_firmware(argv[1], &firmware))
+    {
+        fprintf(stderr, "%s: cannot load %s\n", argv[0], argv[1]);
+        return 1;
+    }
+
+    avr = avr_make_mcu_by_name("atmega328p");
+    avr_init(avr);
+    avr_load_firmware(avr, &firmware);
+    avr->frequency = 16000000;
+    avr->log = LOG_ERROR;
+
+    avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+    flags &= ~AVR_UART_FLAG_STDIO;
+    avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT), uartOut, NULL);
+
+    for (int idx = 0; idx < 256; idx++)
+    {
+        device.memory[idx] = (uint8_t)idx;
+    }
+    device.irq = avr_alloc_irq(&avr->irq_pool, 0, 2, names);
+    avr_irq_register_notify(device.irq + TWI_IRQ_OUTPUT, deviceHook, &device);
+    avr_connect_irq(device.irq + TWI_IRQ_INPUT, avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_INPUT));
+    avr_connect_irq(avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_OUTPUT), device.irq + TWI_IRQ_OUTPUT);
+
+    while ((cpu_Done != state) && (cpu_Crashed != state))
+    {
+        state = avr_run(avr);
+
+        // TWI_vect entry: return address already pushed; exit when it has been popped by reti
+        if (!inIsr && (avr->pc == TWI_VECTOR * avr->vector_size) && avr->data[GPIOR0_ADDRESS])
+        {
+            inIsr = 1;
+            blocking = 1;
+            isrSp = _avr_sp_get(avr);
+            isrStart = avr->cycle;
+            continue;
+        }
+        // other interrupts are blocked until the handler enables them, at the latest by reti
+        if (blocking && avr->sreg[S_I])
+        {
+            uint16_t cycles = (uint16_t)(avr->cycle - isrStart);
+
+            blocking = 0;
+            blockedCycles += cycles;
+            blockedMin = (cycles < blockedMin) ? cycles : blockedMin;
+            blockedMax = (cycles > blockedMax) ? cycles : blockedMax;
+        }
+        if (inIsr && (_avr_sp_get(avr) == (uint16_t)(isrSp + 2)))
+        {
+            uint16_t cycles = (uint16_t)(avr->cycle - isrStart);
+
+            inIsr = 0;
+            isrCycles += cycles;
+            isrCalls++;
+            isrMin = (cycles < isrMin) ? cycles : isrMin;
+            isrMax = (cycles > isrMax) ? cycles : isrMax;
+        }
+    }
+
+    printf("{\"bench\":\"ISR(TWI_vect) per byte\",\"min\":%u,\"avg\":%u,\"max\":%u,\"n\":%u}\n",
+           isrCalls ? isrMin : 0, isrCalls ? (unsigned)(isrCycles / isrCalls) : 0, isrMax, isrCalls);
+    printf("{\"bench\":\"ISR(TWI_vect) interrupts blocked\",\"min\":%u,\"avg\":%u,\"max\":%u,\"n\":%u}\n",
+           isrCalls ? blockedMin : 0, isrCalls ? (unsigned)(blockedCycles / isrCalls) : 0, blockedMax, isrCalls);
+
+    return (cpu_Done == state) ? 0 : 2;
+}
@@ -0,0 +1,51 @@
+#!/bin/sh
+#
+# Cycle-accurate benchmark of the libraries' hot paths on ATmega328P.
+# Builds avr_cycles.ino with arduino-cli (using libraries from this repository),
+# runs it under simavr through harness.c and prints results as one JSON document.
+#
+# Requirements: arduino-cli with arduino:avr core, simavr (library and headers), libelf.
+#
+# Environment:
+#   BUILD_DIR       build directory            (default: <repo>/_bench_build/avr_cycles)
+#   FQBN            board used for compilation (default: arduino:avr:uno)
+#   FLAGS           extra compiler flags       (e.g. -DTWI_SPLIT_ISR to compare ISR variants)
+#   SIMAVR_CFLAGS   compiler flags for simavr  (default: pkg-config simavr)
+#   SIMAVR_LIBS     linker flags for simavr    (default: pkg-config simavr)
+#
+# SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+# SPDX-License-Identifier: MIT
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/../.." && pwd)
+HERE="$ROOT/bench/avr_cycles"
+BUILD_DIR=${BUILD_DIR:-"$ROOT/_bench_build/avr_cycles"}
+FQBN=${FQBN:-arduino:avr:uno}
+FLAGS=${FLAGS:-}
+SIMAVR_CFLAGS=${SIMAVR_CFLAGS:-$(pkg-config --cflags simavr 2>/dev/null || echo "-I/usr/include/simavr")}
+SIMAVR_LIBS=${SIMAVR_LIBS:-$(pkg-config --libs simavr 2>/dev/null || echo "-lsimavr")}
+
+mkdir -p "$BUILD_DIR"
+
+arduino-cli compile --fqbn "$FQBN" --build-path "$BUILD_DIR/firmware" \
+    --build-property "compiler.c.extra_flags=$FLAGS" \
+    --build-property "compiler.cpp.extra_flags=$FLAGS" \
+    --library "$ROOT/hal" \
+    --library "$ROOT/profiler" \
+    --library "$ROOT/scheduler" \
+    --library "$ROOT/max7219" \
+    --library "$ROOT/mcp402x" \
+    --library "$ROOT/i2c_helper" \
+    --library "$ROOT/wire_avr_one_buffer" \
+    "$HERE" >&2
+
+cc -O2 -o "$BUILD_DIR/harness" "$HERE/harness.c" $SIMAVR_CFLAGS $SIMAVR_LIBS -lelf
+
+"$BUILD_DIR/harness" "$BUILD_DIR/firmware/avr_cycles.ino.elf" > "$BUILD_DIR/results.txt"
+
+COMMIT=$(git -C "$ROOT" rev-parse --short HEAD 2>/dev/null || echo unknown)
+
+printf '{"mcu":"atmega328p","f_cpu":16000000,"commit":"%s","flags":"%s","results":[' "$COMMIT" "$FLAGS"
+grep '^{' "$BUILD_DIR/results.txt" | tr -d '\r' | paste -sd, -
+printf ']}\n'
@@ -0,0 +1,32 @@
+/**
+ * \file i2c_cache.ino
+ * \brief Footprint configuration: two consumers of the same sensor registers sharing the read cache.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "i2c_cache.h"
+
+namespace
+{
+    uint8_t         reg[1]          {0x3B};
+    uint8_t         control[6]      {};
+    uint8_t         logger[6]       {};
+    I2C::context_t  controlCtx      {&Wire, reg, control, 0x68, 1, 6, false, true};
+    I2C::context_t  loggerCtx       {&Wire, reg, logger, 0x68, 1, 6, false, true};
+}
+
+void setup(void)
+{
+    Wire.begin();
+    I2CCache::begin();
+}
+
+void loop(void)
+{
+    I2CCache::read(&controlCtx, 2);
+    I2CCache::read(&loggerCtx, 20);
+}
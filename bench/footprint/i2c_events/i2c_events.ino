@@ -0,0 +1,42 @@
+/**
+ * \file i2c_events.ino
+ * \brief Footprint configuration: event driven reads of a DRDY device and two devices on a shared SMBALERT# line.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "i2c_events.h"
+
+namespace
+{
+    uint8_t         reg[1]          {0x00};
+    uint8_t         data[3][2]      {};
+    I2C::context_t  drdyCtx         {&Wire, reg, data[0], 0x50, 1, 2, false, true};
+    I2C::context_t  alertCtx[2]     {{&Wire, nullptr, data[1], 0x48, 0, 2, true, true},
+                                     {&Wire, nullptr, data[2], 0x49, 0, 2, true, true}};
+    volatile uint8_t    last        {0};
+
+    void onRead(I2C::context_t *ctx, uint8_t result)
+    {
+        if (I2C::SUCCESS == result)
+        {
+            last = ctx->readBuffer[0];
+        }
+    }
+}
+
+void setup(void)
+{
+    Wire.begin();
+    I2CEvents::registerSource(drdyCtx, 2, I2CEvents::DATA_READY, onRead);
+    I2CEvents::registerSource(alertCtx[0], 3, I2CEvents::SMBUS_ALERT, onRead);
+    I2CEvents::registerSource(alertCtx[1], 3, I2CEvents::SMBUS_ALERT, onRead);
+}
+
+void loop(void)
+{
+    I2CEvents::service();
+}
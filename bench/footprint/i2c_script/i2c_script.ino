@@ -0,0 +1,44 @@
+/**
+ * \file i2c_script.ino
+ * \brief Footprint configuration: PROGMEM bring-up script of two devices run from the TWI and tick interrupts.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "i2c_script.h"
+
+namespace
+{
+    const uint8_t PROGMEM   bringUp[]   {
+                                            I2C_SCRIPT_DEVICE(0x68),
+                                            I2C_SCRIPT_WRITE(0x6B, 0x80),
+                                            I2C_SCRIPT_DELAY(100),
+                                            I2C_SCRIPT_POLL(0x6B, 0x80, 0x00, 50),
+                                            I2C_SCRIPT_BURST(3), 0x19, 0x07, 0x01,
+                                            I2C_SCRIPT_READ(0x75, 1, 0),
+                                            I2C_SCRIPT_DEVICE(0x50),
+                                            I2C_SCRIPT_WRITE(0x00, 0x42),
+                                            I2C_SCRIPT_END
+                                        };
+    uint8_t                 slots[1]    {};
+    volatile uint8_t        status      {0xFF};
+
+    void onDone(uint8_t result, uint16_t position)
+    {
+        (void)position;
+        status = result;
+    }
+}
+
+void setup(void)
+{
+    Wire.begin();
+    I2CScript::start(bringUp, slots, sizeof(slots), onDone);
+}
+
+void loop(void)
+{
+}
@@ -0,0 +1,80 @@
+/**
+ * \file max7219.ino
+ * \brief   Footprint configuration: chain of MAX7219 chips written digit by digit,
+ *          or with a precompiled PROGMEM frame (FOOTPRINT_STATIC_FRAME);
+ *          FOOTPRINT_USI clocks the chain with the USI of an ATtiny, FOOTPRINT_SPI_BUFFERED
+ *          with SPI0 of a megaAVR-0 (with MAX7219_SPI_ASYNC the frame is sent in the background);
+ *          FOOTPRINT_DUAL_ENGINE adds a second chain on the USART in master SPI mode, both
+ *          refreshed at the same time (MAX7219_SPI_ASYNC and MAX7219_MSPI_ASYNC).
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "max7219.h"
+
+namespace
+{
+    Max7219NS::context_t    ctx         {};
+    Max7219                 display     {ctx};
+#if defined(FOOTPRINT_DUAL_ENGINE)
+    Max7219NS::context_t    ctx2        {};
+    Max7219                 display2    {ctx2};
+#endif
+#if defined(FOOTPRINT_STATIC_FRAME)
+    constexpr uint8_t       logo[4][Max7219NS::maxDigits]
+                                        {{0x3C, 0x42, 0xA5, 0x81, 0xA5, 0x99, 0x42, 0x3C},
+                                         {0x00, 0x7E, 0x40, 0x40, 0x7C, 0x40, 0x40, 0x7E},
+                                         {0x00, 0x7E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18},
+                                         {0x00, 0x3C, 0x42, 0x40, 0x3C, 0x02, 0x42, 0x3C}};
+    const Max7219NS::frame_t<4> PROGMEM logoFrame   {Max7219NS::makeFrame(logo)};
+#endif
+}
+
+void setup(void)
+{
+    ctx.numDevices = 4;
+    ctx.activeDevice = 4;
+#if defined(FOOTPRINT_USI)
+    ctx.csbPin = 3;
+    ctx.backend = Max7219NS::BACKEND_USI;
+#elif defined(FOOTPRINT_SPI_BUFFERED)
+    ctx.backend = Max7219NS::BACKEND_SPI_BUFFERED;
+#endif
+    display.init();
+#if defined(FOOTPRINT_DUAL_ENGINE)
+    ctx2.csbPin = 5;
+    ctx2.numDevices = 4;
+    ctx2.activeDevice = 4;
+    ctx2.backend = Max7219NS::BACKEND_USART_MSPI;
+    display2.init();
+#endif
+}
+
+void loop(void)
+{
+#if defined(FOOTPRINT_STATIC_FRAME) && defined(MAX7219_SPI_ASYNC)
+    if (!display.isFrameBusy())
+    {
+        display.writeFrameAsync_P(logoFrame);
+    }
+#if defined(FOOTPRINT_DUAL_ENGINE)
+    if (!display2.isFrameBusy())
+    {
+        display2.writeFrameAsync_P(logoFrame);
+    }
+#endif
+#elif defined(FOOTPRINT_STATIC_FRAME)
+    display.writeFrame_P(logoFrame);
+#else
+    for (uint8_t position = 0; position < Max7219NS::maxDigits; position++)
+    {
+        do
+        {
+            display.write(position, position);
+        } while (display.isChainBusy());
+    }
+#endif
+}
@@ -0,0 +1,32 @@
+/**
+ * \file mcp402x.ino
+ * \brief Footprint configuration: MCP402x potentiometer, volatile wiper only.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "mcp402x.h"
+
+namespace
+{
+    Mcp402xNS::context_t    ctx     {};
+    Mcp402x                 pot     {ctx};
+}
+
+void setup(void)
+{
+#if defined(FOOTPRINT_USI)
+    ctx.csPin = 3;
+    ctx.udPin = HAL_USI_USCK_PIN;
+    ctx.backend = Mcp402xNS::BACKEND_USI;
+#endif
+    pot.init();
+}
+
+void loop(void)
+{
+    pot.set(pot.get() + 1);
+}
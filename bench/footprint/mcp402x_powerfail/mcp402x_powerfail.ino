@@ -0,0 +1,30 @@
+/**
+ * \file mcp402x_powerfail.ino
+ * \brief Footprint configuration: MCP402x potentiometer with power-fail persistence.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "mcp402x_powerfail.h"
+
+namespace
+{
+    Mcp402xNS::context_t    ctx     {};
+    Mcp402x                 pot     {ctx};
+}
+
+void setup(void)
+{
+    pot.init();
+    Mcp402xPowerFail::restore(pot, 0);
+    Mcp402xPowerFail::registerPot(ctx, 0);
+    Mcp402xPowerFail::armComparator();
+}
+
+void loop(void)
+{
+    pot.set(pot.get() + 1);
+}
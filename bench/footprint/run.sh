@@ -0,0 +1,89 @@
+#!/bin/sh
+#
+# Flash/RAM footprint of the libraries per feature configuration (see configs.txt).
+# Every configuration is a small sketch compiled with arduino-cli for ATmega328P
+# (or for the board given with fqbn=<board> as the first flag of the configuration);
+# reported are .text/.data/.bss of the whole image and of every library object,
+# and all static buffers (.data/.bss symbols) of at least MIN_BUFFER bytes,
+# e.g. twi_masterBuffer[TWI_BUFFER_LENGTH]. Output is one JSON document.
+#
+# Requirements: arduino-cli with arduino:avr core (and the cores of boards given with fqbn=),
+# avr-size and avr-nm in PATH.
+#
+# Environment:
+#   BUILD_DIR       build directory            (default: <repo>/_bench_build/footprint)
+#   FQBN            board used for compilation (default: arduino:avr:uno)
+#   MIN_BUFFER      smallest reported buffer   (default: 16)
+#
+# SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+# SPDX-License-Identifier: MIT
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/../.." && pwd)
+HERE="$ROOT/bench/footprint"
+BUILD_DIR=${BUILD_DIR:-"$ROOT/_bench_build/footprint"}
+FQBN=${FQBN:-arduino:avr:uno}
+MIN_BUFFER=${MIN_BUFFER:-16}
+
+# prints .text .data .bss of the given file
+sizes()
+{
+    avr-size --format=berkeley "$1" | awk 'NR == 2 { print $1, $2, $3 }'
+}
+
+COMMIT=$(git -C "$ROOT" rev-parse --short HEAD 2>/dev/null || echo unknown)
+printf '{"mcu":"atmega328p","commit":"%s","configurations":[' "$COMMIT"
+
+FIRST=1
+grep -v '^#' "$HERE/configs.txt" | while read -r NAME SKETCH FLAGS; do
+    [ -n "$NAME" ] || continue
+    OUT="$BUILD_DIR/$NAME"
+    mkdir -p "$OUT"
+
+    BOARD=$FQBN
+    case "$FLAGS" in
+        fqbn=*)
+            BOARD=${FLAGS%% *}
+            FLAGS=${FLAGS#"$BOARD"}
+            FLAGS=${FLAGS# }
+            BOARD=${BOARD#fqbn=}
+            ;;
+    esac
+
+    arduino-cli compile --fqbn "$BOARD" --build-path "$OUT" \
+        --build-property "compiler.c.extra_flags=$FLAGS" \
+        --build-property "compiler.cpp.extra_flags=$FLAGS" \
+        --library "$ROOT/hal" \
+        --library "$ROOT/profiler" \
+        --library "$ROOT/scheduler" \
+        --library "$ROOT/max7219" \
+        --library "$ROOT/mcp402x" \
+        --library "$ROOT/i2c_helper" \
+        --library "$ROOT/wire_avr_one_buffer" \
+        "$HERE/$SKETCH" >&2
+
+    ELF="$OUT/$SKETCH.ino.elf"
+    [ $FIRST -eq 1 ] || printf ','
+    FIRST=0
+
+    set -- $(sizes "$ELF")
+    printf '{"name":"%s","board":"%s","flags":"%s","image":{"text":%s,"data":%s,"bss":%s},"objects":[' "$NAME" "$BOARD" "$FLAGS" "$1" "$2" "$3"
+
+    SEP=''
+    for OBJ in $(find "$OUT/libraries" "$OUT/sketch" -name '*.o' | sort); do
+        set -- $(sizes "$OBJ")
+        printf '%s{"object":"%s","text":%s,"data":%s,"bss":%s}' "$SEP" "${OBJ#$OUT/}" "$1" "$2" "$3"
+        SEP=','
+    done
+
+    printf '],"buffers":['
+    avr-nm -S --size-sort -t d -C "$ELF" | \
+        awk -v min="$MIN_BUFFER" '($3 ~ /^[bBdD]$/) && ($2 + 0 >= min) {
+            $1 = ""; $2 = $2 + 0; type = $3; $3 = ""; size = $2; $2 = "";
+            sub(/^ +/, ""); printf "%s{\"symbol\":\"%s\",\"section\":\"%s\",\"size\":%d}", sep, $0, (type ~ /[bB]/) ? "bss" : "data", size; sep = ","
+        }'
+    printf ']}'
+done
+
+printf ']}\n'
@@ -0,0 +1,41 @@
+/**
+ * \file scheduler.ino
+ * \brief Footprint configuration: scheduler with one periodic and one one-shot task.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "scheduler.h"
+
+namespace
+{
+    SchedulerNS::task_t     tasks[4]    {};
+    Scheduler               scheduler   {tasks, 4};
+    volatile uint8_t        counter     {0};
+
+    void periodic(void *arg)
+    {
+        (void)arg;
+        counter++;
+    }
+
+    void oneShot(void *arg)
+    {
+        (void)arg;
+        counter = 0;
+    }
+}
+
+void setup(void)
+{
+    scheduler.every(10, periodic);
+    scheduler.after(1000, oneShot);
+}
+
+void loop(void)
+{
+    scheduler.run();
+}
@@ -0,0 +1,33 @@
+/**
+ * \file twi_master.ino
+ * \brief   Footprint configuration: TWI master only, register reads through I2C helper.
+ *          With FOOTPRINT_ADDRESS_10BIT the device has 10-bit address.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "i2c.h"
+
+namespace
+{
+    uint8_t         reg[1]      {0x00};
+    uint8_t         data[2]     {};
+#if defined(FOOTPRINT_ADDRESS_10BIT)
+    I2C::context_t  ctx         {&Wire, reg, data, 0x250, 1, 2, false, true, I2C::ADDRESS_10BIT};
+#else
+    I2C::context_t  ctx         {&Wire, reg, data, 0x50, 1, 2, false, true};
+#endif
+}
+
+void setup(void)
+{
+    Wire.begin();
+}
+
+void loop(void)
+{
+    I2C::writeThenReadBytes(&ctx);
+}
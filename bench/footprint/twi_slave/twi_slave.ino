@@ -0,0 +1,59 @@
+/**
+ * \file twi_slave.ino
+ * \brief   Footprint configuration: TWI slave receiver and transmitter.
+ *          With FOOTPRINT_GENERAL_CALL general calls are answered by their own handler,
+ *          with FOOTPRINT_RX_FLOW_CONTROL a full receive buffer holds the bus instead of nacking.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "Wire.h"
+
+namespace
+{
+    volatile uint8_t    last    {0};
+
+    void onReceive(int count)
+    {
+        while (count--)
+        {
+            last = Wire.read();
+        }
+    }
+
+#if defined(FOOTPRINT_GENERAL_CALL)
+    void onGeneralCall(int count)
+    {
+        while (count--)
+        {
+            last = (uint8_t)(Wire.read() | 0x80);
+        }
+    }
+#endif
+
+    void onRequest(void)
+    {
+        Wire.write(last);
+    }
+}
+
+void setup(void)
+{
+    Wire.begin(0x42);
+    Wire.onReceive(onReceive);
+    Wire.onRequest(onRequest);
+#if defined(FOOTPRINT_RX_FLOW_CONTROL)
+    Wire.setReceiveFlowControl(true);
+#endif
+#if defined(FOOTPRINT_GENERAL_CALL)
+    Wire.setGeneralCall(true);
+    Wire.onGeneralCall(onGeneralCall);
+#endif
+}
+
+void loop(void)
+{
+}
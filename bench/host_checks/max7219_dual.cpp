@@ -0,0 +1,159 @@
+/**
+ * \file max7219_dual.cpp
+ * \brief   Host check of concurrent refresh of two Max7219 chains on SPI0 and on the master-SPI
+ *          USART (library built with MAX7219_SPI_ASYNC and MAX7219_MSPI_ASYNC). Each chain is
+ *          watched by a Max7219Sim chain on the pins of its peripheral (HostSpi0, HostMspi).
+ *          The same two frames are sent once one after the other and once at the same time;
+ *          the refresh times are measured on the virtual clock. Checked: the concurrent refresh
+ *          takes at most 60% of the sequential one, and both chains, the USART one included,
+ *          receive the expected digits with no framing errors and one LOAD pulse per row.
+ *          Prints one JSON line; exit status is non-zero when a check fails.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include "host_clock.h"
+#include "host_gpio.h"
+#include "host_spi0.h"
+#include "host_mspi.h"
+#include "max7219_sim.h"
+#include "max7219.h"
+
+namespace
+{
+    constexpr uint8_t   chainLength     {4};
+    constexpr uint8_t   spiCsPin        {9};
+    constexpr uint8_t   mspiCsPin       {10};
+    constexpr uint32_t  rows            {Max7219NS::maxDigits};
+
+    constexpr uint8_t   spiDigits[chainLength][Max7219NS::maxDigits]
+    {
+        { 1,  2,  3,  4,  5,  6,  7,  8},
+        { 9, 10, 11, 12, 13, 14, 15, 16},
+        {17, 18, 19, 20, 21, 22, 23, 24},
+        {25, 26, 27, 28, 29, 30, 31, 32},
+    };
+
+    constexpr uint8_t   mspiDigits[chainLength][Max7219NS::maxDigits]
+    {
+        {0x81, 0x42, 0x24, 0x18, 0x18, 0x24, 0x42, 0x81},
+        {0xFF, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0xFF},
+        {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80},
+        {0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01},
+    };
+
+    const Max7219NS::frame_t<chainLength> PROGMEM spiFrame     {Max7219NS::makeFrame(spiDigits)};
+    const Max7219NS::frame_t<chainLength> PROGMEM mspiFrame    {Max7219NS::makeFrame(mspiDigits)};
+
+    uint8_t mismatches(const Max7219Sim &chain, const uint8_t (&digits)[chainLength][Max7219NS::maxDigits])
+    {
+        uint8_t result {0};
+
+        for (uint8_t device = 0; device < chainLength; device++)
+        {
+            for (uint8_t position = 0; position < Max7219NS::maxDigits; position++)
+            {
+                if (digits[device][position] != chain.digit(device, position))
+                {
+                    result++;
+                }
+            }
+        }
+
+        return result;
+    }
+
+    void waitFrames(Max7219 &first, Max7219 &second)
+    {
+        for (uint32_t spin = 0; (spin < 10000000) && (first.isFrameBusy() || second.isFrameBusy()); spin++)
+        {
+            hal_spin();
+        }
+    }
+
+    void blank(Max7219 &display)
+    {
+        for (uint8_t position = 0; position < Max7219NS::maxDigits; position++)
+        {
+            display.write(position, 0x00);
+        }
+    }
+
+    void setup(Max7219NS::context_t &ctx, const uint8_t csPin, const Max7219NS::backend_t backend)
+    {
+        ctx.csbPin = csPin;
+        ctx.numDevices = chainLength;
+        ctx.activeDevice = chainLength;
+        ctx.backend = backend;
+    }
+}
+
+int main(void)
+{
+    HostGpio::reset();
+    HostSpi0::reset();
+    HostMspi::reset();
+    HostSpi0::setIsrCostNs(1000);
+    HostMspi::setIsrCostNs(1000);
+    sei();
+
+    Max7219Sim              spiChain    {spiCsPin, HAL_SPI0_SCK_PIN, HAL_SPI0_MOSI_PIN, chainLength};
+    Max7219Sim              mspiChain   {mspiCsPin, HAL_MSPI_XCK_PIN, HAL_MSPI_TXD_PIN, chainLength};
+    Max7219NS::context_t    spiCtx      {};
+    Max7219NS::context_t    mspiCtx     {};
+    Max7219                 spi         {spiCtx};
+    Max7219                 mspi        {mspiCtx};
+    uint8_t                 failures    {0};
+    uint64_t                start       {0};
+
+    setup(spiCtx, spiCsPin, Max7219NS::BACKEND_SPI_BUFFERED);
+    setup(mspiCtx, mspiCsPin, Max7219NS::BACKEND_USART_MSPI);
+
+    const bool      initialized     {spi.init() && mspi.init()};
+
+    // one after the other
+    start = HostClock::nowNs();
+    failures += spi.writeFrameAsync_P(spiFrame) ? 0 : 1;
+    waitFrames(spi, mspi);
+    failures += mspi.writeFrameAsync_P(mspiFrame) ? 0 : 1;
+    waitFrames(spi, mspi);
+
+    const uint64_t  sequentialNs    {HostClock::nowNs() - start};
+    const uint8_t   sequentialWrong {(uint8_t)(mismatches(spiChain, spiDigits) + mismatches(mspiChain, mspiDigits))};
+
+    blank(spi);
+    blank(mspi);
+
+    // at the same time
+    const uint32_t  spiLoads        {spiChain.frames()};
+    const uint32_t  mspiLoads       {mspiChain.frames()};
+
+    start = HostClock::nowNs();
+    failures += spi.writeFrameAsync_P(spiFrame) ? 0 : 1;
+    failures += mspi.writeFrameAsync_P(mspiFrame) ? 0 : 1;
+    waitFrames(spi, mspi);
+
+    const uint64_t  concurrentNs    {HostClock::nowNs() - start};
+    const uint8_t   concurrentWrong {(uint8_t)(mismatches(spiChain, spiDigits) + mismatches(mspiChain, mspiDigits))};
+    const bool      loadsPerRow     {(rows == (spiChain.frames() - spiLoads)) && (rows == (mspiChain.frames() - mspiLoads))};
+
+    failures += initialized ? 0 : 1;
+    failures += ((0 == sequentialWrong) && (0 == concurrentWrong)) ? 0 : 1;
+    failures += loadsPerRow ? 0 : 1;
+    failures += ((0 == spiChain.framingErrors()) && (0 == mspiChain.framingErrors())) ? 0 : 1;
+    failures += ((0 == HostSpi0::overruns()) && (0 == HostMspi::overruns())) ? 0 : 1;
+    failures += ((10 * concurrentNs) <= (6 * sequentialNs)) ? 0 : 1;
+
+    printf("{\"check\":\"max7219_dual\",\"sequential_us\":%.1f,\"concurrent_us\":%.1f,\"ratio\":%.2f,"
+           "\"digit_mismatches\":%u,\"framing_errors\":%u,\"mspi_bytes\":%u,\"result\":\"%s\"}\n",
+           sequentialNs / 1000.0, concurrentNs / 1000.0, (double)concurrentNs / (double)sequentialNs,
+           sequentialWrong + concurrentWrong, spiChain.framingErrors() + mspiChain.framingErrors(),
+           HostMspi::bytes(), (0 == failures) ? "pass" : "fail");
+
+    return (0 == failures) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,144 @@
+/**
+ * \file max7219_spi0.cpp
+ * \brief   Host check of the buffered-mode SPI0 backend of Max7219 (library built with MAX7219_SPI_ASYNC).
+ *          Two chains share SCK and MOSI of HostSpi0 and have their own LOAD pins; each is
+ *          watched by a Max7219Sim chain. Checked: the second chain is initialized while a frame
+ *          of the first one is sent in the background, and both frames arrive intact; frames
+ *          sent by the interrupts and by writeFrame_P() give the expected digits with no framing
+ *          errors and one LOAD pulse per row; releasing one chain leaves SPI0 working for the other.
+ *          Prints one JSON line; exit status is non-zero when a check fails.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include "host_clock.h"
+#include "host_gpio.h"
+#include "host_spi0.h"
+#include "max7219_sim.h"
+#include "max7219.h"
+
+namespace
+{
+    constexpr uint8_t   chainLength     {4};
+    constexpr uint8_t   firstCsPin      {9};
+    constexpr uint8_t   secondCsPin     {10};
+    constexpr uint32_t  rows            {Max7219NS::maxDigits};
+
+    constexpr uint8_t   firstDigits[chainLength][Max7219NS::maxDigits]
+    {
+        { 1,  2,  3,  4,  5,  6,  7,  8},
+        { 9, 10, 11, 12, 13, 14, 15, 16},
+        {17, 18, 19, 20, 21, 22, 23, 24},
+        {25, 26, 27, 28, 29, 30, 31, 32},
+    };
+
+    constexpr uint8_t   secondDigits[chainLength][Max7219NS::maxDigits]
+    {
+        {0x81, 0x42, 0x24, 0x18, 0x18, 0x24, 0x42, 0x81},
+        {0xFF, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0xFF},
+        {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80},
+        {0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01},
+    };
+
+    const Max7219NS::frame_t<chainLength> PROGMEM firstFrame    {Max7219NS::makeFrame(firstDigits)};
+    const Max7219NS::frame_t<chainLength> PROGMEM secondFrame   {Max7219NS::makeFrame(secondDigits)};
+
+    uint8_t mismatches(const Max7219Sim &chain, const uint8_t (&digits)[chainLength][Max7219NS::maxDigits])
+    {
+        uint8_t result {0};
+
+        for (uint8_t device = 0; device < chainLength; device++)
+        {
+            for (uint8_t position = 0; position < Max7219NS::maxDigits; position++)
+            {
+                if (digits[device][position] != chain.digit(device, position))
+                {
+                    result++;
+                }
+            }
+        }
+
+        return result;
+    }
+
+    void waitFrame(Max7219 &display)
+    {
+        for (uint32_t spin = 0; (spin < 10000000) && display.isFrameBusy(); spin++)
+        {
+            hal_spin();
+        }
+    }
+
+    void setup(Max7219NS::context_t &ctx, const uint8_t csPin)
+    {
+        ctx.csbPin = csPin;
+        ctx.numDevices = chainLength;
+        ctx.activeDevice = chainLength;
+        ctx.backend = Max7219NS::BACKEND_SPI_BUFFERED;
+    }
+}
+
+int main(void)
+{
+    HostGpio::reset();
+    HostSpi0::reset();
+    HostSpi0::setIsrCostNs(1000);
+    sei();
+
+    Max7219Sim              firstChain      {firstCsPin, HAL_SPI0_SCK_PIN, HAL_SPI0_MOSI_PIN, chainLength};
+    Max7219Sim              secondChain     {secondCsPin, HAL_SPI0_SCK_PIN, HAL_SPI0_MOSI_PIN, chainLength};
+    Max7219NS::context_t    firstCtx        {};
+    Max7219NS::context_t    secondCtx       {};
+    Max7219                 first           {firstCtx};
+    Max7219                 second          {secondCtx};
+    uint8_t                 failures        {0};
+
+    setup(firstCtx, firstCsPin);
+    setup(secondCtx, secondCsPin);
+
+    // second chain initialized while the first one sends a frame in the background
+    const bool      firstInit       {first.init()};
+    const uint32_t  framesBefore    {firstChain.frames()};
+    const bool      started         {first.writeFrameAsync_P(firstFrame)};
+    const bool      secondInit      {second.init()};
+
+    waitFrame(first);
+
+    const uint32_t  firstLoads      {firstChain.frames() - framesBefore};
+    const uint8_t   firstWrong      {mismatches(firstChain, firstDigits)};
+    const bool      secondReady     {!secondChain.isShutdown(0) && (0x07 == secondChain.scanLimit(chainLength - 1))};
+
+    // frame of the second chain sent by the interrupts
+    const bool      secondStarted   {second.writeFrameAsync_P(secondFrame)};
+
+    waitFrame(second);
+
+    const uint8_t   secondWrong     {mismatches(secondChain, secondDigits)};
+    const uint8_t   firstKept       {mismatches(firstChain, firstDigits)};
+
+    // the first chain is released, the second one still sends over SPI0
+    first.release();
+
+    const bool      written         {second.writeFrame_P(firstFrame)};
+    const uint8_t   afterRelease    {mismatches(secondChain, firstDigits)};
+
+    failures += (firstInit && started && secondInit && secondStarted && written) ? 0 : 1;
+    failures += (rows == firstLoads) ? 0 : 1;
+    failures += (0 == firstWrong) && (0 == secondWrong) && (0 == firstKept) && (0 == afterRelease) ? 0 : 1;
+    failures += secondReady ? 0 : 1;
+    failures += (0 == firstChain.framingErrors()) && (0 == secondChain.framingErrors()) ? 0 : 1;
+    failures += (0 == HostSpi0::overruns()) ? 0 : 1;
+
+    printf("{\"check\":\"max7219_spi0\",\"loads_per_frame\":%u,\"digit_mismatches\":%u,\"framing_errors\":%u,"
+           "\"overruns\":%u,\"isr_calls\":%u,\"result\":\"%s\"}\n",
+           firstLoads, firstWrong + secondWrong + firstKept + afterRelease,
+           firstChain.framingErrors() + secondChain.framingErrors(), HostSpi0::overruns(), HostSpi0::isrCalls(),
+           (0 == failures) ? "pass" : "fail");
+
+    return (0 == failures) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,94 @@
+/**
+ * \file max7219_spidev.cpp
+ * \brief   Host check of the Linux spidev backend of Max7219.
+ *          The driver is given HostSpidev::ioctl() instead of the system call, so every
+ *          SPI_IOC_MESSAGE batch is played on the simulated pins of a Max7219Sim chain.
+ *          Checked: a whole frame is one ioctl() call, the chain sees no framing errors,
+ *          every digit holds what was written, and release() closes the device.
+ *          Prints one JSON line; exit status is non-zero when a check fails.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include "host_gpio.h"
+#include "host_spidev.h"
+#include "max7219_sim.h"
+#include "max7219.h"
+
+namespace
+{
+    constexpr uint8_t   chainLength     {4};
+    constexpr uint8_t   csPin           {10};
+    constexpr uint8_t   clkPin          {11};
+    constexpr uint8_t   dataPin         {12};
+
+    constexpr uint8_t   digits[chainLength][Max7219NS::maxDigits]
+    {
+        { 1,  2,  3,  4,  5,  6,  7,  8},
+        { 9, 10, 11, 12, 13, 14, 15, 16},
+        {17, 18, 19, 20, 21, 22, 23, 24},
+        {25, 26, 27, 28, 29, 30, 31, 32},
+    };
+
+    const Max7219NS::frame_t<chainLength> PROGMEM frame {Max7219NS::makeFrame(digits)};
+
+    uint8_t mismatches(const Max7219Sim &chain)
+    {
+        uint8_t result {0};
+
+        for (uint8_t device = 0; device < chainLength; device++)
+        {
+            for (uint8_t position = 0; position < Max7219NS::maxDigits; position++)
+            {
+                if (digits[device][position] != chain.digit(device, position))
+                {
+                    result++;
+                }
+            }
+        }
+
+        return result;
+    }
+}
+
+int main(void)
+{
+    HostGpio::reset();
+    HostSpidev::reset(csPin, clkPin, dataPin);
+    HostSpidev::setCallCostNs(5000);
+
+    Max7219Sim              chain   {csPin, clkPin, dataPin, chainLength};
+    Max7219NS::context_t    ctx     {};
+    Max7219                 display {ctx};
+
+    ctx.numDevices = chainLength;
+    ctx.activeDevice = chainLength;
+    ctx.backend = Max7219NS::BACKEND_SPIDEV;
+    ctx.spiDevice = "/dev/null";                                    // opened, never used: transfers go to spiIoctl
+    ctx.spiSpeedHz = 10000000;
+    ctx.spiIoctl = HostSpidev::ioctl;
+
+    const bool      initialized     {display.init()};
+    const uint32_t  callsBefore     {HostSpidev::calls()};
+    const bool      written         {display.writeFrame_P(frame)};
+    const uint32_t  frameCalls      {HostSpidev::calls() - callsBefore};
+    const uint8_t   wrongDigits     {mismatches(chain)};
+
+    display.release();
+
+    const bool      closed          {-1 == ctx.spiFd};
+    const bool      passed          {initialized && written && (1 == frameCalls) && (0 == chain.framingErrors()) &&
+                                     (0 == wrongDigits) && closed};
+
+    printf("{\"check\":\"max7219_spidev\",\"init\":%s,\"calls_per_frame\":%u,\"framing_errors\":%u,"
+           "\"digit_mismatches\":%u,\"closed\":%s,\"result\":\"%s\"}\n",
+           initialized ? "true" : "false", frameCalls, chain.framingErrors(), wrongDigits,
+           closed ? "true" : "false", passed ? "pass" : "fail");
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,116 @@
+/**
+ * \file max7219_usi.cpp
+ * \brief   Host check of the USI three-wire backend of Max7219.
+ *          The driver clocks the chain with HostUsi; a Max7219Sim chain listens on HAL_USI_USCK_PIN
+ *          and HAL_USI_DO_PIN. Checked: init() takes the USI pins, a frame written with
+ *          writeFrame_P() gives the expected digits with no framing errors and one LOAD pulse
+ *          per row, every bit is shifted by the USI, and the last word latched by each chip is
+ *          the last row of the frame.
+ *          Prints one JSON line; exit status is non-zero when a check fails.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include "host_gpio.h"
+#include "host_usi.h"
+#include "max7219_sim.h"
+#include "max7219.h"
+
+namespace
+{
+    constexpr uint8_t   chainLength     {4};
+    constexpr uint8_t   csPin           {3};
+    constexpr uint32_t  rows            {Max7219NS::maxDigits};
+
+    constexpr uint8_t   digits[chainLength][Max7219NS::maxDigits]
+    {
+        { 1,  2,  3,  4,  5,  6,  7,  8},
+        { 9, 10, 11, 12, 13, 14, 15, 16},
+        {17, 18, 19, 20, 21, 22, 23, 24},
+        {25, 26, 27, 28, 29, 30, 31, 32},
+    };
+
+    const Max7219NS::frame_t<chainLength> PROGMEM frame {Max7219NS::makeFrame(digits)};
+
+    uint8_t mismatches(const Max7219Sim &chain)
+    {
+        uint8_t result {0};
+
+        for (uint8_t device = 0; device < chainLength; device++)
+        {
+            for (uint8_t position = 0; position < Max7219NS::maxDigits; position++)
+            {
+                if (digits[device][position] != chain.digit(device, position))
+                {
+                    result++;
+                }
+            }
+        }
+
+        return result;
+    }
+
+    uint8_t lastWordMismatches(const Max7219Sim &chain)
+    {
+        uint8_t result {0};
+
+        for (uint8_t device = 0; device < chainLength; device++)
+        {
+            const uint16_t expected {(uint16_t)((Max7219NS::maxDigits << 8) | digits[device][Max7219NS::maxDigits - 1])};
+
+            if (expected != chain.lastWord(device))
+            {
+                result++;
+            }
+        }
+
+        return result;
+    }
+}
+
+int main(void)
+{
+    HostGpio::reset();
+    HostUsi::reset();
+    HostUsi::setWriteCostNs(125);
+
+    Max7219Sim              chain   {csPin, HAL_USI_USCK_PIN, HAL_USI_DO_PIN, chainLength};
+    Max7219NS::context_t    ctx     {};
+    Max7219                 display {ctx};
+
+    ctx.csbPin = csPin;
+    ctx.numDevices = chainLength;
+    ctx.activeDevice = chainLength;
+    ctx.backend = Max7219NS::BACKEND_USI;
+
+    const bool      initialized     {display.init()};
+    const bool      usiPins         {(HAL_USI_USCK_PIN == ctx.clkPin) && (HAL_USI_DO_PIN == ctx.dataPin)};
+    const uint32_t  loadsBefore     {chain.frames()};
+    const uint32_t  bitsBefore      {chain.bits()};
+    const uint32_t  shiftsBefore    {HostUsi::shifts()};
+    const bool      written         {display.writeFrame_P(frame)};
+    const uint32_t  loads           {chain.frames() - loadsBefore};
+    const uint32_t  bits            {chain.bits() - bitsBefore};
+    const uint32_t  shifts          {HostUsi::shifts() - shiftsBefore};
+    const uint8_t   wrongDigits     {mismatches(chain)};
+    const uint8_t   wrongWords      {lastWordMismatches(chain)};
+    const uint32_t  frameBits       {rows * chainLength * 16};
+
+    display.release();
+
+    const bool      passed          {initialized && usiPins && written && (rows == loads) && (frameBits == bits) &&
+                                     (frameBits == shifts) && (0 == chain.framingErrors()) && (0 == wrongDigits) &&
+                                     (0 == wrongWords)};
+
+    printf("{\"check\":\"max7219_usi\",\"init\":%s,\"loads_per_frame\":%u,\"bits_per_frame\":%u,\"usi_shifts\":%u,"
+           "\"framing_errors\":%u,\"digit_mismatches\":%u,\"word_mismatches\":%u,\"result\":\"%s\"}\n",
+           initialized ? "true" : "false", loads, bits, shifts, chain.framingErrors(), wrongDigits, wrongWords,
+           passed ? "pass" : "fail");
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
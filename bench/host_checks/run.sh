@@ -0,0 +1,53 @@
+#!/bin/sh
+#
+# Functional checks of driver backends on the host simulation. Every check is built together
+# with the libraries and host_sim, runs in virtual time and prints one JSON line.
+# The script exits with an error when any check fails.
+#
+# Requirements: C and C++ compilers for the host.
+#
+# Environment:
+#   BUILD_DIR       build directory            (default: <repo>/_bench_build/host_checks)
+#   CC, CXX         host compilers             (default: cc, c++)
+#
+# SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+# SPDX-License-Identifier: MIT
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/../.." && pwd)
+HERE="$ROOT/bench/host_checks"
+BUILD_DIR=${BUILD_DIR:-"$ROOT/_bench_build/host_checks"}
+CC=${CC:-cc}
+CXX=${CXX:-c++}
+INCLUDES="-I$ROOT/hal -I$ROOT/host_sim -I$ROOT/profiler -I$ROOT/scheduler -I$ROOT/max7219 -I$ROOT/mcp402x \
+    -I$ROOT/i2c_helper -I$ROOT/wire_avr_one_buffer"
+
+mkdir -p "$BUILD_DIR"
+cd "$BUILD_DIR"
+
+failed=0
+
+# builds check program $1 from $2 (<source>.cpp) with the flags and sources given after them and runs it
+check()
+{
+    name=$1
+    source=$2
+    shift 2
+    $CXX -O2 -std=c++17 -o "$name" $INCLUDES "$HERE/$source.cpp" "$ROOT"/host_sim/*.cpp "$@"
+    ./"$name" || failed=1
+}
+
+# the TWI backends are C sources
+$CC -O2 -c $INCLUDES -o twi.o "$ROOT/wire_avr_one_buffer/utility/twi.c"
+$CC -O2 -c $INCLUDES -DTWI_BACKEND_MEGA0 -o twi_mega0.o "$ROOT/wire_avr_one_buffer/utility/twi_mega0.c"
+
+check max7219_spidev max7219_spidev "$ROOT/max7219/max7219.cpp" "$ROOT/profiler/profiler.cpp"
+check max7219_usi max7219_usi "$ROOT/max7219/max7219.cpp" "$ROOT/profiler/profiler.cpp"
+check max7219_spi0 max7219_spi0 -DMAX7219_SPI_ASYNC "$ROOT/max7219/max7219.cpp" "$ROOT/profiler/profiler.cpp"
+check max7219_dual max7219_dual -DMAX7219_SPI_ASYNC -DMAX7219_MSPI_ASYNC "$ROOT/max7219/max7219.cpp" \
+    "$ROOT/profiler/profiler.cpp"
+check twi_backend twi_backend twi.o
+check twi0_backend twi_backend -DTWI_BACKEND_MEGA0 twi_mega0.o
+
+exit $failed
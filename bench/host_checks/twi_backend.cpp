@@ -0,0 +1,238 @@
+/**
+ * \file twi_backend.cpp
+ * \brief   Host check of the TWI master/slave backends of wire_avr_one_buffer.
+ *          Built once with utility/twi.c (classic TWI, host_twi) and once with TWI_BACKEND_MEGA0
+ *          and utility/twi_mega0.c (megaAVR-0 / AVR-Dx TWI0, host_twi0). The same transactions
+ *          are run on both and must give the same results: interrupt and polled writes and reads,
+ *          missing device, 10-bit addressing, async read of a present and of a missing device and
+ *          slave receive. The quick command (zero-length twi_startReadFrom()) is only available with TWI0.
+ *          Interrupt counts of the write and of the read are reported for comparison.
+ *          Prints one JSON line; exit status is non-zero when a check fails.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "host_clock.h"
+#include "host_gpio.h"
+#include "host_twi.h"
+
+extern "C"
+{
+    #include "utility/twi.h"
+}
+
+#if defined(TWI_BACKEND_MEGA0)
+    #include "host_twi0.h"
+
+    namespace Bus = HostTwi0;
+    #define BACKEND_NAME        "twi0"
+#else
+    namespace Bus = HostTwi;
+    #define BACKEND_NAME        "twi"
+#endif
+
+namespace
+{
+    constexpr uint8_t   memoryAddress       {0x50};
+    constexpr uint16_t  memory10Address     {0x250};
+    constexpr uint8_t   missingAddress      {0x51};
+    constexpr uint8_t   slaveAddress        {0x30};
+
+    /**
+     * \brief Register file: the first written byte selects the register, following ones are stored.
+    **/
+    class Memory : public HostTwi::Device
+    {
+    public:
+        uint8_t     registers[256]  {};
+        uint8_t     pointer         {0};
+        bool        first           {true};
+
+        Memory(void)
+        {
+            for (uint16_t idx = 0; idx < sizeof(registers); idx++)
+            {
+                registers[idx] = (uint8_t)idx;
+            }
+        }
+
+        bool onAddress(const bool read) override
+        {
+            first = !read;
+
+            return true;
+        }
+
+        bool onWrite(const uint8_t data) override
+        {
+            if (first)
+            {
+                pointer = data;
+                first = false;
+            } else
+            {
+                registers[pointer++] = data;
+            }
+
+            return true;
+        }
+
+        uint8_t onRead(void) override
+        {
+            return registers[pointer++];
+        }
+    };
+
+    uint8_t             failures            {0};
+    volatile bool       completed           {false};
+    uint8_t             completedResult     {0};
+    uint8_t             completedCount      {0};
+    uint8_t             receivedLength      {0};
+    uint8_t             receivedFirst       {0};
+
+    void expect(const bool condition, const char *what)
+    {
+        if (!condition)
+        {
+            fprintf(stderr, "%s: %s failed\n", BACKEND_NAME, what);
+            failures++;
+        }
+    }
+
+    void onComplete(uint8_t result, uint8_t count)
+    {
+        completedResult = result;
+        completedCount = count;
+        completed = true;
+    }
+
+    void onReceive(uint8_t *data, int length)
+    {
+        receivedLength = (uint8_t)length;
+        receivedFirst = data[0];
+    }
+
+    void waitCompleted(void)
+    {
+        for (uint32_t spin = 0; (spin < 1000000) && !completed; spin++)
+        {
+            hal_spin();
+        }
+    }
+
+    void runFor(const uint64_t ns)
+    {
+        const uint64_t end {HostClock::nowNs() + ns};
+
+        while (HostClock::nowNs() < end)
+        {
+            hal_spin();
+        }
+    }
+}
+
+int main(void)
+{
+    Memory  memory;
+    Memory  memory10;
+    uint8_t buffer[16]      {};
+    uint8_t data[3]         {0x10, 0xAA, 0xBB};
+    uint8_t data10[3]       {0x20, 0x77, 0x88};
+    uint8_t slaveData[4]    {0xA1, 0x02, 0x03, 0x04};
+    uint32_t isrs           {0};
+    uint32_t writeIsrs      {0};
+    uint32_t readIsrs       {0};
+    uint8_t count           {0};
+    uint8_t status          {0};
+
+    HostGpio::reset();
+    HostTwi::reset();
+#if defined(TWI_BACKEND_MEGA0)
+    HostTwi0::reset();
+#endif
+    HostTwi::attach(memoryAddress, &memory);
+    HostTwi::attach10(memory10Address, &memory10);
+    sei();
+
+    twi_init();
+    twi_setFrequency(100000);
+    twi_setPolledLength(0);
+
+    // interrupt driven write and read
+    isrs = Bus::isrCalls();
+    expect(0 == twi_writeTo(memoryAddress, data, sizeof(data), true, true), "write");
+    writeIsrs = Bus::isrCalls() - isrs;
+    expect((0xAA == memory.registers[0x10]) && (0xBB == memory.registers[0x11]), "written data");
+
+    twi_writeTo(memoryAddress, data, 1, true, false);
+    isrs = Bus::isrCalls();
+    count = twi_readFrom(memoryAddress, buffer, 8, true);
+    readIsrs = Bus::isrCalls() - isrs;
+    expect((8 == count) && (0xAA == buffer[0]) && (0xBB == buffer[1]) && (0x12 == buffer[2]), "read");
+
+    // missing device
+    expect(0 == twi_readFrom(missingAddress, buffer, 2, true), "missing read");
+    expect(2 == twi_writeTo(missingAddress, data, 1, true, true), "missing write");
+
+    // polled fast path: no interrupt at all
+    twi_setPolledLength(2);
+    twi_writeTo(memoryAddress, data, 1, true, false);
+    isrs = Bus::isrCalls();
+    count = twi_readFrom(memoryAddress, buffer, 2, true);
+    expect((2 == count) && (0xAA == buffer[0]) && (0xBB == buffer[1]) && (isrs == Bus::isrCalls()), "polled read");
+    expect(2 == twi_writeTo(missingAddress, data, 1, true, true), "polled missing write");
+    twi_setPolledLength(0);
+
+    // 10-bit addressing
+    expect(0 == twi_writeTo(memory10Address | TWI_ADDRESS_10BIT, data10, sizeof(data10), true, true), "10-bit write");
+    twi_writeTo(memory10Address | TWI_ADDRESS_10BIT, data10, 1, true, false);
+    count = twi_readFrom(memory10Address | TWI_ADDRESS_10BIT, buffer, 2, true);
+    expect((2 == count) && (0x77 == buffer[0]) && (0x88 == buffer[1]), "10-bit read");
+
+    // async read completed from the interrupt
+    twi_attachMasterCompleteEvent(onComplete);
+    twi_writeTo(memoryAddress, data, 1, true, true);
+    completed = false;
+    status = twi_startReadFrom(memoryAddress, 4, true);
+    waitCompleted();
+    expect((0 == status) && completed && (0 == completedResult) && (4 == completedCount) &&
+           (0xAA == twi_getBufferHandle()[0]), "async read");
+    completed = false;
+    status = twi_startReadFrom(missingAddress, 4, true);
+    waitCompleted();
+    expect((0 == status) && completed && (2 == completedResult) && (0 == completedCount), "async missing read");
+
+    // quick command: address only
+    completed = false;
+    status = twi_startReadFrom(memoryAddress, 0, true);
+    waitCompleted();
+#if defined(TWI_BACKEND_MEGA0)
+    expect((0 == status) && completed && (0 == completedResult), "quick command present");
+    completed = false;
+    status = twi_startReadFrom(missingAddress, 0, true);
+    waitCompleted();
+    expect((0 == status) && completed && (2 == completedResult), "quick command missing");
+#else
+    expect((1 == status) && !completed, "quick command rejected");
+#endif
+    twi_attachMasterCompleteEvent(nullptr);
+
+    // slave receive from an external master
+    twi_setAddress(slaveAddress);
+    twi_attachSlaveRxEvent(onReceive);
+    Bus::externalWrite(slaveAddress, slaveData, sizeof(slaveData));
+    runFor(2000000);
+    expect(!Bus::externalBusy() && (4 == receivedLength) && (0xA1 == receivedFirst), "slave receive");
+
+    printf("{\"check\":\"twi_backend\",\"backend\":\"%s\",\"write3_isrs\":%u,\"read8_isrs\":%u,"
+           "\"failures\":%u,\"result\":\"%s\"}\n",
+           BACKEND_NAME, writeIsrs, readIsrs, failures, (0 == failures) ? "pass" : "fail");
+
+    return (0 == failures) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,452 @@
+/**
+ * \file node_scenario.cpp
+ * \brief   Whole-node scenario benchmark on the host simulation (virtual time).
+ *          Node: 10 I2C sensors of mixed speed, 24LC256-like EEPROM logger, chain of 16 MAX7219
+ *          modules and 4 MCP402x potentiometers, driven by the cooperative scheduler from a main loop.
+ *          Reports main-loop latency percentiles, I2C bus utilisation and CPU budget per library
+ *          as one JSON document, and checks the simulated chips against what the drivers were told.
+ *
+ *          Workload is configured with key=value arguments, e.g.:
+ *              node_scenario duration_ms=10000 i2c_hz=100000 display_hz=25
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "host_gpio.h"
+#include "host_twi.h"
+#include "max7219_sim.h"
+#include "mcp402x_sim.h"
+#include "i2c.h"
+#include "max7219.h"
+#include "mcp402x.h"
+#include "scheduler.h"
+
+namespace
+{
+    constexpr uint8_t   sensorCount         {10};
+    constexpr uint8_t   potCount            {4};
+    constexpr uint8_t   chainLength         {16};
+    constexpr uint8_t   eepromAddress       {0x50};
+    constexpr uint8_t   sensorBaseAddress   {0x40};
+    constexpr uint8_t   logRecordSize       {16};
+
+    /**
+     * \brief Workload parameters; every field can be overridden from the command line.
+    **/
+    typedef struct
+    {
+        uint32_t    duration_ms     {5000};
+        uint32_t    i2c_hz          {400000};
+        uint32_t    display_hz      {10};
+        uint32_t    log_ms          {100};
+        uint32_t    pot_ms          {50};
+        uint32_t    sensor_scale    {100};             // sensor periods in percent of the defaults below
+        uint32_t    gpio_write_ns   {125};             // cost of a single pin write (2 cycles at 16 MHz)
+        uint32_t    poll_ns         {500};             // cost of a single pass of a busy-wait loop
+    } config_t;
+
+    /**
+     * \brief Library to which time spent in a task is charged.
+    **/
+    typedef enum : uint8_t
+    {
+        LIB_I2C         = 0,
+        LIB_MAX7219,
+        LIB_MCP402X,
+        LIB_SCHEDULER,
+        LIB_COUNT,
+    } library_t;
+
+    const char * const libraryNames[LIB_COUNT] {"i2c", "max7219", "mcp402x", "scheduler"};
+
+    /**
+     * \brief Sensor with 8-bit register pointer; slow sensors stretch the clock before every byte.
+    **/
+    class SensorSim : public HostTwi::Device
+    {
+    public:
+        uint32_t    stretch     {0};
+        uint8_t     pointer     {0};
+        bool        addressed   {false};
+        uint32_t    reads       {0};
+
+        bool onAddress(const bool read) override
+        {
+            addressed = !read;
+            reads += read ? 1 : 0;
+
+            return true;
+        }
+
+        bool onWrite(const uint8_t data) override
+        {
+            if (addressed)
+            {
+                pointer = data;
+                addressed = false;
+            }
+
+            return true;
+        }
+
+        uint8_t onRead(void) override
+        {
+            return (uint8_t)(pointer++ + (HostClock::nowNs() >> 20));   // slowly changing "measurement"
+        }
+
+        uint32_t stretchNs(void) override
+        {
+            return stretch;
+        }
+    };
+
+    /**
+     * \brief   24LC256-like EEPROM: 16-bit address, 64-byte pages, the device does not
+     *          acknowledge its address during the 5 ms write cycle.
+    **/
+    class EepromSim : public HostTwi::Device
+    {
+    public:
+        uint8_t     memory[32768]   {};
+        uint16_t    pointer         {0};
+        uint8_t     addressBytes    {0};
+        bool        written         {false};
+        uint64_t    busyUntilNs     {0};
+        uint32_t    pageWrites      {0};
+        uint32_t    busyNacks       {0};
+
+        bool onAddress(const bool read) override
+        {
+            bool result {HostClock::nowNs() >= busyUntilNs};
+
+            busyNacks += result ? 0 : 1;
+            addressBytes = read ? 2 : 0;
+            written = false;
+
+            return result;
+        }
+
+        bool onWrite(const uint8_t data) override
+        {
+            if (addressBytes < 2)
+            {
+                pointer = (uint16_t)(((pointer << 8) | data) & 0x7FFF);
+                addressBytes++;
+            } else
+            {
+                memory[pointer] = data;
+                pointer = (uint16_t)((pointer & 0x7FC0) | ((pointer + 1) & 0x003F));   // wraps within the page
+                written = true;
+            }
+
+            return true;
+        }
+
+        uint8_t onRead(void) override
+        {
+            uint8_t result {memory[pointer]};
+
+            pointer = (uint16_t)((pointer + 1) & 0x7FFF);
+
+            return result;
+        }
+
+        void onStop(void) override
+        {
+            if (written)
+            {
+                written = false;
+                pageWrites++;
+                busyUntilNs = HostClock::nowNs() + 5000000ULL;
+            }
+        }
+    };
+
+    config_t                config                      {};
+    uint64_t                libraryNs[LIB_COUNT]        {};
+    std::vector<uint32_t>   loopNs                      {};
+    std::vector<uint32_t>   busyLoopNs                  {};        // iterations which executed a task
+
+    SensorSim               sensors[sensorCount]        {};
+    EepromSim               eeprom                      {};
+    const uint16_t          sensorPeriodMs[sensorCount] {5, 10, 10, 20, 50, 50, 100, 100, 200, 1000};
+    const uint8_t           sensorReadLen[sensorCount]  {6, 2, 2, 4, 6, 3, 2, 2, 8, 2};
+    const uint32_t          sensorStretch[sensorCount]  {0, 0, 2000, 0, 10000, 0, 0, 50000, 0, 0};
+    uint8_t                 sensorData[sensorCount][8]  {};
+    uint8_t                 sensorRegister[sensorCount] {};
+    I2C::context_t          sensorCtx[sensorCount]      {};
+    uint32_t                sensorErrors                {0};
+
+    uint8_t                 logBuffer[2 + logRecordSize]    {};
+    I2C::context_t          logCtx                      {};
+    uint16_t                logPointer                  {0};
+    uint32_t                logRecords                  {0};
+    uint32_t                logRetries                  {0};
+
+    Max7219NS::context_t    displayCtx                  {};
+    Max7219                 display                     {displayCtx};
+    uint8_t                 displayFrame                {0};
+
+    Mcp402xNS::context_t    potCtx[potCount]            {};
+    Mcp402x                 pots[potCount]              {{potCtx[0]}, {potCtx[1]}, {potCtx[2]}, {potCtx[3]}};
+    uint8_t                 potTarget[potCount]         {};
+
+    SchedulerNS::task_t     tasks[sensorCount + 4]      {};
+    Scheduler               scheduler                   {tasks, sensorCount + 4};
+    SchedulerNS::taskId_t   logTask                     {SchedulerNS::invalidTask};
+
+    /**
+     * \brief Charges time elapsed since 'startNs' to the library.
+    **/
+    void charge(const library_t library, const uint64_t startNs)
+    {
+        libraryNs[library] += HostClock::nowNs() - startNs;
+    }
+
+    void readSensor(void *arg)
+    {
+        const uint8_t   idx     {(uint8_t)(uintptr_t)arg};
+        const uint64_t  start   {HostClock::nowNs()};
+
+        if (I2C::SUCCESS != I2C::writeThenReadBytes(&sensorCtx[idx]))
+        {
+            sensorErrors++;
+        }
+        charge(LIB_I2C, start);
+    }
+
+    void writeLog(void *arg)
+    {
+        const uint64_t start {HostClock::nowNs()};
+
+        (void)arg;
+        logBuffer[0] = (uint8_t)(logPointer >> 8);
+        logBuffer[1] = (uint8_t)(logPointer & 0xFF);
+        for (uint8_t idx = 0; idx < logRecordSize; idx++)
+        {
+            logBuffer[2 + idx] = sensorData[idx % sensorCount][0];
+        }
+        if (I2C::SUCCESS == I2C::writeBytes(&logCtx))
+        {
+            logPointer = (uint16_t)((logPointer + logRecordSize) & 0x7FFF);
+            logRecords++;
+        } else
+        {
+            logRetries++;                                           // EEPROM busy with previous page - retry soon
+            scheduler.reschedule(logTask, 1);
+        }
+        charge(LIB_I2C, start);
+    }
+
+    void refreshDisplay(void *arg)
+    {
+        const uint64_t start {HostClock::nowNs()};
+
+        (void)arg;
+        displayFrame++;
+        for (uint8_t position = 0; position < Max7219NS::maxDigits; position++)
+        {
+            do
+            {
+                display.write(position, (uint8_t)(displayFrame + position + displayCtx.activeDevice));
+            } while (display.isChainBusy());
+        }
+        charge(LIB_MAX7219, start);
+    }
+
+    void rampPots(void *arg)
+    {
+        const uint64_t start {HostClock::nowNs()};
+
+        (void)arg;
+        for (uint8_t idx = 0; idx < potCount; idx++)
+        {
+            potTarget[idx] = (uint8_t)((potTarget[idx] + 1 + idx) % (Mcp402xNS::maxValue + 1));
+            pots[idx].set(potTarget[idx]);
+        }
+        charge(LIB_MCP402X, start);
+    }
+
+    void parse(const int argc, char *argv[])
+    {
+        struct
+        {
+            const char  *name;
+            uint32_t    *value;
+        } const options[]
+        {
+            {"duration_ms",     &config.duration_ms},
+            {"i2c_hz",          &config.i2c_hz},
+            {"display_hz",      &config.display_hz},
+            {"log_ms",          &config.log_ms},
+            {"pot_ms",          &config.pot_ms},
+            {"sensor_scale",    &config.sensor_scale},
+            {"gpio_write_ns",   &config.gpio_write_ns},
+            {"poll_ns",         &config.poll_ns},
+        };
+
+        for (int arg = 1; arg < argc; arg++)
+        {
+            const char *separator {strchr(argv[arg], '=')};
+            bool        known     {false};
+
+            for (const auto &option : options)
+            {
+                if ((nullptr != separator) && (strlen(option.name) == (size_t)(separator - argv[arg])) &&
+                    (0 == strncmp(option.name, argv[arg], (size_t)(separator - argv[arg]))))
+                {
+                    *option.value = (uint32_t)strtoul(separator + 1, nullptr, 0);
+                    known = true;
+                }
+            }
+            if (!known)
+            {
+                fprintf(stderr, "unknown option: %s\n", argv[arg]);
+                exit(1);
+            }
+        }
+    }
+
+    uint32_t percentile(const std::vector<uint32_t> &sorted, const double fraction)
+    {
+        size_t idx {(size_t)(fraction * (double)(sorted.size() - 1) + 0.5)};
+
+        return sorted.empty() ? 0 : sorted[idx];
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    parse(argc, argv);
+
+    HostGpio::reset();
+    HostTwi::reset();
+    HostGpio::setWriteCostNs(config.gpio_write_ns);
+    HostClock::setPollCostNs(config.poll_ns);
+
+    Max7219Sim  chain       {10, 11, 12, chainLength};
+    Mcp402xSim  potSims[potCount]
+    {
+        {2, 3, 0}, {4, 5, 0}, {6, 7, 0}, {8, 9, 0},
+    };
+
+    Wire.begin();
+    Wire.setClock(config.i2c_hz);
+    Wire.setWireTimeout(25000, true);
+
+    for (uint8_t idx = 0; idx < sensorCount; idx++)
+    {
+        uint32_t period {std::max<uint32_t>(1, sensorPeriodMs[idx] * config.sensor_scale / 100)};
+
+        sensors[idx].stretch = sensorStretch[idx];
+        HostTwi::attach((uint8_t)(sensorBaseAddress + idx), &sensors[idx]);
+        sensorCtx[idx] = {&Wire, &sensorRegister[idx], sensorData[idx], (uint8_t)(sensorBaseAddress + idx),
+                          1, sensorReadLen[idx], false, true, I2C::ADDRESS_7BIT, 0, 0};
+        scheduler.every(period, readSensor, (void *)(uintptr_t)idx, idx);
+    }
+    HostTwi::attach(eepromAddress, &eeprom);
+    logCtx = {&Wire, logBuffer, nullptr, eepromAddress, sizeof(logBuffer), 0, true, true, I2C::ADDRESS_7BIT, 0, 0};
+    logTask = scheduler.every(std::max<uint32_t>(1, config.log_ms), writeLog);
+
+    displayCtx.csbPin = 10;
+    displayCtx.clkPin = 11;
+    displayCtx.dataPin = 12;
+    displayCtx.numDevices = chainLength;
+    displayCtx.activeDevice = chainLength;
+    display.init();
+    if (0 != config.display_hz)
+    {
+        scheduler.every(std::max<uint32_t>(1, 1000 / config.display_hz), refreshDisplay);
+    }
+
+    for (uint8_t idx = 0; idx < potCount; idx++)
+    {
+        potCtx[idx].csPin = (uint8_t)(2 + 2 * idx);
+        potCtx[idx].udPin = (uint8_t)(3 + 2 * idx);
+        pots[idx].init();
+        pots[idx].updateWiperValue(0);
+    }
+    scheduler.every(std::max<uint32_t>(1, config.pot_ms), rampPots);
+
+    // main loop: one scheduler pass per iteration, iteration time is the loop latency
+    const uint64_t  startNs     {HostClock::nowNs()};
+    const uint64_t  endNs       {startNs + (uint64_t)config.duration_ms * 1000000ULL};
+    const uint64_t  busyStartNs {HostTwi::busyNs()};
+    uint64_t        idleNs      {0};
+
+    while (HostClock::nowNs() < endNs)
+    {
+        const uint64_t  loopStart   {HostClock::nowNs()};
+        const uint64_t  tasksBefore {libraryNs[LIB_I2C] + libraryNs[LIB_MAX7219] + libraryNs[LIB_MCP402X]};
+        uint64_t        spentNs;
+        uint64_t        inTasksNs;
+
+        if (0 != scheduler.run())
+        {
+            spentNs = HostClock::nowNs() - loopStart;
+            inTasksNs = libraryNs[LIB_I2C] + libraryNs[LIB_MAX7219] + libraryNs[LIB_MCP402X] - tasksBefore;
+            libraryNs[LIB_SCHEDULER] += spentNs - inTasksNs;        // selection of the task and polling of the time
+            busyLoopNs.push_back((uint32_t)spentNs);
+        } else
+        {
+            spentNs = HostClock::nowNs() - loopStart;
+            idleNs += spentNs;                                      // nothing was due
+        }
+        loopNs.push_back((uint32_t)spentNs);
+    }
+
+    // consistency of the simulated chips with the drivers' view
+    uint32_t mismatches {0};
+
+    for (uint8_t idx = 0; idx < potCount; idx++)
+    {
+        mismatches += (potSims[idx].wiper() != pots[idx].get()) ? 1 : 0;
+    }
+    mismatches += chain.framingErrors();
+
+    const uint64_t  elapsedNs   {HostClock::nowNs() - startNs};
+    const uint64_t  busNs       {HostTwi::busyNs() - busyStartNs};
+    uint32_t        violations  {0};
+
+    for (auto &pot : potSims)
+    {
+        violations += pot.violations();
+    }
+    std::sort(loopNs.begin(), loopNs.end());
+    std::sort(busyLoopNs.begin(), busyLoopNs.end());
+
+    printf("{\"scenario\":\"node\",\"duration_ms\":%u,\"i2c_hz\":%u,\"display_hz\":%u,\"log_ms\":%u,\"pot_ms\":%u,"
+           "\"sensor_scale\":%u,\n",
+           config.duration_ms, config.i2c_hz, config.display_hz, config.log_ms, config.pot_ms, config.sensor_scale);
+    printf(" \"loop_latency_us\":{\"n\":%zu,\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f},\n",
+           loopNs.size(), percentile(loopNs, 0.50) / 1000.0, percentile(loopNs, 0.90) / 1000.0,
+           percentile(loopNs, 0.99) / 1000.0, percentile(loopNs, 0.999) / 1000.0,
+           (loopNs.empty() ? 0 : loopNs.back()) / 1000.0);
+    printf(" \"busy_loop_latency_us\":{\"n\":%zu,\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f},\n",
+           busyLoopNs.size(), percentile(busyLoopNs, 0.50) / 1000.0, percentile(busyLoopNs, 0.90) / 1000.0,
+           percentile(busyLoopNs, 0.99) / 1000.0, percentile(busyLoopNs, 0.999) / 1000.0,
+           (busyLoopNs.empty() ? 0 : busyLoopNs.back()) / 1000.0);
+    printf(" \"i2c\":{\"utilisation\":%.4f,\"transactions\":%u,\"bytes\":%u,\"sensor_errors\":%u,"
+           "\"log_records\":%u,\"log_retries\":%u,\"eeprom_busy_nacks\":%u},\n",
+           (double)busNs / (double)elapsedNs, HostTwi::transactions(), HostTwi::bytes(), sensorErrors,
+           logRecords, logRetries, eeprom.busyNacks);
+    printf(" \"cpu_budget\":{");
+    for (uint8_t lib = 0; lib < LIB_COUNT; lib++)
+    {
+        printf("\"%s\":%.4f,", libraryNames[lib], (double)libraryNs[lib] / (double)elapsedNs);
+    }
+    printf("\"idle\":%.4f},\n", (double)idleNs / (double)elapsedNs);
+    printf(" \"checks\":{\"display_frames\":%u,\"display_framing_errors\":%u,\"pot_mismatches\":%u,"
+           "\"pot_timing_violations\":%u}}\n",
+           chain.frames(), chain.framingErrors(), mismatches - chain.framingErrors(), violations);
+
+    return (0 == mismatches) ? 0 : 2;
+}
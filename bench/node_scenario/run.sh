@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+# Whole-node scenario benchmark on the host simulation (see node_scenario.cpp).
+# Builds the scenario together with the libraries and host_sim, runs it in virtual time
+# and prints results as one JSON document. Arguments are passed to the scenario,
+# e.g. ./run.sh duration_ms=10000 i2c_hz=100000 display_hz=25
+#
+# Requirements: C and C++ compilers for the host.
+#
+# Environment:
+#   BUILD_DIR       build directory            (default: <repo>/_bench_build/node_scenario)
+#   CC, CXX         host compilers             (default: cc, c++)
+#
+# SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+# SPDX-License-Identifier: MIT
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/../.." && pwd)
+HERE="$ROOT/bench/node_scenario"
+BUILD_DIR=${BUILD_DIR:-"$ROOT/_bench_build/node_scenario"}
+CC=${CC:-cc}
+CXX=${CXX:-c++}
+INCLUDES="-I$ROOT/hal -I$ROOT/host_sim -I$ROOT/profiler -I$ROOT/scheduler -I$ROOT/max7219 -I$ROOT/mcp402x \
+    -I$ROOT/i2c_helper -I$ROOT/wire_avr_one_buffer"
+
+mkdir -p "$BUILD_DIR"
+cd "$BUILD_DIR"
+
+$CC -O2 -c $INCLUDES "$ROOT/wire_avr_one_buffer/utility/twi.c" -o twi.o
+$CXX -O2 -std=c++17 -o node_scenario $INCLUDES twi.o \
+    "$HERE/node_scenario.cpp" \
+    "$ROOT"/host_sim/*.cpp \
+    "$ROOT/profiler/profiler.cpp" \
+    "$ROOT/scheduler/scheduler.cpp" \
+    "$ROOT/max7219/max7219.cpp" \
+    "$ROOT/mcp402x/mcp402x.cpp" \
+    "$ROOT/i2c_helper/i2c.cpp" \
+    "$ROOT/wire_avr_one_buffer/Wire.cpp"
+
+./node_scenario "$@"
@@ -0,0 +1,1341 @@
+/**
+ * \file hal.h
+ * \brief   Thin hardware abstraction layer for GPIO, delays, time, TWI (classic and megaAVR-0),
+ *          USI, SPI and USART master SPI (megaAVR-0) registers,
+ *          and Linux spidev devices.
+ *          All functions are static inline, so there is no call overhead compared to
+ *          using the Arduino core or AVR registers directly. Usable from C and C++.
+ *
+ *          Backend is selected at compile time:
+ *          HAL_BACKEND_AVR_DIRECT  - direct port access on AVR (default when __AVR__ is defined)
+ *          HAL_BACKEND_ARDUINO     - Arduino core functions (default on other Arduino targets)
+ *          HAL_BACKEND_HOST        - host simulation (default otherwise, see host_sim)
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#if !defined(HAL_BACKEND_AVR_DIRECT) && !defined(HAL_BACKEND_ARDUINO) && !defined(HAL_BACKEND_HOST)
+    #if defined(__AVR__)
+        #define HAL_BACKEND_AVR_DIRECT
+    #elif defined(ARDUINO)
+        #define HAL_BACKEND_ARDUINO
+    #else
+        #define HAL_BACKEND_HOST
+    #endif
+#endif
+
+#include <Arduino.h>
+
+#if defined(__AVR__)
+    #include <avr/io.h>
+    #include <avr/interrupt.h>
+#elif defined(HAL_BACKEND_HOST)
+    #include <avr/io.h>                                             // bit positions of the simulated peripherals
+#endif
+
+#if defined(__linux__)
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/ioctl.h>
+    #include <linux/spi/spidev.h>
+
+    #define HAL_HAS_SPIDEV
+#endif
+
+/**
+ * \brief   Identifiers of TWI registers. On AVR they are resolved at compile time
+ *          to a single register access, on host they are routed to the simulated peripheral.
+**/
+typedef enum
+{
+    HAL_TWBR    = 0x00,
+    HAL_TWSR    = 0x01,
+    HAL_TWAR    = 0x02,
+    HAL_TWDR    = 0x03,
+    HAL_TWCR    = 0x04,
+    HAL_TWAMR   = 0x05,
+} hal_twiReg_t;
+
+/**
+ * \brief   Identifiers of registers of the TWI peripheral of megaAVR-0, tinyAVR-0/1/2 and AVR-Dx
+ *          parts (TWI0: separate master and slave with MSTATUS/MDATA, smart mode, quick command),
+ *          resolved the same way as the TWI ones.
+**/
+typedef enum
+{
+    HAL_TWI0_MCTRLA     = 0x00,
+    HAL_TWI0_MCTRLB     = 0x01,
+    HAL_TWI0_MSTATUS    = 0x02,
+    HAL_TWI0_MBAUD      = 0x03,
+    HAL_TWI0_MADDR      = 0x04,
+    HAL_TWI0_MDATA      = 0x05,
+    HAL_TWI0_SCTRLA     = 0x06,
+    HAL_TWI0_SCTRLB     = 0x07,
+    HAL_TWI0_SSTATUS    = 0x08,
+    HAL_TWI0_SADDR      = 0x09,
+    HAL_TWI0_SDATA      = 0x0A,
+    HAL_TWI0_SADDRMASK  = 0x0B,
+} hal_twi0Reg_t;
+
+/**
+ * \brief   Identifiers of USI registers (Universal Serial Interface of ATtiny parts), resolved
+ *          the same way as the TWI ones.
+**/
+typedef enum
+{
+    HAL_USIDR   = 0x00,
+    HAL_USISR   = 0x01,
+    HAL_USICR   = 0x02,
+} hal_usiReg_t;
+
+/**
+ * \brief   Identifiers of registers of the SPI peripheral of megaAVR-0, tinyAVR-0/1/2 and AVR-Dx
+ *          parts (SPI0, with buffered mode), resolved the same way as the TWI ones.
+**/
+typedef enum
+{
+    HAL_SPI0_CTRLA      = 0x00,
+    HAL_SPI0_CTRLB      = 0x01,
+    HAL_SPI0_INTCTRL    = 0x02,
+    HAL_SPI0_INTFLAGS   = 0x03,
+    HAL_SPI0_DATA       = 0x04,
+} hal_spi0Reg_t;
+
+/**
+ * \brief   Identifiers of registers of the USART of megaAVR-0, tinyAVR-0/1/2 and AVR-Dx parts
+ *          used in master SPI mode (HAL_MSPI_USART), resolved the same way as the TWI ones.
+**/
+typedef enum
+{
+    HAL_MSPI_RXDATAL    = 0x00,
+    HAL_MSPI_RXDATAH    = 0x01,
+    HAL_MSPI_TXDATAL    = 0x02,
+    HAL_MSPI_TXDATAH    = 0x03,
+    HAL_MSPI_STATUS     = 0x04,
+    HAL_MSPI_CTRLA      = 0x05,
+    HAL_MSPI_CTRLB      = 0x06,
+    HAL_MSPI_CTRLC      = 0x07,
+    HAL_MSPI_BAUDL      = 0x08,
+    HAL_MSPI_BAUDH      = 0x09,
+} hal_mspiReg_t;
+
+/**
+ * \brief   Transmit interrupt requests of SPI0 and the master SPI USART, see hal_spi0TxInterrupt()
+ *          and hal_mspiTxInterrupt().
+**/
+typedef enum
+{
+    HAL_TX_IRQ_NONE     = 0x00,
+    HAL_TX_IRQ_READY    = 0x01,     // while the transmit buffer accepts a byte
+    HAL_TX_IRQ_COMPLETE = 0x02,     // when the last queued byte is shifted out
+} hal_txIrq_t;
+
+#if defined(HAL_BACKEND_HOST)
+#ifdef __cplusplus
+extern "C" {
+#endif
+    /**
+     * \brief Register access of the simulated TWI peripheral (implemented in host_sim).
+    **/
+    uint8_t hal_hostTwiRead(hal_twiReg_t reg);
+    void    hal_hostTwiWrite(hal_twiReg_t reg, uint8_t value);
+
+    /**
+     * \brief Register access of the simulated megaAVR-0 TWI peripheral (implemented in host_sim).
+    **/
+    uint8_t hal_hostTwi0Read(hal_twi0Reg_t reg);
+    void    hal_hostTwi0Write(hal_twi0Reg_t reg, uint8_t value);
+
+    /**
+     * \brief Register access of the simulated USI peripheral (implemented in host_sim).
+    **/
+    uint8_t hal_hostUsiRead(hal_usiReg_t reg);
+    void    hal_hostUsiWrite(hal_usiReg_t reg, uint8_t value);
+
+    /**
+     * \brief Register access of the simulated megaAVR-0 SPI peripheral (implemented in host_sim).
+    **/
+    uint8_t hal_hostSpi0Read(hal_spi0Reg_t reg);
+    void    hal_hostSpi0Write(hal_spi0Reg_t reg, uint8_t value);
+
+    /**
+     * \brief Register access of the simulated master SPI USART (implemented in host_sim).
+    **/
+    uint8_t hal_hostMspiRead(hal_mspiReg_t reg);
+    void    hal_hostMspiWrite(hal_mspiReg_t reg, uint8_t value);
+
+    /**
+     * \brief Lets virtual time progress in busy-wait loops (implemented in host_sim).
+    **/
+    void    hal_hostSpin(void);
+
+    /**
+     * \brief Cycle counter of host builds, derived from virtual time (implemented in host_sim).
+    **/
+    void        hal_hostCycleCounterStart(uint16_t prescaler);
+    uint16_t    hal_hostCycleCounter(void);
+
+    /**
+     * \brief Enables pin change interrupt of the simulated GPIO (implemented in host_sim).
+    **/
+    bool        hal_hostPinChangeEnable(uint8_t pin);
+
+    /**
+     * \brief Disables pin change interrupt of the simulated GPIO (implemented in host_sim).
+    **/
+    void        hal_hostPinChangeDisable(uint8_t pin);
+
+    /**
+     * \brief Starts the 1 ms tick interrupt of host builds (implemented in host_sim).
+    **/
+    bool        hal_hostTickEnable(void);
+
+    /**
+     * \brief Global interrupt flag of the simulation (implemented in host_sim).
+    **/
+    bool        host_interruptsEnabled(void);
+#ifdef __cplusplus
+}
+#endif
+#endif
+
+// *****************************************************************
+// *                                                               *
+// *                             GPIO                              *
+// *                                                               *
+// *****************************************************************
+
+#if defined(HAL_BACKEND_AVR_DIRECT)
+/**
+ * \brief Returns true when the core maps the pin number to an IO port.
+**/
+static inline bool hal_pinValid(uint8_t pin)
+{
+    return NOT_A_PORT != digitalPinToPort(pin);
+}
+
+#if defined(PORT_PULLUPEN_bm)
+/**
+ * \brief   Switches the pull-up of megaAVR-0 / tinyAVR-0/1/2 / AVR-Dx parts: it is controlled
+ *          by PULLUPEN of the pin's PINnCTRL register, not by the OUT register.
+**/
+static inline void hal_pinPullup(uint8_t pin, bool enable)
+{
+    volatile uint8_t *ctrl  = &digitalPinToPortStruct(pin)->PIN0CTRL + digitalPinToBitPosition(pin);
+
+    if (enable)
+    {
+        *ctrl |= PORT_PULLUPEN_bm;
+    } else
+    {
+        *ctrl &= (uint8_t)~PORT_PULLUPEN_bm;
+    }
+}
+#endif
+#endif
+
+/**
+ * \brief   Configures pin as INPUT, OUTPUT or INPUT_PULLUP.
+ *          Pin numbers not mapped to a port are ignored, as by the Arduino core.
+**/
+static inline void hal_pinMode(uint8_t pin, uint8_t mode)
+{
+#if defined(HAL_BACKEND_AVR_DIRECT)
+    if (hal_pinValid(pin))
+    {
+        volatile uint8_t *ddr   = portModeRegister(digitalPinToPort(pin));
+        volatile uint8_t *out   = portOutputRegister(digitalPinToPort(pin));
+        uint8_t           mask  = digitalPinToBitMask(pin);
+        uint8_t           sreg  = SREG;
+
+        cli();
+        if (OUTPUT == mode)
+        {
+            *ddr |= mask;
+        } else
+        {
+            *ddr &= (uint8_t)~mask;
+#if defined(PORT_PULLUPEN_bm)
+            (void)out;
+            hal_pinPullup(pin, INPUT_PULLUP == mode);
+#else
+            if (INPUT_PULLUP == mode)
+            {
+                *out |= mask;
+            } else
+            {
+                *out &= (uint8_t)~mask;
+            }
+#endif
+        }
+        SREG = sreg;
+    }
+#else
+    pinMode(pin, mode);
+#endif
+}
+
+/**
+ * \brief   Sets output level of pin. Written to a pin configured as input, HIGH enables
+ *          and LOW disables its pull-up, as by the Arduino core.
+**/
+static inline void hal_digitalWrite(uint8_t pin, uint8_t level)
+{
+#if defined(HAL_BACKEND_AVR_DIRECT)
+    if (hal_pinValid(pin))
+    {
+        volatile uint8_t *out   = portOutputRegister(digitalPinToPort(pin));
+        uint8_t           mask  = digitalPinToBitMask(pin);
+        uint8_t           sreg  = SREG;
+
+        cli();
+        if (LOW != level)
+        {
+            *out |= mask;
+        } else
+        {
+            *out &= (uint8_t)~mask;
+        }
+#if defined(PORT_PULLUPEN_bm)
+        if (0 == (*portModeRegister(digitalPinToPort(pin)) & mask))
+        {
+            hal_pinPullup(pin, LOW != level);
+        }
+#endif
+        SREG = sreg;
+    }
+#else
+    digitalWrite(pin, level);
+#endif
+}
+
+/**
+ * \brief Reads input level of pin; LOW for pin numbers not mapped to a port.
+**/
+static inline uint8_t hal_digitalRead(uint8_t pin)
+{
+#if defined(HAL_BACKEND_AVR_DIRECT)
+    uint8_t result = LOW;
+
+    if (hal_pinValid(pin) && (*portInputRegister(digitalPinToPort(pin)) & digitalPinToBitMask(pin)))
+    {
+        result = HIGH;
+    }
+
+    return result;
+#else
+    return (uint8_t)digitalRead(pin);
+#endif
+}
+
+/**
+ * \brief   Enables pin change interrupt (PCINTn) of the pin. The interrupt is raised on both
+ *          edges; its service routine (PCINT0_vect ... PCINT3_vect) is provided by the user
+ *          of the pin. On host all pins share one vector, PCINT0_vect.
+ *
+ * \return true if successful, false when the pin has no pin change interrupt.
+**/
+static inline bool hal_pinChangeEnable(uint8_t pin)
+{
+#if defined(HAL_BACKEND_HOST)
+    return hal_hostPinChangeEnable(pin);
+#elif defined(PCICR) && defined(digitalPinToPCICR)
+    bool result = false;
+
+    if (0 != digitalPinToPCICR(pin))
+    {
+        uint8_t sreg = SREG;
+
+        cli();
+        *digitalPinToPCMSK(pin) |= _BV(digitalPinToPCMSKbit(pin));
+        *digitalPinToPCICR(pin) |= _BV(digitalPinToPCICRbit(pin));
+        SREG = sreg;
+        result = true;
+    }
+
+    return result;
+#else
+    (void)pin;
+
+    return false;
+#endif
+}
+
+/**
+ * \brief   Disables pin change interrupt of the pin enabled by hal_pinChangeEnable().
+ *          The interrupt of the whole port group is disabled when no pin of it is left.
+**/
+static inline void hal_pinChangeDisable(uint8_t pin)
+{
+#if defined(HAL_BACKEND_HOST)
+    hal_hostPinChangeDisable(pin);
+#elif defined(PCICR) && defined(digitalPinToPCICR)
+    if (0 != digitalPinToPCICR(pin))
+    {
+        uint8_t sreg = SREG;
+
+        cli();
+        *digitalPinToPCMSK(pin) &= (uint8_t)~_BV(digitalPinToPCMSKbit(pin));
+        if (0 == *digitalPinToPCMSK(pin))
+        {
+            *digitalPinToPCICR(pin) &= (uint8_t)~_BV(digitalPinToPCICRbit(pin));
+        }
+        SREG = sreg;
+    }
+#else
+    (void)pin;
+#endif
+}
+
+#if defined(HAL_BACKEND_AVR_DIRECT)
+/**
+ * \brief   Output register of the port the pin belongs to. Together with hal_pinBitMask()
+ *          it allows drivers to precompute pin access and update several pins with one write.
+**/
+static inline volatile uint8_t *hal_pinOutputRegister(uint8_t pin)
+{
+    return portOutputRegister(digitalPinToPort(pin));
+}
+
+/**
+ * \brief Bit mask of the pin within its port.
+**/
+static inline uint8_t hal_pinBitMask(uint8_t pin)
+{
+    return digitalPinToBitMask(pin);
+}
+#endif
+
+// *****************************************************************
+// *                                                               *
+// *                         delays & time                         *
+// *                                                               *
+// *****************************************************************
+
+/**
+ * \brief Busy-waits for given number of microseconds. Safe to use in interrupts.
+**/
+static inline void hal_delayMicroseconds(uint16_t us)
+{
+    delayMicroseconds(us);
+}
+
+/**
+ * \brief   Called in every busy-wait loop. On targets it costs nothing, on host
+ *          it lets virtual time, and so the simulated peripherals, make progress.
+**/
+static inline void hal_spin(void)
+{
+#if defined(HAL_BACKEND_HOST)
+    hal_hostSpin();
+#endif
+}
+
+/**
+ * \brief Waits for given number of milliseconds.
+**/
+static inline void hal_delay(uint32_t ms)
+{
+    delay(ms);
+}
+
+/**
+ * \brief Microseconds since start.
+**/
+static inline uint32_t hal_micros(void)
+{
+    return (uint32_t)micros();
+}
+
+/**
+ * \brief Milliseconds since start.
+**/
+static inline uint32_t hal_millis(void)
+{
+    return (uint32_t)millis();
+}
+
+/**
+ * \brief   Starts the free-running 16-bit cycle counter (Timer1 on AVR, takes over the timer).
+ *
+ * \param prescaler[in] number of CPU cycles per counter tick: 1, 8, 64, 256 or 1024
+**/
+static inline void hal_cycleCounterStart(uint16_t prescaler)
+{
+#if defined(HAL_BACKEND_HOST)
+    hal_hostCycleCounterStart(prescaler);
+#elif defined(TCCR1B)
+    uint8_t clockSelect;
+
+    switch (prescaler)
+    {
+        case 1:     clockSelect = _BV(CS10);                break;
+        case 8:     clockSelect = _BV(CS11);                break;
+        case 64:    clockSelect = _BV(CS11) | _BV(CS10);    break;
+        case 256:   clockSelect = _BV(CS12);                break;
+        default:    clockSelect = _BV(CS12) | _BV(CS10);    break;
+    }
+    TCCR1A = 0;
+    TCCR1B = clockSelect;
+#else
+    (void)prescaler;
+#endif
+}
+
+/**
+ * \brief Current value of the free-running 16-bit cycle counter (see hal_cycleCounterStart()).
+**/
+static inline uint16_t hal_cycleCounter(void)
+{
+#if defined(HAL_BACKEND_HOST)
+    return hal_hostCycleCounter();
+#elif defined(TCNT1)
+    return TCNT1;
+#else
+    return (uint16_t)(micros() * (F_CPU / 1000000UL));
+#endif
+}
+
+/**
+ * \brief   Starts the periodic tick interrupt (about 1 ms) served by TIMER0_COMPA_vect.
+ *          On AVR it uses the compare unit A of Timer0, which already runs for millis(),
+ *          so the timer keeps its setting; its service routine is provided by the user of the tick.
+ *          The compare value is moved away from the overflow only while OC0A is disconnected:
+ *          PWM of analogWrite() on the OC0A pin (pin 6 of the UNO) keeps its duty cycle, and the
+ *          tick then fires at that compare value, still once per timer period.
+ *
+ * \return true if successful, false on targets without the tick.
+**/
+static inline bool hal_tickEnable(void)
+{
+#if defined(HAL_BACKEND_HOST)
+    return hal_hostTickEnable();
+#elif defined(TIMSK0) && defined(OCIE0A)
+#if defined(COM0A1) && defined(COM0A0)
+    if (0 == (TCCR0A & (_BV(COM0A1) | _BV(COM0A0))))
+#endif
+    {
+        OCR0A = 0x80;                                               // half way between millis() overflows
+    }
+    TIMSK0 |= _BV(OCIE0A);
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+// *****************************************************************
+// *                                                               *
+// *                      critical sections                        *
+// *                                                               *
+// *****************************************************************
+
+/**
+ * \brief   Disables interrupts and returns the previous state for hal_irqRestore(), so sections
+ *          may nest. The state is read from SREG on AVR, PRIMASK on ARM Cortex-M, the interrupt
+ *          level of PS on Xtensa and MIE of mstatus on RISC-V. On other targets it cannot be read:
+ *          hal_irqRestore() always enables interrupts there and sections must not nest.
+**/
+static inline uint8_t hal_irqSave(void)
+{
+#if defined(__AVR__)
+    uint8_t sreg = SREG;
+
+    cli();
+
+    return sreg;
+#elif defined(HAL_BACKEND_HOST)
+    uint8_t enabled = host_interruptsEnabled() ? 1 : 0;
+
+    cli();
+
+    return enabled;
+#elif defined(__arm__)
+    uint32_t primask;
+
+    __asm__ volatile ("mrs %0, primask" : "=r" (primask));
+    __asm__ volatile ("cpsid i" ::: "memory");
+
+    return (0 == (primask & 1)) ? 1 : 0;
+#elif defined(__XTENSA__)
+    uint32_t ps;
+
+    __asm__ volatile ("rsil %0, 15" : "=a" (ps) :: "memory");
+
+    return (uint8_t)(ps & 0x0F);                                    // previous interrupt level
+#elif defined(__riscv)
+    uint32_t mstatus;
+
+    __asm__ volatile ("csrrci %0, mstatus, 8" : "=r" (mstatus) :: "memory");
+
+    return (0 != (mstatus & 8)) ? 1 : 0;
+#else
+    noInterrupts();
+
+    return 1;
+#endif
+}
+
+/**
+ * \brief Restores interrupt state saved by hal_irqSave().
+**/
+static inline void hal_irqRestore(uint8_t state)
+{
+#if defined(__AVR__)
+    SREG = state;
+#elif defined(__arm__) && !defined(HAL_BACKEND_HOST)
+    if (0 != state)
+    {
+        __asm__ volatile ("cpsie i" ::: "memory");
+    }
+#elif defined(__XTENSA__) && !defined(HAL_BACKEND_HOST)
+    uint32_t ps;
+
+    __asm__ volatile ("rsr %0, ps" : "=a" (ps));
+    ps = (ps & ~(uint32_t)0x0F) | (state & 0x0F);
+    __asm__ volatile ("wsr %0, ps\n\trsync" :: "a" (ps) : "memory");
+#elif defined(__riscv) && !defined(HAL_BACKEND_HOST)
+    if (0 != state)
+    {
+        __asm__ volatile ("csrsi mstatus, 8" ::: "memory");
+    }
+#else
+    if (0 != state)
+    {
+        interrupts();
+    }
+#endif
+}
+
+// *****************************************************************
+// *                                                               *
+// *                         TWI registers                         *
+// *                                                               *
+// *****************************************************************
+
+/**
+ * \brief Reads TWI register.
+**/
+static inline uint8_t hal_twiRead(hal_twiReg_t reg)
+{
+#if defined(HAL_BACKEND_HOST)
+    return hal_hostTwiRead(reg);
+#elif defined(TWCR)
+    uint8_t value = 0;
+
+    switch (reg)
+    {
+        case HAL_TWBR:  value = TWBR;   break;
+        case HAL_TWSR:  value = TWSR;   break;
+        case HAL_TWAR:  value = TWAR;   break;
+        case HAL_TWDR:  value = TWDR;   break;
+        case HAL_TWCR:  value = TWCR;   break;
+#if defined(TWAMR)
+        case HAL_TWAMR: value = TWAMR;  break;
+#endif
+        default:                        break;
+    }
+
+    return value;
+#else
+    (void)reg;
+
+    return 0;
+#endif
+}
+
+/**
+ * \brief Writes TWI register.
+**/
+static inline void hal_twiWrite(hal_twiReg_t reg, uint8_t value)
+{
+#if defined(HAL_BACKEND_HOST)
+    hal_hostTwiWrite(reg, value);
+#elif defined(TWCR)
+    switch (reg)
+    {
+        case HAL_TWBR:  TWBR = value;   break;
+        case HAL_TWSR:  TWSR = value;   break;
+        case HAL_TWAR:  TWAR = value;   break;
+        case HAL_TWDR:  TWDR = value;   break;
+        case HAL_TWCR:  TWCR = value;   break;
+#if defined(TWAMR)
+        case HAL_TWAMR: TWAMR = value;  break;
+#endif
+        default:                        break;
+    }
+#else
+    (void)reg;
+    (void)value;
+#endif
+}
+
+// *****************************************************************
+// *                                                               *
+// *                   TWI0 (megaAVR-0) registers                  *
+// *                                                               *
+// *****************************************************************
+
+/**
+ * \brief Reads register of the megaAVR-0 TWI peripheral.
+**/
+static inline uint8_t hal_twi0Read(hal_twi0Reg_t reg)
+{
+#if defined(HAL_BACKEND_HOST)
+    return hal_hostTwi0Read(reg);
+#elif defined(TWI0_MCTRLA)
+    uint8_t value = 0;
+
+    switch (reg)
+    {
+        case HAL_TWI0_MCTRLA:       value = TWI0_MCTRLA;    break;
+        case HAL_TWI0_MCTRLB:       value = TWI0_MCTRLB;    break;
+        case HAL_TWI0_MSTATUS:      value = TWI0_MSTATUS;   break;
+        case HAL_TWI0_MBAUD:        value = TWI0_MBAUD;     break;
+        case HAL_TWI0_MADDR:        value = TWI0_MADDR;     break;
+        case HAL_TWI0_MDATA:        value = TWI0_MDATA;     break;
+        case HAL_TWI0_SCTRLA:       value = TWI0_SCTRLA;    break;
+        case HAL_TWI0_SCTRLB:       value = TWI0_SCTRLB;    break;
+        case HAL_TWI0_SSTATUS:      value = TWI0_SSTATUS;   break;
+        case HAL_TWI0_SADDR:        value = TWI0_SADDR;     break;
+        case HAL_TWI0_SDATA:        value = TWI0_SDATA;     break;
+        case HAL_TWI0_SADDRMASK:    value = TWI0_SADDRMASK; break;
+        default:                                            break;
+    }
+
+    return value;
+#else
+    (void)reg;
+
+    return 0;
+#endif
+}
+
+/**
+ * \brief Writes register of the megaAVR-0 TWI peripheral.
+**/
+static inline void hal_twi0Write(hal_twi0Reg_t reg, uint8_t value)
+{
+#if defined(HAL_BACKEND_HOST)
+    hal_hostTwi0Write(reg, value);
+#elif defined(TWI0_MCTRLA)
+    switch (reg)
+    {
+        case HAL_TWI0_MCTRLA:       TWI0_MCTRLA = value;    break;
+        case HAL_TWI0_MCTRLB:       TWI0_MCTRLB = value;    break;
+        case HAL_TWI0_MSTATUS:      TWI0_MSTATUS = value;   break;
+        case HAL_TWI0_MBAUD:        TWI0_MBAUD = value;     break;
+        case HAL_TWI0_MADDR:        TWI0_MADDR = value;     break;
+        case HAL_TWI0_MDATA:        TWI0_MDATA = value;     break;
+        case HAL_TWI0_SCTRLA:       TWI0_SCTRLA = value;    break;
+        case HAL_TWI0_SCTRLB:       TWI0_SCTRLB = value;    break;
+        case HAL_TWI0_SSTATUS:      TWI0_SSTATUS = value;   break;
+        case HAL_TWI0_SADDR:        TWI0_SADDR = value;     break;
+        case HAL_TWI0_SDATA:        TWI0_SDATA = value;     break;
+        case HAL_TWI0_SADDRMASK:    TWI0_SADDRMASK = value; break;
+        default:                                            break;
+    }
+#else
+    (void)reg;
+    (void)value;
+#endif
+}
+
+// *****************************************************************
+// *                                                               *
+// *                         USI registers                         *
+// *                                                               *
+// *****************************************************************
+
+/**
+ * \brief   Arduino pin numbers of USI data input, data output and clock. Defaults are those
+ *          of PB0, PB1 and PB2 of ATtiny25/45/85 (and of host builds); define them for other parts.
+**/
+#ifndef HAL_USI_DI_PIN
+    #define HAL_USI_DI_PIN      0
+#endif
+#ifndef HAL_USI_DO_PIN
+    #define HAL_USI_DO_PIN      1
+#endif
+#ifndef HAL_USI_USCK_PIN
+    #define HAL_USI_USCK_PIN    2
+#endif
+
+/**
+ * \brief Reads USI register.
+**/
+static inline uint8_t hal_usiRead(hal_usiReg_t reg)
+{
+#if defined(HAL_BACKEND_HOST)
+    return hal_hostUsiRead(reg);
+#elif defined(USICR)
+    uint8_t value = 0;
+
+    switch (reg)
+    {
+        case HAL_USIDR: value = USIDR;  break;
+        case HAL_USISR: value = USISR;  break;
+        case HAL_USICR: value = USICR;  break;
+        default:                        break;
+    }
+
+    return value;
+#else
+    (void)reg;
+
+    return 0;
+#endif
+}
+
+/**
+ * \brief Writes USI register.
+**/
+static inline void hal_usiWrite(hal_usiReg_t reg, uint8_t value)
+{
+#if defined(HAL_BACKEND_HOST)
+    hal_hostUsiWrite(reg, value);
+#elif defined(USICR)
+    switch (reg)
+    {
+        case HAL_USIDR: USIDR = value;  break;
+        case HAL_USISR: USISR = value;  break;
+        case HAL_USICR: USICR = value;  break;
+        default:                        break;
+    }
+#else
+    (void)reg;
+    (void)value;
+#endif
+}
+
+/**
+ * \brief   Takes the USI in three-wire mode with software clock: DO and USCK become outputs
+ *          driven by the peripheral, USCK idles low.
+ *
+ * \return true if successful, false on targets without USI.
+**/
+static inline bool hal_usiBegin(void)
+{
+#if defined(HAL_BACKEND_HOST) || defined(USICR)
+    hal_pinMode(HAL_USI_DI_PIN, INPUT);
+    hal_pinMode(HAL_USI_DO_PIN, OUTPUT);
+    hal_pinMode(HAL_USI_USCK_PIN, OUTPUT);
+    hal_digitalWrite(HAL_USI_USCK_PIN, LOW);
+    hal_usiWrite(HAL_USISR, _BV(USIOIF));
+    hal_usiWrite(HAL_USICR, _BV(USIWM0));
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * \brief Returns DO and USCK to port control.
+**/
+static inline void hal_usiEnd(void)
+{
+#if defined(HAL_BACKEND_HOST) || defined(USICR)
+    hal_usiWrite(HAL_USICR, 0);
+#endif
+}
+
+/**
+ * \brief   Shifts byte out MSB first, two register writes per bit: a USCK rising edge with
+ *          the bit on DO (data sampled by the slave), then a falling edge shifting the next bit out.
+**/
+static inline void hal_usiShiftOut(uint8_t value)
+{
+#if defined(HAL_BACKEND_HOST) || defined(USICR)
+    const uint8_t rise = _BV(USIWM0) | _BV(USITC);
+    const uint8_t fall = _BV(USIWM0) | _BV(USITC) | _BV(USICLK);
+
+    hal_usiWrite(HAL_USIDR, value);
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+        hal_usiWrite(HAL_USICR, rise);
+        hal_usiWrite(HAL_USICR, fall);
+    }
+#else
+    (void)value;
+#endif
+}
+
+/**
+ * \brief   Takes only USCK, as an output toggled by hal_usiToggleClock(): no wire mode is selected,
+ *          so DO and DI stay ordinary port pins. USITC toggles the USCK port latch in any wire mode.
+ *
+ * \return true if successful, false on targets without USI.
+**/
+static inline bool hal_usiClockBegin(void)
+{
+#if defined(HAL_BACKEND_HOST) || defined(USICR)
+    hal_pinMode(HAL_USI_USCK_PIN, OUTPUT);
+    hal_usiWrite(HAL_USICR, 0);
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * \brief   Toggles USCK, e.g. to clock the up/down input of a device. The wire mode selected
+ *          by hal_usiBegin() or hal_usiClockBegin() is kept (strobe bits read as zero).
+**/
+static inline void hal_usiToggleClock(void)
+{
+#if defined(HAL_BACKEND_HOST) || defined(USICR)
+    hal_usiWrite(HAL_USICR, (uint8_t)(hal_usiRead(HAL_USICR) | _BV(USITC)));
+#endif
+}
+
+// *****************************************************************
+// *                                                               *
+// *                   SPI0 (megaAVR-0) registers                  *
+// *                                                               *
+// *****************************************************************
+
+/**
+ * \brief   Arduino pin numbers of SPI0 data output and clock. Defaults are those of PE0 and PE2
+ *          (default pin group) of Arduino Nano Every (and of host builds); define them for other boards.
+**/
+#ifndef HAL_SPI0_MOSI_PIN
+    #define HAL_SPI0_MOSI_PIN   11
+#endif
+#ifndef HAL_SPI0_SCK_PIN
+    #define HAL_SPI0_SCK_PIN    13
+#endif
+
+/**
+ * \brief Reads SPI0 register.
+**/
+static inline uint8_t hal_spi0Read(hal_spi0Reg_t reg)
+{
+#if defined(HAL_BACKEND_HOST)
+    return hal_hostSpi0Read(reg);
+#elif defined(SPI0_CTRLA)
+    uint8_t value = 0;
+
+    switch (reg)
+    {
+        case HAL_SPI0_CTRLA:    value = SPI0_CTRLA;     break;
+        case HAL_SPI0_CTRLB:    value = SPI0_CTRLB;     break;
+        case HAL_SPI0_INTCTRL:  value = SPI0_INTCTRL;   break;
+        case HAL_SPI0_INTFLAGS: value = SPI0_INTFLAGS;  break;
+        case HAL_SPI0_DATA:     value = SPI0_DATA;      break;
+        default:                                        break;
+    }
+
+    return value;
+#else
+    (void)reg;
+
+    return 0;
+#endif
+}
+
+/**
+ * \brief Writes SPI0 register.
+**/
+static inline void hal_spi0Write(hal_spi0Reg_t reg, uint8_t value)
+{
+#if defined(HAL_BACKEND_HOST)
+    hal_hostSpi0Write(reg, value);
+#elif defined(SPI0_CTRLA)
+    switch (reg)
+    {
+        case HAL_SPI0_CTRLA:    SPI0_CTRLA = value;     break;
+        case HAL_SPI0_CTRLB:    SPI0_CTRLB = value;     break;
+        case HAL_SPI0_INTCTRL:  SPI0_INTCTRL = value;   break;
+        case HAL_SPI0_INTFLAGS: SPI0_INTFLAGS = value;  break;
+        case HAL_SPI0_DATA:     SPI0_DATA = value;      break;
+        default:                                        break;
+    }
+#else
+    (void)reg;
+    (void)value;
+#endif
+}
+
+/**
+ * \brief   Takes SPI0 as master in mode 0, MSB first, in buffered mode (BUFEN: one byte waits in the
+ *          transmit buffer while another is shifted out, so bytes written in time leave back-to-back).
+ *          Slave select is disabled (SSD), so the SS pin stays a general purpose pin. The clock is
+ *          the fastest division of F_CPU (2, 4, 8, 16, 32, 64 or 128) not above maxHz.
+ *          Interrupts of the peripheral are disabled.
+ *
+ * \param maxHz[in] highest clock frequency accepted by the devices
+ *
+ * \return true if successful, false on targets without SPI0.
+**/
+static inline bool hal_spi0Begin(uint32_t maxHz)
+{
+#if defined(HAL_BACKEND_HOST) || defined(SPI0_CTRLA)
+    static const uint8_t    settings[]  = {SPI_CLK2X_bm | SPI_PRESC_DIV4_gc, SPI_PRESC_DIV4_gc,
+                                           SPI_CLK2X_bm | SPI_PRESC_DIV16_gc, SPI_PRESC_DIV16_gc,
+                                           SPI_CLK2X_bm | SPI_PRESC_DIV64_gc, SPI_PRESC_DIV64_gc,
+                                           SPI_PRESC_DIV128_gc};
+    uint8_t                 idx         = 0;
+
+    while ((idx < (sizeof(settings) - 1)) && ((F_CPU >> (idx + 1)) > maxHz))
+    {
+        idx++;
+    }
+    hal_pinMode(HAL_SPI0_MOSI_PIN, OUTPUT);                         // directions are not overridden by the peripheral
+    hal_pinMode(HAL_SPI0_SCK_PIN, OUTPUT);
+    hal_spi0Write(HAL_SPI0_INTCTRL, 0);
+    hal_spi0Write(HAL_SPI0_CTRLB, SPI_BUFEN_bm | SPI_BUFWR_bm | SPI_SSD_bm | SPI_MODE_0_gc);
+    hal_spi0Write(HAL_SPI0_CTRLA, SPI_MASTER_bm | settings[idx] | SPI_ENABLE_bm);
+
+    return true;
+#else
+    (void)maxHz;
+
+    return false;
+#endif
+}
+
+/**
+ * \brief Disables SPI0 and its interrupts; MOSI and SCK return to port control.
+**/
+static inline void hal_spi0End(void)
+{
+#if defined(HAL_BACKEND_HOST) || defined(SPI0_CTRLA)
+    hal_spi0Write(HAL_SPI0_INTCTRL, 0);
+    hal_spi0Write(HAL_SPI0_CTRLA, 0);
+#endif
+}
+
+/**
+ * \brief   Returns true when the transmit buffer accepts a byte (DREIF); always true on targets
+ *          without SPI0, so loops waiting for it do not hang.
+**/
+static inline bool hal_spi0TxReady(void)
+{
+#if defined(HAL_BACKEND_HOST) || defined(SPI0_CTRLA)
+    return 0 != (hal_spi0Read(HAL_SPI0_INTFLAGS) & SPI_DREIF_bm);
+#else
+    return true;
+#endif
+}
+
+/**
+ * \brief   Returns true when the last queued byte has been shifted out (TXCIF); always true
+ *          on targets without SPI0.
+**/
+static inline bool hal_spi0TxComplete(void)
+{
+#if defined(HAL_BACKEND_HOST) || defined(SPI0_CTRLA)
+    return 0 != (hal_spi0Read(HAL_SPI0_INTFLAGS) & SPI_TXCIF_bm);
+#else
+    return true;
+#endif
+}
+
+/**
+ * \brief   Puts byte into the transmit buffer (hal_spi0TxReady() must be true) and clears TXCIF,
+ *          which may be left from the previous byte. Cleared after the write, it can be set again
+ *          only when this byte is shifted out - provided nothing delays the clear by a byte time,
+ *          so call it with interrupts disabled.
+**/
+static inline void hal_spi0TxQueue(uint8_t value)
+{
+#if defined(HAL_BACKEND_HOST) || defined(SPI0_CTRLA)
+    hal_spi0Write(HAL_SPI0_DATA, value);
+    hal_spi0Write(HAL_SPI0_INTFLAGS, SPI_TXCIF_bm);
+#else
+    (void)value;
+#endif
+}
+
+/**
+ * \brief Selects the transmit request of SPI0_INT_vect (the other requests are disabled).
+**/
+static inline void hal_spi0TxInterrupt(hal_txIrq_t irq)
+{
+#if defined(HAL_BACKEND_HOST) || defined(SPI0_CTRLA)
+    hal_spi0Write(HAL_SPI0_INTCTRL, (HAL_TX_IRQ_READY == irq) ? SPI_DREIE_bm :
+                                    (HAL_TX_IRQ_COMPLETE == irq) ? SPI_TXCIE_bm : 0);
+#else
+    (void)irq;
+#endif
+}
+
+// *****************************************************************
+// *                                                               *
+// *              USART master SPI (megaAVR-0) registers           *
+// *                                                               *
+// *****************************************************************
+
+/**
+ * \brief   USART used in master SPI mode, its "data register empty" and "transmit complete" vectors,
+ *          and Arduino pin numbers of its TXD (data output) and XCK (clock). Defaults are USART1
+ *          with the default pin group, PC4 and PC6 - pins 1 and 4 of Arduino Nano Every (and of host
+ *          builds); Serial1 of the Arduino core must not be used then. Define them all for another USART.
+ *          On parts without USART1 there is no default and HAL_HAS_MSPI stays undefined.
+**/
+#if !defined(HAL_MSPI_USART) && (defined(HAL_BACKEND_HOST) || defined(USART1))
+    #define HAL_MSPI_USART      USART1
+    #define HAL_MSPI_DRE_vect   USART1_DRE_vect
+    #define HAL_MSPI_TXC_vect   USART1_TXC_vect
+#endif
+#if defined(HAL_MSPI_USART)
+    #define HAL_HAS_MSPI
+#endif
+#ifndef HAL_MSPI_TXD_PIN
+    #define HAL_MSPI_TXD_PIN    1
+#endif
+#ifndef HAL_MSPI_XCK_PIN
+    #define HAL_MSPI_XCK_PIN    4
+#endif
+
+/**
+ * \brief Reads register of the master SPI USART.
+**/
+static inline uint8_t hal_mspiRead(hal_mspiReg_t reg)
+{
+#if defined(HAL_BACKEND_HOST)
+    return hal_hostMspiRead(reg);
+#elif defined(HAL_HAS_MSPI)
+    uint8_t value = 0;
+
+    switch (reg)
+    {
+        case HAL_MSPI_RXDATAL:  value = HAL_MSPI_USART.RXDATAL; break;
+        case HAL_MSPI_RXDATAH:  value = HAL_MSPI_USART.RXDATAH; break;
+        case HAL_MSPI_TXDATAL:  value = HAL_MSPI_USART.TXDATAL; break;
+        case HAL_MSPI_TXDATAH:  value = HAL_MSPI_USART.TXDATAH; break;
+        case HAL_MSPI_STATUS:   value = HAL_MSPI_USART.STATUS;  break;
+        case HAL_MSPI_CTRLA:    value = HAL_MSPI_USART.CTRLA;   break;
+        case HAL_MSPI_CTRLB:    value = HAL_MSPI_USART.CTRLB;   break;
+        case HAL_MSPI_CTRLC:    value = HAL_MSPI_USART.CTRLC;   break;
+        case HAL_MSPI_BAUDL:    value = HAL_MSPI_USART.BAUDL;   break;
+        case HAL_MSPI_BAUDH:    value = HAL_MSPI_USART.BAUDH;   break;
+        default:                                                break;
+    }
+
+    return value;
+#else
+    (void)reg;
+
+    return 0;
+#endif
+}
+
+/**
+ * \brief Writes register of the master SPI USART.
+**/
+static inline void hal_mspiWrite(hal_mspiReg_t reg, uint8_t value)
+{
+#if defined(HAL_BACKEND_HOST)
+    hal_hostMspiWrite(reg, value);
+#elif defined(HAL_HAS_MSPI)
+    switch (reg)
+    {
+        case HAL_MSPI_RXDATAL:  HAL_MSPI_USART.RXDATAL = value; break;
+        case HAL_MSPI_RXDATAH:  HAL_MSPI_USART.RXDATAH = value; break;
+        case HAL_MSPI_TXDATAL:  HAL_MSPI_USART.TXDATAL = value; break;
+        case HAL_MSPI_TXDATAH:  HAL_MSPI_USART.TXDATAH = value; break;
+        case HAL_MSPI_STATUS:   HAL_MSPI_USART.STATUS = value;  break;
+        case HAL_MSPI_CTRLA:    HAL_MSPI_USART.CTRLA = value;   break;
+        case HAL_MSPI_CTRLB:    HAL_MSPI_USART.CTRLB = value;   break;
+        case HAL_MSPI_CTRLC:    HAL_MSPI_USART.CTRLC = value;   break;
+        case HAL_MSPI_BAUDL:    HAL_MSPI_USART.BAUDL = value;   break;
+        case HAL_MSPI_BAUDH:    HAL_MSPI_USART.BAUDH = value;   break;
+        default:                                                break;
+    }
+#else
+    (void)reg;
+    (void)value;
+#endif
+}
+
+/**
+ * \brief   Takes the USART as SPI master in mode 0, MSB first, transmitter only. Like SPI0 in
+ *          buffered mode, one byte waits in the transmit buffer while another is shifted out.
+ *          The clock is F_CPU divided by the smallest even number not giving more than maxHz
+ *          (F_CPU / 2 at most). Interrupts of the USART are disabled.
+ *
+ * \param maxHz[in] highest clock frequency accepted by the devices
+ *
+ * \return true if successful, false on targets without such USART.
+**/
+static inline bool hal_mspiBegin(uint32_t maxHz)
+{
+#if defined(HAL_HAS_MSPI)
+    uint32_t divider = (F_CPU + (2 * maxHz) - 1) / (2 * maxHz);     // f = F_CPU / (2 * BAUD[15:6])
+    uint16_t baud;
+
+    if (0 == divider)
+    {
+        divider = 1;
+    } else if (divider > 0x03FF)
+    {
+        divider = 0x03FF;
+    }
+    baud = (uint16_t)(divider << 6);
+    hal_pinMode(HAL_MSPI_TXD_PIN, OUTPUT);                          // directions are not overridden by the peripheral
+    hal_pinMode(HAL_MSPI_XCK_PIN, OUTPUT);
+    hal_digitalWrite(HAL_MSPI_XCK_PIN, LOW);
+    hal_mspiWrite(HAL_MSPI_CTRLA, 0);
+    hal_mspiWrite(HAL_MSPI_BAUDL, (uint8_t)(baud & 0xFF));
+    hal_mspiWrite(HAL_MSPI_BAUDH, (uint8_t)(baud >> 8));
+    hal_mspiWrite(HAL_MSPI_CTRLC, USART_CMODE_MSPI_gc);             // UDORD = 0: MSB first, UCPHA = 0: mode 0
+    hal_mspiWrite(HAL_MSPI_CTRLB, USART_TXEN_bm);
+
+    return true;
+#else
+    (void)maxHz;
+
+    return false;
+#endif
+}
+
+/**
+ * \brief Disables the transmitter and interrupts of the USART; TXD and XCK return to port control.
+**/
+static inline void hal_mspiEnd(void)
+{
+#if defined(HAL_HAS_MSPI)
+    hal_mspiWrite(HAL_MSPI_CTRLA, 0);
+    hal_mspiWrite(HAL_MSPI_CTRLB, 0);
+#endif
+}
+
+/**
+ * \brief   Returns true when the transmit buffer accepts a byte (DREIF); always true on targets
+ *          without such USART.
+**/
+static inline bool hal_mspiTxReady(void)
+{
+#if defined(HAL_HAS_MSPI)
+    return 0 != (hal_mspiRead(HAL_MSPI_STATUS) & USART_DREIF_bm);
+#else
+    return true;
+#endif
+}
+
+/**
+ * \brief   Returns true when the last queued byte has been shifted out (TXCIF); always true
+ *          on targets without such USART.
+**/
+static inline bool hal_mspiTxComplete(void)
+{
+#if defined(HAL_HAS_MSPI)
+    return 0 != (hal_mspiRead(HAL_MSPI_STATUS) & USART_TXCIF_bm);
+#else
+    return true;
+#endif
+}
+
+/**
+ * \brief   Puts byte into the transmit buffer and clears TXCIF, with the same rules as hal_spi0TxQueue().
+**/
+static inline void hal_mspiTxQueue(uint8_t value)
+{
+#if defined(HAL_HAS_MSPI)
+    hal_mspiWrite(HAL_MSPI_TXDATAL, value);
+    hal_mspiWrite(HAL_MSPI_STATUS, USART_TXCIF_bm);
+#else
+    (void)value;
+#endif
+}
+
+/**
+ * \brief   Selects the transmit interrupt of the USART: HAL_MSPI_DRE_vect (ready) or
+ *          HAL_MSPI_TXC_vect (complete); receive interrupt stays disabled.
+**/
+static inline void hal_mspiTxInterrupt(hal_txIrq_t irq)
+{
+#if defined(HAL_HAS_MSPI)
+    hal_mspiWrite(HAL_MSPI_CTRLA, (HAL_TX_IRQ_READY == irq) ? USART_DREIE_bm :
+                                  (HAL_TX_IRQ_COMPLETE == irq) ? USART_TXCIE_bm : 0);
+#else
+    (void)irq;
+#endif
+}
+
+#if defined(HAL_HAS_SPIDEV)
+// *****************************************************************
+// *                                                               *
+// *                        Linux spidev                           *
+// *                                                               *
+// *****************************************************************
+
+/**
+ * \brief   ioctl() used for a spidev device. The system one is taken when nullptr is passed,
+ *          a stand-in (e.g. HostSpidev::ioctl of host_sim) allows to run the driver without the device.
+**/
+typedef int (*hal_spidevIoctl_t)(int fd, unsigned long request, void *arg);
+
+/**
+ * \brief System ioctl() in the form of hal_spidevIoctl_t.
+**/
+static inline int hal_spidevSystemIoctl(int fd, unsigned long request, void *arg)
+{
+    return ioctl(fd, request, arg);
+}
+
+/**
+ * \brief   Opens spidev device (e.g. "/dev/spidev0.0") in SPI mode 0 with 8-bit words.
+ *
+ * \param path[in]      device node
+ * \param speedHz[in]   clock frequency
+ * \param ioctlFn[in]   ioctl() to use, nullptr for the system one
+ *
+ * \return file descriptor, or -1 on failure.
+**/
+static inline int hal_spidevOpen(const char *path, uint32_t speedHz, hal_spidevIoctl_t ioctlFn)
+{
+    hal_spidevIoctl_t   call    = (NULL != ioctlFn) ? ioctlFn : hal_spidevSystemIoctl;
+    uint8_t             mode    = SPI_MODE_0;
+    uint8_t             bits    = 8;
+    int                 fd      = open(path, O_RDWR);
+
+    if ((0 <= fd) && ((0 > call(fd, SPI_IOC_WR_MODE, &mode)) || (0 > call(fd, SPI_IOC_WR_BITS_PER_WORD, &bits)) ||
+                      (0 > call(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speedHz))))
+    {
+        close(fd);
+        fd = -1;
+    }
+
+    return fd;
+}
+
+/**
+ * \brief Closes spidev device opened with hal_spidevOpen().
+**/
+static inline void hal_spidevClose(int fd)
+{
+    if (0 <= fd)
+    {
+        close(fd);
+    }
+}
+
+/**
+ * \brief   Executes transfers as one SPI message, i.e. with a single system call. Chip select
+ *          stays active between transfers unless cs_change of a transfer is set.
+ *
+ * \param fd[in]        file descriptor of hal_spidevOpen()
+ * \param transfers[in] transfers of the message
+ * \param count[in]     number of transfers (1 - 255)
+ * \param ioctlFn[in]   ioctl() to use, nullptr for the system one
+ *
+ * \return true if successful, otherwise false.
+**/
+static inline bool hal_spidevTransfer(int fd, struct spi_ioc_transfer *transfers, uint8_t count, hal_spidevIoctl_t ioctlFn)
+{
+    hal_spidevIoctl_t   call    = (NULL != ioctlFn) ? ioctlFn : hal_spidevSystemIoctl;
+    unsigned long       request = _IOC(_IOC_WRITE, SPI_IOC_MAGIC, 0, SPI_MSGSIZE(count));   // SPI_IOC_MESSAGE(count)
+
+    return (0 <= fd) && (0 != count) && (0 <= call(fd, request, transfers));
+}
+#endif
@@ -0,0 +1,300 @@
+/**
+ * \file hal_os.h
+ * \brief   Locking and notification layer for running the libraries under an RTOS.
+ *          Provides recursive mutexes (one per bus or display chain) and events signalled
+ *          from interrupts, on which waiting tasks sleep instead of busy-waiting.
+ *          All functions are static inline and usable from C and C++.
+ *
+ *          Backend is selected at compile time:
+ *          HAL_OS_NONE     - bare metal: mutexes do nothing, waiting is hal_spin() (default)
+ *          HAL_OS_FREERTOS - FreeRTOS static recursive mutexes and binary semaphores
+ *                            (requires configSUPPORT_STATIC_ALLOCATION and configUSE_RECURSIVE_MUTEXES)
+ *          HAL_OS_PTHREAD  - POSIX threads (Linux, host simulation)
+ *
+ *          A wait returns when the event is signalled or when its timeout passes; it may also
+ *          return early, so the caller always re-checks its condition and its own timeout.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include "hal.h"
+
+#if !defined(HAL_OS_NONE) && !defined(HAL_OS_FREERTOS) && !defined(HAL_OS_PTHREAD)
+    #define HAL_OS_NONE
+#endif
+
+#if defined(HAL_OS_FREERTOS)
+    #if defined(ARDUINO_ARCH_AVR)
+        #include <Arduino_FreeRTOS.h>
+    #else
+        #include <FreeRTOS.h>
+    #endif
+    #include <semphr.h>
+
+    /**
+     * \brief   Requests a context switch at the end of an ISR when 'woken' is set.
+     *          The macro differs between ports: ARM and most others take the flag
+     *          (portEND_SWITCHING_ISR / portYIELD_FROM_ISR(x)), the AVR port takes none.
+     *          Can be overridden for other ports.
+    **/
+    #if !defined(HAL_OS_YIELD_FROM_ISR)
+        #if defined(portEND_SWITCHING_ISR)
+            #define HAL_OS_YIELD_FROM_ISR(woken)    portEND_SWITCHING_ISR(woken)
+        #elif defined(__AVR__)
+            #define HAL_OS_YIELD_FROM_ISR(woken)    do { if (pdFALSE != (woken)) { portYIELD_FROM_ISR(); } } while (0)
+        #else
+            #define HAL_OS_YIELD_FROM_ISR(woken)    portYIELD_FROM_ISR(woken)
+        #endif
+    #endif
+
+    typedef struct
+    {
+        SemaphoreHandle_t   handle;
+        StaticSemaphore_t   buffer;
+    } hal_mutex_t;
+
+    typedef hal_mutex_t hal_event_t;
+#elif defined(HAL_OS_PTHREAD)
+    #include <pthread.h>
+    #include <sched.h>
+    #include <stdbool.h>
+    #include <time.h>
+
+    typedef struct
+    {
+        pthread_mutex_t     mutex;
+        bool                ready;
+    } hal_mutex_t;
+
+    typedef struct
+    {
+        pthread_mutex_t     mutex;
+        pthread_cond_t      cond;
+        volatile bool       signalled;
+        bool                ready;
+    } hal_event_t;
+#else
+    typedef struct
+    {
+        uint8_t             unused;
+    } hal_mutex_t;
+
+    typedef hal_mutex_t hal_event_t;
+#endif
+
+// *****************************************************************
+// *                                                               *
+// *                            mutexes                            *
+// *                                                               *
+// *****************************************************************
+
+/**
+ * \brief   Prepares recursive mutex for use; a mutex which has not been initialized
+ *          is never taken (locking and unlocking do nothing).
+**/
+static inline void hal_mutexInit(hal_mutex_t *mutex)
+{
+#if defined(HAL_OS_FREERTOS)
+    if (NULL == mutex->handle)
+    {
+        mutex->handle = xSemaphoreCreateRecursiveMutexStatic(&mutex->buffer);
+    }
+#elif defined(HAL_OS_PTHREAD)
+    if (!mutex->ready)
+    {
+        pthread_mutexattr_t attributes;
+
+        pthread_mutexattr_init(&attributes);
+        pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+        pthread_mutex_init(&mutex->mutex, &attributes);
+        pthread_mutexattr_destroy(&attributes);
+        mutex->ready = true;
+    }
+#else
+    (void)mutex;
+#endif
+}
+
+/**
+ * \brief Takes mutex, sleeping while it is held by another task; may be nested in the owner task.
+**/
+static inline void hal_mutexLock(hal_mutex_t *mutex)
+{
+#if defined(HAL_OS_FREERTOS)
+    if (NULL != mutex->handle)
+    {
+        xSemaphoreTakeRecursive(mutex->handle, portMAX_DELAY);
+    }
+#elif defined(HAL_OS_PTHREAD)
+    if (mutex->ready)
+    {
+        pthread_mutex_lock(&mutex->mutex);
+    }
+#else
+    (void)mutex;
+#endif
+}
+
+/**
+ * \brief Releases mutex taken by hal_mutexLock().
+**/
+static inline void hal_mutexUnlock(hal_mutex_t *mutex)
+{
+#if defined(HAL_OS_FREERTOS)
+    if (NULL != mutex->handle)
+    {
+        xSemaphoreGiveRecursive(mutex->handle);
+    }
+#elif defined(HAL_OS_PTHREAD)
+    if (mutex->ready)
+    {
+        pthread_mutex_unlock(&mutex->mutex);
+    }
+#else
+    (void)mutex;
+#endif
+}
+
+// *****************************************************************
+// *                                                               *
+// *                            events                             *
+// *                                                               *
+// *****************************************************************
+
+/**
+ * \brief Prepares event for use; waiting on an event which has not been initialized is hal_spin().
+**/
+static inline void hal_eventInit(hal_event_t *event)
+{
+#if defined(HAL_OS_FREERTOS)
+    if (NULL == event->handle)
+    {
+        event->handle = xSemaphoreCreateBinaryStatic(&event->buffer);
+    }
+#elif defined(HAL_OS_PTHREAD)
+    if (!event->ready)
+    {
+        pthread_mutex_init(&event->mutex, NULL);
+        pthread_cond_init(&event->cond, NULL);
+        event->signalled = false;
+        event->ready = true;
+    }
+#else
+    (void)event;
+#endif
+}
+
+/**
+ * \brief   Sleeps until the event is signalled or the timeout passes (rounded up to whole ticks).
+ *          Used in place of hal_spin() in loops waiting for an interrupt; on bare metal and on
+ *          host it is one hal_spin() step.
+ *
+ * \param timeoutUs[in] longest sleep in microseconds, 0 to sleep until the event is signalled
+**/
+static inline void hal_eventWait(hal_event_t *event, uint32_t timeoutUs)
+{
+#if defined(HAL_OS_FREERTOS)
+    if (NULL != event->handle)
+    {
+        TickType_t ticks = portMAX_DELAY;
+
+        if (0 != timeoutUs)
+        {
+            ticks = (TickType_t)((timeoutUs + (1000UL * portTICK_PERIOD_MS) - 1) / (1000UL * portTICK_PERIOD_MS));
+        }
+        xSemaphoreTake(event->handle, ticks);
+    } else
+    {
+        hal_spin();
+    }
+#elif defined(HAL_OS_PTHREAD)
+    hal_spin();                                                     // on host virtual time advances only when polled
+    if (event->ready)
+    {
+        pthread_mutex_lock(&event->mutex);
+    #if defined(HAL_BACKEND_HOST)
+        if (!event->signalled)
+        {
+            pthread_mutex_unlock(&event->mutex);
+            sched_yield();                                          // interrupt is raised by virtual time, not by another thread
+            pthread_mutex_lock(&event->mutex);
+        }
+    #else
+        if (0 == timeoutUs)
+        {
+            while (!event->signalled)
+            {
+                pthread_cond_wait(&event->cond, &event->mutex);
+            }
+        } else if (!event->signalled)
+        {
+            struct timespec deadline;
+
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += (time_t)(timeoutUs / 1000000UL);
+            deadline.tv_nsec += (long)(timeoutUs % 1000000UL) * 1000L;
+            if (deadline.tv_nsec >= 1000000000L)
+            {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&event->cond, &event->mutex, &deadline);
+        }
+    #endif
+        event->signalled = false;
+        pthread_mutex_unlock(&event->mutex);
+    }
+#else
+    (void)event;
+    (void)timeoutUs;
+    hal_spin();
+#endif
+}
+
+/**
+ * \brief Wakes task waiting on the event; to be called from interrupt service routine.
+**/
+static inline void hal_eventSignalFromIsr(hal_event_t *event)
+{
+#if defined(HAL_OS_FREERTOS)
+    if (NULL != event->handle)
+    {
+        BaseType_t woken = pdFALSE;
+
+        xSemaphoreGiveFromISR(event->handle, &woken);
+        HAL_OS_YIELD_FROM_ISR(woken);
+    }
+#elif defined(HAL_OS_PTHREAD)
+    if (event->ready)
+    {
+        pthread_mutex_lock(&event->mutex);
+        event->signalled = true;
+        pthread_cond_broadcast(&event->cond);
+        pthread_mutex_unlock(&event->mutex);
+    }
+#else
+    (void)event;
+#endif
+}
+
+/**
+ * \brief Wakes task waiting on the event; to be called from a task.
+**/
+static inline void hal_eventSignal(hal_event_t *event)
+{
+#if defined(HAL_OS_FREERTOS)
+    if (NULL != event->handle)
+    {
+        xSemaphoreGive(event->handle);
+    }
+#elif defined(HAL_OS_PTHREAD)
+    hal_eventSignalFromIsr(event);
+#else
+    (void)event;
+#endif
+}
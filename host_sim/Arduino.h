@@ -0,0 +1,55 @@
+/**
+ * \file Arduino.h
+ * \brief   Minimal host-side replacement of the Arduino core.
+ *          Allows the drivers from this repository to be built and run on Linux,
+ *          with all pin operations routed to the simulated GPIO layer (host_gpio.h).
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#define HIGH            0x1
+#define LOW             0x0
+
+#define INPUT           0x0
+#define OUTPUT          0x1
+#define INPUT_PULLUP    0x2
+
+typedef bool    boolean;
+typedef uint8_t byte;
+
+#include <avr/pgmspace.h>
+
+#define interrupts()    sei()
+#define noInterrupts()  cli()
+
+#ifdef __cplusplus
+class __FlashStringHelper;
+#define F(string_literal)   (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+extern "C" {
+#endif
+
+void            cli(void);
+void            sei(void);
+void            pinMode(uint8_t pin, uint8_t mode);
+void            digitalWrite(uint8_t pin, uint8_t val);
+int             digitalRead(uint8_t pin);
+unsigned long   micros(void);
+unsigned long   millis(void);
+void            delay(unsigned long ms);
+void            delayMicroseconds(unsigned int us);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,102 @@
+/**
+ * \file Print.h
+ * \brief Host-side replacement of the Arduino Print class (only what the libraries use).
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class Print
+{
+public:
+    virtual ~Print(void) {}
+
+    virtual size_t write(uint8_t) = 0;
+
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t result {0};
+
+        while (size--)
+        {
+            result += write(*buffer++);
+        }
+
+        return result;
+    }
+
+    size_t print(const __FlashStringHelper *text)
+    {
+        return print(reinterpret_cast<const char *>(text));
+    }
+
+    size_t print(const char *text)
+    {
+        return write(reinterpret_cast<const uint8_t *>(text), strlen(text));
+    }
+
+    size_t print(char value)
+    {
+        return write((uint8_t)value);
+    }
+
+    size_t print(unsigned long value)
+    {
+        char    buffer[11];
+        char   *text    {&buffer[sizeof(buffer) - 1]};
+
+        *text = '\0';
+        do
+        {
+            *--text = (char)('0' + (value % 10));
+            value /= 10;
+        } while (0 != value);
+
+        return print(text);
+    }
+
+    size_t print(unsigned int value)
+    {
+        return print((unsigned long)value);
+    }
+
+    size_t print(int value)
+    {
+        return (value < 0) ? print('-') + print((unsigned long)-(long)value) : print((unsigned long)value);
+    }
+
+    size_t println(void)
+    {
+        return print("\r\n");
+    }
+
+    template <typename T> size_t println(T value)
+    {
+        return print(value) + println();
+    }
+
+    int getWriteError(void)
+    {
+        return _writeError;
+    }
+
+    void clearWriteError(void)
+    {
+        _writeError = 0;
+    }
+
+protected:
+    void setWriteError(int err = 1)
+    {
+        _writeError = err;
+    }
+
+private:
+    int _writeError {0};
+};
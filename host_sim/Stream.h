@@ -0,0 +1,22 @@
+/**
+ * \file Stream.h
+ * \brief Host-side replacement of the Arduino Stream class (only what the drivers use).
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include "Print.h"
+
+class Stream : public Print
+{
+public:
+    virtual int available(void) = 0;
+    virtual int read(void) = 0;
+    virtual int peek(void) = 0;
+    virtual void flush(void) {}
+};
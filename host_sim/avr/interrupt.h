@@ -0,0 +1,46 @@
+/**
+ * \file avr/interrupt.h
+ * \brief   Host-side replacement of avr-libc <avr/interrupt.h>.
+ *          Interrupt service routines become plain functions called by simulated peripherals.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void cli(void);
+void sei(void);
+bool host_interruptsEnabled(void);
+
+void hal_hostTwiIsr(void);
+void hal_hostTwi0MasterIsr(void);
+void hal_hostTwi0SlaveIsr(void);
+void hal_hostSpi0Isr(void);
+void hal_hostMspiDreIsr(void);
+void hal_hostMspiTxcIsr(void);
+void hal_hostPinChangeIsr(void);
+void hal_hostTickIsr(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define ISR(vector, ...)    void vector(void)
+
+#define TWI_vect            hal_hostTwiIsr
+#define TWI0_TWIM_vect      hal_hostTwi0MasterIsr                   // megaAVR-0 TWI master, see host_twi0
+#define TWI0_TWIS_vect      hal_hostTwi0SlaveIsr                    // megaAVR-0 TWI slave
+#define SPI0_INT_vect       hal_hostSpi0Isr                         // megaAVR-0 SPI, see host_spi0
+#define USART1_DRE_vect     hal_hostMspiDreIsr                      // USART in master SPI mode, see host_mspi
+#define USART1_TXC_vect     hal_hostMspiTxcIsr
+#define PCINT0_vect         hal_hostPinChangeIsr                    // host has one pin change vector for all pins
+#define TIMER0_COMPA_vect   hal_hostTickIsr                         // 1 ms tick, see hal_tickEnable()
@@ -0,0 +1,146 @@
+/**
+ * \file avr/io.h
+ * \brief   Host-side replacement of avr-libc <avr/io.h>.
+ *          Provides only bit positions and helpers used by the drivers;
+ *          registers themselves are accessed through hal.h.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifndef F_CPU
+#define F_CPU       16000000UL
+#endif
+
+#ifndef _BV
+#define _BV(bit)    (1 << (bit))
+#endif
+
+// TWCR
+#define TWINT       7
+#define TWEA        6
+#define TWSTA       5
+#define TWSTO       4
+#define TWWC        3
+#define TWEN        2
+#define TWIE        0
+
+// TWSR
+#define TWPS1       1
+#define TWPS0       0
+
+// TWAR
+#define TWGCE       0
+
+// TWI0 MCTRLA, SCTRLA (megaAVR-0, AVR-Dx)
+#define TWI_RIEN_bm             0x80
+#define TWI_WIEN_bm             0x40
+#define TWI_DIEN_bm             0x80
+#define TWI_APIEN_bm            0x40
+#define TWI_PIEN_bm             0x20
+#define TWI_QCEN_bm             0x10
+#define TWI_TIMEOUT_gm          0x0C
+#define TWI_PMEN_bm             0x04
+#define TWI_SMEN_bm             0x02
+#define TWI_ENABLE_bm           0x01
+
+// TWI0 MCTRLB, SCTRLB
+#define TWI_FLUSH_bm            0x08
+#define TWI_ACKACT_bm           0x04
+#define TWI_ACKACT_ACK_gc       0x00
+#define TWI_ACKACT_NACK_gc      0x04
+#define TWI_MCMD_gm             0x03
+#define TWI_MCMD_NOACT_gc       0x00
+#define TWI_MCMD_REPSTART_gc    0x01
+#define TWI_MCMD_RECVTRANS_gc   0x02
+#define TWI_MCMD_STOP_gc        0x03
+#define TWI_SCMD_gm             0x03
+#define TWI_SCMD_NOACT_gc       0x00
+#define TWI_SCMD_COMPTRANS_gc   0x02
+#define TWI_SCMD_RESPONSE_gc    0x03
+
+// TWI0 MSTATUS, SSTATUS
+#define TWI_RIF_bm              0x80
+#define TWI_WIF_bm              0x40
+#define TWI_DIF_bm              0x80
+#define TWI_APIF_bm             0x40
+#define TWI_CLKHOLD_bm          0x20
+#define TWI_RXACK_bm            0x10
+#define TWI_ARBLOST_bm          0x08
+#define TWI_COLL_bm             0x08
+#define TWI_BUSERR_bm           0x04
+#define TWI_DIR_bm              0x02
+#define TWI_AP_bm               0x01
+#define TWI_BUSSTATE_gm         0x03
+#define TWI_BUSSTATE_UNKNOWN_gc 0x00
+#define TWI_BUSSTATE_IDLE_gc    0x01
+#define TWI_BUSSTATE_OWNER_gc   0x02
+#define TWI_BUSSTATE_BUSY_gc    0x03
+
+// USICR
+#define USISIE      7
+#define USIOIE      6
+#define USIWM1      5
+#define USIWM0      4
+#define USICS1      3
+#define USICS0      2
+#define USICLK      1
+#define USITC       0
+
+// USISR
+#define USISIF      7
+#define USIOIF      6
+#define USIPF       5
+#define USIDC       4
+
+// SPI0 CTRLA (megaAVR-0, AVR-Dx)
+#define SPI_DORD_bm             0x40
+#define SPI_MASTER_bm           0x20
+#define SPI_CLK2X_bm            0x10
+#define SPI_PRESC_gm            0x06
+#define SPI_PRESC_DIV4_gc       0x00
+#define SPI_PRESC_DIV16_gc      0x02
+#define SPI_PRESC_DIV64_gc      0x04
+#define SPI_PRESC_DIV128_gc     0x06
+#define SPI_ENABLE_bm           0x01
+
+// SPI0 CTRLB
+#define SPI_BUFEN_bm            0x80
+#define SPI_BUFWR_bm            0x40
+#define SPI_SSD_bm              0x04
+#define SPI_MODE_gm             0x03
+#define SPI_MODE_0_gc           0x00
+
+// SPI0 INTCTRL, INTFLAGS (buffered mode)
+#define SPI_RXCIE_bm            0x80
+#define SPI_TXCIE_bm            0x40
+#define SPI_DREIE_bm            0x20
+#define SPI_SSIE_bm             0x10
+#define SPI_IE_bm               0x01
+#define SPI_RXCIF_bm            0x80
+#define SPI_TXCIF_bm            0x40
+#define SPI_DREIF_bm            0x20
+#define SPI_SSIF_bm             0x10
+#define SPI_BUFOVF_bm           0x01
+
+// USART STATUS, CTRLA (megaAVR-0, AVR-Dx)
+#define USART_RXCIF_bm          0x80
+#define USART_TXCIF_bm          0x40
+#define USART_DREIF_bm          0x20
+#define USART_RXCIE_bm          0x80
+#define USART_TXCIE_bm          0x40
+#define USART_DREIE_bm          0x20
+
+// USART CTRLB, CTRLC
+#define USART_RXEN_bm           0x80
+#define USART_TXEN_bm           0x40
+#define USART_CMODE_gm          0xC0
+#define USART_CMODE_MSPI_gc     0xC0
+#define USART_UDORD_bm          0x04
+#define USART_UCPHA_bm          0x02
@@ -0,0 +1,27 @@
+/**
+ * \file avr/pgmspace.h
+ * \brief   Host-side replacement of avr-libc <avr/pgmspace.h>.
+ *          Host has a single address space, so program memory accessors are plain reads.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P                   const char *
+
+#define pgm_read_byte(addr)     (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)     (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr)    (*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr)      (*(void * const *)(addr))
+
+#define memcpy_P                memcpy
+#define strlen_P                strlen
+#define strcpy_P                strcpy
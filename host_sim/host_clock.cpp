@@ -0,0 +1,229 @@
+/**
+ * \file host_clock.cpp
+ * \brief   Deterministic virtual clock of host builds.
+ *          micros(), millis(), delays and busy-wait loops advance the clock instantly,
+ *          simulated peripherals schedule their events on it. Events due at the same
+ *          time are executed in the order they were scheduled, so every run of
+ *          a simulation gives the same results.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "host_clock.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <map>
+#include <utility>
+
+namespace
+{
+    typedef std::pair<uint64_t, HostClock::eventId_t> eventKey_t;  // (time, sequence) - sequence keeps the order stable
+
+    std::map<eventKey_t, HostClock::callback_t>  events      {};
+    uint64_t                                timeNs      {0};
+    HostClock::eventId_t                    lastId      {0};
+    uint32_t                                pollCost    {500};
+    uint16_t                                prescaler   {1};
+    bool                                    tickEnabled {false};
+    std::recursive_mutex                    lock        {};
+
+    /**
+     * \brief Executes all events due not later than 'untilNs'; time follows executed events.
+    **/
+    void runUntil(const uint64_t untilNs)
+    {
+        while (!events.empty() && (events.begin()->first.first <= untilNs))
+        {
+            auto                    event       {events.begin()};
+            HostClock::callback_t   callback    {std::move(event->second)};
+
+            if (event->first.first > timeNs)
+            {
+                timeNs = event->first.first;
+            }
+            events.erase(event);
+            callback();
+        }
+        if (untilNs > timeNs)
+        {
+            timeNs = untilNs;
+        }
+    }
+}
+
+void HostClock::reset(void)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    events.clear();
+    timeNs = 0;
+    lastId = 0;
+    pollCost = 500;
+    prescaler = 1;
+    tickEnabled = false;
+}
+
+uint64_t HostClock::nowNs(void)
+{
+    return timeNs;
+}
+
+void HostClock::advanceNs(const uint64_t ns)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    runUntil(timeNs + ns);
+}
+
+bool HostClock::runNext(void)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    bool result {!events.empty()};
+
+    if (result)
+    {
+        runUntil(events.begin()->first.first);
+    }
+
+    return result;
+}
+
+HostClock::eventId_t HostClock::scheduleAt(const uint64_t atNs, callback_t callback)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    eventId_t id {++lastId};
+
+    events.emplace(eventKey_t(atNs, id), std::move(callback));
+
+    return id;
+}
+
+HostClock::eventId_t HostClock::scheduleIn(const uint64_t delayNs, callback_t callback)
+{
+    return scheduleAt(timeNs + delayNs, std::move(callback));
+}
+
+bool HostClock::cancel(const eventId_t id)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    bool result {false};
+
+    for (auto event = events.begin(); event != events.end(); ++event)
+    {
+        if (id == event->first.second)
+        {
+            events.erase(event);
+            result = true;
+            break;
+        }
+    }
+
+    return result;
+}
+
+uint32_t HostClock::pending(void)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    return (uint32_t)events.size();
+}
+
+void HostClock::setPollCostNs(const uint32_t ns)
+{
+    pollCost = ns;
+}
+
+uint32_t HostClock::pollCostNs(void)
+{
+    return pollCost;
+}
+
+std::recursive_mutex &HostClock::mutex(void)
+{
+    return lock;
+}
+
+// *****************************************************************
+// *                                                               *
+// *                  Arduino core API replacement                 *
+// *                                                               *
+// *****************************************************************
+
+extern "C" unsigned long micros(void)
+{
+    HostClock::advanceNs(pollCost);
+
+    return (unsigned long)(timeNs / 1000ULL);
+}
+
+extern "C" unsigned long millis(void)
+{
+    HostClock::advanceNs(pollCost);
+
+    return (unsigned long)(timeNs / 1000000ULL);
+}
+
+extern "C" void delay(unsigned long ms)
+{
+    HostClock::advanceNs((uint64_t)ms * 1000000ULL);
+}
+
+extern "C" void delayMicroseconds(unsigned int us)
+{
+    HostClock::advanceNs((uint64_t)us * 1000ULL);
+}
+
+extern "C" void hal_hostSpin(void)
+{
+    HostClock::advanceNs(pollCost);
+}
+
+extern "C" void hal_hostCycleCounterStart(uint16_t cyclesPerTick)
+{
+    prescaler = (0 != cyclesPerTick) ? cyclesPerTick : 1;
+}
+
+extern "C" uint16_t hal_hostCycleCounter(void)
+{
+    return (uint16_t)((timeNs * (F_CPU / 1000000ULL)) / 1000ULL / prescaler);
+}
+
+namespace
+{
+    void tick(void)
+    {
+        if (tickEnabled)
+        {
+            HostClock::scheduleIn(1000000ULL, tick);
+            if (host_interruptsEnabled())                           // a tick missed with interrupts off is lost
+            {
+                cli();
+                hal_hostTickIsr();
+                sei();
+            }
+        }
+    }
+}
+
+extern "C" bool hal_hostTickEnable(void)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    if (!tickEnabled)
+    {
+        tickEnabled = true;
+        HostClock::scheduleIn(1000000ULL, tick);
+    }
+
+    return true;
+}
+
+extern "C" __attribute__((weak)) void hal_hostTickIsr(void)
+{
+}
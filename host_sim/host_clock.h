@@ -0,0 +1,110 @@
+/**
+ * \file host_clock.h
+ * \brief   Deterministic virtual clock of host builds.
+ *          micros(), millis(), delays and busy-wait loops advance the clock instantly,
+ *          simulated peripherals schedule their events on it. Events due at the same
+ *          time are executed in the order they were scheduled, so every run of
+ *          a simulation gives the same results.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+#include <mutex>
+
+namespace HostClock
+{
+    /**
+     * \brief Identifier of scheduled event; 0 is never used.
+    **/
+    typedef uint32_t eventId_t;
+
+    /**
+     * \brief Type of function called when event is due.
+    **/
+    typedef std::function<void(void)> callback_t;
+
+    /**
+     * \brief Removes all pending events and sets the clock to zero.
+    **/
+    void reset(void);
+
+    /**
+     * \brief Current virtual time in nanoseconds.
+    **/
+    uint64_t nowNs(void);
+
+    /**
+     * \brief   Advances virtual time, executing all events which become due
+     *          (including events scheduled by executed events) in time order.
+     *
+     * \param ns[in] time to add in nanoseconds
+    **/
+    void advanceNs(const uint64_t ns);
+
+    /**
+     * \brief Advances virtual time to the moment of the next pending event and executes it.
+     *
+     * \return false if there are no pending events.
+    **/
+    bool runNext(void);
+
+    /**
+     * \brief Schedules event at absolute virtual time (events in the past are executed on next advance).
+     *
+     * \param atNs[in]      virtual time of the event in nanoseconds
+     * \param callback[in]  function to be called
+     *
+     * \return identifier of the event.
+    **/
+    eventId_t scheduleAt(const uint64_t atNs, callback_t callback);
+
+    /**
+     * \brief Schedules event relative to current virtual time.
+     *
+     * \param delayNs[in]   delay of the event in nanoseconds
+     * \param callback[in]  function to be called
+     *
+     * \return identifier of the event.
+    **/
+    eventId_t scheduleIn(const uint64_t delayNs, callback_t callback);
+
+    /**
+     * \brief Cancels pending event.
+     *
+     * \return true if event was pending, false otherwise.
+    **/
+    bool cancel(const eventId_t id);
+
+    /**
+     * \brief Number of pending events.
+    **/
+    uint32_t pending(void);
+
+    /**
+     * \brief   Sets time consumed by a single pass of a busy-wait loop (hal_spin())
+     *          and by a single call of micros() / millis(). It lets loops polling
+     *          the time or a flag set by an interrupt make progress.
+     *
+     * \param ns[in] cost in nanoseconds (default 500 ns)
+    **/
+    void setPollCostNs(const uint32_t ns);
+
+    /**
+     * \brief Time consumed by a single poll, see setPollCostNs().
+    **/
+    uint32_t pollCostNs(void);
+
+    /**
+     * \brief   Lock of the simulation state, taken by the clock and by simulated peripherals
+     *          around register accesses, so tasks of a threaded build (HAL_OS_PTHREAD)
+     *          can share the simulation. Recursive - events may use the clock again.
+    **/
+    std::recursive_mutex &mutex(void);
+}
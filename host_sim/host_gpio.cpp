@@ -0,0 +1,229 @@
+/**
+ * \file host_gpio.cpp
+ * \brief   Simulated GPIO layer for host (Linux) builds of the drivers.
+ *          Keeps the state of every pin and notifies attached device models
+ *          about every edge on the pins they observe. Edges on pins with pin change
+ *          interrupt enabled (hal_pinChangeEnable()) raise PCINT0_vect.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "host_gpio.h"
+#include "host_clock.h"
+#include <avr/interrupt.h>
+
+namespace
+{
+    typedef struct
+    {
+        HostGpio::Listener *listeners[HostGpio::maxListeners];
+        uint32_t            edges;
+        uint8_t             mode;
+        bool                level;
+        bool                pinChange;
+    } pin_t;
+
+    pin_t       pins[HostGpio::maxPins] {};
+    uint32_t    writeCostNs             {0};
+    bool        irqEnabled              {true};
+    bool        pinChangeFlag           {false};                    // PCIF: pin change interrupt pending
+
+    void deliverPinChange(void)
+    {
+        if (pinChangeFlag)
+        {
+            if (irqEnabled)
+            {
+                pinChangeFlag = false;
+                irqEnabled = false;
+                hal_hostPinChangeIsr();
+                irqEnabled = true;
+            } else
+            {
+                HostClock::scheduleIn(HostClock::pollCostNs(), deliverPinChange);  // pending until interrupts are enabled
+            }
+        }
+    }
+
+    void setLevel(const uint8_t pin, const bool level)
+    {
+        if ((pin < HostGpio::maxPins) && (pins[pin].level != level))
+        {
+            pins[pin].level = level;
+            pins[pin].edges++;
+
+            for (uint8_t idx = 0; idx < HostGpio::maxListeners; idx++)
+            {
+                if (nullptr != pins[pin].listeners[idx])
+                {
+                    pins[pin].listeners[idx]->onPinChange(pin, level, HostClock::nowNs());
+                }
+            }
+            if (pins[pin].pinChange && !pinChangeFlag)
+            {
+                pinChangeFlag = true;
+                deliverPinChange();
+            }
+        }
+    }
+}
+
+void HostGpio::reset(void)
+{
+    memset(pins, 0, sizeof(pins));
+    HostClock::reset();
+    writeCostNs = 0;
+    irqEnabled = true;
+    pinChangeFlag = false;
+}
+
+bool HostGpio::attach(const uint8_t pin, Listener *listener)
+{
+    bool result {false};
+
+    if ((pin < maxPins) && (nullptr != listener))
+    {
+        for (uint8_t idx = 0; idx < maxListeners; idx++)
+        {
+            if (nullptr == pins[pin].listeners[idx])
+            {
+                pins[pin].listeners[idx] = listener;
+                result = true;
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+void HostGpio::detach(Listener *listener)
+{
+    for (uint8_t pin = 0; pin < maxPins; pin++)
+    {
+        for (uint8_t idx = 0; idx < maxListeners; idx++)
+        {
+            if (listener == pins[pin].listeners[idx])
+            {
+                pins[pin].listeners[idx] = nullptr;
+            }
+        }
+    }
+}
+
+bool HostGpio::level(const uint8_t pin)
+{
+    return (pin < maxPins) ? pins[pin].level : false;
+}
+
+uint8_t HostGpio::mode(const uint8_t pin)
+{
+    return (pin < maxPins) ? pins[pin].mode : INPUT;
+}
+
+uint32_t HostGpio::edges(const uint8_t pin)
+{
+    return (pin < maxPins) ? pins[pin].edges : 0;
+}
+
+uint64_t HostGpio::nowNs(void)
+{
+    return HostClock::nowNs();
+}
+
+void HostGpio::advanceNs(const uint64_t ns)
+{
+    HostClock::advanceNs(ns);
+}
+
+void HostGpio::setWriteCostNs(const uint32_t ns)
+{
+    writeCostNs = ns;
+}
+
+void HostGpio::drive(const uint8_t pin, const bool level)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    setLevel(pin, level);
+}
+
+// *****************************************************************
+// *                                                               *
+// *                  Arduino core API replacement                 *
+// *                                                               *
+// *****************************************************************
+
+extern "C" void cli(void)
+{
+    irqEnabled = false;
+}
+
+extern "C" void sei(void)
+{
+    irqEnabled = true;
+}
+
+extern "C" bool host_interruptsEnabled(void)
+{
+    return irqEnabled;
+}
+
+extern "C" void pinMode(uint8_t pin, uint8_t mode)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    if (pin < HostGpio::maxPins)
+    {
+        pins[pin].mode = mode;
+        if (INPUT_PULLUP == mode)
+        {
+            setLevel(pin, true);
+        }
+    }
+}
+
+extern "C" void digitalWrite(uint8_t pin, uint8_t val)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    HostClock::advanceNs(writeCostNs);
+    setLevel(pin, (LOW != val));
+}
+
+extern "C" int digitalRead(uint8_t pin)
+{
+    return HostGpio::level(pin) ? HIGH : LOW;
+}
+
+extern "C" bool hal_hostPinChangeEnable(uint8_t pin)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    bool result {false};
+
+    if (pin < HostGpio::maxPins)
+    {
+        pins[pin].pinChange = true;
+        result = true;
+    }
+
+    return result;
+}
+
+extern "C" void hal_hostPinChangeDisable(uint8_t pin)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    if (pin < HostGpio::maxPins)
+    {
+        pins[pin].pinChange = false;
+    }
+}
+
+extern "C" __attribute__((weak)) void hal_hostPinChangeIsr(void)
+{
+}
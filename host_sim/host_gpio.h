@@ -0,0 +1,114 @@
+/**
+ * \file host_gpio.h
+ * \brief   Simulated GPIO layer for host (Linux) builds of the drivers.
+ *          Keeps the state of every pin and notifies attached device models
+ *          about every edge on the pins they observe. Edges on pins with pin change
+ *          interrupt enabled (hal_pinChangeEnable()) raise PCINT0_vect.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+namespace HostGpio
+{
+    /**
+     * \brief Number of pins handled by the simulated GPIO layer.
+    **/
+    constexpr uint8_t   maxPins         {64};
+
+    /**
+     * \brief Maximum number of device models that can observe a single pin.
+    **/
+    constexpr uint8_t   maxListeners    {4};
+
+    /**
+     * \brief   Interface of a simulated device connected to GPIO pins.
+     *          onPinChange() is called only when the level of an observed pin really changes.
+    **/
+    class Listener
+    {
+    public:
+        virtual ~Listener(void) {}
+
+        /**
+         * \brief Notification about an edge on the observed pin.
+         *
+         * \param pin[in]       number of pin on which the edge occurred
+         * \param level[in]     new level of the pin
+         * \param timeNs[in]    simulated time of the edge in nanoseconds
+        **/
+        virtual void onPinChange(const uint8_t pin, const bool level, const uint64_t timeNs) = 0;
+    };
+
+    /**
+     * \brief   Restores the power-on state: all pins are inputs at low level, no listeners,
+     *          virtual clock (host_clock.h) is reset to zero.
+    **/
+    void reset(void);
+
+    /**
+     * \brief   Attaches a device model to a pin.
+     *
+     * \param pin[in]       pin to observe
+     * \param listener[in]  device model to be notified about edges
+     *
+     * \return true if successful, false when pin is out of range or the listener table is full.
+    **/
+    bool attach(const uint8_t pin, Listener *listener);
+
+    /**
+     * \brief Detaches a device model from all pins.
+     *
+     * \param listener[in] device model to remove
+    **/
+    void detach(Listener *listener);
+
+    /**
+     * \brief A method that returns current level of a pin.
+    **/
+    bool level(const uint8_t pin);
+
+    /**
+     * \brief A method that returns current mode (INPUT, OUTPUT, INPUT_PULLUP) of a pin.
+    **/
+    uint8_t mode(const uint8_t pin);
+
+    /**
+     * \brief A method that returns the number of edges generated on a pin since reset.
+    **/
+    uint32_t edges(const uint8_t pin);
+
+    /**
+     * \brief Current simulated time in nanoseconds (same as HostClock::nowNs()).
+    **/
+    uint64_t nowNs(void);
+
+    /**
+     * \brief Advances simulated time (same as HostClock::advanceNs()).
+     *
+     * \param ns[in] time to add in nanoseconds
+    **/
+    void advanceNs(const uint64_t ns);
+
+    /**
+     * \brief   Sets the time consumed by a single pin write. It allows to model the cost
+     *          of the GPIO engine of a real target (e.g. ~4000 ns for digitalWrite on a 16 MHz AVR).
+     *
+     * \param ns[in] cost of a single write in nanoseconds; 0 (default) means writes are free
+    **/
+    void setWriteCostNs(const uint32_t ns);
+
+    /**
+     * \brief Drives a pin from the device side (e.g. an output of a simulated chip).
+     *
+     * \param pin[in]   pin number
+     * \param level[in] new level of the pin
+    **/
+    void drive(const uint8_t pin, const bool level);
+}
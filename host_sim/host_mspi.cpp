@@ -0,0 +1,306 @@
+/**
+ * \file host_mspi.cpp
+ * \brief   Simulated USART of megaAVR-0, tinyAVR-0/1/2 and AVR-Dx parts of host builds, in master
+ *          SPI mode (CMODE = MSPI). Implements the register interface behind hal_mspiRead()/hal_mspiWrite():
+ *          with the transmitter enabled a TXDATAL write goes to the shift register when it is idle,
+ *          or waits in the one-byte transmit buffer (DREIF cleared); the buffered byte follows the
+ *          shifted one without a gap. TXCIF is raised when the shift register finishes with the
+ *          buffer empty. DREIF and TXCIF have separate vectors (HAL_MSPI_DRE_vect, HAL_MSPI_TXC_vect).
+ *          Bytes are played in mode 0 on the simulated GPIO pins HAL_MSPI_TXD_PIN and HAL_MSPI_XCK_PIN
+ *          at the clock resulting from BAUD, so simulated chips listening on them see the same word
+ *          stream as on the real part. The receiver and the asynchronous modes are not modelled.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "host_mspi.h"
+#include "host_clock.h"
+#include "host_gpio.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+namespace
+{
+    constexpr uint8_t   clearedFlags    {USART_TXCIF_bm};
+
+    uint8_t     registers[HAL_MSPI_BAUDH + 1]   {};
+    uint8_t     buffer                          {0};
+    bool        bufferFull                      {false};
+    bool        shifting                        {false};
+    uint8_t     shifted                         {0};
+    uint8_t     bit                             {0};
+    uint32_t    generation                      {0};                // events of a disabled transmitter are dropped
+    uint64_t    shiftStartNs                    {0};
+    bool        isrPending                      {false};
+    uint32_t    isrCostNs                       {0};
+    uint32_t    byteCount                       {0};
+    uint64_t    busyTimeNs                      {0};
+    uint32_t    overrunCount                    {0};
+    uint32_t    interruptCount                  {0};
+
+    inline bool enabled(void)
+    {
+        return (0 != (registers[HAL_MSPI_CTRLB] & USART_TXEN_bm)) &&
+               (USART_CMODE_MSPI_gc == (registers[HAL_MSPI_CTRLC] & USART_CMODE_gm));
+    }
+
+    uint64_t halfBitNs(void)
+    {
+        uint64_t divider {(uint64_t)((registers[HAL_MSPI_BAUDH] << 8) | registers[HAL_MSPI_BAUDL]) >> 6};
+
+        if (0 == divider)
+        {
+            divider = 1;
+        }
+
+        return (divider * 1000000000ULL) / F_CPU;                   // f = F_CPU / (2 * BAUD[15:6])
+    }
+
+    inline bool dataEmptyRequested(void)
+    {
+        return enabled() && (registers[HAL_MSPI_STATUS] & USART_DREIF_bm) && (registers[HAL_MSPI_CTRLA] & USART_DREIE_bm);
+    }
+
+    inline bool completeRequested(void)
+    {
+        return enabled() && (registers[HAL_MSPI_STATUS] & USART_TXCIF_bm) && (registers[HAL_MSPI_CTRLA] & USART_TXCIE_bm);
+    }
+
+    void deliver(void);
+
+    void enter(void)
+    {
+        isrPending = false;
+        if (dataEmptyRequested() || completeRequested())
+        {
+            if (host_interruptsEnabled())
+            {
+                interruptCount++;
+                cli();
+                if (dataEmptyRequested())
+                {
+                    hal_hostMspiDreIsr();                           // lower vector address: served first
+                } else
+                {
+                    hal_hostMspiTxcIsr();
+                }
+                sei();
+                deliver();
+            } else
+            {
+                isrPending = true;
+                HostClock::scheduleIn(HostClock::pollCostNs(), enter);   // pending until interrupts are enabled
+            }
+        }
+    }
+
+    void deliver(void)
+    {
+        if (!isrPending && (dataEmptyRequested() || completeRequested()))
+        {
+            isrPending = true;
+            HostClock::scheduleIn(isrCostNs, enter);
+        }
+    }
+
+    void startShift(const uint8_t value);
+
+    /**
+     * \brief   One half of a bit period of mode 0: data is set up with XCK low and sampled by
+     *          the slave on the rising edge; after the eighth falling edge the byte is done.
+    **/
+    void halfBit(const uint32_t owner)
+    {
+        if (owner == generation)
+        {
+            if (!HostGpio::level(HAL_MSPI_XCK_PIN))
+            {
+                HostGpio::drive(HAL_MSPI_XCK_PIN, true);
+                HostClock::scheduleIn(halfBitNs(), [owner]() { halfBit(owner); });
+            } else
+            {
+                HostGpio::drive(HAL_MSPI_XCK_PIN, false);
+                if (8 > ++bit)
+                {
+                    HostGpio::drive(HAL_MSPI_TXD_PIN, 0 != (shifted & (0x80 >> bit)));
+                    HostClock::scheduleIn(halfBitNs(), [owner]() { halfBit(owner); });
+                } else
+                {
+                    shifting = false;
+                    byteCount++;
+                    busyTimeNs += HostClock::nowNs() - shiftStartNs;
+                    if (bufferFull)
+                    {
+                        bufferFull = false;
+                        registers[HAL_MSPI_STATUS] |= USART_DREIF_bm;
+                        startShift(buffer);                         // buffered byte follows without a gap
+                    } else
+                    {
+                        registers[HAL_MSPI_STATUS] |= USART_TXCIF_bm;
+                    }
+                    deliver();
+                }
+            }
+        }
+    }
+
+    void startShift(const uint8_t value)
+    {
+        const uint32_t owner {generation};
+
+        shifting = true;
+        shifted = value;
+        bit = 0;
+        shiftStartNs = HostClock::nowNs();
+        HostGpio::drive(HAL_MSPI_TXD_PIN, 0 != (value & 0x80));
+        HostClock::scheduleIn(halfBitNs(), [owner]() { halfBit(owner); });
+    }
+
+    void onDataWrite(const uint8_t value)
+    {
+        if (enabled())
+        {
+            if (!shifting)
+            {
+                startShift(value);
+            } else if (!bufferFull)
+            {
+                buffer = value;
+                bufferFull = true;
+                registers[HAL_MSPI_STATUS] &= (uint8_t)~USART_DREIF_bm;
+            } else
+            {
+                overrunCount++;                                     // written while DREIF was clear
+            }
+        }
+    }
+
+    /**
+     * \brief Applies a CTRLB or CTRLC write; the transmitter starts and stops with TXEN in MSPI mode.
+    **/
+    void onModeWrite(const hal_mspiReg_t reg, const uint8_t value)
+    {
+        const bool wasEnabled {enabled()};
+
+        registers[reg] = value;
+        if (!enabled())
+        {
+            generation++;                                           // byte in progress is abandoned
+            shifting = false;
+            bufferFull = false;
+            registers[HAL_MSPI_STATUS] = 0;
+        } else if (!wasEnabled)
+        {
+            registers[HAL_MSPI_STATUS] = USART_DREIF_bm;
+        }
+    }
+}
+
+void HostMspi::reset(void)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    memset(registers, 0, sizeof(registers));
+    buffer = 0;
+    bufferFull = false;
+    shifting = false;
+    shifted = 0;
+    bit = 0;
+    generation++;
+    shiftStartNs = 0;
+    isrPending = false;
+    isrCostNs = 0;
+    byteCount = 0;
+    busyTimeNs = 0;
+    overrunCount = 0;
+    interruptCount = 0;
+}
+
+void HostMspi::setIsrCostNs(const uint32_t ns)
+{
+    isrCostNs = ns;
+}
+
+uint32_t HostMspi::bytes(void)
+{
+    return byteCount;
+}
+
+uint64_t HostMspi::busyNs(void)
+{
+    return busyTimeNs;
+}
+
+uint32_t HostMspi::overruns(void)
+{
+    return overrunCount;
+}
+
+uint32_t HostMspi::isrCalls(void)
+{
+    return interruptCount;
+}
+
+// *****************************************************************
+// *                                                               *
+// *                   hal.h register interface                    *
+// *                                                               *
+// *****************************************************************
+
+extern "C" uint8_t hal_hostMspiRead(hal_mspiReg_t reg)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    uint8_t result {0};
+
+    if (reg <= HAL_MSPI_BAUDH)
+    {
+        result = registers[reg];
+    }
+
+    return result;
+}
+
+extern "C" void hal_hostMspiWrite(hal_mspiReg_t reg, uint8_t value)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    switch (reg)
+    {
+        case HAL_MSPI_TXDATAL:
+            onDataWrite(value);
+            break;
+
+        case HAL_MSPI_STATUS:
+            registers[HAL_MSPI_STATUS] &= (uint8_t)~(value & clearedFlags);
+            break;
+
+        case HAL_MSPI_CTRLA:
+            registers[HAL_MSPI_CTRLA] = value;
+            deliver();                                              // DREIE/TXCIE may have been just enabled
+            break;
+
+        case HAL_MSPI_CTRLB:
+        case HAL_MSPI_CTRLC:
+            onModeWrite(reg, value);
+            break;
+
+        default:
+            if (reg <= HAL_MSPI_BAUDH)
+            {
+                registers[reg] = value;
+            }
+            break;
+    }
+}
+
+extern "C" __attribute__((weak)) void hal_hostMspiDreIsr(void)
+{
+}
+
+extern "C" __attribute__((weak)) void hal_hostMspiTxcIsr(void)
+{
+}
@@ -0,0 +1,59 @@
+/**
+ * \file host_mspi.h
+ * \brief   Simulated USART of megaAVR-0, tinyAVR-0/1/2 and AVR-Dx parts of host builds, in master
+ *          SPI mode (CMODE = MSPI). Implements the register interface behind hal_mspiRead()/hal_mspiWrite():
+ *          with the transmitter enabled a TXDATAL write goes to the shift register when it is idle,
+ *          or waits in the one-byte transmit buffer (DREIF cleared); the buffered byte follows the
+ *          shifted one without a gap. TXCIF is raised when the shift register finishes with the
+ *          buffer empty. DREIF and TXCIF have separate vectors (HAL_MSPI_DRE_vect, HAL_MSPI_TXC_vect).
+ *          Bytes are played in mode 0 on the simulated GPIO pins HAL_MSPI_TXD_PIN and HAL_MSPI_XCK_PIN
+ *          at the clock resulting from BAUD, so simulated chips listening on them see the same word
+ *          stream as on the real part. The receiver and the asynchronous modes are not modelled.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include "hal.h"
+
+namespace HostMspi
+{
+    /**
+     * \brief Restores power-on state of the peripheral.
+    **/
+    void reset(void);
+
+    /**
+     * \brief   Sets the interrupt response time: from a request (DREIF, TXCIF) to the first
+     *          instruction of its vector, e.g. 1000 ns for the entry and prologue of a
+     *          compiled ISR on a 16 MHz part. The same time passes before a request still
+     *          pending after the ISR returns is served again.
+     *
+     * \param ns[in] response time in nanoseconds; 0 (default) means interrupts are served at once
+    **/
+    void setIsrCostNs(const uint32_t ns);
+
+    /**
+     * \brief Number of bytes shifted out since reset.
+    **/
+    uint32_t bytes(void);
+
+    /**
+     * \brief Total time in nanoseconds the shift register was busy since reset.
+    **/
+    uint64_t busyNs(void);
+
+    /**
+     * \brief Number of TXDATAL writes lost because the transmit buffer was full, since reset.
+    **/
+    uint32_t overruns(void);
+
+    /**
+     * \brief Number of HAL_MSPI_DRE_vect and HAL_MSPI_TXC_vect calls since reset.
+    **/
+    uint32_t isrCalls(void);
+}
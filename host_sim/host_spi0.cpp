@@ -0,0 +1,290 @@
+/**
+ * \file host_spi0.cpp
+ * \brief   Simulated SPI peripheral of megaAVR-0, tinyAVR-0/1/2 and AVR-Dx parts of host builds.
+ *          Implements the register interface behind hal_spi0Read()/hal_spi0Write() for a master
+ *          in buffered mode (BUFEN): a DATA write goes to the shift register when it is idle, or
+ *          waits in the one-byte transmit buffer (DREIF cleared); the buffered byte follows the
+ *          shifted one without a gap. TXCIF is raised when the shift register finishes with the
+ *          buffer empty. Bytes are played in mode 0 on the simulated GPIO pins HAL_SPI0_MOSI_PIN
+ *          and HAL_SPI0_SCK_PIN at the clock resulting from CTRLA, so simulated chips listening
+ *          on them see the same word stream as on the real part. MISO and the receive side are
+ *          not modelled (RXCIF is never raised), nor is the unbuffered mode.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "host_spi0.h"
+#include "host_clock.h"
+#include "host_gpio.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+namespace
+{
+    constexpr uint8_t   clearedFlags    {SPI_RXCIF_bm | SPI_TXCIF_bm | SPI_SSIF_bm | SPI_BUFOVF_bm};
+    constexpr uint8_t   requestFlags    {SPI_RXCIF_bm | SPI_TXCIF_bm | SPI_DREIF_bm | SPI_SSIF_bm};
+
+    uint8_t     registers[HAL_SPI0_DATA + 1]    {};
+    uint8_t     buffer                          {0};
+    bool        bufferFull                      {false};
+    bool        shifting                        {false};
+    uint8_t     shifted                         {0};
+    uint8_t     bit                             {0};
+    uint32_t    generation                      {0};                // events of a disabled peripheral are dropped
+    uint64_t    shiftStartNs                    {0};
+    bool        isrPending                      {false};
+    uint32_t    isrCostNs                       {0};
+    uint32_t    byteCount                       {0};
+    uint64_t    busyTimeNs                      {0};
+    uint32_t    overrunCount                    {0};
+    uint32_t    interruptCount                  {0};
+
+    inline bool enabled(void)
+    {
+        return (SPI_MASTER_bm | SPI_ENABLE_bm) == (registers[HAL_SPI0_CTRLA] & (SPI_MASTER_bm | SPI_ENABLE_bm));
+    }
+
+    uint64_t halfBitNs(void)
+    {
+        static const uint16_t   dividers[]  {4, 16, 64, 128};
+        const uint8_t           control     {registers[HAL_SPI0_CTRLA]};
+        uint64_t                divider     {dividers[(control & SPI_PRESC_gm) >> 1]};
+
+        if (control & SPI_CLK2X_bm)
+        {
+            divider >>= 1;
+        }
+
+        return (divider * 500000000ULL) / F_CPU;
+    }
+
+    inline bool requested(void)
+    {
+        return enabled() && (0 != (registers[HAL_SPI0_INTFLAGS] & registers[HAL_SPI0_INTCTRL] & requestFlags));
+    }
+
+    void deliver(void);
+
+    void enter(void)
+    {
+        isrPending = false;
+        if (requested())
+        {
+            if (host_interruptsEnabled())
+            {
+                interruptCount++;
+                cli();
+                hal_hostSpi0Isr();
+                sei();
+                deliver();                                          // request still pending: the ISR is entered again
+            } else
+            {
+                isrPending = true;
+                HostClock::scheduleIn(HostClock::pollCostNs(), enter);   // pending until interrupts are enabled
+            }
+        }
+    }
+
+    void deliver(void)
+    {
+        if (!isrPending && requested())
+        {
+            isrPending = true;
+            HostClock::scheduleIn(isrCostNs, enter);
+        }
+    }
+
+    void startShift(const uint8_t value);
+
+    /**
+     * \brief   One half of a bit period of mode 0: data is set up with SCK low and sampled by
+     *          the slave on the rising edge; after the eighth falling edge the byte is done.
+    **/
+    void halfBit(const uint32_t owner)
+    {
+        if (owner == generation)
+        {
+            if (!HostGpio::level(HAL_SPI0_SCK_PIN))
+            {
+                HostGpio::drive(HAL_SPI0_SCK_PIN, true);
+                HostClock::scheduleIn(halfBitNs(), [owner]() { halfBit(owner); });
+            } else
+            {
+                HostGpio::drive(HAL_SPI0_SCK_PIN, false);
+                if (8 > ++bit)
+                {
+                    HostGpio::drive(HAL_SPI0_MOSI_PIN, 0 != (shifted & (0x80 >> bit)));
+                    HostClock::scheduleIn(halfBitNs(), [owner]() { halfBit(owner); });
+                } else
+                {
+                    shifting = false;
+                    byteCount++;
+                    busyTimeNs += HostClock::nowNs() - shiftStartNs;
+                    if (bufferFull)
+                    {
+                        bufferFull = false;
+                        registers[HAL_SPI0_INTFLAGS] |= SPI_DREIF_bm;
+                        startShift(buffer);                         // buffered byte follows without a gap
+                    } else
+                    {
+                        registers[HAL_SPI0_INTFLAGS] |= SPI_TXCIF_bm;
+                    }
+                    deliver();
+                }
+            }
+        }
+    }
+
+    void startShift(const uint8_t value)
+    {
+        const uint32_t owner {generation};
+
+        shifting = true;
+        shifted = value;
+        bit = 0;
+        shiftStartNs = HostClock::nowNs();
+        HostGpio::drive(HAL_SPI0_MOSI_PIN, 0 != (value & 0x80));
+        HostClock::scheduleIn(halfBitNs(), [owner]() { halfBit(owner); });
+    }
+
+    void onDataWrite(const uint8_t value)
+    {
+        if (enabled())
+        {
+            if (!shifting)
+            {
+                startShift(value);
+            } else if (!bufferFull)
+            {
+                buffer = value;
+                bufferFull = true;
+                registers[HAL_SPI0_INTFLAGS] &= (uint8_t)~SPI_DREIF_bm;
+            } else
+            {
+                overrunCount++;                                     // written while DREIF was clear
+            }
+        }
+    }
+
+    void onControlWrite(const uint8_t value)
+    {
+        const bool wasEnabled {enabled()};
+
+        registers[HAL_SPI0_CTRLA] = value;
+        if (!enabled())
+        {
+            generation++;                                           // byte in progress is abandoned
+            shifting = false;
+            bufferFull = false;
+            registers[HAL_SPI0_INTFLAGS] = 0;
+        } else if (!wasEnabled)
+        {
+            registers[HAL_SPI0_INTFLAGS] = SPI_DREIF_bm;
+            HostGpio::drive(HAL_SPI0_SCK_PIN, false);               // mode 0: SCK idles low
+        }
+    }
+}
+
+void HostSpi0::reset(void)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    memset(registers, 0, sizeof(registers));
+    buffer = 0;
+    bufferFull = false;
+    shifting = false;
+    shifted = 0;
+    bit = 0;
+    generation++;
+    shiftStartNs = 0;
+    isrPending = false;
+    isrCostNs = 0;
+    byteCount = 0;
+    busyTimeNs = 0;
+    overrunCount = 0;
+    interruptCount = 0;
+}
+
+void HostSpi0::setIsrCostNs(const uint32_t ns)
+{
+    isrCostNs = ns;
+}
+
+uint32_t HostSpi0::bytes(void)
+{
+    return byteCount;
+}
+
+uint64_t HostSpi0::busyNs(void)
+{
+    return busyTimeNs;
+}
+
+uint32_t HostSpi0::overruns(void)
+{
+    return overrunCount;
+}
+
+uint32_t HostSpi0::isrCalls(void)
+{
+    return interruptCount;
+}
+
+// *****************************************************************
+// *                                                               *
+// *                   hal.h register interface                    *
+// *                                                               *
+// *****************************************************************
+
+extern "C" uint8_t hal_hostSpi0Read(hal_spi0Reg_t reg)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    uint8_t result {0};
+
+    if (reg <= HAL_SPI0_DATA)
+    {
+        result = registers[reg];
+    }
+
+    return result;
+}
+
+extern "C" void hal_hostSpi0Write(hal_spi0Reg_t reg, uint8_t value)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    switch (reg)
+    {
+        case HAL_SPI0_CTRLA:
+            onControlWrite(value);
+            break;
+
+        case HAL_SPI0_INTCTRL:
+            registers[HAL_SPI0_INTCTRL] = value;
+            deliver();                                              // DREIE/TXCIE may have been just enabled
+            break;
+
+        case HAL_SPI0_INTFLAGS:
+            registers[HAL_SPI0_INTFLAGS] &= (uint8_t)~(value & clearedFlags);
+            break;
+
+        case HAL_SPI0_DATA:
+            onDataWrite(value);
+            break;
+
+        default:
+            if (reg <= HAL_SPI0_DATA)
+            {
+                registers[reg] = value;
+            }
+            break;
+    }
+}
+
+extern "C" __attribute__((weak)) void hal_hostSpi0Isr(void)
+{
+}
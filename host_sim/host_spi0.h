@@ -0,0 +1,59 @@
+/**
+ * \file host_spi0.h
+ * \brief   Simulated SPI peripheral of megaAVR-0, tinyAVR-0/1/2 and AVR-Dx parts of host builds.
+ *          Implements the register interface behind hal_spi0Read()/hal_spi0Write() for a master
+ *          in buffered mode (BUFEN): a DATA write goes to the shift register when it is idle, or
+ *          waits in the one-byte transmit buffer (DREIF cleared); the buffered byte follows the
+ *          shifted one without a gap. TXCIF is raised when the shift register finishes with the
+ *          buffer empty. Bytes are played in mode 0 on the simulated GPIO pins HAL_SPI0_MOSI_PIN
+ *          and HAL_SPI0_SCK_PIN at the clock resulting from CTRLA, so simulated chips listening
+ *          on them see the same word stream as on the real part. MISO and the receive side are
+ *          not modelled (RXCIF is never raised), nor is the unbuffered mode.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include "hal.h"
+
+namespace HostSpi0
+{
+    /**
+     * \brief Restores power-on state of the peripheral.
+    **/
+    void reset(void);
+
+    /**
+     * \brief   Sets the interrupt response time: from a request (DREIF, TXCIF) to the first
+     *          instruction of SPI0_INT_vect, e.g. 1000 ns for the entry and prologue of a
+     *          compiled ISR on a 16 MHz part. The same time passes before a request still
+     *          pending after the ISR returns is served again.
+     *
+     * \param ns[in] response time in nanoseconds; 0 (default) means interrupts are served at once
+    **/
+    void setIsrCostNs(const uint32_t ns);
+
+    /**
+     * \brief Number of bytes shifted out since reset.
+    **/
+    uint32_t bytes(void);
+
+    /**
+     * \brief Total time in nanoseconds the shift register was busy since reset.
+    **/
+    uint64_t busyNs(void);
+
+    /**
+     * \brief Number of DATA writes lost because the transmit buffer was full, since reset.
+    **/
+    uint32_t overruns(void);
+
+    /**
+     * \brief Number of SPI0_INT_vect calls since reset.
+    **/
+    uint32_t isrCalls(void);
+}
@@ -0,0 +1,142 @@
+/**
+ * \file host_spidev.cpp
+ * \brief   Stand-in of the Linux spidev driver for host builds. HostSpidev::ioctl() is passed
+ *          to drivers instead of the system ioctl() (hal_spidevIoctl_t); it accepts the setup
+ *          requests and SPI_IOC_MESSAGE batches and plays every transfer on simulated GPIO pins
+ *          (chip select, clock, data in mode 0), so chip models attached to these pins see
+ *          the waveform of the SPI controller, including chip select changes between transfers.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "host_spidev.h"
+#include "host_clock.h"
+#include "host_gpio.h"
+
+namespace
+{
+    uint8_t     csPin           {0};
+    uint8_t     clkPin          {0};
+    uint8_t     dataPin         {0};
+    uint32_t    speedHz         {500000};
+    uint32_t    callCostNs      {0};
+    uint32_t    callCount       {0};
+    uint32_t    transferCount   {0};
+    uint32_t    byteCount       {0};
+
+    /**
+     * \brief Plays one transfer on the pins; chip select is expected to be active.
+    **/
+    void play(const spi_ioc_transfer &transfer)
+    {
+        const uint8_t  *tx          {(const uint8_t *)(uintptr_t)transfer.tx_buf};
+        const uint32_t  hz          {(0 != transfer.speed_hz) ? transfer.speed_hz : speedHz};
+        const uint64_t  halfBitNs   {500000000ULL / hz};
+
+        for (uint32_t idx = 0; idx < transfer.len; idx++)
+        {
+            uint8_t value {(nullptr != tx) ? tx[idx] : (uint8_t)0};
+
+            for (uint8_t bit = 0; bit < 8; bit++)
+            {
+                HostGpio::drive(dataPin, 0 != (value & 0x80));
+                value <<= 1;
+                HostClock::advanceNs(halfBitNs);
+                HostGpio::drive(clkPin, true);
+                HostClock::advanceNs(halfBitNs);
+                HostGpio::drive(clkPin, false);
+            }
+        }
+        byteCount += transfer.len;
+        HostClock::advanceNs((uint64_t)transfer.delay_usecs * 1000);
+    }
+
+    int message(const spi_ioc_transfer *transfers, const uint32_t count)
+    {
+        int result {0};
+
+        HostGpio::drive(csPin, false);
+        for (uint32_t idx = 0; idx < count; idx++)
+        {
+            play(transfers[idx]);
+            result += (int)transfers[idx].len;
+            if ((0 != transfers[idx].cs_change) && ((idx + 1) < count))
+            {
+                HostGpio::drive(csPin, true);                       // deselect between transfers of the message
+                HostClock::advanceNs(1000);
+                HostGpio::drive(csPin, false);
+            }
+        }
+        HostGpio::drive(csPin, true);
+        transferCount += count;
+
+        return result;
+    }
+}
+
+void HostSpidev::reset(const uint8_t csPin, const uint8_t clkPin, const uint8_t dataPin)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    ::csPin = csPin;
+    ::clkPin = clkPin;
+    ::dataPin = dataPin;
+    speedHz = 500000;
+    callCostNs = 0;
+    callCount = 0;
+    transferCount = 0;
+    byteCount = 0;
+    HostGpio::drive(::clkPin, false);
+    HostGpio::drive(::csPin, true);
+}
+
+void HostSpidev::setCallCostNs(const uint32_t ns)
+{
+    callCostNs = ns;
+}
+
+uint32_t HostSpidev::calls(void)
+{
+    return callCount;
+}
+
+uint32_t HostSpidev::transfers(void)
+{
+    return transferCount;
+}
+
+uint32_t HostSpidev::bytes(void)
+{
+    return byteCount;
+}
+
+int HostSpidev::ioctl(int fd, unsigned long request, void *arg)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    int result {-1};
+
+    (void)fd;
+    callCount++;
+    HostClock::advanceNs(callCostNs);
+    if ((SPI_IOC_WR_MODE == request) || (SPI_IOC_WR_BITS_PER_WORD == request))
+    {
+        result = 0;
+    } else if (SPI_IOC_WR_MAX_SPEED_HZ == request)
+    {
+        if (0 != *(const uint32_t *)arg)
+        {
+            speedHz = *(const uint32_t *)arg;
+            result = 0;
+        }
+    } else if ((_IOC_TYPE(request) == SPI_IOC_MAGIC) && (0 == _IOC_NR(request)) && (_IOC_WRITE == _IOC_DIR(request)) &&
+               (0 == (_IOC_SIZE(request) % sizeof(spi_ioc_transfer))))
+    {
+        result = message((const spi_ioc_transfer *)arg, _IOC_SIZE(request) / sizeof(spi_ioc_transfer));
+    }
+
+    return result;
+}
@@ -0,0 +1,60 @@
+/**
+ * \file host_spidev.h
+ * \brief   Stand-in of the Linux spidev driver for host builds. HostSpidev::ioctl() is passed
+ *          to drivers instead of the system ioctl() (hal_spidevIoctl_t); it accepts the setup
+ *          requests and SPI_IOC_MESSAGE batches and plays every transfer on simulated GPIO pins
+ *          (chip select, clock, data in mode 0), so chip models attached to these pins see
+ *          the waveform of the SPI controller, including chip select changes between transfers.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include "hal.h"
+
+namespace HostSpidev
+{
+    /**
+     * \brief   Restores the initial state: statistics are cleared and the controller drives
+     *          the given pins, chip select idles high.
+     *
+     * \param csPin[in]     chip select pin
+     * \param clkPin[in]    clock pin
+     * \param dataPin[in]   data output (MOSI) pin
+    **/
+    void reset(const uint8_t csPin, const uint8_t clkPin, const uint8_t dataPin);
+
+    /**
+     * \brief   Sets the time consumed by a single system call (context switch and driver overhead),
+     *          added to the wire time of every message.
+     *
+     * \param ns[in] cost of a call in nanoseconds; 0 (default) means calls are free
+    **/
+    void setCallCostNs(const uint32_t ns);
+
+    /**
+     * \brief Number of ioctl() calls since reset.
+    **/
+    uint32_t calls(void);
+
+    /**
+     * \brief Number of transfers of all SPI_IOC_MESSAGE calls since reset.
+    **/
+    uint32_t transfers(void);
+
+    /**
+     * \brief Number of bytes sent since reset.
+    **/
+    uint32_t bytes(void);
+
+    /**
+     * \brief   ioctl() of a spidev device in the form of hal_spidevIoctl_t.
+     *
+     * \return 0 for setup requests, number of bytes sent for SPI_IOC_MESSAGE, -1 for other requests.
+    **/
+    int ioctl(int fd, unsigned long request, void *arg);
+}
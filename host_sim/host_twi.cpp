@@ -0,0 +1,600 @@
+/**
+ * \file host_twi.cpp
+ * \brief   Simulated TWI peripheral and I2C bus of host builds.
+ *          Implements the master side of the ATmega TWI register interface behind
+ *          hal_twiRead()/hal_twiWrite(): every bus phase is scheduled on the virtual clock
+ *          with the duration resulting from TWBR, and TWI_vect is raised on completion.
+ *          Simulated slave devices are attached to bus addresses; a write to the general
+ *          call address 0x00 is delivered to every device accepting general calls.
+ *          An external master can write to the slave receiver of the peripheral.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "host_twi.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <compat/twi.h>
+
+namespace
+{
+    typedef struct
+    {
+        uint16_t            address;
+        HostTwi::Device    *device;
+        bool                tenBit;
+    } slot_t;
+
+    uint8_t             registers[HAL_TWAMR + 1]    {};
+    bool                twint                       {false};
+    bool                actionPending               {false};     // bus action started and not completed yet
+    bool                busOwned                    {false};
+    uint64_t            busOwnedSinceNs             {0};
+    HostTwi::Device    *active                      {nullptr};
+    bool                generalCall                 {false};     // active transfer is a general call write
+    bool                address10Low                {false};     // next written byte is second byte of 10-bit address
+    uint8_t             address10High               {0};         // A9 A8 of the 10-bit address being sent
+    HostTwi::Device    *selected10                  {nullptr};   // device selected by 10-bit address until stop
+    slot_t              slots[HostTwi::maxDevices]  {};
+    uint32_t            transactionCount            {0};
+    uint32_t            byteCount                   {0};
+    uint64_t            busyTimeNs                  {0};
+    uint32_t            interruptCount              {0};
+
+    typedef struct
+    {
+        const uint8_t      *data;
+        uint16_t            length;
+        uint16_t            index;
+        uint16_t            acked;
+        uint64_t            bitNs;
+        uint64_t            heldSinceNs;
+        uint8_t             address;
+        bool                active;
+        bool                ack;                                    // TWEA when TWINT was cleared
+        bool                nacked;                                 // byte not acknowledged: master gives up
+    } external_t;
+
+    external_t          external                    {};
+    uint64_t            stretchTimeNs               {0};
+
+    uint64_t bitNs(void)
+    {
+        static const uint16_t prescaler[] {1, 4, 16, 64};
+        uint64_t divider {16ULL + 2ULL * registers[HAL_TWBR] * prescaler[registers[HAL_TWSR] & 0x03]};
+
+        return (divider * 1000000000ULL) / F_CPU;
+    }
+
+    HostTwi::Device *find(const uint8_t address)
+    {
+        HostTwi::Device *result {nullptr};
+
+        for (uint8_t idx = 0; idx < HostTwi::maxDevices; idx++)
+        {
+            if ((nullptr != slots[idx].device) && !slots[idx].tenBit && (address == slots[idx].address))
+            {
+                result = slots[idx].device;
+                break;
+            }
+        }
+
+        return result;
+    }
+
+    HostTwi::Device *find10(const uint16_t address)
+    {
+        HostTwi::Device *result {nullptr};
+
+        for (uint8_t idx = 0; idx < HostTwi::maxDevices; idx++)
+        {
+            if ((nullptr != slots[idx].device) && slots[idx].tenBit && (address == slots[idx].address))
+            {
+                result = slots[idx].device;
+                break;
+            }
+        }
+
+        return result;
+    }
+
+    bool any10(const uint8_t high)
+    {
+        bool result {false};
+
+        for (uint8_t idx = 0; idx < HostTwi::maxDevices; idx++)
+        {
+            if ((nullptr != slots[idx].device) && slots[idx].tenBit && (high == (slots[idx].address >> 8)))
+            {
+                result = true;
+                break;
+            }
+        }
+
+        return result;
+    }
+
+    bool acceptsGeneralCall(const uint8_t idx)
+    {
+        return (nullptr != slots[idx].device) && slots[idx].device->acceptsGeneralCall();
+    }
+
+    bool generalCallAddress(void)
+    {
+        bool result {false};
+
+        for (uint8_t idx = 0; idx < HostTwi::maxDevices; idx++)
+        {
+            if (acceptsGeneralCall(idx) && slots[idx].device->onAddress(false))
+            {
+                result = true;
+            }
+        }
+
+        return result;
+    }
+
+    bool generalCallWrite(const uint8_t data)
+    {
+        bool result {false};
+
+        for (uint8_t idx = 0; idx < HostTwi::maxDevices; idx++)
+        {
+            if (acceptsGeneralCall(idx) && slots[idx].device->onWrite(data))
+            {
+                result = true;                                      // open drain: one acknowledging device is enough
+            }
+        }
+
+        return result;
+    }
+
+    void endTransfer(void)
+    {
+        if (generalCall)
+        {
+            for (uint8_t idx = 0; idx < HostTwi::maxDevices; idx++)
+            {
+                if (acceptsGeneralCall(idx))
+                {
+                    slots[idx].device->onStop();
+                }
+            }
+            generalCall = false;
+        }
+        if (nullptr != active)
+        {
+            active->onStop();
+            active = nullptr;
+        }
+    }
+
+    void deliverInterrupt(void)
+    {
+        if (twint && (registers[HAL_TWCR] & _BV(TWIE)) && (registers[HAL_TWCR] & _BV(TWEN)))
+        {
+            if (host_interruptsEnabled())
+            {
+                interruptCount++;
+                cli();
+                hal_hostTwiIsr();
+                sei();
+            } else
+            {
+                HostClock::scheduleIn(HostClock::pollCostNs(), deliverInterrupt);   // pending until interrupts are enabled
+            }
+        }
+    }
+
+    void complete(const uint8_t status)
+    {
+        actionPending = false;
+        registers[HAL_TWSR] = (uint8_t)((registers[HAL_TWSR] & 0x03) | status);
+        twint = true;
+        deliverInterrupt();
+    }
+
+    void releaseBus(void)
+    {
+        endTransfer();
+        address10Low = false;
+        selected10 = nullptr;
+        if (busOwned)
+        {
+            busyTimeNs += HostClock::nowNs() - busOwnedSinceNs;
+            busOwned = false;
+        }
+    }
+
+    void start(void)
+    {
+        uint8_t status {TW_START};
+
+        if (busOwned)
+        {
+            status = TW_REP_START;
+        } else
+        {
+            busOwned = true;
+            busOwnedSinceNs = HostClock::nowNs();
+            transactionCount++;
+        }
+        endTransfer();                                              // repeated start ends transfer with the device
+        complete(status);
+    }
+
+    void stop(void)
+    {
+        actionPending = false;
+        releaseBus();
+        registers[HAL_TWCR] &= (uint8_t)~_BV(TWSTO);
+    }
+
+    void transfer(void)
+    {
+        const uint8_t status {(uint8_t)(registers[HAL_TWSR] & TW_STATUS_MASK)};
+        const uint8_t data   {registers[HAL_TWDR]};
+
+        byteCount++;
+        switch (status)
+        {
+            case TW_START:
+            case TW_REP_START:
+                {
+                    const bool read {0 != (data & TW_READ)};
+
+                    active = find(data >> 1);
+                    address10Low = false;
+                    if (0xF0 == (data & 0xF8))                      // first byte of 10-bit address: 11110 A9 A8 R/W
+                    {
+                        const uint8_t high {(uint8_t)((data >> 1) & 0x03)};
+
+                        active = nullptr;
+                        if (read && (nullptr != selected10) && selected10->onAddress(true))
+                        {
+                            active = selected10;                    // read after repeated start: device still selected
+                            complete(TW_MR_SLA_ACK);
+                        } else if (!read && any10(high))
+                        {
+                            address10Low = true;
+                            address10High = high;
+                            complete(TW_MT_SLA_ACK);
+                        } else
+                        {
+                            complete(read ? TW_MR_SLA_NACK : TW_MT_SLA_NACK);
+                        }
+                    } else if ((0 == data) && generalCallAddress())
+                    {
+                        active = nullptr;
+                        generalCall = true;
+                        complete(TW_MT_SLA_ACK);
+                    } else if ((nullptr != active) && active->onAddress(read))
+                    {
+                        complete(read ? TW_MR_SLA_ACK : TW_MT_SLA_ACK);
+                    } else
+                    {
+                        active = nullptr;
+                        complete(read ? TW_MR_SLA_NACK : TW_MT_SLA_NACK);
+                    }
+                }
+                break;
+
+            case TW_MT_SLA_ACK:
+            case TW_MT_DATA_ACK:
+                if (address10Low)
+                {
+                    address10Low = false;
+                    active = find10((uint16_t)((address10High << 8) | data));
+                    selected10 = ((nullptr != active) && active->onAddress(false)) ? active : nullptr;
+                    active = selected10;
+                    complete((nullptr != active) ? TW_MT_DATA_ACK : TW_MT_DATA_NACK);
+                } else if (generalCall)
+                {
+                    complete(generalCallWrite(data) ? TW_MT_DATA_ACK : TW_MT_DATA_NACK);
+                } else
+                {
+                    complete(((nullptr != active) && active->onWrite(data)) ? TW_MT_DATA_ACK : TW_MT_DATA_NACK);
+                }
+                break;
+
+            case TW_MR_SLA_ACK:
+            case TW_MR_DATA_ACK:
+                registers[HAL_TWDR] = (nullptr != active) ? active->onRead() : 0xFF;
+                complete((registers[HAL_TWCR] & _BV(TWEA)) ? TW_MR_DATA_ACK : TW_MR_DATA_NACK);
+                break;
+
+            default:                                                // nothing to transfer in this state
+                actionPending = false;
+                byteCount--;
+                break;
+        }
+    }
+
+    void externalComplete(const uint8_t status)
+    {
+        external.heldSinceNs = HostClock::nowNs();
+        complete(status);
+    }
+
+    void externalStop(void)
+    {
+        external.active = false;
+        complete(TW_SR_STOP);
+    }
+
+    void externalAddress(void)
+    {
+        const bool generalCall {(0 == external.address) && (registers[HAL_TWAR] & _BV(TWGCE))};
+        const bool match {generalCall || ((0 != external.address) && (external.address == (registers[HAL_TWAR] >> 1)))};
+
+        byteCount++;
+        if (match && (registers[HAL_TWCR] & _BV(TWEA)) && (registers[HAL_TWCR] & _BV(TWEN)))
+        {
+            externalComplete(generalCall ? TW_SR_GCALL_ACK : TW_SR_SLA_ACK);
+        } else
+        {
+            external.active = false;                                // address not acknowledged: master stops
+        }
+    }
+
+    void externalByte(void)
+    {
+        const bool generalCall {0 == external.address};
+
+        byteCount++;
+        registers[HAL_TWDR] = external.data[external.index++];
+        if (external.ack)
+        {
+            external.acked++;
+            externalComplete(generalCall ? TW_SR_GCALL_DATA_ACK : TW_SR_DATA_ACK);
+        } else
+        {
+            external.nacked = true;
+            externalComplete(generalCall ? TW_SR_GCALL_DATA_NACK : TW_SR_DATA_NACK);
+        }
+    }
+
+    void externalResume(const uint8_t value)
+    {
+        stretchTimeNs += HostClock::nowNs() - external.heldSinceNs;
+        external.ack = (0 != (value & _BV(TWEA)));
+        if (external.nacked)
+        {
+            external.active = false;                                // not addressed any more: no stop is reported
+            actionPending = false;
+        } else if (external.index >= external.length)
+        {
+            HostClock::scheduleIn(external.bitNs, externalStop);
+        } else
+        {
+            HostClock::scheduleIn(9 * external.bitNs, externalByte);
+        }
+    }
+
+    void onControlWrite(const uint8_t value)
+    {
+        registers[HAL_TWCR] = (uint8_t)((value & ~(_BV(TWINT) | _BV(TWWC))) | (registers[HAL_TWCR] & _BV(TWWC)));  // TWWC is read-only
+
+        if (0 == (value & _BV(TWEN)))
+        {
+            twint = false;
+            actionPending = false;
+            releaseBus();
+        } else if ((value & _BV(TWINT)) && (twint || !actionPending))
+        {
+            twint = false;                                          // writing one clears the flag and starts next action
+            actionPending = true;
+            if (value & _BV(TWSTO))
+            {
+                HostClock::scheduleIn(bitNs(), stop);
+            } else if (value & _BV(TWSTA))
+            {
+                HostClock::scheduleIn(bitNs(), start);
+            } else if (external.active)
+            {
+                externalResume(value);
+            } else
+            {
+                const uint32_t stretch {(nullptr != active) ? active->stretchNs() : 0};
+
+                HostClock::scheduleIn(9 * bitNs() + stretch, transfer);
+            }
+        } else
+        {
+            deliverInterrupt();                                     // TWIE may have been just enabled
+        }
+    }
+}
+
+void HostTwi::reset(void)
+{
+    memset(registers, 0, sizeof(registers));
+    registers[HAL_TWSR] = TW_NO_INFO;
+    twint = false;
+    actionPending = false;
+    busOwned = false;
+    active = nullptr;
+    generalCall = false;
+    address10Low = false;
+    selected10 = nullptr;
+    memset(slots, 0, sizeof(slots));
+    transactionCount = 0;
+    byteCount = 0;
+    busyTimeNs = 0;
+    interruptCount = 0;
+    external = {};
+    stretchTimeNs = 0;
+}
+
+bool HostTwi::attach(const uint8_t address, Device *device)
+{
+    bool result {false};
+
+    for (uint8_t idx = 0; idx < maxDevices; idx++)
+    {
+        if (nullptr == slots[idx].device)
+        {
+            slots[idx].address = address;
+            slots[idx].device = device;
+            slots[idx].tenBit = false;
+            result = true;
+            break;
+        }
+    }
+
+    return result;
+}
+
+bool HostTwi::attach10(const uint16_t address, Device *device)
+{
+    bool result {false};
+
+    for (uint8_t idx = 0; idx < maxDevices; idx++)
+    {
+        if (nullptr == slots[idx].device)
+        {
+            slots[idx].address = (uint16_t)(address & 0x03FF);
+            slots[idx].device = device;
+            slots[idx].tenBit = true;
+            result = true;
+            break;
+        }
+    }
+
+    return result;
+}
+
+void HostTwi::detach(Device *device)
+{
+    for (uint8_t idx = 0; idx < maxDevices; idx++)
+    {
+        if (device == slots[idx].device)
+        {
+            slots[idx].device = nullptr;
+        }
+    }
+}
+
+HostTwi::Device *HostTwi::device(const uint16_t address, const bool tenBit)
+{
+    return tenBit ? find10((uint16_t)(address & 0x03FF)) : find((uint8_t)address);
+}
+
+bool HostTwi::anyDevice10(const uint8_t high)
+{
+    return any10(high);
+}
+
+uint32_t HostTwi::transactions(void)
+{
+    return transactionCount;
+}
+
+uint32_t HostTwi::bytes(void)
+{
+    return byteCount;
+}
+
+uint64_t HostTwi::busyNs(void)
+{
+    return busyTimeNs;
+}
+
+uint32_t HostTwi::isrCalls(void)
+{
+    return interruptCount;
+}
+
+bool HostTwi::externalWrite(const uint8_t address, const uint8_t *data, const uint16_t length, const uint32_t clockHz)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    bool result {false};
+
+    if (!external.active)
+    {
+        external = {};
+        external.data = data;
+        external.length = length;
+        external.bitNs = 1000000000ULL / clockHz;
+        external.address = address;
+        external.active = true;
+        transactionCount++;
+        HostClock::scheduleIn(10 * external.bitNs, externalAddress);   // start, address and ack
+        result = true;
+    }
+
+    return result;
+}
+
+bool HostTwi::externalBusy(void)
+{
+    return external.active;
+}
+
+uint16_t HostTwi::externalAcked(void)
+{
+    return external.acked;
+}
+
+uint64_t HostTwi::stretchedNs(void)
+{
+    return stretchTimeNs;
+}
+
+// *****************************************************************
+// *                                                               *
+// *                   hal.h register interface                    *
+// *                                                               *
+// *****************************************************************
+
+extern "C" uint8_t hal_hostTwiRead(hal_twiReg_t reg)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    uint8_t result {0};
+
+    if (reg <= HAL_TWAMR)
+    {
+        result = registers[reg];
+        if ((HAL_TWCR == reg) && twint)
+        {
+            result |= _BV(TWINT);
+        }
+    }
+
+    return result;
+}
+
+extern "C" void hal_hostTwiWrite(hal_twiReg_t reg, uint8_t value)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    if (HAL_TWCR == reg)
+    {
+        onControlWrite(value);
+    } else if (HAL_TWDR == reg)
+    {
+        if (twint || !actionPending)
+        {
+            registers[HAL_TWDR] = value;
+            registers[HAL_TWCR] &= (uint8_t)~_BV(TWWC);
+        } else
+        {
+            registers[HAL_TWCR] |= _BV(TWWC);                       // write collision: bus action in progress
+        }
+    } else if (HAL_TWSR == reg)
+    {
+        registers[HAL_TWSR] = (uint8_t)((registers[HAL_TWSR] & TW_STATUS_MASK) | (value & 0x03));  // only prescaler is writable
+    } else if (reg <= HAL_TWAMR)
+    {
+        registers[reg] = value;
+    }
+}
+
+extern "C" __attribute__((weak)) void hal_hostTwiIsr(void)
+{
+}
@@ -0,0 +1,172 @@
+/**
+ * \file host_twi.h
+ * \brief   Simulated TWI peripheral and I2C bus of host builds.
+ *          Implements the master side of the ATmega TWI register interface behind
+ *          hal_twiRead()/hal_twiWrite(): every bus phase is scheduled on the virtual clock
+ *          with the duration resulting from TWBR, and TWI_vect is raised on completion.
+ *          Simulated slave devices are attached to bus addresses; a write to the general
+ *          call address 0x00 is delivered to every device accepting general calls.
+ *          An external master can write to the slave receiver of the peripheral.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include "hal.h"
+#include "host_clock.h"
+
+namespace HostTwi
+{
+    /**
+     * \brief Maximum number of devices attached to the simulated bus.
+    **/
+    constexpr uint8_t   maxDevices  {16};
+
+    /**
+     * \brief Interface of a simulated slave device.
+    **/
+    class Device
+    {
+    public:
+        virtual ~Device(void) {}
+
+        /**
+         * \brief   Device has been addressed.
+         *
+         * \param read[in] true for master read (SLA+R), false for master write (SLA+W)
+         *
+         * \return true to acknowledge the address.
+        **/
+        virtual bool onAddress(const bool read)
+        {
+            (void)read;
+
+            return true;
+        }
+
+        /**
+         * \brief Master has written a byte; return true to acknowledge it.
+        **/
+        virtual bool onWrite(const uint8_t data) = 0;
+
+        /**
+         * \brief Master reads a byte; return its value.
+        **/
+        virtual uint8_t onRead(void) = 0;
+
+        /**
+         * \brief Stop (or repeated start) condition ends the transfer with the device.
+        **/
+        virtual void onStop(void) {}
+
+        /**
+         * \brief Return true if the device acknowledges general call (address 0x00) writes.
+        **/
+        virtual bool acceptsGeneralCall(void)
+        {
+            return false;
+        }
+
+        /**
+         * \brief Time (ns) the device holds SCL low before each byte - models slow devices.
+        **/
+        virtual uint32_t stretchNs(void)
+        {
+            return 0;
+        }
+    };
+
+    /**
+     * \brief Restores power-on state of the peripheral; attached devices are removed.
+    **/
+    void reset(void);
+
+    /**
+     * \brief   Attaches simulated device to 7-bit bus address.
+     *
+     * \return true if successful, false when the device table is full.
+    **/
+    bool attach(const uint8_t address, Device *device);
+
+    /**
+     * \brief   Attaches simulated device to 10-bit bus address. The device is selected by both
+     *          address bytes with write direction and stays selected for a read after repeated start.
+     *
+     * \return true if successful, false when the device table is full.
+    **/
+    bool attach10(const uint16_t address, Device *device);
+
+    /**
+     * \brief Removes device from the bus.
+    **/
+    void detach(Device *device);
+
+    /**
+     * \brief   Device attached to the bus; lets other simulated TWI peripherals (host_twi0) reach
+     *          the same devices.
+     *
+     * \param address[in]   7-bit address, or 10-bit one
+     * \param tenBit[in]    true for 10-bit address
+     *
+     * \return attached device, or nullptr.
+    **/
+    Device *device(const uint16_t address, const bool tenBit = false);
+
+    /**
+     * \brief A method that returns true if a device has 10-bit address with A9 A8 equal to 'high'.
+    **/
+    bool anyDevice10(const uint8_t high);
+
+    /**
+     * \brief Number of transactions (START to STOP) seen on the bus since reset.
+    **/
+    uint32_t transactions(void);
+
+    /**
+     * \brief Number of bytes (including address bytes) transferred since reset.
+    **/
+    uint32_t bytes(void);
+
+    /**
+     * \brief Total time in nanoseconds the bus was busy since reset.
+    **/
+    uint64_t busyNs(void);
+
+    /**
+     * \brief Number of TWI interrupt service routine calls since reset.
+    **/
+    uint32_t isrCalls(void);
+
+    /**
+     * \brief   Starts a write of an external master to the slave receiver of the peripheral.
+     *          Every bus phase waits until the software clears TWINT (clock stretching);
+     *          the master stops after the first byte which is not acknowledged.
+     *
+     * \param address[in]   7-bit address (0x00 for general call)
+     * \param data[in]      bytes to write; must stay valid until externalBusy() returns false
+     * \param length[in]    number of bytes
+     * \param clockHz[in]   SCL frequency of the external master
+     *
+     * \return true if the write has started, false when another one is in progress.
+    **/
+    bool externalWrite(const uint8_t address, const uint8_t *data, const uint16_t length, const uint32_t clockHz = 100000);
+
+    /**
+     * \brief A method that returns true while the external write is in progress.
+    **/
+    bool externalBusy(void);
+
+    /**
+     * \brief Number of data bytes of the last external write acknowledged by the peripheral.
+    **/
+    uint16_t externalAcked(void);
+
+    /**
+     * \brief Total time in nanoseconds the peripheral held SCL low during external writes since reset.
+    **/
+    uint64_t stretchedNs(void);
+}
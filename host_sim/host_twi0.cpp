@@ -0,0 +1,635 @@
+/**
+ * \file host_twi0.cpp
+ * \brief   Simulated TWI peripheral of megaAVR-0, tinyAVR-0/1/2 and AVR-Dx parts of host builds.
+ *          Implements the register interface behind hal_twi0Read()/hal_twi0Write():
+ *          writing MADDR sends start (or repeated start) and address, MDATA writes send a byte,
+ *          RIF/WIF are raised with the clock held, and in smart mode (SMEN) reading MDATA
+ *          executes the acknowledge action of MCTRLB and the next byte read. With QCEN an
+ *          acknowledged read address raises RIF at once, without a data byte (quick command).
+ *          Bus phases take the time resulting from MBAUD on the virtual clock. The master
+ *          uses devices attached to the simulated bus of host_twi (HostTwi::attach());
+ *          general call writes of the master are not modelled.
+ *          An external master can write to the slave of the peripheral (SADDR, SSTATUS, SDATA).
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "host_twi0.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+namespace
+{
+    typedef enum : uint8_t
+    {
+        HOLD_NONE   = 0x00,     // bus idle, or bus action in progress
+        HOLD_WRITE  = 0x01,     // WIF: address or data byte sent, clock held
+        HOLD_READ   = 0x02,     // RIF: data byte received (or read address acked by quick command), clock held
+        HOLD_OWNER  = 0x03,     // bus owned, clock released, waiting for MADDR or MCMD
+    } hold_t;
+
+    constexpr uint8_t   masterFlags {TWI_RIF_bm | TWI_WIF_bm | TWI_ARBLOST_bm | TWI_BUSERR_bm};
+    constexpr uint8_t   slaveFlags  {TWI_DIF_bm | TWI_APIF_bm | TWI_COLL_bm | TWI_BUSERR_bm};
+
+    uint8_t             registers[HAL_TWI0_SADDRMASK + 1]   {};
+    uint8_t             busState                            {TWI_BUSSTATE_UNKNOWN_gc};
+    hold_t              hold                                {HOLD_NONE};
+    bool                actionPending                       {false};     // bus action started and not completed yet
+    bool                quickRead                           {false};     // RIF of quick command, no byte received
+    uint64_t            busFreeAtNs                         {0};         // end of the stop condition being sent
+    uint64_t            busOwnedSinceNs                     {0};
+    HostTwi::Device    *active                              {nullptr};
+    bool                address10Low                        {false};     // next written byte is second byte of 10-bit address
+    uint8_t             address10High                       {0};
+    HostTwi::Device    *selected10                          {nullptr};   // device selected by 10-bit address until stop
+    uint32_t            transactionCount                    {0};
+    uint32_t            byteCount                           {0};
+    uint64_t            busyTimeNs                          {0};
+    uint32_t            interruptCount                      {0};
+
+    typedef struct
+    {
+        const uint8_t      *data;
+        uint16_t            length;
+        uint16_t            index;
+        uint16_t            acked;
+        uint64_t            bitNs;
+        uint64_t            heldSinceNs;
+        uint8_t             address;
+        bool                active;
+        bool                held;                                   // address or data waits for SCMD
+    } external_t;
+
+    external_t          external                            {};
+    uint64_t            stretchTimeNs                       {0};
+
+    uint64_t bitNs(void)
+    {
+        return ((10ULL + 2ULL * registers[HAL_TWI0_MBAUD]) * 1000000000ULL) / F_CPU;
+    }
+
+    uint32_t stretch(void)
+    {
+        return (nullptr != active) ? active->stretchNs() : 0;
+    }
+
+    void deliverMaster(void)
+    {
+        const uint8_t control   {registers[HAL_TWI0_MCTRLA]};
+        const uint8_t status    {registers[HAL_TWI0_MSTATUS]};
+
+        if ((control & TWI_ENABLE_bm) &&
+            (((status & TWI_RIF_bm) && (control & TWI_RIEN_bm)) || ((status & TWI_WIF_bm) && (control & TWI_WIEN_bm))))
+        {
+            if (host_interruptsEnabled())
+            {
+                interruptCount++;
+                cli();
+                hal_hostTwi0MasterIsr();
+                sei();
+            } else
+            {
+                HostClock::scheduleIn(HostClock::pollCostNs(), deliverMaster);   // pending until interrupts are enabled
+            }
+        }
+    }
+
+    void deliverSlave(void)
+    {
+        const uint8_t control   {registers[HAL_TWI0_SCTRLA]};
+        const uint8_t status    {registers[HAL_TWI0_SSTATUS]};
+
+        if ((control & TWI_ENABLE_bm) &&
+            (((status & TWI_DIF_bm) && (control & TWI_DIEN_bm)) || ((status & TWI_APIF_bm) && (control & TWI_APIEN_bm))))
+        {
+            if (host_interruptsEnabled())
+            {
+                interruptCount++;
+                cli();
+                hal_hostTwi0SlaveIsr();
+                sei();
+            } else
+            {
+                HostClock::scheduleIn(HostClock::pollCostNs(), deliverSlave);
+            }
+        }
+    }
+
+    void endTransfer(void)
+    {
+        if (nullptr != active)
+        {
+            active->onStop();
+            active = nullptr;
+        }
+    }
+
+    void releaseBus(void)
+    {
+        endTransfer();
+        address10Low = false;
+        selected10 = nullptr;
+        if (TWI_BUSSTATE_OWNER_gc == busState)
+        {
+            busyTimeNs += HostClock::nowNs() - busOwnedSinceNs;
+        }
+        busState = TWI_BUSSTATE_IDLE_gc;
+        hold = HOLD_NONE;
+        actionPending = false;
+    }
+
+    void raise(const uint8_t flag, const hold_t state, const bool nack)
+    {
+        uint8_t status {(uint8_t)(registers[HAL_TWI0_MSTATUS] & ~TWI_RXACK_bm)};
+
+        actionPending = false;
+        hold = state;
+        status |= (uint8_t)(flag | TWI_CLKHOLD_bm);
+        if (nack)
+        {
+            status |= TWI_RXACK_bm;
+        }
+        registers[HAL_TWI0_MSTATUS] = status;
+        deliverMaster();
+    }
+
+    void readByte(void)
+    {
+        byteCount++;
+        quickRead = false;
+        registers[HAL_TWI0_MDATA] = (nullptr != active) ? active->onRead() : 0xFF;
+        raise(TWI_RIF_bm, HOLD_READ, false);
+    }
+
+    void addressDone(void)
+    {
+        const uint8_t   data    {registers[HAL_TWI0_MADDR]};
+        const bool      read    {0 != (data & 0x01)};
+        bool            ack     {false};
+
+        byteCount++;
+        active = nullptr;
+        address10Low = false;
+        if (0xF0 == (data & 0xF8))                                  // first byte of 10-bit address: 11110 A9 A8 R/W
+        {
+            const uint8_t high {(uint8_t)((data >> 1) & 0x03)};
+
+            if (read && (nullptr != selected10) && selected10->onAddress(true))
+            {
+                active = selected10;                                // read after repeated start: device still selected
+                ack = true;
+            } else if (!read && HostTwi::anyDevice10(high))
+            {
+                address10Low = true;
+                address10High = high;
+                ack = true;
+            }
+        } else if (0 != data)
+        {
+            active = HostTwi::device(data >> 1);
+            ack = (nullptr != active) && active->onAddress(read);
+            if (!ack)
+            {
+                active = nullptr;
+            }
+        }
+
+        if (ack && read)
+        {
+            if (registers[HAL_TWI0_MCTRLA] & TWI_QCEN_bm)
+            {
+                quickRead = true;
+                raise(TWI_RIF_bm, HOLD_READ, false);
+            } else
+            {
+                actionPending = true;
+                HostClock::scheduleIn(9 * bitNs() + stretch(), readByte);
+            }
+        } else
+        {
+            raise(TWI_WIF_bm, HOLD_WRITE, !ack);                    // a not acknowledged address raises WIF in both directions
+        }
+    }
+
+    void writeDone(void)
+    {
+        const uint8_t   data    {registers[HAL_TWI0_MDATA]};
+        bool            ack     {false};
+
+        byteCount++;
+        if (address10Low)
+        {
+            address10Low = false;
+            active = HostTwi::device((uint16_t)((address10High << 8) | data), true);
+            selected10 = ((nullptr != active) && active->onAddress(false)) ? active : nullptr;
+            active = selected10;
+            ack = (nullptr != active);
+        } else
+        {
+            ack = (nullptr != active) && active->onWrite(data);
+        }
+        raise(TWI_WIF_bm, HOLD_WRITE, !ack);
+    }
+
+    void clearMasterFlags(void)
+    {
+        registers[HAL_TWI0_MSTATUS] &= (uint8_t)~(TWI_RIF_bm | TWI_WIF_bm | TWI_CLKHOLD_bm);
+    }
+
+    /**
+     * \brief   Start (repeated start when the bus is owned) and address from MADDR; a start waits
+     *          for the end of a stop condition being sent.
+    **/
+    void startAddress(void)
+    {
+        uint64_t delay {0};
+
+        if (TWI_BUSSTATE_OWNER_gc == busState)
+        {
+            endTransfer();                                          // repeated start ends transfer with the device
+        } else
+        {
+            delay = (busFreeAtNs > HostClock::nowNs()) ? (busFreeAtNs - HostClock::nowNs()) : 0;
+            busState = TWI_BUSSTATE_OWNER_gc;
+            busOwnedSinceNs = HostClock::nowNs() + delay;
+            transactionCount++;
+        }
+        clearMasterFlags();
+        hold = HOLD_NONE;
+        actionPending = true;
+        HostClock::scheduleIn(delay + 10 * bitNs(), addressDone);   // start, address and acknowledge
+    }
+
+    /**
+     * \brief Acknowledge action of MCTRLB after a received byte; an ACK reads the next byte.
+    **/
+    void acknowledge(void)
+    {
+        clearMasterFlags();
+        if (0 == (registers[HAL_TWI0_MCTRLB] & TWI_ACKACT_bm))
+        {
+            hold = HOLD_NONE;
+            actionPending = true;
+            HostClock::scheduleIn(9 * bitNs() + stretch(), readByte);
+        } else
+        {
+            hold = HOLD_OWNER;                                      // NACK: device stops sending, bus stays owned
+        }
+    }
+
+    void stop(void)
+    {
+        clearMasterFlags();
+        busFreeAtNs = HostClock::nowNs() + bitNs();
+        releaseBus();
+        busyTimeNs += bitNs();
+    }
+
+    void onMasterCommand(const uint8_t value)
+    {
+        registers[HAL_TWI0_MCTRLB] = (uint8_t)(value & TWI_ACKACT_bm); // command bits are strobes
+
+        if (value & TWI_FLUSH_bm)
+        {
+            clearMasterFlags();
+            releaseBus();
+        } else if ((TWI_BUSSTATE_OWNER_gc == busState) && !actionPending)
+        {
+            switch (value & TWI_MCMD_gm)
+            {
+                case TWI_MCMD_REPSTART_gc:
+                    startAddress();
+                    break;
+
+                case TWI_MCMD_RECVTRANS_gc:
+                    if ((HOLD_READ == hold) && !quickRead)
+                    {
+                        acknowledge();
+                    } else if (HOLD_READ == hold)
+                    {
+                        clearMasterFlags();
+                        hold = HOLD_NONE;
+                        actionPending = true;
+                        HostClock::scheduleIn(9 * bitNs() + stretch(), readByte);
+                    }
+                    break;
+
+                case TWI_MCMD_STOP_gc:
+                    stop();
+                    break;
+
+                default:
+                    break;
+            }
+        }
+    }
+
+    void onMasterStatusWrite(const uint8_t value)
+    {
+        const uint8_t cleared {(uint8_t)(value & masterFlags)};
+
+        registers[HAL_TWI0_MSTATUS] &= (uint8_t)~cleared;           // flags are cleared by writing one
+        if ((cleared & (TWI_RIF_bm | TWI_WIF_bm)) && ((HOLD_READ == hold) || (HOLD_WRITE == hold)))
+        {
+            registers[HAL_TWI0_MSTATUS] &= (uint8_t)~TWI_CLKHOLD_bm;
+            hold = HOLD_OWNER;
+        }
+        if ((TWI_BUSSTATE_IDLE_gc == (value & TWI_BUSSTATE_gm)) && (TWI_BUSSTATE_OWNER_gc != busState))
+        {
+            busState = TWI_BUSSTATE_IDLE_gc;                        // only forcing idle is possible
+        }
+    }
+
+    void onMasterControlWrite(const uint8_t value)
+    {
+        registers[HAL_TWI0_MCTRLA] = value;
+        if (0 == (value & TWI_ENABLE_bm))
+        {
+            registers[HAL_TWI0_MSTATUS] &= (uint8_t)~(masterFlags | TWI_CLKHOLD_bm | TWI_RXACK_bm);
+            releaseBus();
+            busState = TWI_BUSSTATE_UNKNOWN_gc;
+        } else
+        {
+            deliverMaster();                                        // RIEN/WIEN may have been just enabled
+        }
+    }
+
+    // *************************************************************
+    // *                     slave, external master                *
+    // *************************************************************
+
+    void holdSlave(const uint8_t flags)
+    {
+        external.held = true;
+        external.heldSinceNs = HostClock::nowNs();
+        registers[HAL_TWI0_SSTATUS] = (uint8_t)((registers[HAL_TWI0_SSTATUS] & (TWI_COLL_bm | TWI_BUSERR_bm)) | flags | TWI_CLKHOLD_bm);
+        deliverSlave();
+    }
+
+    void externalStop(void)
+    {
+        external.active = false;
+        if (registers[HAL_TWI0_SCTRLA] & TWI_PIEN_bm)
+        {
+            registers[HAL_TWI0_SSTATUS] = (uint8_t)((registers[HAL_TWI0_SSTATUS] & (TWI_COLL_bm | TWI_BUSERR_bm)) | TWI_APIF_bm);
+            deliverSlave();
+        }
+    }
+
+    void externalAddress(void)
+    {
+        const uint8_t   own         {registers[HAL_TWI0_SADDR]};
+        const bool      generalCall {(0 == external.address) && (own & 0x01)};
+        const bool      match       {generalCall || ((0 != external.address) && (external.address == (own >> 1)))};
+
+        byteCount++;
+        if (match && (registers[HAL_TWI0_SCTRLA] & TWI_ENABLE_bm))
+        {
+            registers[HAL_TWI0_SDATA] = (uint8_t)(external.address << 1);
+            holdSlave(TWI_APIF_bm | TWI_AP_bm);                     // write direction: DIR is zero
+        } else
+        {
+            external.active = false;                                // address not acknowledged: master stops
+        }
+    }
+
+    void externalByte(void)
+    {
+        byteCount++;
+        registers[HAL_TWI0_SDATA] = external.data[external.index++];
+        holdSlave(TWI_DIF_bm);
+    }
+
+    void externalResume(const bool ack)
+    {
+        const bool addressPhase {0 != (registers[HAL_TWI0_SSTATUS] & TWI_APIF_bm)};
+
+        stretchTimeNs += HostClock::nowNs() - external.heldSinceNs;
+        external.held = false;
+        registers[HAL_TWI0_SSTATUS] &= (uint8_t)~(TWI_DIF_bm | TWI_APIF_bm | TWI_CLKHOLD_bm | TWI_AP_bm);
+        if (addressPhase && !ack)
+        {
+            external.active = false;
+        } else if (!ack)
+        {
+            HostClock::scheduleIn(external.bitNs, externalStop);    // data not acknowledged: master stops
+        } else
+        {
+            if (!addressPhase)
+            {
+                external.acked++;
+            }
+            if (external.index >= external.length)
+            {
+                HostClock::scheduleIn(external.bitNs, externalStop);
+            } else
+            {
+                HostClock::scheduleIn(9 * external.bitNs, externalByte);
+            }
+        }
+    }
+
+    void onSlaveCommand(const uint8_t value)
+    {
+        registers[HAL_TWI0_SCTRLB] = (uint8_t)(value & TWI_ACKACT_bm);
+
+        switch (value & TWI_SCMD_gm)
+        {
+            case TWI_SCMD_RESPONSE_gc:
+                if (external.active && external.held)
+                {
+                    externalResume(0 == (value & TWI_ACKACT_bm));
+                }
+                break;
+
+            case TWI_SCMD_COMPTRANS_gc:
+                if (external.active && external.held)
+                {
+                    externalResume(false);                          // transaction completed by the slave: no more ACKs
+                } else
+                {
+                    registers[HAL_TWI0_SSTATUS] &= (uint8_t)~(TWI_DIF_bm | TWI_APIF_bm | TWI_CLKHOLD_bm);
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+void HostTwi0::reset(void)
+{
+    memset(registers, 0, sizeof(registers));
+    busState = TWI_BUSSTATE_UNKNOWN_gc;
+    hold = HOLD_NONE;
+    actionPending = false;
+    quickRead = false;
+    busFreeAtNs = 0;
+    active = nullptr;
+    address10Low = false;
+    selected10 = nullptr;
+    transactionCount = 0;
+    byteCount = 0;
+    busyTimeNs = 0;
+    interruptCount = 0;
+    external = {};
+    stretchTimeNs = 0;
+}
+
+uint32_t HostTwi0::transactions(void)
+{
+    return transactionCount;
+}
+
+uint32_t HostTwi0::bytes(void)
+{
+    return byteCount;
+}
+
+uint64_t HostTwi0::busyNs(void)
+{
+    return busyTimeNs;
+}
+
+uint32_t HostTwi0::isrCalls(void)
+{
+    return interruptCount;
+}
+
+bool HostTwi0::externalWrite(const uint8_t address, const uint8_t *data, const uint16_t length, const uint32_t clockHz)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    bool result {false};
+
+    if (!external.active)
+    {
+        external = {};
+        external.data = data;
+        external.length = length;
+        external.bitNs = 1000000000ULL / clockHz;
+        external.address = address;
+        external.active = true;
+        HostClock::scheduleIn(10 * external.bitNs, externalAddress);   // start, address and ack
+        result = true;
+    }
+
+    return result;
+}
+
+bool HostTwi0::externalBusy(void)
+{
+    return external.active;
+}
+
+uint16_t HostTwi0::externalAcked(void)
+{
+    return external.acked;
+}
+
+uint64_t HostTwi0::stretchedNs(void)
+{
+    return stretchTimeNs;
+}
+
+// *****************************************************************
+// *                                                               *
+// *                   hal.h register interface                    *
+// *                                                               *
+// *****************************************************************
+
+extern "C" uint8_t hal_hostTwi0Read(hal_twi0Reg_t reg)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    uint8_t result {0};
+
+    if (HAL_TWI0_MSTATUS == reg)
+    {
+        result = (uint8_t)(registers[HAL_TWI0_MSTATUS] | busState);
+    } else if (HAL_TWI0_MDATA == reg)
+    {
+        result = registers[HAL_TWI0_MDATA];
+        if ((registers[HAL_TWI0_MCTRLA] & TWI_SMEN_bm) && (HOLD_READ == hold) && !quickRead)
+        {
+            acknowledge();                                          // smart mode: reading data sends ACKACT
+        }
+    } else if (reg <= HAL_TWI0_SADDRMASK)
+    {
+        result = registers[reg];
+    }
+
+    return result;
+}
+
+extern "C" void hal_hostTwi0Write(hal_twi0Reg_t reg, uint8_t value)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    switch (reg)
+    {
+        case HAL_TWI0_MCTRLA:
+            onMasterControlWrite(value);
+            break;
+
+        case HAL_TWI0_MCTRLB:
+            onMasterCommand(value);
+            break;
+
+        case HAL_TWI0_MSTATUS:
+            onMasterStatusWrite(value);
+            break;
+
+        case HAL_TWI0_MADDR:
+            registers[HAL_TWI0_MADDR] = value;
+            if ((registers[HAL_TWI0_MCTRLA] & TWI_ENABLE_bm) && !actionPending &&
+                ((TWI_BUSSTATE_IDLE_gc == busState) || (TWI_BUSSTATE_OWNER_gc == busState)))
+            {
+                startAddress();                                     // unknown bus state: master waits for idle
+            }
+            break;
+
+        case HAL_TWI0_MDATA:
+            registers[HAL_TWI0_MDATA] = value;
+            if ((HOLD_WRITE == hold) && !actionPending)
+            {
+                clearMasterFlags();
+                hold = HOLD_NONE;
+                actionPending = true;
+                HostClock::scheduleIn(9 * bitNs() + stretch(), writeDone);
+            }
+            break;
+
+        case HAL_TWI0_SCTRLA:
+            registers[HAL_TWI0_SCTRLA] = value;
+            deliverSlave();                                         // DIEN/APIEN may have been just enabled
+            break;
+
+        case HAL_TWI0_SCTRLB:
+            onSlaveCommand(value);
+            break;
+
+        case HAL_TWI0_SSTATUS:
+            registers[HAL_TWI0_SSTATUS] &= (uint8_t)~(value & slaveFlags);   // flags only, the clock stays held
+            break;
+
+        default:
+            if (reg <= HAL_TWI0_SADDRMASK)
+            {
+                registers[reg] = value;
+            }
+            break;
+    }
+}
+
+extern "C" __attribute__((weak)) void hal_hostTwi0MasterIsr(void)
+{
+}
+
+extern "C" __attribute__((weak)) void hal_hostTwi0SlaveIsr(void)
+{
+}
@@ -0,0 +1,82 @@
+/**
+ * \file host_twi0.h
+ * \brief   Simulated TWI peripheral of megaAVR-0, tinyAVR-0/1/2 and AVR-Dx parts of host builds.
+ *          Implements the register interface behind hal_twi0Read()/hal_twi0Write():
+ *          writing MADDR sends start (or repeated start) and address, MDATA writes send a byte,
+ *          RIF/WIF are raised with the clock held, and in smart mode (SMEN) reading MDATA
+ *          executes the acknowledge action of MCTRLB and the next byte read. With QCEN an
+ *          acknowledged read address raises RIF at once, without a data byte (quick command).
+ *          Bus phases take the time resulting from MBAUD on the virtual clock. The master
+ *          uses devices attached to the simulated bus of host_twi (HostTwi::attach());
+ *          general call writes of the master are not modelled.
+ *          An external master can write to the slave of the peripheral (SADDR, SSTATUS, SDATA).
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include "hal.h"
+#include "host_clock.h"
+#include "host_twi.h"
+
+namespace HostTwi0
+{
+    /**
+     * \brief   Restores power-on state of the peripheral (bus state unknown until software forces
+     *          it to idle); devices attached to the bus are kept.
+    **/
+    void reset(void);
+
+    /**
+     * \brief Number of transactions (START to STOP) of the master since reset.
+    **/
+    uint32_t transactions(void);
+
+    /**
+     * \brief Number of bytes (including address bytes) transferred since reset.
+    **/
+    uint32_t bytes(void);
+
+    /**
+     * \brief Total time in nanoseconds the master owned the bus since reset.
+    **/
+    uint64_t busyNs(void);
+
+    /**
+     * \brief Number of master (TWI0_TWIM_vect) and slave (TWI0_TWIS_vect) interrupt calls since reset.
+    **/
+    uint32_t isrCalls(void);
+
+    /**
+     * \brief   Starts a write of an external master to the slave of the peripheral.
+     *          The address and every data byte wait until the software writes SCMD
+     *          (clock stretching); the master stops after the first byte which is not acknowledged.
+     *
+     * \param address[in]   7-bit address (0x00 for general call)
+     * \param data[in]      bytes to write; must stay valid until externalBusy() returns false
+     * \param length[in]    number of bytes
+     * \param clockHz[in]   SCL frequency of the external master
+     *
+     * \return true if the write has started, false when another one is in progress.
+    **/
+    bool externalWrite(const uint8_t address, const uint8_t *data, const uint16_t length, const uint32_t clockHz = 100000);
+
+    /**
+     * \brief A method that returns true while the external write is in progress.
+    **/
+    bool externalBusy(void);
+
+    /**
+     * \brief Number of data bytes of the last external write acknowledged by the peripheral.
+    **/
+    uint16_t externalAcked(void);
+
+    /**
+     * \brief Total time in nanoseconds the slave held SCL low during external writes since reset.
+    **/
+    uint64_t stretchedNs(void);
+}
@@ -0,0 +1,161 @@
+/**
+ * \file host_usi.cpp
+ * \brief   Simulated USI peripheral (Universal Serial Interface of ATtiny parts) of host builds.
+ *          Implements the register interface behind hal_usiRead()/hal_usiWrite() in three-wire
+ *          mode: USITC toggles USCK, software (USICLK) or external clock edges shift USIDR and
+ *          count in USISR, and the MSB of USIDR is driven on DO. Pins are those of the simulated
+ *          GPIO layer (HAL_USI_DI_PIN, HAL_USI_DO_PIN, HAL_USI_USCK_PIN), so simulated chips
+ *          listening on them see the same waveform as on the real part.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "host_usi.h"
+#include "host_clock.h"
+#include "host_gpio.h"
+#include <avr/io.h>
+
+namespace
+{
+    constexpr uint8_t   counterMask     {0x0F};
+    constexpr uint8_t   flagsMask       {_BV(USISIF) | _BV(USIOIF) | _BV(USIPF)};
+    constexpr uint8_t   strobesMask     {_BV(USICLK) | _BV(USITC)};
+
+    uint8_t     dataRegister    {0};
+    uint8_t     statusRegister  {0};
+    uint8_t     controlRegister {0};
+    uint32_t    writeCostNs     {0};
+    uint32_t    shiftCount      {0};
+
+    inline bool threeWire(void)
+    {
+        return (_BV(USIWM0) == (controlRegister & (_BV(USIWM1) | _BV(USIWM0))));
+    }
+
+    inline uint8_t clockSource(void)
+    {
+        return (controlRegister >> USICS0) & 0x03;
+    }
+
+    void driveOutput(void)
+    {
+        if (threeWire())
+        {
+            HostGpio::drive(HAL_USI_DO_PIN, 0 != (dataRegister & 0x80));
+        }
+    }
+
+    void count(void)
+    {
+        uint8_t counter {(uint8_t)((statusRegister + 1) & counterMask)};
+
+        statusRegister = (uint8_t)((statusRegister & (uint8_t)~counterMask) | counter);
+        if (0 == counter)
+        {
+            statusRegister |= _BV(USIOIF);
+        }
+    }
+
+    void shift(void)
+    {
+        dataRegister = (uint8_t)((dataRegister << 1) | (HostGpio::level(HAL_USI_DI_PIN) ? 0x01 : 0x00));
+        shiftCount++;
+        driveOutput();
+    }
+
+    /**
+     * \brief Executes strobes of a USICR write.
+    **/
+    void strobe(const uint8_t value)
+    {
+        const uint8_t source {clockSource()};
+
+        if (0 != (value & _BV(USITC)))
+        {
+            const bool rising {!HostGpio::level(HAL_USI_USCK_PIN)};
+
+            HostGpio::drive(HAL_USI_USCK_PIN, rising);
+            if (source >= 0x02)                                     // external clock: the pin edge shifts the data
+            {
+                if (rising == (0x02 == source))
+                {
+                    shift();
+                }
+                count();                                            // by USITC strobes (USICLK) or by both edges: the same here
+            }
+        }
+        if ((0x00 == source) && (0 != (value & _BV(USICLK))))
+        {
+            shift();                                                // software clock strobe shifts and counts
+            count();
+        }
+    }
+}
+
+void HostUsi::reset(void)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    dataRegister = 0;
+    statusRegister = 0;
+    controlRegister = 0;
+    writeCostNs = 0;
+    shiftCount = 0;
+}
+
+void HostUsi::setWriteCostNs(const uint32_t ns)
+{
+    writeCostNs = ns;
+}
+
+uint32_t HostUsi::shifts(void)
+{
+    return shiftCount;
+}
+
+extern "C" uint8_t hal_hostUsiRead(hal_usiReg_t reg)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    uint8_t result {0};
+
+    switch (reg)
+    {
+        case HAL_USIDR: result = dataRegister;      break;
+        case HAL_USISR: result = statusRegister;    break;
+        case HAL_USICR: result = controlRegister;   break;
+        default:                                    break;
+    }
+
+    return result;
+}
+
+extern "C" void hal_hostUsiWrite(hal_usiReg_t reg, uint8_t value)
+{
+    std::lock_guard<std::recursive_mutex> guard {HostClock::mutex()};
+
+    HostClock::advanceNs(writeCostNs);
+    switch (reg)
+    {
+        case HAL_USIDR:
+            dataRegister = value;
+            driveOutput();
+            break;
+
+        case HAL_USISR:
+            statusRegister = (uint8_t)((statusRegister & flagsMask & (uint8_t)~value) | (value & counterMask));
+            break;
+
+        case HAL_USICR:
+            controlRegister = (uint8_t)(value & (uint8_t)~strobesMask);
+            driveOutput();
+            strobe(value);
+            break;
+
+        default:
+            break;
+    }
+}
@@ -0,0 +1,39 @@
+/**
+ * \file host_usi.h
+ * \brief   Simulated USI peripheral (Universal Serial Interface of ATtiny parts) of host builds.
+ *          Implements the register interface behind hal_usiRead()/hal_usiWrite() in three-wire
+ *          mode: USITC toggles USCK, software (USICLK) or external clock edges shift USIDR and
+ *          count in USISR, and the MSB of USIDR is driven on DO. Pins are those of the simulated
+ *          GPIO layer (HAL_USI_DI_PIN, HAL_USI_DO_PIN, HAL_USI_USCK_PIN), so simulated chips
+ *          listening on them see the same waveform as on the real part.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include "hal.h"
+
+namespace HostUsi
+{
+    /**
+     * \brief Restores power-on state of the peripheral.
+    **/
+    void reset(void);
+
+    /**
+     * \brief   Sets the time consumed by a single register write, e.g. 125 ns (one 'out' instruction)
+     *          for an 8 MHz ATtiny.
+     *
+     * \param ns[in] cost of a single write in nanoseconds; 0 (default) means writes are free
+    **/
+    void setWriteCostNs(const uint32_t ns);
+
+    /**
+     * \brief Number of USIDR shifts since reset.
+    **/
+    uint32_t shifts(void);
+}
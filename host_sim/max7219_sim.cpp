@@ -0,0 +1,179 @@
+/**
+ * \file    max7219_sim.cpp
+ * \brief   Host-side model of a daisy chain of MAX7219 LED display drivers.
+ *          Shifts DIN into the chain on every CLK rising edge (every chip passes
+ *          the bit shifted out of its 16-bit register to the next one) and latches
+ *          all registers on LOAD (CS) rising edge, the way the real chips do.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "max7219_sim.h"
+
+Max7219Sim::Max7219Sim(const uint8_t csPin, const uint8_t clkPin, const uint8_t dataPin, const uint8_t numDevices)
+    : _csPin(csPin), _clkPin(clkPin), _dataPin(dataPin),
+      _numDevices((0 == numDevices) ? 1 : ((numDevices > maxDevices) ? maxDevices : numDevices))
+{
+    powerOn();
+    HostGpio::attach(_csPin, this);
+    HostGpio::attach(_clkPin, this);
+}
+
+Max7219Sim::~Max7219Sim(void)
+{
+    HostGpio::detach(this);
+}
+
+void Max7219Sim::powerOn(void)
+{
+    for (uint8_t idx = 0; idx < maxDevices; idx++)
+    {
+        _chips[idx] = {};
+        _chips[idx].shutdown = true;
+    }
+    _frames = 0;
+    _bits = 0;
+    _bitsInFrame = 0;
+    _framingErrors = 0;
+}
+
+uint8_t Max7219Sim::numDevices(void) const
+{
+    return _numDevices;
+}
+
+uint8_t Max7219Sim::digit(const uint8_t device, const uint8_t position) const
+{
+    return ((device < _numDevices) && (position < 8)) ? _chips[device].digits[position] : 0;
+}
+
+uint8_t Max7219Sim::decodeMode(const uint8_t device) const
+{
+    return (device < _numDevices) ? _chips[device].decodeMode : 0;
+}
+
+uint8_t Max7219Sim::intensity(const uint8_t device) const
+{
+    return (device < _numDevices) ? _chips[device].intensity : 0;
+}
+
+uint8_t Max7219Sim::scanLimit(const uint8_t device) const
+{
+    return (device < _numDevices) ? _chips[device].scanLimit : 0;
+}
+
+bool Max7219Sim::isShutdown(const uint8_t device) const
+{
+    return (device < _numDevices) ? _chips[device].shutdown : true;
+}
+
+bool Max7219Sim::isTest(const uint8_t device) const
+{
+    return (device < _numDevices) ? _chips[device].test : false;
+}
+
+uint16_t Max7219Sim::lastWord(const uint8_t device) const
+{
+    return (device < _numDevices) ? _chips[device].lastWord : 0;
+}
+
+uint32_t Max7219Sim::frames(void) const
+{
+    return _frames;
+}
+
+uint32_t Max7219Sim::bits(void) const
+{
+    return _bits;
+}
+
+uint32_t Max7219Sim::framingErrors(void) const
+{
+    return _framingErrors;
+}
+
+void Max7219Sim::onPinChange(const uint8_t pin, const bool level, const uint64_t timeNs)
+{
+    (void)timeNs;
+
+    if (level && (pin == _clkPin))
+    {
+        shiftIn(HostGpio::level(_dataPin));
+    } else if (level && (pin == _csPin))
+    {
+        _frames++;
+        if (0 != (_bitsInFrame % 16))
+        {
+            _framingErrors++;
+        }
+        _bitsInFrame = 0;
+        for (uint8_t idx = 0; idx < _numDevices; idx++)
+        {
+            execute(_chips[idx], _chips[idx].shift);
+        }
+    }
+}
+
+// *****************************************************************
+// *                                                               *
+// *                       protected methods                       *
+// *                                                               *
+// *****************************************************************
+
+void Max7219Sim::shiftIn(const bool bit)
+{
+    bool carry {bit};
+
+    for (uint8_t idx = 0; idx < _numDevices; idx++)
+    {
+        bool out {0 != (_chips[idx].shift & 0x8000)};
+
+        _chips[idx].shift = (uint16_t)((_chips[idx].shift << 1) | (carry ? 1 : 0));
+        carry = out;                                                // DOUT of this chip feeds DIN of the next one
+    }
+    _bits++;
+    _bitsInFrame++;
+}
+
+void Max7219Sim::execute(chip_t &chip, const uint16_t word)
+{
+    const uint8_t reg   {(uint8_t)((word >> 8) & 0x0F)};
+    const uint8_t data  {(uint8_t)(word & 0xFF)};
+
+    chip.lastWord = word;
+    switch (reg)
+    {
+        case 0x00:                                                  // no-op
+            break;
+
+        case 0x09:
+            chip.decodeMode = data;
+            break;
+
+        case 0x0A:
+            chip.intensity = data & 0x0F;
+            break;
+
+        case 0x0B:
+            chip.scanLimit = data & 0x07;
+            break;
+
+        case 0x0C:
+            chip.shutdown = (0 == (data & 0x01));
+            break;
+
+        case 0x0F:
+            chip.test = (0 != (data & 0x01));
+            break;
+
+        default:
+            if (reg <= 0x08)
+            {
+                chip.digits[reg - 1] = data;
+            }
+            break;
+    }
+}
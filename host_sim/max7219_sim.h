@@ -0,0 +1,141 @@
+/**
+ * \file    max7219_sim.h
+ * \brief   Host-side model of a daisy chain of MAX7219 LED display drivers.
+ *          Shifts DIN into the chain on every CLK rising edge (every chip passes
+ *          the bit shifted out of its 16-bit register to the next one) and latches
+ *          all registers on LOAD (CS) rising edge, the way the real chips do.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include "host_gpio.h"
+
+class Max7219Sim : public HostGpio::Listener
+{
+public:
+    /**
+     * \brief Maximum number of chips in the simulated chain.
+    **/
+    static constexpr uint8_t    maxDevices  {32};
+
+    Max7219Sim(void) = delete;
+
+    /**
+     * \brief Max7219Sim class constructor. Attaches the model to LOAD, CLK and DIN pins.
+     *
+     * \param csPin[in]         LOAD (CS) pin of the chain
+     * \param clkPin[in]        CLK pin of the chain
+     * \param dataPin[in]       DIN pin of the first chip
+     * \param numDevices[in]    number of chips in the chain (up to maxDevices)
+    **/
+    Max7219Sim(const uint8_t csPin, const uint8_t clkPin, const uint8_t dataPin, const uint8_t numDevices);
+
+    /**
+     * \brief Max7219Sim class destructor. Detaches the model from the pins.
+    **/
+    virtual ~Max7219Sim(void);
+
+    /**
+     * \brief Simulates power cycle: registers take their power-on values and statistics are cleared.
+    **/
+    void powerOn(void);
+
+    /**
+     * \brief Number of chips in the chain.
+    **/
+    uint8_t numDevices(void) const;
+
+    /**
+     * \brief   Content of digit register of the chip; chips are numbered from 0,
+     *          starting with the one connected to the microcontroller.
+    **/
+    uint8_t digit(const uint8_t device, const uint8_t position) const;
+
+    /**
+     * \brief Decode-mode register of the chip.
+    **/
+    uint8_t decodeMode(const uint8_t device) const;
+
+    /**
+     * \brief Intensity register of the chip.
+    **/
+    uint8_t intensity(const uint8_t device) const;
+
+    /**
+     * \brief Scan-limit register of the chip.
+    **/
+    uint8_t scanLimit(const uint8_t device) const;
+
+    /**
+     * \brief True when the chip is in shutdown mode (power-on state).
+    **/
+    bool isShutdown(const uint8_t device) const;
+
+    /**
+     * \brief True when the chip is in display-test mode.
+    **/
+    bool isTest(const uint8_t device) const;
+
+    /**
+     * \brief Last 16-bit word (register and data) latched by the chip.
+    **/
+    uint16_t lastWord(const uint8_t device) const;
+
+    /**
+     * \brief Number of LOAD rising edges (latched frames) since power-on.
+    **/
+    uint32_t frames(void) const;
+
+    /**
+     * \brief Number of bits shifted into the chain since power-on.
+    **/
+    uint32_t bits(void) const;
+
+    /**
+     * \brief Number of frames whose length was not a multiple of 16 bits.
+    **/
+    uint32_t framingErrors(void) const;
+
+    virtual void onPinChange(const uint8_t pin, const bool level, const uint64_t timeNs) override;
+
+protected:
+    /**
+     * \brief Registers of a single chip.
+    **/
+    typedef struct
+    {
+        uint16_t    shift;
+        uint16_t    lastWord;
+        uint8_t     digits[8];
+        uint8_t     decodeMode;
+        uint8_t     intensity;
+        uint8_t     scanLimit;
+        bool        shutdown;
+        bool        test;
+    } chip_t;
+
+    const uint8_t   _csPin;
+    const uint8_t   _clkPin;
+    const uint8_t   _dataPin;
+    const uint8_t   _numDevices;
+    chip_t          _chips[maxDevices]  {};
+    uint32_t        _frames             {0};
+    uint32_t        _bits               {0};
+    uint32_t        _bitsInFrame        {0};
+    uint32_t        _framingErrors      {0};
+
+    /**
+     * \brief Shifts one bit into the chain.
+    **/
+    void shiftIn(const bool bit);
+
+    /**
+     * \brief Executes 16-bit word latched by the chip.
+    **/
+    void execute(chip_t &chip, const uint16_t word);
+};
@@ -0,0 +1,192 @@
+/**
+ * \file    mcp402x_sim.cpp
+ * \brief   Host-side model of MCP402x digital potentiometer.
+ *          Decodes CS and U/D edges the way the real chip does, tracks the true wiper
+ *          position and the non-volatile value, and checks every edge against
+ *          datasheet timing minimums.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "mcp402x_sim.h"
+
+namespace
+{
+    constexpr uint8_t   maxWiper    {0x3F};
+}
+
+Mcp402xSim::Mcp402xSim(const uint8_t csPin, const uint8_t udPin, const uint8_t nvValue)
+    : _csPin(csPin), _udPin(udPin), _wiper(nvValue & maxWiper), _nvValue(nvValue & maxWiper)
+{
+    HostGpio::attach(_csPin, this);
+    HostGpio::attach(_udPin, this);
+}
+
+Mcp402xSim::~Mcp402xSim(void)
+{
+    HostGpio::detach(this);
+}
+
+void Mcp402xSim::setTiming(const timing_t &timing)
+{
+    _timing = timing;
+}
+
+void Mcp402xSim::powerOn(void)
+{
+    _wiper = _nvValue;
+    _mode = IDLE;
+    _risingEdges = 0;
+    _udEdgeSinceCs = false;
+    _nvBusyUntilNs = 0;
+    _increments = 0;
+    _decrements = 0;
+    _nvWrites = 0;
+    memset(_violations, 0, sizeof(_violations));
+    _lastViolation = NO_VIOLATION;
+}
+
+uint8_t Mcp402xSim::wiper(void) const
+{
+    return _wiper;
+}
+
+uint8_t Mcp402xSim::nvValue(void) const
+{
+    return _nvValue;
+}
+
+uint32_t Mcp402xSim::increments(void) const
+{
+    return _increments;
+}
+
+uint32_t Mcp402xSim::decrements(void) const
+{
+    return _decrements;
+}
+
+uint32_t Mcp402xSim::nvWrites(void) const
+{
+    return _nvWrites;
+}
+
+uint32_t Mcp402xSim::violations(void) const
+{
+    uint32_t result {0};
+
+    for (uint8_t idx = 0; idx < VIOLATION_TYPES; idx++)
+    {
+        result += _violations[idx];
+    }
+
+    return result;
+}
+
+uint32_t Mcp402xSim::violations(const violation_t type) const
+{
+    return (type < VIOLATION_TYPES) ? _violations[type] : 0;
+}
+
+Mcp402xSim::violation_t Mcp402xSim::lastViolation(void) const
+{
+    return _lastViolation;
+}
+
+void Mcp402xSim::onPinChange(const uint8_t pin, const bool level, const uint64_t timeNs)
+{
+    if (_csPin == pin)
+    {
+        onCsChange(level, timeNs);
+    } else if (_udPin == pin)
+    {
+        onUdChange(level, timeNs);
+    }
+}
+
+// *****************************************************************
+// *                                                               *
+// *                       protected methods                       *
+// *                                                               *
+// *****************************************************************
+
+void Mcp402xSim::check(const bool condition, const violation_t type)
+{
+    if (!condition)
+    {
+        _violations[type]++;
+        _lastViolation = type;
+    }
+}
+
+void Mcp402xSim::onCsChange(const bool level, const uint64_t timeNs)
+{
+    if (!level)
+    {
+        check((timeNs - _udEdgeNs) >= _timing.udToCsNs, UD_TO_CS);
+        check((timeNs - _csEdgeNs) >= _timing.csHighNs, CS_HIGH_TIME);
+        check(timeNs >= _nvBusyUntilNs, NV_WRITE_BUSY);
+
+        // direction of the command is latched from U/D level at CS falling edge
+        _mode = HostGpio::level(_udPin) ? INCREMENT : DECREMENT;
+        _risingEdges = 0;
+        _udEdgeSinceCs = false;
+        if (timeNs < _nvBusyUntilNs)
+        {
+            _mode = IDLE;                                           // chip is busy, command is ignored
+        }
+    } else if (IDLE != _mode)
+    {
+        check((timeNs - _udEdgeNs) >= _timing.udToCsNs, UD_TO_CS);
+
+        // increment mode, U/D pulled low without rising edge, CS released while U/D low: write wiper to EEPROM
+        if ((INCREMENT == _mode) && (0 == _risingEdges) && _udEdgeSinceCs && !HostGpio::level(_udPin))
+        {
+            _nvValue = _wiper;
+            _nvWrites++;
+            _nvBusyUntilNs = timeNs + _timing.nvWriteNs;
+        }
+        _mode = IDLE;
+    }
+    _csEdgeNs = timeNs;
+}
+
+void Mcp402xSim::onUdChange(const bool level, const uint64_t timeNs)
+{
+    if (IDLE != _mode)
+    {
+        if (!_udEdgeSinceCs)
+        {
+            check((timeNs - _csEdgeNs) >= _timing.csLowToUdNs, CS_LOW_TO_UD);
+        } else
+        {
+            // a rising edge ends the low pulse, a falling edge ends the high pulse
+            check((timeNs - _udEdgeNs) >= (level ? _timing.udLowNs : _timing.udHighNs), level ? UD_LOW_TIME : UD_HIGH_TIME);
+        }
+
+        if (level)
+        {
+            _risingEdges++;
+            if (INCREMENT == _mode)
+            {
+                _increments++;
+                if (_wiper < maxWiper)
+                {
+                    _wiper++;
+                }
+            } else
+            {
+                _decrements++;
+                if (_wiper > 0)
+                {
+                    _wiper--;
+                }
+            }
+        }
+        _udEdgeSinceCs = true;
+    }
+    _udEdgeNs = timeNs;
+}
@@ -0,0 +1,156 @@
+/**
+ * \file    mcp402x_sim.h
+ * \brief   Host-side model of MCP402x digital potentiometer.
+ *          Decodes CS and U/D edges the way the real chip does, tracks the true wiper
+ *          position and the non-volatile value, and checks every edge against
+ *          datasheet timing minimums.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include "host_gpio.h"
+
+class Mcp402xSim : public HostGpio::Listener
+{
+public:
+    /**
+     * \brief   Timing minimums (in nanoseconds) checked by the model.
+     *          Default values come from the AC characteristics of the chip's datasheet.
+     *
+     * \param csLowToUdNs       tLCUF / tLCUR - CS low to the first U/D edge
+     * \param udHighNs          tHI - U/D high time
+     * \param udLowNs           tLO - U/D low time
+     * \param udToCsNs          tLUC - last U/D edge to CS edge (setup before CS falling, hold before CS rising)
+     * \param csHighNs          tCSHI - CS high time between commands
+     * \param nvWriteNs         tWC - EEPROM write cycle; the chip ignores commands during it
+    **/
+    typedef struct
+    {
+        uint32_t    csLowToUdNs     {500};
+        uint32_t    udHighNs        {500};
+        uint32_t    udLowNs         {500};
+        uint32_t    udToCsNs        {500};
+        uint32_t    csHighNs        {500};
+        uint32_t    nvWriteNs       {5000000};
+    } timing_t;
+
+    /**
+     * \brief Type describing detected timing violations.
+    **/
+    typedef enum : uint8_t
+    {
+        NO_VIOLATION    = 0x00,
+        CS_LOW_TO_UD    = 0x01,     // U/D edge too early after CS falling edge
+        UD_HIGH_TIME    = 0x02,     // U/D high pulse too short
+        UD_LOW_TIME     = 0x03,     // U/D low pulse too short
+        UD_TO_CS        = 0x04,     // CS edge too early after U/D edge
+        CS_HIGH_TIME    = 0x05,     // CS high time between commands too short
+        NV_WRITE_BUSY   = 0x06,     // command started during EEPROM write cycle
+        VIOLATION_TYPES,
+    } violation_t;
+
+    Mcp402xSim(void) = delete;
+
+    /**
+     * \brief Mcp402xSim class constructor. Attaches the model to CS and U/D pins.
+     *
+     * \param csPin[in]     chip select pin of the simulated chip
+     * \param udPin[in]     U/D pin of the simulated chip
+     * \param nvValue[in]   value stored in chip's EEPROM; loaded to the wiper at power-on
+    **/
+    Mcp402xSim(const uint8_t csPin, const uint8_t udPin, const uint8_t nvValue = 0x1F);
+
+    /**
+     * \brief Mcp402xSim class destructor. Detaches the model from the pins.
+    **/
+    virtual ~Mcp402xSim(void);
+
+    /**
+     * \brief Replaces timing minimums used for validation.
+    **/
+    void setTiming(const timing_t &timing);
+
+    /**
+     * \brief Simulates power cycle: the wiper is reloaded from EEPROM and statistics are cleared.
+    **/
+    void powerOn(void);
+
+    /**
+     * \brief True position of the wiper.
+    **/
+    uint8_t wiper(void) const;
+
+    /**
+     * \brief Value stored in the chip's non-volatile memory.
+    **/
+    uint8_t nvValue(void) const;
+
+    /**
+     * \brief Number of increment steps decoded since power-on (including steps at the end of scale).
+    **/
+    uint32_t increments(void) const;
+
+    /**
+     * \brief Number of decrement steps decoded since power-on (including steps at the end of scale).
+    **/
+    uint32_t decrements(void) const;
+
+    /**
+     * \brief Number of EEPROM writes decoded since power-on.
+    **/
+    uint32_t nvWrites(void) const;
+
+    /**
+     * \brief Total number of timing violations detected since power-on.
+    **/
+    uint32_t violations(void) const;
+
+    /**
+     * \brief Number of violations of the given type detected since power-on.
+    **/
+    uint32_t violations(const violation_t type) const;
+
+    /**
+     * \brief Type of the most recently detected violation.
+    **/
+    violation_t lastViolation(void) const;
+
+    virtual void onPinChange(const uint8_t pin, const bool level, const uint64_t timeNs) override;
+
+protected:
+    /**
+     * \brief Command mode latched on CS falling edge.
+    **/
+    typedef enum : uint8_t
+    {
+        IDLE        = 0x00,
+        INCREMENT   = 0x01,
+        DECREMENT   = 0x02,
+    } mode_t;
+
+    uint8_t         _csPin;
+    uint8_t         _udPin;
+    uint8_t         _wiper;
+    uint8_t         _nvValue;
+    mode_t          _mode               {IDLE};
+    timing_t        _timing             {};
+    uint8_t         _risingEdges        {0};
+    bool            _udEdgeSinceCs      {false};
+    uint64_t        _csEdgeNs           {0};
+    uint64_t        _udEdgeNs           {0};
+    uint64_t        _nvBusyUntilNs      {0};
+    uint32_t        _increments         {0};
+    uint32_t        _decrements         {0};
+    uint32_t        _nvWrites           {0};
+    uint32_t        _violations[VIOLATION_TYPES] {};
+    violation_t     _lastViolation      {NO_VIOLATION};
+
+    void check(const bool condition, const violation_t type);
+    void onCsChange(const bool level, const uint64_t timeNs);
+    void onUdChange(const bool level, const uint64_t timeNs);
+};
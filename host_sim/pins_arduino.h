@@ -0,0 +1,14 @@
+/**
+ * \file pins_arduino.h
+ * \brief Host-side replacement of the variant pin definitions (ATmega328P layout).
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#define SDA     18
+#define SCL     19
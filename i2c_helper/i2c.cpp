@@ -9,6 +9,68 @@
  */
 
 #include "i2c.h"
+#include "profiler.h"
+
+namespace
+{
+    bool    repeatedStartHeld   {false};                            // bus lock kept until the transaction is stopped
+
+    /**
+     * \brief   Releases the bus taken at the beginning of an operation. When the operation
+     *          ended without stop (repeated start follows), the bus stays taken by the task
+     *          until the transaction is finished by a later operation.
+    **/
+    void releaseBus(TwoWire *wire, const bool stopSent)
+    {
+        if (stopSent)
+        {
+            if (repeatedStartHeld)
+            {
+                repeatedStartHeld = false;
+                wire->unlock();
+            }
+            wire->unlock();
+        } else if (repeatedStartHeld)
+        {
+            wire->unlock();
+        } else
+        {
+            repeatedStartHeld = true;
+        }
+    }
+
+    /**
+     * \brief Starts transmission to the device, with 7-bit or 10-bit address as set in context.
+    **/
+    void beginTransmission(const I2C::context_t *ctx)
+    {
+        if (I2C::ADDRESS_10BIT == ctx->addressMode)
+        {
+            ctx->wire->beginTransmission10(ctx->devAddress);
+        } else
+        {
+            ctx->wire->beginTransmission((uint8_t)ctx->devAddress);
+        }
+    }
+
+    /**
+     * \brief Reads readLen bytes from the device, with 7-bit or 10-bit address as set in context.
+    **/
+    uint8_t requestFrom(const I2C::context_t *ctx)
+    {
+        uint8_t result {0};
+
+        if (I2C::ADDRESS_10BIT == ctx->addressMode)
+        {
+            result = ctx->wire->requestFrom10(ctx->devAddress, ctx->readLen, (uint8_t)ctx->stopAfterRead);
+        } else
+        {
+            result = ctx->wire->requestFrom((uint8_t)(ctx->devAddress), (uint8_t)(ctx->readLen), (uint8_t)ctx->stopAfterRead);
+        }
+
+        return result;
+    }
+}
 
 bool I2C::isDevicePresent(context_t *ctx)
 {
@@ -16,9 +78,11 @@ bool I2C::isDevicePresent(context_t *ctx)
 
     if (nullptr != ctx->wire)
     {
-        ctx->wire->beginTransmission(ctx->devAddress);
+        ctx->wire->lock();
+        beginTransmission(ctx);
 
         result = (I2C::SUCCESS == ctx->wire->endTransmission());
+        releaseBus(ctx->wire, true);
     }
 
     return result;
@@ -26,6 +90,7 @@ bool I2C::isDevicePresent(context_t *ctx)
 
 uint8_t I2C::readBytes(context_t *ctx)
 {
+    PROFILE_SCOPE(PROFILER_ZONE_I2C_READ_BYTES);
     uint8_t resultCode {I2C::OTHER_ERROR};
 
     if ((nullptr != ctx->wire) && (nullptr != ctx->readBuffer))
@@ -36,14 +101,16 @@ uint8_t I2C::readBytes(context_t *ctx)
             bool    retry       {true};
             bool    matchLen    {false};
 
+            ctx->wire->lock();
             do
             {
-                matchLen = (ctx->readLen == ctx->wire->requestFrom((uint8_t)(ctx->devAddress), (uint8_t)(ctx->readLen), (uint8_t)ctx->stopAfterRead));
+                matchLen = (ctx->readLen == requestFrom(ctx));
                 retry = !matchLen && retries--;
             } while (retry);
 
             if (matchLen)
             {
+                ctx->wire->getReadTimestamps(ctx->ackMicros, ctx->sampleMicros);
                 for (uint8_t idx = 0; idx < ctx->readLen; idx++)
                 {
                     ctx->readBuffer[idx] = ctx->wire->read();
@@ -51,12 +118,15 @@ uint8_t I2C::readBytes(context_t *ctx)
                 resultCode = I2C::SUCCESS;
             } else
             {
+                ctx->ackMicros = 0;
+                ctx->sampleMicros = 0;
                 while(ctx->wire->available())
                 {
                     ctx->wire->read();
                 }
                 resultCode = I2C::WRONG_DATA_AMOUNT;
             }
+            releaseBus(ctx->wire, ctx->stopAfterRead || !matchLen);
         } else
         {
             resultCode = (0 == ctx->readLen) ? I2C::WRONG_DATA_AMOUNT : I2C::DATA_TOO_LONG;
@@ -74,13 +144,41 @@ uint8_t I2C::writeBytes(context_t *ctx)
     {
         if ((ctx->writeLen > 0) && (ctx->writeLen <= BUFFER_SIZE))
         {
-            ctx->wire->beginTransmission(ctx->devAddress);
+            ctx->wire->lock();
+            beginTransmission(ctx);
             for (uint8_t idx = 0; idx < ctx->writeLen; idx++)
             {
                 ctx->wire->write(ctx->writeBuffer[idx]);
             }
 
             resultCode = ctx->wire->endTransmission(ctx->stopAfterWrite);
+            releaseBus(ctx->wire, ctx->stopAfterWrite || (I2C::SUCCESS != resultCode));
+        } else
+        {
+            resultCode = (0 == ctx->writeLen) ? I2C::WRONG_DATA_AMOUNT : I2C::DATA_TOO_LONG;
+        }
+    }
+
+    return resultCode;
+}
+
+uint8_t I2C::generalCall(context_t *ctx)
+{
+    uint8_t resultCode {I2C::OTHER_ERROR};
+
+    if ((nullptr != ctx->wire) && (nullptr != ctx->writeBuffer))
+    {
+        if ((ctx->writeLen > 0) && (ctx->writeLen <= BUFFER_SIZE))
+        {
+            ctx->wire->lock();
+            ctx->wire->beginTransmission(GENERAL_CALL_ADDRESS);
+            for (uint8_t idx = 0; idx < ctx->writeLen; idx++)
+            {
+                ctx->wire->write(ctx->writeBuffer[idx]);
+            }
+
+            resultCode = ctx->wire->endTransmission(true);
+            releaseBus(ctx->wire, true);
         } else
         {
             resultCode = (0 == ctx->writeLen) ? I2C::WRONG_DATA_AMOUNT : I2C::DATA_TOO_LONG;
@@ -92,11 +190,17 @@ uint8_t I2C::writeBytes(context_t *ctx)
 
 uint8_t I2C::writeThenReadBytes(context_t *ctx)
 {
-    uint8_t resultCode {writeBytes(ctx)};
+    uint8_t resultCode {I2C::OTHER_ERROR};
 
-    if (I2C::SUCCESS == resultCode)
+    if (nullptr != ctx->wire)
     {
-        resultCode = readBytes(ctx);
+        ctx->wire->lock();                                          // no other transaction between write and read
+        resultCode = writeBytes(ctx);
+        if (I2C::SUCCESS == resultCode)
+        {
+            resultCode = readBytes(ctx);
+        }
+        ctx->wire->unlock();
     }
 
     return resultCode;
@@ -39,6 +39,15 @@ namespace I2C
         SEND_STOP           = true,
     } stopBit_t;
 
+    /**
+     * \brief Type that determines how devAddress of context is sent on the bus.
+    **/
+    typedef enum : uint8_t
+    {
+        ADDRESS_7BIT        = 0x00,
+        ADDRESS_10BIT       = 0x01,
+    } addressMode_t;
+
     /**
      * \brief Context in which all transmission settings and pointers to data buffers for a given chip are stored.
      * 
@@ -46,22 +55,33 @@ namespace I2C
      *                              for data transmission over the I2C bus.
      * \param[in]   writeBuffer     A pointer to a buffer with data to write to.
      * \param[out]  readBuffer      A pointer to a buffer with data to read.
-     * \param[in]   devAddress      Address of slave device on I2C bus with which we will communicate.
+     * \param[in]   devAddress      Address of slave device on I2C bus with which we will communicate
+     *                              (7-bit, or 10-bit when addressMode is ADDRESS_10BIT).
      * \param[in]   writeLen        Amount of data to write to slave device.
      * \param[in]   readLen         Amount of data to read from slave device.
      * \param[in]   stopAfterWrite  Indicates whether to send a stop bit after writing.
      * \param[in]   stopAfterRead   Indicates whether to send a stop bit after reading.
+     * \param[in]   addressMode     Length of devAddress; ADDRESS_7BIT (default) or ADDRESS_10BIT.
+     * \param[out]  ackMicros       micros() latched in TWI interrupt when the device acknowledged
+     *                              the read address in the last successful readBytes(), 0 otherwise.
+     * \param[out]  sampleMicros    micros() latched in TWI interrupt when the first data byte of the last
+     *                              successful readBytes() was received - the moment the sample was taken.
+     *
+     *          Outputs are the last fields, so a context can be initialized with the inputs only.
     **/
     typedef struct
     {
         TwoWire           * wire;
         uint8_t           * writeBuffer;
         uint8_t           * readBuffer;
-        uint8_t             devAddress;
+        uint16_t            devAddress;
         uint8_t             writeLen;
         uint8_t             readLen;
         bool                stopAfterWrite;
         bool                stopAfterRead;
+        addressMode_t       addressMode;
+        uint32_t            ackMicros;
+        uint32_t            sampleMicros;
     } context_t;
 
     /**
@@ -75,6 +95,21 @@ namespace I2C
     **/
     constexpr uint8_t RETRIES       {20};
 
+    /**
+     * \brief General call address; a write to it is received by all devices that answer general calls.
+    **/
+    constexpr uint8_t GENERAL_CALL_ADDRESS          {0x00};
+
+    /**
+     * \brief Second byte of general call: reset and write programmable part of slave address.
+    **/
+    constexpr uint8_t GENERAL_CALL_RESET            {0x06};
+
+    /**
+     * \brief Second byte of general call: write programmable part of slave address.
+    **/
+    constexpr uint8_t GENERAL_CALL_LATCH_ADDRESS    {0x04};
+
     /**
      * \brief A method that checks whether a slave device with address indicated in context is available on the I2C bus.
      * 
@@ -123,4 +158,17 @@ namespace I2C
      *          Status of operations of results_t type (uint8_t) is also returned.
     **/
     uint8_t writeThenReadBytes(context_t *ctx);
+
+    /**
+     * \brief   A method that broadcasts n bytes with general call (address 0x00), e.g.
+     *          GENERAL_CALL_RESET or a synchronous latch command shared by a family of devices.
+     *          Data is taken from writeBuffer/writeLen of the context, devAddress is not used.
+     *          The transmission always ends with a stop bit.
+     *
+     * \param ctx[in] Current I2C context.
+     *
+     * \return  Operation status of results_t (uint8_t) type is returned; NACK_AFTER_ADDRESS
+     *          means that no device on the bus answers general calls.
+    **/
+    uint8_t generalCall(context_t *ctx);
 }
@@ -0,0 +1,245 @@
+/**
+ * \file    i2c_cache.cpp
+ * \brief   Shared read cache of I2C device registers.
+ *          Modules reading the same registers of a sensor within a short time get the data
+ *          from RAM instead of the bus. Entries are keyed by (bus, device, register, length);
+ *          every consumer states the age of data it still accepts (time-to-live), so a fast
+ *          control loop and a slow logger can share one entry. Requests for an entry which is
+ *          being read by another task wait for that read instead of starting their own.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "i2c_cache.h"
+#include "hal_os.h"
+
+namespace
+{
+    typedef struct
+    {
+        TwoWire            *wire;                                   // nullptr marks a free entry
+        uint16_t            devAddress;
+        I2C::addressMode_t  addressMode;
+        bool                hasRegister;
+        uint8_t             reg;
+        uint8_t             length;
+        bool                valid;                                  // data holds result of a successful read
+        bool                inFlight;                               // bus read of the entry is in progress
+        uint32_t            readMillis;                             // hal_millis() at the start of the read
+        uint32_t            ackMicros;
+        uint32_t            sampleMicros;
+        uint8_t             data[I2CCache::maxLength];
+    } entry_t;
+
+    constexpr uint32_t  settledWaitUs   {1000};                     // several tasks may wait, one signal wakes one of them
+
+    entry_t     entries[I2CCache::maxEntries]   {};
+    hal_mutex_t mutex                           {};                 // guards entries and counters
+    hal_event_t settled                         {};                 // signalled when a read in progress ends
+    uint32_t    hitCount                        {0};
+    uint32_t    missCount                       {0};
+
+    inline uint8_t busRead(I2C::context_t *ctx)
+    {
+        return (0 != ctx->writeLen) ? I2C::writeThenReadBytes(ctx) : I2C::readBytes(ctx);
+    }
+
+    inline bool sameDevice(const entry_t &entry, const I2C::context_t *ctx)
+    {
+        return (entry.wire == ctx->wire) && (entry.devAddress == ctx->devAddress) && (entry.addressMode == ctx->addressMode);
+    }
+
+    entry_t *find(const I2C::context_t *ctx)
+    {
+        entry_t *result {nullptr};
+
+        for (uint8_t idx = 0; idx < I2CCache::maxEntries; idx++)
+        {
+            entry_t &entry {entries[idx]};
+
+            if (sameDevice(entry, ctx) && (entry.length == ctx->readLen) && (entry.hasRegister == (1 == ctx->writeLen)) &&
+                (!entry.hasRegister || (entry.reg == ctx->writeBuffer[0])))
+            {
+                result = &entry;
+                break;
+            }
+        }
+
+        return result;
+    }
+
+    /**
+     * \brief Free entry, or the one read longest ago; nullptr when all entries are being read.
+    **/
+    entry_t *victim(void)
+    {
+        entry_t        *result  {nullptr};
+        const uint32_t  now     {hal_millis()};
+
+        for (uint8_t idx = 0; idx < I2CCache::maxEntries; idx++)
+        {
+            entry_t &entry {entries[idx]};
+
+            if (nullptr == entry.wire)
+            {
+                result = &entry;
+                break;
+            }
+            if (!entry.inFlight && ((nullptr == result) || ((now - entry.readMillis) > (now - result->readMillis))))
+            {
+                result = &entry;
+            }
+        }
+
+        return result;
+    }
+
+    inline void copyOut(const entry_t &entry, I2C::context_t *ctx)
+    {
+        for (uint8_t idx = 0; idx < entry.length; idx++)
+        {
+            ctx->readBuffer[idx] = entry.data[idx];
+        }
+        ctx->ackMicros = entry.ackMicros;
+        ctx->sampleMicros = entry.sampleMicros;
+    }
+
+    /**
+     * \brief   Reads the entry from the bus. Called with the mutex taken, which is released for the time
+     *          of the transaction; the entry is marked as in flight meanwhile.
+    **/
+    uint8_t fill(entry_t &entry, I2C::context_t *ctx)
+    {
+        uint8_t result {I2C::OTHER_ERROR};
+
+        entry.wire = ctx->wire;
+        entry.devAddress = ctx->devAddress;
+        entry.addressMode = ctx->addressMode;
+        entry.hasRegister = (1 == ctx->writeLen);
+        entry.reg = entry.hasRegister ? ctx->writeBuffer[0] : 0;
+        entry.length = ctx->readLen;
+        entry.valid = false;
+        entry.inFlight = true;
+        entry.readMillis = hal_millis();
+        missCount++;
+        hal_mutexUnlock(&mutex);
+
+        result = busRead(ctx);
+
+        hal_mutexLock(&mutex);
+        if (I2C::SUCCESS == result)
+        {
+            for (uint8_t idx = 0; idx < entry.length; idx++)
+            {
+                entry.data[idx] = ctx->readBuffer[idx];
+            }
+            entry.ackMicros = ctx->ackMicros;
+            entry.sampleMicros = ctx->sampleMicros;
+            entry.valid = true;
+        }
+        entry.inFlight = false;
+        hal_eventSignal(&settled);
+
+        return result;
+    }
+}
+
+void I2CCache::begin(void)
+{
+    hal_mutexInit(&mutex);
+    hal_eventInit(&settled);
+    clear();
+}
+
+uint8_t I2CCache::read(I2C::context_t *ctx, const uint16_t ttlMs)
+{
+    uint8_t result {I2C::OTHER_ERROR};
+
+    if ((nullptr == ctx->wire) || (nullptr == ctx->readBuffer) || (1 < ctx->writeLen) ||
+        ((1 == ctx->writeLen) && (nullptr == ctx->writeBuffer)) ||
+        (0 == ctx->readLen) || (maxLength < ctx->readLen) || !ctx->stopAfterRead)
+    {
+        result = busRead(ctx);
+    } else
+    {
+        bool done {false};
+
+        hal_mutexLock(&mutex);
+        while (!done)
+        {
+            entry_t *entry {find(ctx)};
+
+            if ((nullptr != entry) && entry->inFlight)
+            {
+                hal_mutexUnlock(&mutex);                            // another task reads the same data, take its result
+                hal_eventWait(&settled, settledWaitUs);
+                hal_mutexLock(&mutex);
+            } else if ((nullptr != entry) && entry->valid && ((hal_millis() - entry->readMillis) < ttlMs))
+            {
+                copyOut(*entry, ctx);
+                hitCount++;
+                result = I2C::SUCCESS;
+                done = true;
+            } else
+            {
+                if (nullptr == entry)
+                {
+                    entry = victim();
+                }
+                if (nullptr != entry)
+                {
+                    result = fill(*entry, ctx);
+                } else
+                {
+                    hal_mutexUnlock(&mutex);                        // all entries are being read, bypass the cache
+                    result = busRead(ctx);
+                    hal_mutexLock(&mutex);
+                }
+                done = true;
+            }
+        }
+        hal_mutexUnlock(&mutex);
+    }
+
+    return result;
+}
+
+void I2CCache::invalidate(const I2C::context_t *ctx)
+{
+    hal_mutexLock(&mutex);
+    for (uint8_t idx = 0; idx < maxEntries; idx++)
+    {
+        if (sameDevice(entries[idx], ctx))
+        {
+            entries[idx].valid = false;
+        }
+    }
+    hal_mutexUnlock(&mutex);
+}
+
+void I2CCache::clear(void)
+{
+    hal_mutexLock(&mutex);
+    for (uint8_t idx = 0; idx < maxEntries; idx++)
+    {
+        if (!entries[idx].inFlight)
+        {
+            entries[idx].wire = nullptr;
+            entries[idx].valid = false;
+        }
+    }
+    hitCount = 0;
+    missCount = 0;
+    hal_mutexUnlock(&mutex);
+}
+
+void I2CCache::statistics(uint32_t &hits, uint32_t &misses)
+{
+    hal_mutexLock(&mutex);
+    hits = hitCount;
+    misses = missCount;
+    hal_mutexUnlock(&mutex);
+}
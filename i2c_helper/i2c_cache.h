@@ -0,0 +1,81 @@
+/**
+ * \file    i2c_cache.h
+ * \brief   Shared read cache of I2C device registers.
+ *          Modules reading the same registers of a sensor within a short time get the data
+ *          from RAM instead of the bus. Entries are keyed by (bus, device, register, length);
+ *          every consumer states the age of data it still accepts (time-to-live), so a fast
+ *          control loop and a slow logger can share one entry. Requests for an entry which is
+ *          being read by another task wait for that read instead of starting their own.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include "i2c.h"
+
+#ifndef I2C_CACHE_MAX_ENTRIES
+#define I2C_CACHE_MAX_ENTRIES   4
+#endif
+
+#ifndef I2C_CACHE_MAX_LENGTH
+#define I2C_CACHE_MAX_LENGTH    6
+#endif
+
+namespace I2CCache
+{
+    /**
+     * \brief Number of cached (device, register, length) entries; the least recently read one is replaced.
+    **/
+    constexpr uint8_t   maxEntries  {I2C_CACHE_MAX_ENTRIES};
+
+    /**
+     * \brief Longest cached read; longer reads go to the bus every time.
+    **/
+    constexpr uint8_t   maxLength   {I2C_CACHE_MAX_LENGTH};
+
+    /**
+     * \brief Prepares locks of the cache; to be called once, before tasks using the cache are started.
+    **/
+    void begin(void);
+
+    /**
+     * \brief   Reads readLen bytes of the device like I2C::readBytes() (writeLen 0) or
+     *          I2C::writeThenReadBytes() with one register byte (writeLen 1), unless
+     *          the same data was read less than ttlMs milliseconds ago. Other contexts
+     *          (longer register pointer or read, no stop after read) always use the bus.
+     *          Timestamps of the context (ackMicros, sampleMicros) are those of the bus read,
+     *          so the consumer knows the real age of the sample. Failed reads are not cached.
+     *          Must not be called from an interrupt.
+     *
+     * \param ctx[in,out]   Current I2C device context.
+     * \param ttlMs[in]     maximum age of cached data in milliseconds; 0 forces a bus read
+     *
+     * \return Operation status of results_t (uint8_t) type, as of the bus read which provided the data.
+    **/
+    uint8_t read(I2C::context_t *ctx, const uint16_t ttlMs);
+
+    /**
+     * \brief   Drops all entries of the device, e.g. after a write changing its configuration.
+     *
+     * \param ctx[in] Current I2C device context.
+    **/
+    void invalidate(const I2C::context_t *ctx);
+
+    /**
+     * \brief Drops all entries.
+    **/
+    void clear(void);
+
+    /**
+     * \brief   Number of reads served from the cache and of reads that went to the bus
+     *          since begin() or clear().
+     *
+     * \param hits[out]     reads served from RAM (including those waiting for a read in progress)
+     * \param misses[out]   reads performed on the bus
+    **/
+    void statistics(uint32_t &hits, uint32_t &misses);
+}
@@ -0,0 +1,238 @@
+/**
+ * \file    i2c_events.cpp
+ * \brief   Event driven reads of I2C devices signalling new data on a pin.
+ *          Instead of polling, a device context is registered together with its data ready
+ *          (DRDY) or SMBus alert (SMBALERT#) pin. The pin change interrupt only marks the device
+ *          as pending and the read is performed later by service(), outside the interrupt,
+ *          so the bus is used only when there is data. Devices sharing one SMBALERT# line
+ *          are told apart with the Alert Response Address read.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "i2c_events.h"
+#include "hal.h"
+
+#if defined(__AVR__) || defined(HAL_BACKEND_HOST)
+#include <avr/interrupt.h>
+#endif
+
+namespace
+{
+    typedef struct
+    {
+        I2C::context_t         *ctx;                                // nullptr marks a free slot
+        I2CEvents::callback_t   onRead;
+        uint8_t                 pin;
+        I2CEvents::signal_t     signal;
+        uint8_t                 activeLevel;
+        volatile bool           pending;
+    } source_t;
+
+    source_t    sources[I2CEvents::maxSources]  {};
+
+    inline bool isActive(const source_t &source)
+    {
+        return (source.activeLevel == hal_digitalRead(source.pin));
+    }
+
+    bool pinInUse(const uint8_t pin)
+    {
+        bool result {false};
+
+        for (uint8_t idx = 0; idx < I2CEvents::maxSources; idx++)
+        {
+            if ((nullptr != sources[idx].ctx) && (pin == sources[idx].pin))
+            {
+                result = true;
+                break;
+            }
+        }
+
+        return result;
+    }
+
+    void read(source_t &source)
+    {
+        uint8_t result {(0 != source.ctx->writeLen) ? I2C::writeThenReadBytes(source.ctx) : I2C::readBytes(source.ctx)};
+
+        if (nullptr != source.onRead)
+        {
+            source.onRead(source.ctx, result);
+        }
+    }
+
+    /**
+     * \brief   Asks devices on the SMBALERT# line which one is alerting (Alert Response Address read).
+     *          The device with the lowest address wins arbitration and releases the line;
+     *          the others keep it low and are found in the next rounds.
+     *
+     * \return index of the alerting source, or maxSources when nobody answered or the address is unknown.
+    **/
+    uint8_t alertingSource(const source_t &line)
+    {
+        uint8_t result {I2CEvents::maxSources};
+
+        line.ctx->wire->lock();
+        if (1 == line.ctx->wire->requestFrom(I2CEvents::ALERT_RESPONSE_ADDRESS, (uint8_t)1, (uint8_t)true))
+        {
+            const uint8_t address {(uint8_t)(line.ctx->wire->read() >> 1)};
+
+            for (uint8_t idx = 0; idx < I2CEvents::maxSources; idx++)
+            {
+                if ((nullptr != sources[idx].ctx) && (I2CEvents::SMBUS_ALERT == sources[idx].signal) &&
+                    (line.pin == sources[idx].pin) && (I2C::ADDRESS_7BIT == sources[idx].ctx->addressMode) &&
+                    (address == sources[idx].ctx->devAddress))
+                {
+                    result = idx;
+                    break;
+                }
+            }
+        }
+        line.ctx->wire->unlock();
+
+        return result;
+    }
+}
+
+bool I2CEvents::registerSource(I2C::context_t &ctx, const uint8_t pin, const signal_t signal,
+                               const callback_t onRead, const uint8_t activeLevel)
+{
+    bool result {false};
+
+    for (uint8_t idx = 0; idx < maxSources; idx++)
+    {
+        if (nullptr == sources[idx].ctx)
+        {
+            hal_pinMode(pin, (SMBUS_ALERT == signal) ? INPUT_PULLUP : INPUT);
+
+            uint8_t irq {hal_irqSave()};
+            sources[idx].onRead = onRead;
+            sources[idx].pin = pin;
+            sources[idx].signal = signal;
+            sources[idx].activeLevel = (SMBUS_ALERT == signal) ? LOW : activeLevel;
+            sources[idx].pending = isActive(sources[idx]);          // data may be waiting already
+            sources[idx].ctx = &ctx;
+            hal_irqRestore(irq);
+            hal_pinChangeEnable(pin);
+            result = true;
+            break;
+        }
+    }
+
+    return result;
+}
+
+bool I2CEvents::unregisterSource(I2C::context_t &ctx)
+{
+    bool result {false};
+
+    for (uint8_t idx = 0; idx < maxSources; idx++)
+    {
+        if (&ctx == sources[idx].ctx)
+        {
+            sources[idx].ctx = nullptr;
+            sources[idx].pending = false;
+            if (!pinInUse(sources[idx].pin))
+            {
+                hal_pinChangeDisable(sources[idx].pin);
+            }
+            result = true;
+        }
+    }
+
+    return result;
+}
+
+void I2CEvents::onPinChange(void)
+{
+    for (uint8_t idx = 0; idx < maxSources; idx++)
+    {
+        if ((nullptr != sources[idx].ctx) && isActive(sources[idx]))
+        {
+            sources[idx].pending = true;
+        }
+    }
+}
+
+uint8_t I2CEvents::service(void)
+{
+    uint8_t result {0};
+
+    for (uint8_t idx = 0; idx < maxSources; idx++)
+    {
+        source_t &source {sources[idx]};
+
+        if ((nullptr != source.ctx) && source.pending)
+        {
+            source.pending = false;
+            if (SMBUS_ALERT == source.signal)
+            {
+                for (uint8_t other = idx + 1; other < maxSources; other++)
+                {
+                    if ((nullptr != sources[other].ctx) && (SMBUS_ALERT == sources[other].signal) && (source.pin == sources[other].pin))
+                    {
+                        sources[other].pending = false;             // one response read serves the whole line
+                    }
+                }
+                const uint8_t alerting {alertingSource(source)};
+
+                if (alerting < maxSources)
+                {
+                    read(sources[alerting]);
+                    result++;
+                }
+            } else
+            {
+                read(source);
+                result++;
+            }
+        }
+    }
+    onPinChange();                                                  // signals still active are served in the next call
+
+    return result;
+}
+
+void I2CEvents::task(void *arg)
+{
+    (void)arg;
+
+    service();
+}
+
+uint8_t I2CEvents::pending(void)
+{
+    uint8_t result {0};
+
+    for (uint8_t idx = 0; idx < maxSources; idx++)
+    {
+        if ((nullptr != sources[idx].ctx) && sources[idx].pending)
+        {
+            result++;
+        }
+    }
+
+    return result;
+}
+
+#if defined(I2C_EVENTS_PCINT)
+    #if defined(PCINT0_vect)
+ISR(PCINT0_vect)
+{
+    I2CEvents::onPinChange();
+}
+    #endif
+    #if defined(PCINT1_vect)
+ISR(PCINT1_vect, ISR_ALIASOF(PCINT0_vect));
+    #endif
+    #if defined(PCINT2_vect)
+ISR(PCINT2_vect, ISR_ALIASOF(PCINT0_vect));
+    #endif
+    #if defined(PCINT3_vect)
+ISR(PCINT3_vect, ISR_ALIASOF(PCINT0_vect));
+    #endif
+#endif
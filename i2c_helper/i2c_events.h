@@ -0,0 +1,105 @@
+/**
+ * \file    i2c_events.h
+ * \brief   Event driven reads of I2C devices signalling new data on a pin.
+ *          Instead of polling, a device context is registered together with its data ready
+ *          (DRDY) or SMBus alert (SMBALERT#) pin. The pin change interrupt only marks the device
+ *          as pending and the read is performed later by service(), outside the interrupt,
+ *          so the bus is used only when there is data. Devices sharing one SMBALERT# line
+ *          are told apart with the Alert Response Address read.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include "i2c.h"
+
+#ifndef I2C_EVENTS_MAX_SOURCES
+#define I2C_EVENTS_MAX_SOURCES  4
+#endif
+
+namespace I2CEvents
+{
+    /**
+     * \brief Maximum number of devices which can be registered.
+    **/
+    constexpr uint8_t   maxSources              {I2C_EVENTS_MAX_SOURCES};
+
+    /**
+     * \brief SMBus Alert Response Address; the alerting device answers a read with its own address.
+    **/
+    constexpr uint8_t   ALERT_RESPONSE_ADDRESS  {0x0C};
+
+    /**
+     * \brief Type of the signal line of a device.
+    **/
+    typedef enum : uint8_t
+    {
+        DATA_READY      = 0x00,     // dedicated data ready line, active level is configurable
+        SMBUS_ALERT     = 0x01,     // SMBALERT# line, open drain and active low, may be shared by several devices
+    } signal_t;
+
+    /**
+     * \brief   Function called after a read triggered by the signal line.
+     *
+     * \param ctx[in]       context of the device; read data is in its readBuffer
+     * \param result[in]    status of the read of I2C::results_t type
+    **/
+    typedef void (*callback_t)(I2C::context_t *ctx, uint8_t result);
+
+    /**
+     * \brief   Registers device for event driven reads. When the signal is active the device is read
+     *          with the settings of its context: writeThenReadBytes() if writeLen is not 0
+     *          (register pointer), readBytes() otherwise. The pin is configured as input
+     *          (with pull-up for SMBUS_ALERT) and its pin change interrupt is enabled.
+     *
+     * \param ctx[in]           a reference to the context of the device (must stay valid while registered)
+     * \param pin[in]           pin connected to DRDY or SMBALERT# output of the device
+     * \param signal[in]        type of the signal line
+     * \param onRead[in]        function called after every read, or nullptr
+     * \param activeLevel[in]   level meaning "data ready" of DATA_READY lines (SMBUS_ALERT is always LOW)
+     *
+     * \return true if successful, false when the table is full.
+    **/
+    bool registerSource(I2C::context_t &ctx, const uint8_t pin, const signal_t signal,
+                        const callback_t onRead, const uint8_t activeLevel = HIGH);
+
+    /**
+     * \brief   Removes device from the table. The pin change interrupt of its pin is disabled
+     *          when no other registered device uses the pin.
+     *
+     * \param ctx[in] a reference to the context of the device
+     *
+     * \return true if the context was registered, false otherwise.
+    **/
+    bool unregisterSource(I2C::context_t &ctx);
+
+    /**
+     * \brief   Samples signal lines of all registered devices and marks those with an active signal
+     *          as pending. Safe to call from an interrupt; it is called from the pin change interrupt
+     *          when the sketch is built with I2C_EVENTS_PCINT defined.
+    **/
+    void onPinChange(void);
+
+    /**
+     * \brief   Performs reads of all pending devices. Lines that are still active afterwards
+     *          (level signals, several devices alerting at once) are served again in the next call.
+     *          Must not be called from an interrupt.
+     *
+     * \return number of reads performed.
+    **/
+    uint8_t service(void);
+
+    /**
+     * \brief Calls service(); signature of SchedulerNS::callback_t, so it can be run as a scheduler task.
+    **/
+    void task(void *arg);
+
+    /**
+     * \brief A method that returns number of devices waiting for service().
+    **/
+    uint8_t pending(void);
+}
@@ -0,0 +1,312 @@
+/**
+ * \file    i2c_script.cpp
+ * \brief   I2C command scripts kept in flash and executed in background.
+ *          A script is a compact bytecode (select device, write register, burst write,
+ *          delay, poll until bits match, read into RAM slot) stored in PROGMEM.
+ *          The engine runs from the TWI interrupt (next command starts when the previous
+ *          transaction completes) and from a 1 ms tick (delays, polling, retries when the bus
+ *          is taken by the foreground), so long bring-up sequences of several devices run
+ *          at full bus speed without the main loop and without RAM copies of the tables.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "i2c_script.h"
+#include "hal.h"
+#include <string.h>
+
+#if defined(__AVR__) || defined(HAL_BACKEND_HOST)
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#endif
+
+extern "C"
+{
+    #include "utility/twi.h"
+}
+
+namespace
+{
+    typedef enum : uint8_t
+    {
+        IDLE            = 0x00,     // no script
+        READY           = 0x01,     // command at pc is to be executed
+        WAIT_TWI        = 0x02,     // transaction in progress, the TWI interrupt continues
+        WAIT_TICK       = 0x03,     // delay, poll interval or retry, the tick continues
+    } state_t;
+
+    typedef enum : uint8_t
+    {
+        PHASE_REGISTER  = 0x00,     // register pointer of POLL/READ is being written
+        PHASE_DATA      = 0x01,     // data of POLL/READ is being read
+    } phase_t;
+
+    const uint8_t          *script      {nullptr};
+    uint8_t                *slots       {nullptr};
+    uint8_t                 slotsSize   {0};
+    I2CScript::callback_t   onDone      {nullptr};
+    volatile state_t        state       {IDLE};
+    uint16_t                pc          {0};
+    uint8_t                 device      {0};
+    phase_t                 phase       {PHASE_REGISTER};
+    uint8_t                 countdown   {0};                        // ms left in WAIT_TICK
+    uint8_t                 pollLeft    {0};                        // ms left to the POLL timeout
+    bool                    pollArmed   {false};                    // pollLeft belongs to the POLL at pc
+    uint8_t                 watchdog    {0};                        // ms left to the transaction timeout
+    uint8_t                 lastResult  {I2C::SUCCESS};
+    uint8_t                 staged[I2CScript::maxBurst] {};         // bytes written by the command, copied
+                                                                    // to the TWI buffer only once the bus is claimed
+
+    inline uint8_t code(const uint16_t offset)
+    {
+        return pgm_read_byte(script + pc + offset);
+    }
+
+    void finish(const uint8_t result)
+    {
+        state = IDLE;
+        lastResult = result;
+        twi_attachMasterCompleteEvent(nullptr);
+        if (nullptr != onDone)
+        {
+            onDone(result, pc);
+        }
+    }
+
+    inline void advance(const uint8_t length)
+    {
+        pc += length;
+        phase = PHASE_REGISTER;
+        pollArmed = false;
+    }
+
+    /**
+     * \brief   Translates status of twi_startReadFrom()/twi_startWriteTo(): started transaction is
+     *          continued by the TWI interrupt, busy bus (4) is tried again in the next tick.
+    **/
+    void started(const uint8_t status)
+    {
+        if (I2C::SUCCESS == status)
+        {
+            state = WAIT_TWI;
+            watchdog = I2CScript::TRANSACTION_TIMEOUT_MS;
+        } else if (I2C::OTHER_ERROR == status)
+        {
+            state = WAIT_TICK;
+            countdown = 1;
+        } else
+        {
+            finish(status);
+        }
+    }
+
+    /**
+     * \brief   Starts the transaction of the command at pc, or executes commands that need no bus.
+     *
+     * \return true when the script waits or has finished, false when the next command is to be executed.
+    **/
+    bool execute(void)
+    {
+        bool    result  {true};
+
+        switch (code(0))
+        {
+            case I2CScript::OP_END:
+                finish(I2C::SUCCESS);
+                break;
+
+            case I2CScript::OP_DEVICE:
+                device = code(1);
+                advance(2);
+                result = false;
+                break;
+
+            case I2CScript::OP_WRITE:
+                staged[0] = code(1);
+                staged[1] = code(2);
+                started(twi_startWriteTo(device, staged, 2, I2C::SEND_STOP));
+                break;
+
+            case I2CScript::OP_BURST:
+                if ((code(1) > sizeof(staged)) || (code(1) > TWI_BUFFER_LENGTH))
+                {
+                    finish(I2C::DATA_TOO_LONG);
+                } else
+                {
+                    memcpy_P(staged, script + pc + 2, code(1));
+                    started(twi_startWriteTo(device, staged, code(1), I2C::SEND_STOP));
+                }
+                break;
+
+            case I2CScript::OP_DELAY:
+                countdown = code(1);
+                advance(2);
+                state = WAIT_TICK;
+                break;
+
+            case I2CScript::OP_POLL:
+            case I2CScript::OP_READ:
+                if ((I2CScript::OP_READ == code(0)) && ((uint16_t)code(2) + code(3) > slotsSize))
+                {
+                    finish(I2C::DATA_TOO_LONG);
+                } else if (PHASE_REGISTER == phase)
+                {
+                    if ((I2CScript::OP_POLL == code(0)) && !pollArmed)
+                    {
+                        pollLeft = code(4);
+                        pollArmed = true;
+                    }
+                    staged[0] = code(1);
+                    started(twi_startWriteTo(device, staged, 1, I2C::NO_STOP));
+                } else
+                {
+                    const uint8_t length {(I2CScript::OP_READ == code(0)) ? code(2) : (uint8_t)1};
+
+                    started(twi_startReadFrom(device, length, I2C::SEND_STOP));
+                }
+                break;
+
+            default:
+                finish(I2C::OTHER_ERROR);
+                break;
+        }
+
+        return result;
+    }
+
+    /**
+     * \brief Executes commands until one has to wait.
+    **/
+    void run(void)
+    {
+        state = READY;
+        while ((READY == state) && !execute())
+        {
+        }
+    }
+
+    /**
+     * \brief   Continues the script after the transaction of the command at pc (called from the TWI
+     *          interrupt, or from its bottom half with interrupts enabled when twi.c is built with
+     *          TWI_SPLIT_ISR); tick() must not run in the middle of it.
+    **/
+    void onComplete(const uint8_t status, const uint8_t count)
+    {
+        uint8_t irq {hal_irqSave()};
+
+        if (WAIT_TWI == state)
+        {
+            const uint8_t op {code(0)};
+
+            if (I2C::SUCCESS != status)
+            {
+                finish(status);
+            } else if (((I2CScript::OP_POLL == op) || (I2CScript::OP_READ == op)) && (PHASE_REGISTER == phase))
+            {
+                phase = PHASE_DATA;
+                run();
+            } else if (I2CScript::OP_POLL == op)
+            {
+                phase = PHASE_REGISTER;
+                if ((twi_getBufferHandle()[0] & code(2)) == code(3))
+                {
+                    advance(5);
+                    run();
+                } else if (0 == pollLeft)
+                {
+                    finish(I2C::TIMEOUT);
+                } else
+                {
+                    state = WAIT_TICK;
+                    countdown = 1;
+                }
+            } else if (I2CScript::OP_READ == op)
+            {
+                if (count != code(2))
+                {
+                    finish(I2C::WRONG_DATA_AMOUNT);
+                } else
+                {
+                    memcpy(slots + code(3), twi_getBufferHandle(), count);
+                    advance(4);
+                    run();
+                }
+            } else
+            {
+                advance((I2CScript::OP_WRITE == op) ? 3 : (uint8_t)(2 + code(1)));
+                run();
+            }
+        }
+        hal_irqRestore(irq);
+    }
+}
+
+bool I2CScript::start(const uint8_t *script, uint8_t *slots, const uint8_t slotsSize, const callback_t onDone)
+{
+    bool    result  {false};
+    uint8_t irq     {hal_irqSave()};
+
+    if (IDLE == state)
+    {
+        ::script = script;
+        ::slots = slots;
+        ::slotsSize = (nullptr == slots) ? 0 : slotsSize;
+        ::onDone = onDone;
+        pc = 0;
+        device = 0;
+        advance(0);
+        twi_attachMasterCompleteEvent(onComplete);
+        result = true;
+#if defined(I2C_SCRIPT_TIMER0)
+        hal_tickEnable();
+#endif
+        run();
+    }
+    hal_irqRestore(irq);
+
+    return result;
+}
+
+void I2CScript::tick(void)
+{
+    uint8_t irq {hal_irqSave()};                                    // may be called by the sketch, outside of an interrupt
+
+    if (pollArmed && (0 != pollLeft))
+    {
+        pollLeft--;
+    }
+    if (WAIT_TWI == state)
+    {
+        if (0 == --watchdog)
+        {
+            finish(I2C::TIMEOUT);                                     // a late completion is ignored
+        }
+    } else if (WAIT_TICK == state)
+    {
+        if ((0 == countdown) || (0 == --countdown))
+        {
+            run();
+        }
+    }
+    hal_irqRestore(irq);
+}
+
+bool I2CScript::isRunning(void)
+{
+    return (IDLE != state);
+}
+
+uint8_t I2CScript::result(void)
+{
+    return lastResult;
+}
+
+#if defined(I2C_SCRIPT_TIMER0)
+ISR(TIMER0_COMPA_vect)
+{
+    I2CScript::tick();
+}
+#endif
@@ -0,0 +1,143 @@
+/**
+ * \file    i2c_script.h
+ * \brief   I2C command scripts kept in flash and executed in background.
+ *          A script is a compact bytecode (select device, write register, burst write,
+ *          delay, poll until bits match, read into RAM slot) stored in PROGMEM.
+ *          The engine runs from the TWI interrupt (next command starts when the previous
+ *          transaction completes) and from a 1 ms tick (delays, polling, retries when the bus
+ *          is taken by the foreground), so long bring-up sequences of several devices run
+ *          at full bus speed without the main loop and without RAM copies of the tables.
+ *
+ *          Example:
+ *              const uint8_t PROGMEM init[] {
+ *                  I2C_SCRIPT_DEVICE(0x68),
+ *                  I2C_SCRIPT_WRITE(0x6B, 0x80),                   // reset
+ *                  I2C_SCRIPT_DELAY(100),
+ *                  I2C_SCRIPT_POLL(0x6B, 0x80, 0x00, 50),          // until reset bit clears
+ *                  I2C_SCRIPT_BURST(3), 0x19, 0x07, 0x01,          // register 0x19 and two data bytes
+ *                  I2C_SCRIPT_READ(0x75, 1, 0),                    // WHO_AM_I into slot byte 0
+ *                  I2C_SCRIPT_END
+ *              };
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include "i2c.h"
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#endif
+
+#ifndef I2C_SCRIPT_MAX_BURST
+#define I2C_SCRIPT_MAX_BURST    16
+#endif
+
+/**
+ * \brief Makes following commands address 7-bit device 'address'.
+**/
+#define I2C_SCRIPT_DEVICE(address)                  I2CScript::OP_DEVICE, (address)
+
+/**
+ * \brief Writes 'value' to register 'reg'.
+**/
+#define I2C_SCRIPT_WRITE(reg, value)                I2CScript::OP_WRITE, (reg), (value)
+
+/**
+ * \brief Writes 'count' bytes following the command (usually register and data) in one transaction.
+**/
+#define I2C_SCRIPT_BURST(count)                     I2CScript::OP_BURST, (count)
+
+/**
+ * \brief Waits 'ms' milliseconds (1 - 255).
+**/
+#define I2C_SCRIPT_DELAY(ms)                        I2CScript::OP_DELAY, (ms)
+
+/**
+ * \brief Reads register 'reg' every millisecond until (value & mask) == expected, fails after 'timeoutMs'.
+**/
+#define I2C_SCRIPT_POLL(reg, mask, expected, timeoutMs) I2CScript::OP_POLL, (reg), (mask), (expected), (timeoutMs)
+
+/**
+ * \brief Reads 'length' bytes starting at register 'reg' into slots at 'offset'.
+**/
+#define I2C_SCRIPT_READ(reg, length, offset)        I2CScript::OP_READ, (reg), (length), (offset)
+
+/**
+ * \brief Ends the script.
+**/
+#define I2C_SCRIPT_END                              I2CScript::OP_END
+
+namespace I2CScript
+{
+    /**
+     * \brief Operation codes of the bytecode; use the I2C_SCRIPT_xxx macros to write scripts.
+    **/
+    typedef enum : uint8_t
+    {
+        OP_END          = 0x00,
+        OP_DEVICE       = 0x01,
+        OP_WRITE        = 0x02,
+        OP_BURST        = 0x03,
+        OP_DELAY        = 0x04,
+        OP_POLL         = 0x05,
+        OP_READ         = 0x06,
+    } opcode_t;
+
+    /**
+     * \brief   Time (ms) a single transaction may take before the script fails with TIMEOUT,
+     *          e.g. when the bus hangs or the foreground keeps it for too long.
+    **/
+    constexpr uint8_t   TRANSACTION_TIMEOUT_MS  {25};
+
+    /**
+     * \brief   Longest I2C_SCRIPT_BURST (RAM staging buffer of the engine); a longer one, or one
+     *          longer than the TWI buffer, fails with I2C::DATA_TOO_LONG.
+    **/
+    constexpr uint8_t   maxBurst                {I2C_SCRIPT_MAX_BURST};
+
+    /**
+     * \brief   Function called from interrupt when the script has finished.
+     *
+     * \param result[in]    I2C::SUCCESS, or the error (I2C::results_t) which stopped the script
+     * \param position[in]  offset of the command that failed (of OP_END on success)
+    **/
+    typedef void (*callback_t)(uint8_t result, uint16_t position);
+
+    /**
+     * \brief   Starts script in background. The tick must be running: either the library is built
+     *          with I2C_SCRIPT_TIMER0 defined (tick() is called from TIMER0_COMPA_vect enabled here),
+     *          or tick() is called every millisecond by the sketch, e.g. from its own
+     *          ISR(TIMER0_COMPA_vect) enabled with hal_tickEnable(). I2C_SCRIPT_TIMER0 must be a global
+     *          build flag (compiler option); a #define in the sketch does not reach i2c_script.cpp,
+     *          and no tick runs then. Wire must be initialized.
+     *          The Wire buffer is shared, so the foreground must not use it from interrupts meanwhile.
+     *
+     * \param script[in]    bytecode in flash (PROGMEM)
+     * \param slots[out]    RAM for I2C_SCRIPT_READ results, or nullptr
+     * \param slotsSize[in] size of slots in bytes
+     * \param onDone[in]    function called at the end, or nullptr
+     *
+     * \return true if started, false when another script is running.
+    **/
+    bool start(const uint8_t *script, uint8_t *slots, const uint8_t slotsSize, const callback_t onDone);
+
+    /**
+     * \brief Advances delays, polling and retries; to be called every millisecond (from an interrupt).
+    **/
+    void tick(void);
+
+    /**
+     * \brief A method that returns true while a script is running.
+    **/
+    bool isRunning(void);
+
+    /**
+     * \brief Result (I2C::results_t) of the last finished script.
+    **/
+    uint8_t result(void);
+}
@@ -9,6 +9,241 @@
  */
 
 #include "max7219.h"
+#include "profiler.h"
+
+#if defined(MAX7219_SPI_ASYNC) || defined(MAX7219_MSPI_ASYNC)
+#define MAX7219_ASYNC
+#include <avr/interrupt.h>
+#endif
+
+namespace
+{
+    /**
+     * \brief Peripherals queuing bytes of a row back-to-back (one byte buffered while another is shifted out).
+    **/
+    typedef enum : uint8_t
+    {
+        ENGINE_SPI0     = 0x00,     // BACKEND_SPI_BUFFERED
+        ENGINE_MSPI     = 0x01,     // BACKEND_USART_MSPI
+        ENGINE_COUNT    = 0x02,
+    } engine_t;
+
+    /**
+     * \brief   Chain using the engine from the first byte of a row to its latch, or for a whole frame
+     *          sent in the background; nullptr when the engine is free. Chains bound to different
+     *          engines are sent at the same time.
+    **/
+    Max7219NS::context_t   *volatile owners[ENGINE_COUNT]   {};
+
+    /**
+     * \brief   Number of initialized chains bound to the engine; the peripheral and its clock and
+     *          data pins are released together with the last of them.
+    **/
+    uint8_t                 users[ENGINE_COUNT]             {};
+
+    /**
+     * \brief   Signalled each time the engine is freed; under an RTOS a task waiting in claim()
+     *          sleeps on it instead of polling the owner.
+    **/
+    hal_event_t             engineFree[ENGINE_COUNT]        {};
+
+    inline bool usesEngine(const Max7219NS::context_t *ctx)
+    {
+        return (Max7219NS::BACKEND_SPI_BUFFERED == ctx->backend) || (Max7219NS::BACKEND_USART_MSPI == ctx->backend);
+    }
+
+    inline engine_t engineOf(const Max7219NS::context_t *ctx)
+    {
+        return (Max7219NS::BACKEND_USART_MSPI == ctx->backend) ? ENGINE_MSPI : ENGINE_SPI0;
+    }
+
+    inline bool txReady(const engine_t engine)
+    {
+        return (ENGINE_MSPI == engine) ? hal_mspiTxReady() : hal_spi0TxReady();
+    }
+
+    inline bool txComplete(const engine_t engine)
+    {
+        return (ENGINE_MSPI == engine) ? hal_mspiTxComplete() : hal_spi0TxComplete();
+    }
+
+    inline void txQueue(const engine_t engine, const uint8_t val)
+    {
+        if (ENGINE_MSPI == engine)
+        {
+            hal_mspiTxQueue(val);
+        } else
+        {
+            hal_spi0TxQueue(val);
+        }
+    }
+
+    /**
+     * \brief Frees the engine and wakes a task waiting for it in claim().
+    **/
+    inline void freeEngine(const engine_t engine)
+    {
+        owners[engine] = nullptr;
+        hal_eventSignal(&engineFree[engine]);
+    }
+
+    /**
+     * \brief   Takes the engine of the chain; sleeps while a row or a background frame of any chain
+     *          sharing the engine is in progress.
+    **/
+    void claim(Max7219NS::context_t *ctx)
+    {
+        const engine_t  engine  {engineOf(ctx)};
+        bool            claimed {false};
+
+        while (!claimed)
+        {
+            uint8_t state {hal_irqSave()};
+
+            if (nullptr == owners[engine])
+            {
+                owners[engine] = ctx;
+                claimed = true;
+            }
+            hal_irqRestore(state);
+            if (!claimed)
+            {
+                hal_eventWait(&engineFree[engine], 0);
+            }
+        }
+    }
+
+    /**
+     * \brief   Frees the engine held by a row left open by a partial write of the chain; bytes already
+     *          queued are shifted out and the row is not latched. A frame sent in the background
+     *          by the chain is not affected (the chain is not busy then).
+    **/
+    void abandonRow(Max7219NS::context_t *ctx)
+    {
+        const engine_t engine {engineOf(ctx)};
+
+        if ((ctx->activeDevice != ctx->numDevices) && (owners[engine] == ctx))
+        {
+            while (!txComplete(engine))
+            {
+                hal_spin();
+            }
+            freeEngine(engine);
+        }
+    }
+
+    /**
+     * \brief   Returns true when other initialized chains use the engine of the chain; the peripheral
+     *          is configured then and must not be reprogrammed.
+    **/
+    inline bool sharesEngine(const Max7219NS::context_t *ctx)
+    {
+        return users[engineOf(ctx)] > (ctx->isInitialized ? 1 : 0);
+    }
+
+#if defined(MAX7219_ASYNC)
+    /**
+     * \brief   Returns true when the library is built with the interrupt handlers of the backend
+     *          (MAX7219_SPI_ASYNC for SPI0, MAX7219_MSPI_ASYNC for the USART).
+    **/
+    inline bool hasAsync(const Max7219NS::backend_t backend)
+    {
+        bool result {false};
+
+#if defined(MAX7219_SPI_ASYNC)
+        result = result || (Max7219NS::BACKEND_SPI_BUFFERED == backend);
+#endif
+#if defined(MAX7219_MSPI_ASYNC)
+        result = result || (Max7219NS::BACKEND_USART_MSPI == backend);
+#endif
+
+        return result;
+    }
+
+    /**
+     * \brief Frame sent in the background by the interrupts of the engine; valid while the engine is owned.
+    **/
+    typedef struct
+    {
+        const uint8_t  *frame;
+        uint16_t        index;                                      // next byte of the frame
+        uint16_t        rowEnd;                                     // index of the first byte of the next row
+        uint16_t        length;
+        uint8_t         rowLength;
+        uint8_t         csbPin;
+        bool            inFlash;                                    // frame in PROGMEM or in RAM
+        bool            latching;                                   // row queued, waiting for its last bit
+    } flush_t;
+
+    flush_t     flushes[ENGINE_COUNT]   {};
+
+    inline void txInterrupt(const engine_t engine, const hal_txIrq_t irq)
+    {
+        if (ENGINE_MSPI == engine)
+        {
+            hal_mspiTxInterrupt(irq);
+        } else
+        {
+            hal_spi0TxInterrupt(irq);
+        }
+    }
+
+    /**
+     * \brief   Queues bytes of the current row while the transmit buffer accepts them. When the
+     *          whole row is queued the interrupt switches from "ready" to "complete": the row latch.
+     *          Called with interrupts disabled.
+    **/
+    void fill(const engine_t engine)
+    {
+        flush_t &flush {flushes[engine]};
+
+        while ((flush.index < flush.rowEnd) && txReady(engine))
+        {
+            const uint8_t *next {flush.frame + flush.index++};
+
+            txQueue(engine, flush.inFlash ? pgm_read_byte(next) : *next);
+        }
+        flush.latching = (flush.index == flush.rowEnd);
+        txInterrupt(engine, flush.latching ? HAL_TX_IRQ_COMPLETE : HAL_TX_IRQ_READY);
+    }
+
+    void startRow(const engine_t engine)
+    {
+        flush_t &flush {flushes[engine]};
+
+        hal_digitalWrite(flush.csbPin, LOW);
+        flush.rowEnd += flush.rowLength;
+        fill(engine);
+    }
+
+    /**
+     * \brief   Interrupt of the engine: fills the transmit buffer, or latches the row once its last bit
+     *          is shifted out and starts the next one.
+    **/
+    void serve(const engine_t engine)
+    {
+        flush_t &flush {flushes[engine]};
+
+        if (!flush.latching)
+        {
+            fill(engine);
+        } else if (txComplete(engine))
+        {
+            hal_digitalWrite(flush.csbPin, HIGH);                   // row latched; tCSW (50 ns) is shorter
+                                                                    // than the two port writes
+            if (flush.index < flush.length)
+            {
+                startRow(engine);
+            } else
+            {
+                txInterrupt(engine, HAL_TX_IRQ_NONE);
+                owners[engine] = nullptr;
+                hal_eventSignalFromIsr(&engineFree[engine]);
+            }
+        }
+    }
+#endif
+}
 
 Max7219::Max7219(Max7219NS::context_t &ctx) : _ctx(&ctx)
 {
@@ -20,27 +255,25 @@ Max7219::~Max7219(void)
 
 bool Max7219::init(void)
 {
+    PROFILE_SCOPE(PROFILER_ZONE_MAX7219_INIT);
     bool result {false};
 
-    if (nullptr != _ctx)
+    if ((nullptr != _ctx) && beginBackend())
     {
+        if (!_ctx->isInitialized && usesEngine(_ctx))
+        {
+            users[engineOf(_ctx)]++;
+        }
         if (0 == _ctx->numDevices)
         {
             _ctx->numDevices = 1;
         }
+        hal_mutexInit(&_ctx->mutex);
         if (isChainBusy())
         {
             _ctx->activeDevice = _ctx->numDevices;                      // now chain is ready for operation
         }
 
-        pinMode(_ctx->csbPin, OUTPUT);
-        pinMode(_ctx->clkPin, OUTPUT);
-        pinMode(_ctx->dataPin, OUTPUT);
-
-        digitalWrite(_ctx->csbPin, HIGH);
-        digitalWrite(_ctx->dataPin, LOW);
-        digitalWrite(_ctx->clkPin, LOW);
-
         shutdown();
         do
         {
@@ -72,14 +305,54 @@ bool Max7219::release(void)
 
     if (nullptr != _ctx)
     {
-        digitalWrite(_ctx->csbPin, LOW);                            // prevents the pull-up resistor from turning on
+        if (Max7219NS::BACKEND_SPIDEV == _ctx->backend)
+        {
+#if defined(HAL_HAS_SPIDEV)
+            hal_spidevClose(_ctx->spiFd);
+            _ctx->spiFd = -1;
+#endif
+        } else
+        {
+            bool lastUser {true};                                   // clock and data pins are not shared any more
+
+            if (Max7219NS::BACKEND_USI == _ctx->backend)
+            {
+                hal_usiEnd();
+            } else if (usesEngine(_ctx))
+            {
+                const engine_t engine {engineOf(_ctx)};
+
+                abandonRow(_ctx);                                   // engine held by the chain itself
+                claim(_ctx);                                        // lets the frame in progress finish
+                if (_ctx->isInitialized && (0 < users[engine]))
+                {
+                    users[engine]--;
+                }
+                lastUser = (0 == users[engine]);
+                if (lastUser)
+                {
+                    if (ENGINE_MSPI == engine)
+                    {
+                        hal_mspiEnd();
+                    } else
+                    {
+                        hal_spi0End();
+                    }
+                }
+                freeEngine(engine);
+            }
+            hal_digitalWrite(_ctx->csbPin, LOW);                    // prevents the pull-up resistor from turning on
                                                                     // after pin is configured as an input
-        digitalWrite(_ctx->dataPin, LOW);
-        digitalWrite(_ctx->clkPin, LOW);
+            hal_pinMode(_ctx->csbPin, INPUT);
+            if (lastUser)
+            {
+                hal_digitalWrite(_ctx->dataPin, LOW);
+                hal_digitalWrite(_ctx->clkPin, LOW);
 
-        pinMode(_ctx->csbPin, INPUT);
-        pinMode(_ctx->clkPin, INPUT);
-        pinMode(_ctx->dataPin, INPUT);
+                hal_pinMode(_ctx->clkPin, INPUT);
+                hal_pinMode(_ctx->dataPin, INPUT);
+            }
+        }
 
         _ctx->isInitialized = false;
         result = true;
@@ -206,52 +479,290 @@ bool Max7219::write(const uint8_t position, const uint8_t value)
     {
         uint16_t cmd {(uint16_t)((position & 0x07) + 1) << 8};      // wrap around position and digit 0 is at address 1
 
-        sendCmd(cmd + value);
+        result = sendCmd(cmd + value);
+    }
 
-        result = true;
+    return result;
+}
+
+bool Max7219::writeFrame_P(const uint8_t *frame, const uint8_t devices)
+{
+    PROFILE_SCOPE(PROFILER_ZONE_MAX7219_WRITE_FRAME);
+    bool result {false};
+
+    if ((nullptr != _ctx) && (devices == _ctx->numDevices))
+    {
+        hal_mutexLock(&_ctx->mutex);                                // waits while other task is in the middle of a frame
+        if (!isChainBusy() && (Max7219NS::BACKEND_SPIDEV == _ctx->backend))
+        {
+#if defined(HAL_HAS_SPIDEV)
+            struct spi_ioc_transfer transfers[Max7219NS::maxDigits] {};
+
+            for (uint8_t position = 0; position < Max7219NS::maxDigits; position++)
+            {
+                transfers[position].tx_buf = (uintptr_t)(frame + (uint16_t)position * 2 * devices);
+                transfers[position].len = 2 * devices;
+                transfers[position].cs_change = (position < (Max7219NS::maxDigits - 1)) ? 1 : 0;    // LOAD pulse between rows
+            }
+            result = hal_spidevTransfer(_ctx->spiFd, transfers, Max7219NS::maxDigits, _ctx->spiIoctl);
+#endif
+        } else if (!isChainBusy())
+        {
+            for (uint8_t position = 0; position < Max7219NS::maxDigits; position++)
+            {
+                beginRow();
+                for (uint16_t idx = 0; idx < (uint16_t)(2 * devices); idx++)
+                {
+                    shiftOutByte(pgm_read_byte(frame++));
+                }
+                endRow();
+            }
+            result = true;
+        }
+        hal_mutexUnlock(&_ctx->mutex);
     }
 
     return result;
 }
 
+bool Max7219::writeFrameAsync_P(const uint8_t *frame, const uint8_t devices)
+{
+    return startFrame(frame, devices, true);
+}
+
+bool Max7219::writeFrameAsync(const uint8_t *frame, const uint8_t devices)
+{
+    return startFrame(frame, devices, false);
+}
+
+bool Max7219::isFrameBusy(void)
+{
+    return (nullptr != _ctx) && usesEngine(_ctx) && (owners[engineOf(_ctx)] == _ctx);
+}
+
 // *****************************************************************
 // *                                                               *
 // *                       protected methods                       *
 // *                                                               *
 // *****************************************************************
 
+bool Max7219::startFrame(const uint8_t *frame, const uint8_t devices, const bool inFlash)
+{
+    bool result {false};
+
+#if defined(MAX7219_ASYNC)
+    if ((nullptr != _ctx) && (devices == _ctx->numDevices) && hasAsync(_ctx->backend))
+    {
+        const engine_t  engine  {engineOf(_ctx)};
+        uint8_t         state   {hal_irqSave()};
+
+        if ((nullptr == owners[engine]) && !isChainBusy())
+        {
+            flush_t &flush {flushes[engine]};
+
+            owners[engine] = _ctx;
+            flush.frame = frame;
+            flush.index = 0;
+            flush.rowEnd = 0;
+            flush.rowLength = (uint8_t)(2 * devices);
+            flush.length = (uint16_t)Max7219NS::maxDigits * flush.rowLength;
+            flush.csbPin = _ctx->csbPin;
+            flush.inFlash = inFlash;
+            startRow(engine);
+            result = true;
+        }
+        hal_irqRestore(state);
+    }
+#else
+    (void)frame;
+    (void)devices;
+    (void)inFlash;
+#endif
+
+    return result;
+}
+
+bool Max7219::beginBackend(void)
+{
+    bool result {true};
+
+    switch (_ctx->backend)
+    {
+        case Max7219NS::BACKEND_USI:
+            result = hal_usiBegin();
+            _ctx->clkPin = HAL_USI_USCK_PIN;                        // pins are fixed by the peripheral
+            _ctx->dataPin = HAL_USI_DO_PIN;
+            break;
+
+        case Max7219NS::BACKEND_SPIDEV:
+#if defined(HAL_HAS_SPIDEV)
+            if (0 > _ctx->spiFd)
+            {
+                _ctx->spiFd = hal_spidevOpen(_ctx->spiDevice, _ctx->spiSpeedHz, _ctx->spiIoctl);
+            }
+            result = (0 <= _ctx->spiFd);
+#else
+            result = false;
+#endif
+            break;
+
+        case Max7219NS::BACKEND_SPI_BUFFERED:
+            hal_eventInit(&engineFree[ENGINE_SPI0]);
+            abandonRow(_ctx);
+            claim(_ctx);                                            // lets a frame of another chain finish
+            if (!sharesEngine(_ctx))
+            {
+                result = hal_spi0Begin(Max7219NS::maxClockHz);
+            }
+            freeEngine(ENGINE_SPI0);
+            _ctx->clkPin = HAL_SPI0_SCK_PIN;
+            _ctx->dataPin = HAL_SPI0_MOSI_PIN;
+            break;
+
+        case Max7219NS::BACKEND_USART_MSPI:
+            hal_eventInit(&engineFree[ENGINE_MSPI]);
+            abandonRow(_ctx);
+            claim(_ctx);                                            // lets a frame of another chain finish
+            if (!sharesEngine(_ctx))
+            {
+                result = hal_mspiBegin(Max7219NS::maxClockHz);
+            }
+            freeEngine(ENGINE_MSPI);
+            _ctx->clkPin = HAL_MSPI_XCK_PIN;
+            _ctx->dataPin = HAL_MSPI_TXD_PIN;
+            break;
+
+        default:
+            break;
+    }
+
+    if (result && (Max7219NS::BACKEND_SPIDEV != _ctx->backend))
+    {
+        hal_pinMode(_ctx->csbPin, OUTPUT);
+        hal_digitalWrite(_ctx->csbPin, HIGH);
+        if (Max7219NS::BACKEND_GPIO == _ctx->backend)
+        {
+            hal_pinMode(_ctx->clkPin, OUTPUT);
+            hal_pinMode(_ctx->dataPin, OUTPUT);
+            hal_digitalWrite(_ctx->dataPin, LOW);
+            hal_digitalWrite(_ctx->clkPin, LOW);
+        }
+    }
+
+    return result;
+}
+
+void Max7219::beginRow(void)
+{
+    if (Max7219NS::BACKEND_SPIDEV == _ctx->backend)
+    {
+#if defined(HAL_HAS_SPIDEV)
+        _ctx->spiRowLength = 0;
+#endif
+    } else if (usesEngine(_ctx))
+    {
+        claim(_ctx);
+        hal_digitalWrite(_ctx->csbPin, LOW);                        // tCSS (25 ns) passes before the first SCK edge
+    } else
+    {
+        hal_digitalWrite(_ctx->csbPin, LOW);
+        hal_delayMicroseconds(clockDelay);
+    }
+}
+
+bool Max7219::endRow(void)
+{
+    bool result {true};
+
+    if (Max7219NS::BACKEND_SPIDEV == _ctx->backend)
+    {
+#if defined(HAL_HAS_SPIDEV)
+        struct spi_ioc_transfer transfer {};
+
+        transfer.tx_buf = (uintptr_t)_ctx->spiRow;
+        transfer.len = _ctx->spiRowLength;
+        result = hal_spidevTransfer(_ctx->spiFd, &transfer, 1, _ctx->spiIoctl);    // chip select rises at the end: LOAD
+#endif
+    } else if (usesEngine(_ctx))
+    {
+        while (!txComplete(engineOf(_ctx)))
+        {
+            hal_spin();                                             // last bit of the row still in the shift register
+        }
+        hal_digitalWrite(_ctx->csbPin, HIGH);
+        freeEngine(engineOf(_ctx));
+    } else
+    {
+        hal_digitalWrite(_ctx->csbPin, HIGH);
+        hal_delayMicroseconds(clockDelay);
+    }
+
+    return result;
+}
+
 void Max7219::shiftOutByte(uint8_t val)
 {
-    for (uint8_t bit = 0; bit < 8; bit++)
-    {
-        digitalWrite(_ctx->clkPin, LOW);
-        delayMicroseconds(clockDelay);
-        digitalWrite(_ctx->dataPin, (val & 0x80) != 0);
-        val <<= 1;
-        digitalWrite(_ctx->clkPin, HIGH);
-        delayMicroseconds(clockDelay);
+    if (Max7219NS::BACKEND_USI == _ctx->backend)
+    {
+        hal_usiShiftOut(val);                                       // two register writes per bit; the chip accepts 10 MHz
+    } else if (usesEngine(_ctx))
+    {
+        while (!txReady(engineOf(_ctx)))
+        {
+            hal_spin();                                             // previous byte still waits in the buffer
+        }
+        uint8_t state {hal_irqSave()};
+
+        txQueue(engineOf(_ctx), val);                                       // back-to-back with the byte being shifted out
+        hal_irqRestore(state);
+    } else if (Max7219NS::BACKEND_SPIDEV == _ctx->backend)
+    {
+#if defined(HAL_HAS_SPIDEV)
+        if (_ctx->spiRowLength < sizeof(_ctx->spiRow))
+        {
+            _ctx->spiRow[_ctx->spiRowLength++] = val;               // sent by endRow()
+        }
+#endif
+    } else
+    {
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            hal_digitalWrite(_ctx->clkPin, LOW);
+            hal_delayMicroseconds(clockDelay);
+            hal_digitalWrite(_ctx->dataPin, (val & 0x80) != 0);
+            val <<= 1;
+            hal_digitalWrite(_ctx->clkPin, HIGH);
+            hal_delayMicroseconds(clockDelay);
+        }
     }
 }
 
-void Max7219::sendCmd(const uint16_t cmd)
+bool Max7219::sendCmd(const uint16_t cmd)
 {
+    PROFILE_SCOPE(PROFILER_ZONE_MAX7219_SEND_CMD);
+    bool result {true};
+
+    hal_mutexLock(&_ctx->mutex);                                    // waits while other task is in the middle of a frame
     if (_ctx->activeDevice == _ctx->numDevices)
     {
-        digitalWrite(_ctx->csbPin, LOW);
-        delayMicroseconds(clockDelay);
+        hal_mutexLock(&_ctx->mutex);                                // frame start: chain is held until frame ends
+        beginRow();
     }
     shiftOutByte((uint8_t)((cmd >> 8) & 0xFF));
     shiftOutByte((uint8_t)(cmd & 0xFF));
     
     if (1 == _ctx->activeDevice)
     {
-        digitalWrite(_ctx->csbPin, HIGH);
-        delayMicroseconds(clockDelay);
+        result = endRow();
         _ctx->activeDevice = _ctx->numDevices;
+        hal_mutexUnlock(&_ctx->mutex);
     } else
     {
         _ctx->activeDevice--;
     }
+    hal_mutexUnlock(&_ctx->mutex);
+
+    return result;
 }
 
 inline void Max7219::setScanDigits(const uint8_t digits)
@@ -261,3 +772,22 @@ inline void Max7219::setScanDigits(const uint8_t digits)
         sendCmd(regScanLimit + (digits > 0 ? ((digits - 1) & 0x07) : 0x00));
     } while (isChainBusy());
 }
+
+#if defined(MAX7219_SPI_ASYNC) && defined(SPI0_INT_vect)
+ISR(SPI0_INT_vect)
+{
+    serve(ENGINE_SPI0);
+}
+#endif
+
+#if defined(MAX7219_MSPI_ASYNC) && defined(HAL_MSPI_DRE_vect)
+ISR(HAL_MSPI_DRE_vect)
+{
+    serve(ENGINE_MSPI);
+}
+
+ISR(HAL_MSPI_TXC_vect)
+{
+    serve(ENGINE_MSPI);
+}
+#endif
@@ -10,7 +10,8 @@
 
 #pragma once
 
-#include <Arduino.h>
+#include "hal.h"
+#include "hal_os.h"
 
 namespace Max7219NS
 {
@@ -24,6 +25,23 @@ namespace Max7219NS
     **/
     constexpr uint8_t maxIntensity  {0x0F};
 
+    /**
+     * \brief Maximum serial clock frequency accepted by the chip.
+    **/
+    constexpr uint32_t maxClockHz   {10000000};
+
+    /**
+     * \brief Type selecting the peripheral which clocks data out to the chain.
+    **/
+    typedef enum : uint8_t
+    {
+        BACKEND_GPIO            = 0x00,     // bit-banging of clkPin and dataPin
+        BACKEND_USI             = 0x01,     // USI in three-wire mode (ATtiny); CLK on USCK, DIN on DO
+        BACKEND_SPIDEV          = 0x02,     // Linux spidev device; LOAD is the chip select of the SPI controller
+        BACKEND_SPI_BUFFERED    = 0x03,     // SPI0 in buffered mode (megaAVR-0, AVR-Dx); CLK on SCK, DIN on MOSI
+        BACKEND_USART_MSPI      = 0x04,     // USART in master SPI mode (megaAVR-0, AVR-Dx); CLK on XCK, DIN on TXD
+    } backend_t;
+
     /**
      * \brief Structure containing the context of MAX7219 chip(s) settings.
      *
@@ -38,6 +56,23 @@ namespace Max7219NS
      * \param decodeBcd         false - explicit; true - "code B", i.e. [0-9EHLP\-]
      * \param isInitialized     indicates whether class has set appropriate IO pins
      *                          to communicate with MAX7219 chips chain and initialized them.
+     * \param mutex             chain lock used under an RTOS (see hal_os.h); it is held by a task
+     *                          from the first to the last command of a chain frame.
+     * \param backend           peripheral clocking data out; with BACKEND_USI init() sets clkPin and dataPin
+     *                          to HAL_USI_USCK_PIN and HAL_USI_DO_PIN, and fails on targets without USI.
+     *                          With BACKEND_SPIDEV pins are not used and init() fails on targets other than Linux.
+     *                          With BACKEND_SPI_BUFFERED init() sets clkPin and dataPin to HAL_SPI0_SCK_PIN
+     *                          and HAL_SPI0_MOSI_PIN, and fails on targets without SPI0; chains with
+     *                          different csbPin may share the peripheral. BACKEND_USART_MSPI does the same
+     *                          with HAL_MSPI_XCK_PIN and HAL_MSPI_TXD_PIN of the USART (HAL_MSPI_USART).
+     *                          Chains bound to the two peripherals are sent independently.
+     * \param spiDevice         (Linux) spidev device node of the chain
+     * \param spiSpeedHz        (Linux) clock frequency; the chip accepts up to 10 MHz
+     * \param spiIoctl          (Linux) ioctl() used for the device, nullptr for the system one;
+     *                          a stand-in allows to test the driver without the device
+     * \param spiFd             (Linux) file descriptor of the opened device
+     * \param spiRowLength      (Linux) number of bytes collected in spiRow
+     * \param spiRow            (Linux) chain frame collected by write() until it is sent with one transfer
     **/
     typedef struct
     {
@@ -50,7 +85,84 @@ namespace Max7219NS
         uint8_t activeDevice    {1};
         bool    decodeBcd       {false};
         bool    isInitialized   {false};
+        hal_mutex_t mutex       {};
+        backend_t   backend     {BACKEND_GPIO};
+#if defined(HAL_HAS_SPIDEV)
+        const char         *spiDevice       {"/dev/spidev0.0"};
+        uint32_t            spiSpeedHz      {1000000};
+        hal_spidevIoctl_t   spiIoctl        {nullptr};
+        int                 spiFd           {-1};
+        uint16_t            spiRowLength    {0};
+        uint8_t             spiRow[2 * 255] {};
+#endif
     } context_t;
+
+    /**
+     * \brief   Content of all digit registers of a chain, serialized at compile time into the exact
+     *          sequence of bytes shifted out to the chain: one row (chain frame latched with one
+     *          LOAD pulse) per digit register, in every row the command for the last chip first.
+     *          Built with makeFrame() and kept in flash (PROGMEM), it is sent by Max7219::writeFrame_P()
+     *          without any per-chip or per-digit processing.
+    **/
+    template <uint8_t devices>
+    struct frame_t
+    {
+        uint8_t bytes[maxDigits][2 * devices];
+    };
+
+    /**
+     * \brief Compile time helpers of makeFrame().
+    **/
+    namespace frameBuilder
+    {
+        template <uint16_t... idx>
+        struct indices_t
+        {
+        };
+
+        template <uint16_t count, uint16_t... idx>
+        struct indicesOf : indicesOf<count - 1, count - 1, idx...>
+        {
+        };
+
+        template <uint16_t... idx>
+        struct indicesOf<0, idx...>
+        {
+            typedef indices_t<idx...> type;
+        };
+
+        template <uint8_t devices>
+        constexpr uint8_t byteOf(const uint8_t (&digits)[devices][maxDigits], const uint8_t position, const uint16_t idx)
+        {
+            return (0 == (idx & 0x01)) ? (uint8_t)(position + 1) : digits[devices - 1 - (idx >> 1)][position];
+        }
+
+        template <uint8_t devices, uint16_t... idx>
+        constexpr frame_t<devices> rowsOf(const uint8_t (&digits)[devices][maxDigits], indices_t<idx...>)
+        {
+            return frame_t<devices> {{{byteOf<devices>(digits, 0, idx)...}, {byteOf<devices>(digits, 1, idx)...},
+                                      {byteOf<devices>(digits, 2, idx)...}, {byteOf<devices>(digits, 3, idx)...},
+                                      {byteOf<devices>(digits, 4, idx)...}, {byteOf<devices>(digits, 5, idx)...},
+                                      {byteOf<devices>(digits, 6, idx)...}, {byteOf<devices>(digits, 7, idx)...}}};
+        }
+    }
+
+    /**
+     * \brief   Serializes content of digit registers of the chain at compile time.
+     *          Example:
+     *              constexpr uint8_t logo[2][Max7219NS::maxDigits] {{...}, {...}};
+     *              const Max7219NS::frame_t<2> PROGMEM logoFrame {Max7219NS::makeFrame(logo)};
+     *
+     * \param digits[in]    values of digit registers [0 - 7] of every chip; chips are numbered from 0,
+     *                      starting with the one connected to the microcontroller
+     *
+     * \return frame to be stored in flash and sent with Max7219::writeFrame_P().
+    **/
+    template <uint8_t devices>
+    constexpr frame_t<devices> makeFrame(const uint8_t (&digits)[devices][maxDigits])
+    {
+        return frameBuilder::rowsOf<devices>(digits, typename frameBuilder::indicesOf<2 * devices>::type {});
+    }
 }
 
 class Max7219
@@ -88,7 +200,9 @@ public:
 
     /**
      * \brief   A method of releasing IO pins indicated by the current context
-     *          used to communicate with MAX7219 chip(s) chain.
+     *          used to communicate with MAX7219 chip(s) chain. With the SPI0 and USART backends
+     *          only the LOAD (CS) pin is released while other chains still use the peripheral;
+     *          the peripheral and its clock and data pins are released with the last of them.
      *
      * \return true if successful, otherwise false.
     **/
@@ -181,6 +295,96 @@ public:
     **/
     bool write(const uint8_t position, const uint8_t value);
 
+    /**
+     * \brief   Method that sends precompiled content of all digit registers of the chain, kept in flash.
+     *          Bytes are shifted out as they are stored, so changing a static screen costs only the wire time.
+     *          With BACKEND_SPIDEV the whole frame is one SPI message (one system call), rows separated
+     *          by chip select changes; on Linux the frame may also be built at run time in RAM.
+     *
+     * \param frame[in] frame built with Max7219NS::makeFrame() and stored in PROGMEM
+     *
+     * \return true if successful, false when the frame is for another number of chips or a chain frame
+     *         written with write() is not finished.
+    **/
+    template <uint8_t devices>
+    bool writeFrame_P(const Max7219NS::frame_t<devices> &frame)
+    {
+        return writeFrame_P(&frame.bytes[0][0], devices);
+    }
+
+    /**
+     * \brief   Method that sends precompiled frame of the chain, kept in flash.
+     *
+     * \param frame[in]     bytes of frame_t<devices> stored in PROGMEM
+     * \param devices[in]   number of chips the frame was built for
+     *
+     * \return true if successful, otherwise false.
+    **/
+    bool writeFrame_P(const uint8_t *frame, const uint8_t devices);
+
+    /**
+     * \brief   Method that starts sending precompiled frame of the chain in the background
+     *          (BACKEND_SPI_BUFFERED with the library built with MAX7219_SPI_ASYNC, or
+     *          BACKEND_USART_MSPI with MAX7219_MSPI_ASYNC). Interrupts of the peripheral keep its
+     *          transmit buffer full, so the words of a row leave back-to-back, and latch every row
+     *          (LOAD pulse) as soon as its last bit is shifted out. Frames of chains bound to
+     *          different peripherals are sent at the same time.
+     *          The frame must stay valid until isFrameBusy() returns false; other methods
+     *          sending to a chain on the same peripheral wait for the end of the frame.
+     *
+     * \param frame[in] frame built with Max7219NS::makeFrame() and stored in PROGMEM
+     *
+     * \return true if the frame has started, false when the backend does not support it,
+     *         the peripheral is busy or a chain frame written with write() is not finished.
+    **/
+    template <uint8_t devices>
+    bool writeFrameAsync_P(const Max7219NS::frame_t<devices> &frame)
+    {
+        return writeFrameAsync_P(&frame.bytes[0][0], devices);
+    }
+
+    /**
+     * \brief   Method that starts sending precompiled frame of the chain in the background.
+     *
+     * \param frame[in]     bytes of frame_t<devices> stored in PROGMEM
+     * \param devices[in]   number of chips the frame was built for
+     *
+     * \return true if the frame has started, otherwise false.
+    **/
+    bool writeFrameAsync_P(const uint8_t *frame, const uint8_t devices);
+
+    /**
+     * \brief   Method that starts sending frame of the chain kept in RAM in the background,
+     *          e.g. built at run time with Max7219NS::makeFrame(); see writeFrameAsync_P().
+     *
+     * \param frame[in] frame of the chain; must not change until isFrameBusy() returns false
+     *
+     * \return true if the frame has started, otherwise false.
+    **/
+    template <uint8_t devices>
+    bool writeFrameAsync(const Max7219NS::frame_t<devices> &frame)
+    {
+        return writeFrameAsync(&frame.bytes[0][0], devices);
+    }
+
+    /**
+     * \brief   Method that starts sending frame of the chain kept in RAM in the background.
+     *
+     * \param frame[in]     bytes of frame_t<devices>
+     * \param devices[in]   number of chips the frame was built for
+     *
+     * \return true if the frame has started, otherwise false.
+    **/
+    bool writeFrameAsync(const uint8_t *frame, const uint8_t devices);
+
+    /**
+     * \brief   A method that returns a flag indicating whether a frame (or a row) of the current
+     *          context is being sent by its peripheral (BACKEND_SPI_BUFFERED, BACKEND_USART_MSPI).
+     *
+     * \return true while sending, false otherwise.
+    **/
+    bool isFrameBusy(void);
+
 protected:
     static const uint32_t   clockDelay  {1};
 
@@ -199,6 +403,38 @@ protected:
         regDisplayTest  = 0x0F00,
     } registers_t;
 
+    /**
+     * \brief   Method that starts a background frame on the peripheral of the chain.
+     *
+     * \param frame[in]     bytes of the frame
+     * \param devices[in]   number of chips the frame was built for
+     * \param inFlash[in]   true for a frame in PROGMEM, false for one in RAM
+     *
+     * \return true if the frame has started, otherwise false.
+    **/
+    bool startFrame(const uint8_t *frame, const uint8_t devices, const bool inFlash);
+
+    /**
+     * \brief Method that prepares the peripheral selected by the context backend.
+     *
+     * \return true if successful, false when the backend is not available.
+    **/
+    bool beginBackend(void);
+
+    /**
+     * \brief   Method that starts a chain frame: LOAD goes low, or the spidev row buffer is emptied.
+     *          With BACKEND_SPI_BUFFERED and BACKEND_USART_MSPI it first waits until the peripheral is free.
+    **/
+    void beginRow(void);
+
+    /**
+     * \brief   Method that ends a chain frame: LOAD goes high (after the last bit leaves the peripheral
+     *          with BACKEND_SPI_BUFFERED and BACKEND_USART_MSPI), or the collected row is sent with one transfer.
+     *
+     * \return true if successful, false when the spidev transfer failed.
+    **/
+    bool endRow(void);
+
     /**
      * \brief A method that sends a data byte to the MAX7219 chip.
      *
@@ -210,8 +446,10 @@ protected:
      * \brief Method that sends command [2 bytes] to currently active MAX7219 chip.
      *
      * \param cmd[in] [2 bytes] representing command being sent
+     *
+     * \return true if successful, false when the chain frame could not be sent.
     **/
-    void sendCmd(const uint16_t cmd);
+    bool sendCmd(const uint16_t cmd);
 
     /**
      * \brief Method for setting the number of displayed segment groups (digits) for all chips in chain.
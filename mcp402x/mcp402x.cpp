@@ -11,6 +11,7 @@
  */
 
 #include "mcp402x.h"
+#include "profiler.h"
 
 Mcp402x::Mcp402x(Mcp402xNS::context_t &ctx) : _ctx(&ctx)
 {
@@ -24,12 +25,13 @@ bool Mcp402x::init(void)
 {
     bool result {false};
 
-    if (nullptr != _ctx)
+    if ((nullptr != _ctx) && ((Mcp402xNS::BACKEND_USI != _ctx->backend) ||
+                              ((HAL_USI_USCK_PIN == _ctx->udPin) && hal_usiClockBegin())))
     {
-        pinMode(_ctx->csPin, OUTPUT);
-        pinMode(_ctx->udPin, OUTPUT);
-        digitalWrite(_ctx->csPin, HIGH);
-        digitalWrite(_ctx->udPin, HIGH);
+        hal_pinMode(_ctx->csPin, OUTPUT);
+        hal_pinMode(_ctx->udPin, OUTPUT);
+        hal_digitalWrite(_ctx->csPin, HIGH);
+        hal_digitalWrite(_ctx->udPin, HIGH);
         _ctx->currentValue = 0x00;
         _ctx->isInitialized = true;
         result = true;
@@ -81,9 +83,7 @@ bool Mcp402x::up(void)
 
     if ((nullptr != _ctx) && _ctx->isInitialized && (_ctx->currentValue < Mcp402xNS::maxValue))
     {
-        pulse(1, UP, keepNV_t::NO);
-        _ctx->currentValue++;
-        result= true;
+        result = pulse(1, UP, keepNV_t::NO);
     }
 
     return result;
@@ -95,9 +95,7 @@ bool Mcp402x::down(void)
 
     if ((nullptr != _ctx) && _ctx->isInitialized && (_ctx->currentValue > Mcp402xNS::minValue))
     {
-        pulse(1, DOWN, keepNV_t::NO);
-        _ctx->currentValue--;
-        result= true;
+        result = pulse(1, DOWN, keepNV_t::NO);
     }
 
     return result;
@@ -105,6 +103,7 @@ bool Mcp402x::down(void)
 
 bool Mcp402x::set(uint8_t value)
 {
+    PROFILE_SCOPE(PROFILER_ZONE_MCP402X_SET);
     bool result {false};
 
     if ((nullptr != _ctx) && _ctx->isInitialized)
@@ -129,9 +128,7 @@ bool Mcp402x::set(uint8_t value)
 
         if (diff != 0)
         {
-            pulse(diff, dir, keepNV_t::NO);
-            _ctx->currentValue = value;
-            result = true;
+            result = pulse(diff, dir, keepNV_t::NO);
         }
     }
 
@@ -159,31 +156,91 @@ uint8_t Mcp402x::keepNonVolatile(void)
 // *                                                               *
 // *****************************************************************
 
-void Mcp402x::pulse(const uint8_t pulses, const direction_t dir, const keepNV_t nonVolatile)
+bool Mcp402x::pulse(const uint8_t pulses, const direction_t dir, const keepNV_t nonVolatile)
 {
-    digitalWrite(_ctx->udPin, ((DOWN == dir) ? LOW : HIGH));
-    delayMicroseconds(minCsTime);
-    digitalWrite(_ctx->csPin, LOW);
-
-    for (uint8_t pulse = 0; pulse < pulses; pulse++)
+    bool    result  {true};
+    uint8_t level   {(uint8_t)((DOWN == dir) ? LOW : HIGH)};
+    uint8_t irq     {0};
+
+    hal_digitalWrite(_ctx->udPin, level);
+    hal_delayMicroseconds(minCsTime);
+    irq = hal_irqSave();
+    _ctx->steps = 0;
+    _ctx->sequence = (YES == nonVolatile) ? Mcp402xNS::SEQUENCE_KEEP
+                   : ((UP == dir) ? Mcp402xNS::SEQUENCE_UP : Mcp402xNS::SEQUENCE_DOWN);
+    hal_digitalWrite(_ctx->csPin, LOW);
+    hal_irqRestore(irq);
+
+    for (uint8_t pulse = 0; result && (pulse < pulses); pulse++)
     {
         if (UP == dir)
         {
-            delayMicroseconds(pulseDelay);
-            digitalWrite(_ctx->udPin, LOW);
+            hal_delayMicroseconds(pulseDelay);
+            result = edge(level, LOW);
         }
-        if (NO == nonVolatile)
+        if (result && (NO == nonVolatile))
         {
-            delayMicroseconds(pulseDelay);
-            digitalWrite(_ctx->udPin, HIGH);
+            hal_delayMicroseconds(pulseDelay);
+            result = edge(level, HIGH);
         }
-        if (DOWN == dir)
+        if (result && (DOWN == dir))
         {
-            delayMicroseconds(pulseDelay);
-            digitalWrite(_ctx->udPin, LOW);
+            hal_delayMicroseconds(pulseDelay);
+            result = edge(level, LOW);
         }
     }
 
-    delayMicroseconds(minCsTime);
-    digitalWrite(_ctx->csPin, HIGH);
+    hal_delayMicroseconds(minCsTime);
+    irq = hal_irqSave();
+    if (Mcp402xNS::SEQUENCE_IDLE != _ctx->sequence)
+    {
+        hal_digitalWrite(_ctx->csPin, HIGH);
+        if (UP == dir)
+        {
+            _ctx->currentValue += _ctx->steps;
+        } else
+        {
+            _ctx->currentValue -= _ctx->steps;
+        }
+        _ctx->sequence = Mcp402xNS::SEQUENCE_IDLE;
+    } else
+    {
+        result = false;                                             // ended by an emergency save
+    }
+    hal_irqRestore(irq);
+
+    return result;
+}
+
+bool Mcp402x::edge(uint8_t &level, const uint8_t newLevel)
+{
+    const uint8_t   irq     {hal_irqSave()};
+    const bool      result  {Mcp402xNS::SEQUENCE_IDLE != _ctx->sequence};
+
+    if (result)
+    {
+        setUd(level, newLevel);
+        if ((HIGH == newLevel) && (Mcp402xNS::SEQUENCE_KEEP != _ctx->sequence))
+        {
+            _ctx->steps++;
+        }
+    }
+    hal_irqRestore(irq);
+
+    return result;
+}
+
+inline void Mcp402x::setUd(uint8_t &level, const uint8_t newLevel)
+{
+    if (Mcp402xNS::BACKEND_USI == _ctx->backend)
+    {
+        if (newLevel != level)
+        {
+            hal_usiToggleClock();
+        }
+    } else
+    {
+        hal_digitalWrite(_ctx->udPin, newLevel);
+    }
+    level = newLevel;
 }
@@ -12,7 +12,7 @@
 
 #pragma once
 
-#include <Arduino.h>
+#include "hal.h"
 
 namespace Mcp402xNS
 {
@@ -26,6 +26,26 @@ namespace Mcp402xNS
     **/
     constexpr uint8_t   minValue        {0x00};
 
+    /**
+     * \brief Type selecting the peripheral which drives U/D input of the chip.
+    **/
+    typedef enum : uint8_t
+    {
+        BACKEND_GPIO    = 0x00,     // udPin written as a port pin
+        BACKEND_USI     = 0x01,     // U/D on USCK toggled by USITC strobes (ATtiny), USI data pins untouched
+    } backend_t;
+
+    /**
+     * \brief Type of the serial command in progress (chip select low).
+    **/
+    typedef enum : uint8_t
+    {
+        SEQUENCE_IDLE   = 0x00,     // chip select high
+        SEQUENCE_UP     = 0x01,     // increment: CS fell with U/D high, every U/D rising edge is a step up
+        SEQUENCE_DOWN   = 0x02,     // decrement: CS fell with U/D low, every U/D rising edge is a step down
+        SEQUENCE_KEEP   = 0x03,     // write wiper to EEPROM, no steps
+    } sequence_t;
+
     /**
      *  \brief Structure containing the context of MCP402x chip settings.
      * 
@@ -37,6 +57,13 @@ namespace Mcp402xNS
      *                          In NV mode, you must maintain this value yourself, as it cannot be read from the chip.
      *  \param isInitialized    A variable indicating whether the initialization allowing communication
      *                          with the chip has been performed - the init() method has been called.
+     *  \param backend          Peripheral driving U/D. With BACKEND_USI udPin must be HAL_USI_USCK_PIN;
+     *                          init() fails otherwise and on targets without USI. Only USCK is taken,
+     *                          DO and DI stay free. Step rate is bound by the datasheet delays
+     *                          either way, so the backend mostly saves the port read-modify-write.
+     *  \param sequence         Command in progress, kept by the driver for an emergency save
+     *                          (Mcp402xPowerFail::save()) which may interrupt it.
+     *  \param steps            Wiper steps already made by the command in progress.
     **/
     typedef struct
     {
@@ -44,6 +71,9 @@ namespace Mcp402xNS
         uint8_t         udPin           {0x03};
         uint8_t         currentValue    {0x00};
         bool            isInitialized   {false};
+        backend_t       backend         {BACKEND_GPIO};
+        volatile sequence_t sequence    {SEQUENCE_IDLE};
+        volatile uint8_t    steps       {0};
     } context_t;
     
 }
@@ -177,9 +207,36 @@ protected:
      *  \brief  Method that sends n pulses to U/D pin of MCP402x chip
      *          to change the resistance value.
      *
+     *          The command is recorded in the context and currentValue is updated together
+     *          with the chip select rising edge, so an emergency save interrupting the sequence
+     *          knows the real wiper position.
+     *
      *  \param pulses[in]       number of pulses to be sent
      *  \param dir[in]          potentiometer wiper direction
      *  \param nonVolatile[in]  whether to save data in internal non-volatile memory of chip.
+     *
+     *  \return true if the sequence has been completed, false when an emergency save took it over.
+    **/
+    bool pulse(const uint8_t pulses, const direction_t dir, const keepNV_t nonVolatile);
+
+    /**
+     *  \brief  Method that sets level of U/D pin; with USI backend the pin is toggled
+     *          by a clock strobe when the level changes.
+     *
+     *  \param level[in,out]    current level of the pin, updated to 'newLevel'
+     *  \param newLevel[in]     level to be set
+    **/
+    inline void setUd(uint8_t &level, const uint8_t newLevel);
+
+    /**
+     *  \brief  Method that changes level of U/D pin as a part of the command in progress,
+     *          counting every rising edge of an increment/decrement as a wiper step.
+     *          The edge and the count are made atomic against an emergency save.
+     *
+     *  \param level[in,out]    current level of the pin, updated to 'newLevel'
+     *  \param newLevel[in]     level to be set
+     *
+     *  \return true if the edge has been made, false when the command was taken over.
     **/
-    void pulse(const uint8_t pulses, const direction_t dir, const keepNV_t nonVolatile);
+    bool edge(uint8_t &level, const uint8_t newLevel);
 };
@@ -0,0 +1,310 @@
+/**
+ * \file    mcp402x_powerfail.cpp
+ * \brief   Optional power-fail path for MCP402x devices.
+ *          On a supply failure warning (analog comparator, BOD warning or any other interrupt)
+ *          all registered potentiometers receive the "write wiper to EEPROM" command at the same time
+ *          and their current values are recorded in the MCU's EEPROM.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "mcp402x_powerfail.h"
+
+#if defined(__AVR__)
+#include <avr/eeprom.h>
+#include <avr/interrupt.h>
+#endif
+
+namespace
+{
+    /**
+     * \brief   Time between consecutive edges of the emergency sequence.
+     *          Datasheet minimums (tLUC, tLCUF, tHI/tLO) are all below 1 us.
+    **/
+    constexpr uint8_t   edgeDelayUs {1};
+
+    typedef struct
+    {
+        Mcp402xNS::context_t   *ctx;
+        uint16_t                eepromAddress;
+    } pot_t;
+
+#if defined(HAL_BACKEND_AVR_DIRECT)
+    /**
+     * \brief   Precomputed part of the sequence for one IO port.
+     *          Each edge of the sequence costs a single read-modify-write per port,
+     *          regardless of the number of chips connected to it.
+    **/
+    typedef struct
+    {
+        volatile uint8_t       *out;
+        uint8_t                 csMask;
+        uint8_t                 udMask;
+    } port_t;
+
+    port_t          ports[2 * Mcp402xPowerFail::maxPots]    {};
+    uint8_t         portCount                               {0};
+#endif
+#if !defined(__AVR__)
+    uint8_t         hostEeprom[1024]                        {};
+#endif
+
+    pot_t           pots[Mcp402xPowerFail::maxPots]         {};
+    uint8_t         potCount                                {0};
+    volatile bool   saved                                   {false};
+
+    inline void edgeDelay(void)
+    {
+        hal_delayMicroseconds(edgeDelayUs);
+    }
+
+#if defined(HAL_BACKEND_AVR_DIRECT)
+    port_t *findPort(volatile uint8_t *out)
+    {
+        port_t *result {nullptr};
+
+        for (uint8_t idx = 0; idx < portCount; idx++)
+        {
+            if (out == ports[idx].out)
+            {
+                result = &ports[idx];
+                break;
+            }
+        }
+        if (nullptr == result)
+        {
+            result = &ports[portCount++];
+            result->out = out;
+            result->csMask = 0;
+            result->udMask = 0;
+        }
+
+        return result;
+    }
+#endif
+
+    void buildPlan(void)
+    {
+#if defined(HAL_BACKEND_AVR_DIRECT)
+        portCount = 0;
+        for (uint8_t idx = 0; idx < potCount; idx++)
+        {
+            const uint8_t csPin {pots[idx].ctx->csPin};
+            const uint8_t udPin {pots[idx].ctx->udPin};
+
+            findPort(hal_pinOutputRegister(csPin))->csMask |= hal_pinBitMask(csPin);
+            findPort(hal_pinOutputRegister(udPin))->udMask |= hal_pinBitMask(udPin);
+        }
+#endif
+    }
+
+    inline void setUd(const bool level)
+    {
+#if defined(HAL_BACKEND_AVR_DIRECT)
+        for (uint8_t idx = 0; idx < portCount; idx++)
+        {
+            if (level)
+            {
+                *ports[idx].out |= ports[idx].udMask;
+            } else
+            {
+                *ports[idx].out &= (uint8_t)~ports[idx].udMask;
+            }
+        }
+#else
+        for (uint8_t idx = 0; idx < potCount; idx++)
+        {
+            hal_digitalWrite(pots[idx].ctx->udPin, (level ? HIGH : LOW));
+        }
+#endif
+    }
+
+    inline void setCs(const bool level)
+    {
+#if defined(HAL_BACKEND_AVR_DIRECT)
+        for (uint8_t idx = 0; idx < portCount; idx++)
+        {
+            if (level)
+            {
+                *ports[idx].out |= ports[idx].csMask;
+            } else
+            {
+                *ports[idx].out &= (uint8_t)~ports[idx].csMask;
+            }
+        }
+#else
+        for (uint8_t idx = 0; idx < potCount; idx++)
+        {
+            hal_digitalWrite(pots[idx].ctx->csPin, (level ? HIGH : LOW));
+        }
+#endif
+    }
+
+    /**
+     * \brief   Ends the command the driver had in progress when the save interrupted it.
+     *          CS must rise with U/D at the level it had when CS fell, otherwise the chip
+     *          writes its EEPROM. Restoring the level of an increment is a rising edge,
+     *          i.e. one more step, which is accounted for in currentValue.
+    **/
+    void settle(Mcp402xNS::context_t &ctx)
+    {
+        const Mcp402xNS::sequence_t sequence    {ctx.sequence};
+        uint8_t                     steps       {ctx.steps};
+
+        if (Mcp402xNS::SEQUENCE_IDLE != sequence)
+        {
+            const bool udHigh {HIGH == hal_digitalRead(ctx.udPin)};
+
+            if ((Mcp402xNS::SEQUENCE_UP == sequence) && !udHigh)
+            {
+                edgeDelay();
+                hal_digitalWrite(ctx.udPin, HIGH);
+                steps++;
+            } else if ((Mcp402xNS::SEQUENCE_DOWN == sequence) && udHigh)
+            {
+                edgeDelay();
+                hal_digitalWrite(ctx.udPin, LOW);                   // falling edge: no step
+            }
+            edgeDelay();
+            hal_digitalWrite(ctx.csPin, HIGH);
+
+            if (Mcp402xNS::SEQUENCE_UP == sequence)
+            {
+                ctx.currentValue = ((ctx.currentValue + steps) > Mcp402xNS::maxValue)
+                                 ? Mcp402xNS::maxValue : (ctx.currentValue + steps);
+            } else if (Mcp402xNS::SEQUENCE_DOWN == sequence)
+            {
+                ctx.currentValue = (ctx.currentValue > steps) ? (ctx.currentValue - steps) : Mcp402xNS::minValue;
+            }
+            ctx.sequence = Mcp402xNS::SEQUENCE_IDLE;
+        }
+    }
+
+    inline void recordValue(const uint16_t address, const uint8_t value)
+    {
+#if defined(__AVR__)
+        eeprom_update_byte((uint8_t *)address, value);
+#else
+        hostEeprom[address % sizeof(hostEeprom)] = value;
+#endif
+    }
+
+    inline uint8_t recordedValue(const uint16_t address)
+    {
+#if defined(__AVR__)
+        return eeprom_read_byte((const uint8_t *)address);
+#else
+        return hostEeprom[address % sizeof(hostEeprom)];
+#endif
+    }
+}
+
+bool Mcp402xPowerFail::registerPot(Mcp402xNS::context_t &ctx, const uint16_t eepromAddress)
+{
+    bool result {false};
+
+    if (ctx.isInitialized && (potCount < maxPots))
+    {
+        unregisterPot(ctx);
+        pots[potCount].ctx = &ctx;
+        pots[potCount].eepromAddress = eepromAddress;
+        potCount++;
+        buildPlan();
+        result = true;
+    }
+
+    return result;
+}
+
+bool Mcp402xPowerFail::unregisterPot(Mcp402xNS::context_t &ctx)
+{
+    bool result {false};
+
+    for (uint8_t idx = 0; idx < potCount; idx++)
+    {
+        if (&ctx == pots[idx].ctx)
+        {
+            pots[idx] = pots[--potCount];
+            buildPlan();
+            result = true;
+            break;
+        }
+    }
+
+    return result;
+}
+
+void Mcp402xPowerFail::save(void)
+{
+    if (!saved && (potCount > 0))
+    {
+        saved = true;
+        uint8_t irq {hal_irqSave()};
+        for (uint8_t idx = 0; idx < potCount; idx++)
+        {
+            settle(*pots[idx].ctx);
+        }
+
+        // "write wiper to EEPROM": CS falls with U/D high (increment mode),
+        // U/D falls and CS rises while U/D is still low - no wiper step is made
+        setUd(true);
+        edgeDelay();
+        setCs(false);
+        edgeDelay();
+        setUd(false);
+        edgeDelay();
+        setCs(true);
+        hal_irqRestore(irq);
+
+        for (uint8_t idx = 0; idx < potCount; idx++)
+        {
+            recordValue(pots[idx].eepromAddress, pots[idx].ctx->currentValue);
+        }
+    }
+}
+
+bool Mcp402xPowerFail::isSaved(void)
+{
+    return saved;
+}
+
+void Mcp402xPowerFail::rearm(void)
+{
+    saved = false;
+}
+
+bool Mcp402xPowerFail::restore(Mcp402x &pot, const uint16_t eepromAddress)
+{
+    return pot.updateWiperValue(recordedValue(eepromAddress));
+}
+
+bool Mcp402xPowerFail::armComparator(void)
+{
+    bool result {false};
+
+#if defined(ACSR) && defined(ACIE)
+    ACSR = _BV(ACI);                                                // clear pending interrupt flag
+    ACSR = _BV(ACBG) | _BV(ACIE) | _BV(ACIS1) | _BV(ACIS0);         // bandgap on AIN0, interrupt on rising output:
+                                                                    // divided supply on AIN1 fell below the bandgap
+    result = true;
+#endif
+
+    return result;
+}
+
+void Mcp402xPowerFail::disarmComparator(void)
+{
+#if defined(ACSR) && defined(ACIE)
+    ACSR &= ~_BV(ACIE);
+#endif
+}
+
+#if defined(MCP402X_POWERFAIL_COMPARATOR) && defined(ANALOG_COMP_vect)
+ISR(ANALOG_COMP_vect)
+{
+    Mcp402xPowerFail::save();
+}
+#endif
@@ -0,0 +1,97 @@
+/**
+ * \file    mcp402x_powerfail.h
+ * \brief   Optional power-fail path for MCP402x devices.
+ *          On a supply failure warning (analog comparator, BOD warning or any other interrupt)
+ *          all registered potentiometers receive the "write wiper to EEPROM" command at the same time
+ *          and their current values are recorded in the MCU's EEPROM.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include "mcp402x.h"
+
+#ifndef MCP402X_POWERFAIL_MAX_POTS
+#define MCP402X_POWERFAIL_MAX_POTS  4
+#endif
+
+namespace Mcp402xPowerFail
+{
+    /**
+     * \brief Maximum number of potentiometers which can be registered for emergency save.
+    **/
+    constexpr uint8_t   maxPots     {MCP402X_POWERFAIL_MAX_POTS};
+
+    /**
+     * \brief   Registers potentiometer for emergency save and rebuilds precomputed pulse sequence.
+     *          The context must be initialized (Mcp402x::init()) before registration,
+     *          because the sequence is built from already configured output pins.
+     *
+     * \param ctx[in]           a reference to structure containing settings for chip
+     * \param eepromAddress[in] address in MCU's EEPROM where currentValue is recorded on power-fail
+     *
+     * \return true if successful, false when context is not initialized or the table is full.
+    **/
+    bool registerPot(Mcp402xNS::context_t &ctx, const uint16_t eepromAddress);
+
+    /**
+     * \brief Removes potentiometer from the emergency save table.
+     *
+     * \param ctx[in] a reference to structure containing settings for chip
+     *
+     * \return true if the context was registered, false otherwise.
+    **/
+    bool unregisterPot(Mcp402xNS::context_t &ctx);
+
+    /**
+     * \brief   Emergency save: sends "write wiper to EEPROM" command to all registered chips
+     *          simultaneously (one port write per edge) and records their currentValue in MCU's EEPROM.
+     *          Safe to call from an interrupt; it runs only once until rearm() is called.
+     *          A command interrupted by the save (Mcp402x::set(), up(), down()) is ended first
+     *          without an EEPROM write, and currentValue is corrected to the real wiper position;
+     *          the interrupted call then returns false.
+    **/
+    void save(void);
+
+    /**
+     * \brief A method that returns true when emergency save has already been done.
+    **/
+    bool isSaved(void);
+
+    /**
+     * \brief Allows the next save() call to run again (e.g. after the supply has recovered).
+    **/
+    void rearm(void);
+
+    /**
+     * \brief   Restores the wiper value stored in the context from the record kept in MCU's EEPROM.
+     *          Intended to be called after Mcp402x::init() of NV-mode chips.
+     *
+     * \param pot[in,out]       potentiometer object with initialized context
+     * \param eepromAddress[in] address in MCU's EEPROM passed to registerPot()
+     *
+     * \return true if successful, otherwise false.
+    **/
+    bool restore(Mcp402x &pot, const uint16_t eepromAddress);
+
+    /**
+     * \brief   Configures analog comparator as a supply monitor: the internal bandgap is used
+     *          as reference and the divided supply is connected to AIN1. The comparator interrupt
+     *          calls save() when the library is built with MCP402X_POWERFAIL_COMPARATOR defined.
+     *          It must be a global build flag (compiler option): a #define in the sketch does not
+     *          reach mcp402x_powerfail.cpp. Without it the sketch calls save() from its own
+     *          ISR(ANALOG_COMP_vect).
+     *
+     * \return true if successful, false on targets without analog comparator.
+    **/
+    bool armComparator(void);
+
+    /**
+     * \brief Disables the analog comparator interrupt.
+    **/
+    void disarmComparator(void);
+}
@@ -0,0 +1,117 @@
+/**
+ * \file profiler.cpp
+ * \brief   Compile-time removable profiling zones.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "profiler.h"
+#include <avr/pgmspace.h>
+
+namespace
+{
+    const char nameMax7219Init[]    PROGMEM {"Max7219::init"};
+    const char nameMax7219SendCmd[] PROGMEM {"Max7219::sendCmd"};
+    const char nameMax7219Frame[]   PROGMEM {"Max7219::writeFrame_P"};
+    const char nameMcp402xSet[]     PROGMEM {"Mcp402x::set"};
+    const char nameI2cReadBytes[]   PROGMEM {"I2C::readBytes"};
+    const char nameTwiWaitReady[]   PROGMEM {"twi wait ready"};
+    const char nameTwiWaitRead[]    PROGMEM {"twi wait read"};
+    const char nameTwiWaitWrite[]   PROGMEM {"twi wait write"};
+    const char nameTwiWaitStop[]    PROGMEM {"twi wait stop"};
+    const char nameTwiIsr[]         PROGMEM {"twi isr"};
+
+    const char * const names[PROFILER_ZONE_USER] PROGMEM
+    {
+        nameMax7219Init,
+        nameMax7219SendCmd,
+        nameMax7219Frame,
+        nameMcp402xSet,
+        nameI2cReadBytes,
+        nameTwiWaitReady,
+        nameTwiWaitRead,
+        nameTwiWaitWrite,
+        nameTwiWaitStop,
+        nameTwiIsr,
+    };
+
+    profiler_zone_t     zones[PROFILER_ZONES]   {};
+    uint16_t            overhead                {0};
+}
+
+extern "C" void profiler_init(void)
+{
+    uint16_t start;
+
+    hal_cycleCounterStart(PROFILER_PRESCALER);
+    start = hal_cycleCounter();
+    overhead = hal_cycleCounter() - start;
+    profiler_reset();
+}
+
+extern "C" void profiler_reset(void)
+{
+    uint8_t irq {hal_irqSave()};
+    for (uint8_t idx = 0; idx < PROFILER_ZONES; idx++)
+    {
+        zones[idx] = {0, 0xFFFF, 0, 0};
+    }
+    hal_irqRestore(irq);
+}
+
+extern "C" void profiler_record(uint8_t zone, uint16_t start)
+{
+    uint16_t ticks {(uint16_t)(hal_cycleCounter() - start)};
+
+    if ((zone < PROFILER_ZONES) && (0xFFFF != zones[zone].count))
+    {
+        profiler_zone_t *stats {&zones[zone]};
+
+        ticks = (ticks > overhead) ? (ticks - overhead) : 0;
+        stats->count++;
+        stats->min = (ticks < stats->min) ? ticks : stats->min;
+        stats->max = (ticks > stats->max) ? ticks : stats->max;
+        stats->total += ticks;
+    }
+}
+
+extern "C" const profiler_zone_t *profiler_zone(uint8_t zone)
+{
+    return (zone < PROFILER_ZONES) ? &zones[zone] : nullptr;
+}
+
+void Profiler::dump(Print &out)
+{
+    for (uint8_t idx = 0; idx < PROFILER_ZONES; idx++)
+    {
+        profiler_zone_t stats;
+        uint8_t         irq {hal_irqSave()};
+        stats = zones[idx];
+        hal_irqRestore(irq);
+
+        if (0 != stats.count)
+        {
+            if (idx < PROFILER_ZONE_USER)
+            {
+                out.print(reinterpret_cast<const __FlashStringHelper *>(pgm_read_ptr(&names[idx])));
+            } else
+            {
+                out.print(F("user"));
+                out.print((unsigned int)(idx - PROFILER_ZONE_USER));
+            }
+            out.print(F(": count="));
+            out.print(stats.count);
+            out.print(F(" min="));
+            out.print((uint32_t)stats.min * PROFILER_PRESCALER);
+            out.print(F(" avg="));
+            out.print((stats.total / stats.count) * PROFILER_PRESCALER);
+            out.print(F(" max="));
+            out.print((uint32_t)stats.max * PROFILER_PRESCALER);
+            out.print(F(" total="));
+            out.println(stats.total * PROFILER_PRESCALER);
+        }
+    }
+}
@@ -0,0 +1,141 @@
+/**
+ * \file profiler.h
+ * \brief   Compile-time removable profiling zones.
+ *          A zone measures the time between its begin and end with the free-running
+ *          16-bit cycle counter of the HAL (Timer1 on AVR) and accumulates count, min, max
+ *          and total per zone. Without PROFILER_ENABLED defined all PROFILE_* macros
+ *          expand to nothing, so instrumented code is identical to non-instrumented one.
+ *
+ *          Zones longer than 65535 counter ticks wrap around - use PROFILER_PRESCALER
+ *          to measure long zones (e.g. Max7219::init with long chains).
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include "hal.h"
+
+#ifndef PROFILER_PRESCALER
+    #define PROFILER_PRESCALER      1       // CPU cycles per counter tick: 1, 8, 64, 256 or 1024
+#endif
+
+#ifndef PROFILER_USER_ZONES
+    #define PROFILER_USER_ZONES     4       // zones available to application code
+#endif
+
+/**
+ * \brief Identifiers of profiling zones; zones of the libraries come first, then application zones.
+**/
+typedef enum
+{
+    PROFILER_ZONE_MAX7219_INIT      = 0,
+    PROFILER_ZONE_MAX7219_SEND_CMD,
+    PROFILER_ZONE_MAX7219_WRITE_FRAME,
+    PROFILER_ZONE_MCP402X_SET,
+    PROFILER_ZONE_I2C_READ_BYTES,
+    PROFILER_ZONE_TWI_WAIT_READY,       // waiting for previous transaction to end
+    PROFILER_ZONE_TWI_WAIT_READ,        // waiting for master receive to complete
+    PROFILER_ZONE_TWI_WAIT_WRITE,       // waiting for master transmit to complete
+    PROFILER_ZONE_TWI_WAIT_STOP,        // waiting for stop condition to be executed
+    PROFILER_ZONE_TWI_ISR,              // ISR(TWI_vect) with interrupts blocked (top half with TWI_SPLIT_ISR)
+    PROFILER_ZONE_USER,
+    PROFILER_ZONES                  = PROFILER_ZONE_USER + PROFILER_USER_ZONES
+} profiler_zoneId_t;
+
+/**
+ * \brief Statistics of a single zone; times are in counter ticks (PROFILER_PRESCALER CPU cycles each).
+**/
+typedef struct
+{
+    uint16_t    count;              // statistics stop being updated after 65535 entries
+    uint16_t    min;
+    uint16_t    max;
+    uint32_t    total;
+} profiler_zone_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief   Starts the cycle counter (takes over Timer1 on AVR), measures the cost
+ *          of taking a stamp and clears all zones.
+**/
+void profiler_init(void);
+
+/**
+ * \brief Clears statistics of all zones.
+**/
+void profiler_reset(void);
+
+/**
+ * \brief Adds a single measurement to the zone.
+ *
+ * \param zone[in]  zone identifier
+ * \param start[in] counter value taken at the beginning of the zone
+**/
+void profiler_record(uint8_t zone, uint16_t start);
+
+/**
+ * \brief Statistics of the zone, or NULL when identifier is out of range.
+**/
+const profiler_zone_t *profiler_zone(uint8_t zone);
+
+#ifdef __cplusplus
+}
+#endif
+
+#if defined(PROFILER_ENABLED)
+    #define PROFILE_BEGIN(zone)     const uint16_t profiler_start_##zone = hal_cycleCounter()
+    #define PROFILE_END(zone)       profiler_record((zone), profiler_start_##zone)
+#else
+    #define PROFILE_BEGIN(zone)
+    #define PROFILE_END(zone)
+#endif
+
+#ifdef __cplusplus
+
+#include <Print.h>
+
+namespace Profiler
+{
+    /**
+     * \brief Zone closed automatically at the end of the enclosing scope.
+    **/
+    class Scope
+    {
+    public:
+        explicit Scope(const uint8_t zone) : zone(zone), start(hal_cycleCounter()) {}
+
+        ~Scope(void)
+        {
+            profiler_record(zone, start);
+        }
+
+    private:
+        const uint8_t   zone;
+        const uint16_t  start;
+    };
+
+    /**
+     * \brief   Prints table of all zones that have been entered at least once:
+     *          name, count, min, avg, max and total in CPU cycles, one zone per line.
+     *
+     * \param out[in] destination, e.g. Serial
+    **/
+    void dump(Print &out);
+}
+
+#if defined(PROFILER_ENABLED)
+    #define PROFILER_CONCAT_(a, b)  a##b
+    #define PROFILER_CONCAT(a, b)   PROFILER_CONCAT_(a, b)
+    #define PROFILE_SCOPE(zone)     Profiler::Scope PROFILER_CONCAT(profilerScope, __LINE__) {(zone)}
+#else
+    #define PROFILE_SCOPE(zone)
+#endif
+
+#endif
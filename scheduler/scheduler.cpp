@@ -0,0 +1,191 @@
+/**
+ * \file    scheduler.cpp
+ * \brief   Deadline-ordered cooperative scheduler for background work of the libraries.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "scheduler.h"
+
+Scheduler::Scheduler(SchedulerNS::task_t *tasks, const uint8_t size, const SchedulerNS::timeBase_t timeBase)
+    : _tasks(tasks), _size((size < SchedulerNS::invalidTask) ? size : SchedulerNS::invalidTask - 1), _timeBase(timeBase)
+{
+    if (nullptr == _tasks)
+    {
+        _size = 0;
+    }
+    for (uint8_t idx = 0; idx < _size; idx++)
+    {
+        _tasks[idx] = {};
+    }
+}
+
+Scheduler::~Scheduler(void)
+{
+}
+
+SchedulerNS::taskId_t Scheduler::every(const uint32_t period, SchedulerNS::callback_t callback, void *arg, const uint32_t firstDelay)
+{
+    return (0 != period) ? add(firstDelay, period, callback, arg) : SchedulerNS::invalidTask;
+}
+
+SchedulerNS::taskId_t Scheduler::after(const uint32_t delay, SchedulerNS::callback_t callback, void *arg)
+{
+    return add(delay, 0, callback, arg);
+}
+
+bool Scheduler::reschedule(const SchedulerNS::taskId_t id, const uint32_t delay)
+{
+    bool result {isPending(id)};
+
+    if (result)
+    {
+        _tasks[id].due = now() + delay;
+    }
+
+    return result;
+}
+
+bool Scheduler::cancel(const SchedulerNS::taskId_t id)
+{
+    bool result {isPending(id)};
+
+    if (result)
+    {
+        _tasks[id].callback = nullptr;
+    }
+
+    return result;
+}
+
+bool Scheduler::isPending(const SchedulerNS::taskId_t id)
+{
+    return (id < _size) && (nullptr != _tasks[id].callback);
+}
+
+void Scheduler::tick(void)
+{
+    _ticks = _ticks + 1;
+}
+
+uint32_t Scheduler::now(void)
+{
+    uint32_t result;
+
+    if (SchedulerNS::TICK == _timeBase)
+    {
+        uint8_t irq {hal_irqSave()};
+        result = _ticks;
+        hal_irqRestore(irq);
+    } else
+    {
+        result = hal_millis();
+    }
+
+    return result;
+}
+
+uint32_t Scheduler::timeToNext(void)
+{
+    uint32_t                result  {SchedulerNS::noTask};
+    SchedulerNS::taskId_t   id      {earliest()};
+
+    if (SchedulerNS::invalidTask != id)
+    {
+        int32_t left {remaining(_tasks[id].due, now())};
+
+        result = (left > 0) ? (uint32_t)left : 0;
+    }
+
+    return result;
+}
+
+uint8_t Scheduler::run(const uint8_t maxTasks)
+{
+    uint8_t result {0};
+
+    while (result < maxTasks)
+    {
+        SchedulerNS::taskId_t   id      {earliest()};
+        uint32_t                time    {now()};
+
+        if ((SchedulerNS::invalidTask == id) || (remaining(_tasks[id].due, time) > 0))
+        {
+            break;
+        }
+
+        SchedulerNS::task_t    *task        {&_tasks[id]};
+        SchedulerNS::callback_t callback    {task->callback};
+        void                   *arg         {task->arg};
+
+        if (0 == task->period)
+        {
+            task->callback = nullptr;                                   // one-shot: entry may be reused by the task itself
+        } else
+        {
+            task->due += task->period;
+            if (remaining(task->due, time) <= 0)
+            {
+                task->due = time + task->period;                        // overrun: skip missed periods instead of bursting
+            }
+        }
+        callback(arg);
+        result++;
+    }
+
+    return result;
+}
+
+// *****************************************************************
+// *                                                               *
+// *                       protected methods                       *
+// *                                                               *
+// *****************************************************************
+
+SchedulerNS::taskId_t Scheduler::add(const uint32_t delay, const uint32_t period, SchedulerNS::callback_t callback, void *arg)
+{
+    SchedulerNS::taskId_t result {SchedulerNS::invalidTask};
+
+    if (nullptr != callback)
+    {
+        for (uint8_t idx = 0; idx < _size; idx++)
+        {
+            if (nullptr == _tasks[idx].callback)
+            {
+                _tasks[idx].arg = arg;
+                _tasks[idx].due = now() + delay;
+                _tasks[idx].period = period;
+                _tasks[idx].callback = callback;
+                result = idx;
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+SchedulerNS::taskId_t Scheduler::earliest(void)
+{
+    SchedulerNS::taskId_t   result  {SchedulerNS::invalidTask};
+    uint32_t                time    {now()};
+
+    for (uint8_t idx = 0; idx < _size; idx++)
+    {
+        if ((nullptr != _tasks[idx].callback) &&
+            ((SchedulerNS::invalidTask == result) || (remaining(_tasks[idx].due, time) < remaining(_tasks[result].due, time))))
+        {
+            result = idx;
+        }
+    }
+
+    return result;
+}
+
+int32_t Scheduler::remaining(const uint32_t deadline, const uint32_t time)
+{
+    return (int32_t)(deadline - time);
+}
@@ -0,0 +1,182 @@
+/**
+ * \file    scheduler.h
+ * \brief   Deadline-ordered cooperative scheduler for background work of the libraries
+ *          (display flushes, potentiometer ramps, bus polling, device re-probes).
+ *          Tasks live in a table supplied by the user - no heap is used. The time base is
+ *          either millis() (main loop driven) or a counter advanced by tick() from a timer ISR.
+ *          Every call of run() executes at most the requested number of due tasks, earliest
+ *          deadline first, so worst-case latency of the main loop stays bounded.
+ *
+ * \copyright SPDX-FileCopyrightText: Copyright 2022-2023 Michal Protasowicki
+ *
+ * \license SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include "hal.h"
+
+namespace SchedulerNS
+{
+    /**
+     * \brief Type of function executed by the scheduler; 'arg' is the pointer given at registration.
+    **/
+    typedef void (*callback_t)(void *arg);
+
+    /**
+     * \brief Identifier of a registered task (its index in the task table).
+    **/
+    typedef uint8_t taskId_t;
+
+    /**
+     * \brief Identifier returned when task could not be registered.
+    **/
+    constexpr taskId_t  invalidTask     {0xFF};
+
+    /**
+     * \brief Value returned by Scheduler::timeToNext() when there is no pending task.
+    **/
+    constexpr uint32_t  noTask          {0xFFFFFFFF};
+
+    /**
+     * \brief Source of scheduler time.
+    **/
+    typedef enum : uint8_t
+    {
+        MILLIS  = 0,                    // time in milliseconds taken from millis()
+        TICK    = 1,                    // time in ticks counted by Scheduler::tick()
+    } timeBase_t;
+
+    /**
+     * \brief   Entry of the task table. The table is owned by the user (usually a static array)
+     *          and managed by the scheduler - its content should not be changed directly.
+     *
+     *  \param callback     function to execute, nullptr marks free entry
+     *  \param arg          argument passed to the function
+     *  \param due          time at which the task is to be executed
+     *  \param period       repetition period, 0 for one-shot tasks
+    **/
+    typedef struct
+    {
+        callback_t      callback        {nullptr};
+        void           *arg             {nullptr};
+        uint32_t        due             {0};
+        uint32_t        period          {0};
+    } task_t;
+}
+
+class Scheduler
+{
+public:
+    Scheduler(void) = delete;
+
+    /**
+     *  \brief Scheduler class constructor.
+     *
+     *  \param tasks[in]    table of tasks, all entries are cleared
+     *  \param size[in]     number of entries in the table (up to 254)
+     *  \param timeBase[in] source of time
+    **/
+    Scheduler(SchedulerNS::task_t *tasks, const uint8_t size, const SchedulerNS::timeBase_t timeBase = SchedulerNS::MILLIS);
+
+    /**
+     *  \brief Scheduler class destructor.
+    **/
+    virtual ~Scheduler(void);
+
+    /**
+     *  \brief  Registers a periodic task.
+     *
+     *  \param period[in]       period of execution in units of time source (must be > 0)
+     *  \param callback[in]     function to execute
+     *  \param arg[in]          argument passed to the function
+     *  \param firstDelay[in]   delay of the first execution
+     *
+     *  \return identifier of the task, SchedulerNS::invalidTask when the table is full.
+    **/
+    SchedulerNS::taskId_t every(const uint32_t period, SchedulerNS::callback_t callback, void *arg = nullptr, const uint32_t firstDelay = 0);
+
+    /**
+     *  \brief  Registers a one-shot task; its entry is released before the function is executed.
+     *
+     *  \param delay[in]        delay of execution in units of time source
+     *  \param callback[in]     function to execute
+     *  \param arg[in]          argument passed to the function
+     *
+     *  \return identifier of the task, SchedulerNS::invalidTask when the table is full.
+    **/
+    SchedulerNS::taskId_t after(const uint32_t delay, SchedulerNS::callback_t callback, void *arg = nullptr);
+
+    /**
+     *  \brief  Changes deadline of registered task (period of periodic task is not changed).
+     *
+     *  \return true if successful, false when task is not registered.
+    **/
+    bool reschedule(const SchedulerNS::taskId_t id, const uint32_t delay);
+
+    /**
+     *  \brief  Removes task from the table; may be called from the task itself.
+     *
+     *  \return true if task was registered, false otherwise.
+    **/
+    bool cancel(const SchedulerNS::taskId_t id);
+
+    /**
+     *  \brief A method that checks whether task is registered.
+    **/
+    bool isPending(const SchedulerNS::taskId_t id);
+
+    /**
+     *  \brief  Advances time of SchedulerNS::TICK scheduler by one tick.
+     *          Intended to be called from timer interrupt.
+    **/
+    void tick(void);
+
+    /**
+     *  \brief Current time of the scheduler in units of its time source.
+    **/
+    uint32_t now(void);
+
+    /**
+     *  \brief  Time remaining to the earliest deadline - lets the caller sleep in between.
+     *
+     *  \return 0 when a task is due, SchedulerNS::noTask when there are no tasks.
+    **/
+    uint32_t timeToNext(void);
+
+    /**
+     *  \brief  Executes due tasks in deadline order (ties in table order).
+     *          Must be called from the main loop, never from an interrupt.
+     *
+     *  \param maxTasks[in] maximum number of tasks executed by this call
+     *
+     *  \return number of executed tasks.
+    **/
+    uint8_t run(const uint8_t maxTasks = 1);
+
+protected:
+    SchedulerNS::task_t        *_tasks      {nullptr};
+    uint8_t                     _size       {0};
+    SchedulerNS::timeBase_t     _timeBase   {SchedulerNS::MILLIS};
+    volatile uint32_t           _ticks      {0};
+
+    /**
+     *  \brief  Stores task in the first free entry of the table.
+     *
+     *  \return identifier of the task, SchedulerNS::invalidTask when the table is full.
+    **/
+    SchedulerNS::taskId_t add(const uint32_t delay, const uint32_t period, SchedulerNS::callback_t callback, void *arg);
+
+    /**
+     *  \brief  Finds registered task with the earliest deadline.
+     *
+     *  \return identifier of the task, SchedulerNS::invalidTask when there are no tasks.
+    **/
+    SchedulerNS::taskId_t earliest(void);
+
+    /**
+     *  \brief Signed distance from 'time' to 'deadline', valid across wrap-around of time.
+    **/
+    static int32_t remaining(const uint32_t deadline, const uint32_t time);
+};
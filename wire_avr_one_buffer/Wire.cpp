@@ -36,7 +36,7 @@ uint8_t* TwoWire::rxBuffer {nullptr};
 uint8_t TwoWire::rxBufferIndex = 0;
 uint8_t TwoWire::rxBufferLength = 0;
 
-uint8_t TwoWire::txAddress = 0;
+uint16_t TwoWire::txAddress = 0;
 uint8_t* TwoWire::txBuffer {nullptr};
 uint8_t TwoWire::txBufferIndex = 0;
 uint8_t TwoWire::txBufferLength = 0;
@@ -44,6 +44,8 @@ uint8_t TwoWire::txBufferLength = 0;
 uint8_t TwoWire::transmitting = 0;
 void (*TwoWire::user_onRequest)(void);
 void (*TwoWire::user_onReceive)(int);
+void (*TwoWire::user_onGeneralCall)(int);
+hal_mutex_t TwoWire::busMutex {};
 
 // Constructors ////////////////////////////////////////////////////////////////
 
@@ -61,6 +63,7 @@ void TwoWire::begin(void)
   txBufferIndex = 0;
   txBufferLength = 0;
 
+  hal_mutexInit(&busMutex);
   twi_init();
   twi_attachSlaveTxEvent(onRequestService); // default callback must exist
   twi_attachSlaveRxEvent(onReceiveService); // default callback must exist
@@ -156,6 +159,12 @@ uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint32_t iaddres
   endTransmission(false);
   }
 
+  return requestFromAddress(address, quantity, sendStop);
+}
+
+// address is the one passed to twi_readFrom(): 7-bit, or 10-bit with TWI_ADDRESS_10BIT
+uint8_t TwoWire::requestFromAddress(uint16_t address, uint8_t quantity, uint8_t sendStop)
+{
   // clamp to buffer length
   if(quantity > BUFFER_LENGTH){
     quantity = BUFFER_LENGTH;
@@ -169,6 +178,12 @@ uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint32_t iaddres
   return read;
 }
 
+// reads from device with 10-bit address (write of both address bytes, repeated start, read)
+uint8_t TwoWire::requestFrom10(uint16_t address, uint8_t quantity, uint8_t sendStop)
+{
+  return requestFromAddress((address & 0x03FF) | TWI_ADDRESS_10BIT, quantity, sendStop);
+}
+
 uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop) {
 	return requestFrom((uint8_t)address, (uint8_t)quantity, (uint32_t)0, (uint8_t)0, (uint8_t)sendStop);
 }
@@ -204,6 +219,13 @@ void TwoWire::beginTransmission(int address)
   beginTransmission((uint8_t)address);
 }
 
+// transmission to device with 10-bit address
+void TwoWire::beginTransmission10(uint16_t address)
+{
+  beginTransmission((uint8_t)0);
+  txAddress = (address & 0x03FF) | TWI_ADDRESS_10BIT;
+}
+
 //
 //	Originally, 'endTransmission' was an f(void) function.
 //	It has been modified to take one parameter indicating
@@ -305,6 +327,11 @@ int TwoWire::read(void)
     {
       value = rxBuffer[rxBufferIndex];
       ++rxBufferIndex;
+      // whole part of a slave message consumed: let the master continue
+      if(rxBufferIndex == rxBufferLength)
+      {
+        twi_releaseSlaveRx();
+      }
     }
   }
 
@@ -336,15 +363,30 @@ void TwoWire::flush(void)
 
 // behind the scenes function that is called when data is received
 void TwoWire::onReceiveService(uint8_t* inBytes, int numBytes)
+{
+  receiveService(inBytes, numBytes, user_onReceive);
+}
+
+// behind the scenes function that is called when data is received by general call
+void TwoWire::onGeneralCallService(uint8_t* inBytes, int numBytes)
+{
+  receiveService(inBytes, numBytes, user_onGeneralCall);
+}
+
+// loads received data into the read buffer and alerts the user handler
+void TwoWire::receiveService(uint8_t* inBytes, int numBytes, void (*handler)(int))
 {
   // don't bother if user hasn't registered a callback
-  if(!user_onReceive){
+  // (a held bus is released, the data is dropped)
+  if(!handler){
+    twi_releaseSlaveRx();
     return;
   }
   // don't bother if rx buffer is in use by a master requestFrom() op
   // i know this drops data, but it allows for slight stupidity
   // meaning, they may not have read all the master requestFrom() data yet
   if(rxBufferIndex < rxBufferLength){
+    twi_releaseSlaveRx();
     return;
   }
   // copy twi rx buffer into local read buffer
@@ -359,7 +401,7 @@ void TwoWire::onReceiveService(uint8_t* inBytes, int numBytes)
     rxBufferIndex = 0;
     rxBufferLength = numBytes;
     // alert user program
-    user_onReceive(numBytes);
+    handler(numBytes);
   }
 }
 
@@ -390,6 +432,46 @@ void TwoWire::onRequest( void (*function)(void) )
   user_onRequest = function;
 }
 
+// enables or disables answering the general call address (0x00) in slave mode
+void TwoWire::setGeneralCall(bool enable)
+{
+  twi_setGeneralCall(enable);
+}
+
+// with flow control a slave receiver with full buffer holds the bus: onReceive() gets
+// every full buffer and the master continues when all of it has been read()
+void TwoWire::setReceiveFlowControl(bool enable)
+{
+  twi_setSlaveRxFlowControl(enable);
+}
+
+// sets function called on general call write; without it general calls go to onReceive()
+void TwoWire::onGeneralCall( void (*function)(int) )
+{
+  user_onGeneralCall = function;
+  twi_attachSlaveGeneralCallEvent(function ? onGeneralCallService : nullptr);
+}
+
+// micros() latched in the TWI interrupt during the last requestFrom():
+// when the slave acked its address and when the first data byte arrived (0 if it did not happen)
+void TwoWire::getReadTimestamps(uint32_t &addressAckMicros, uint32_t &firstDataMicros)
+{
+  twi_getReadTimestamps(&addressAckMicros, &firstDataMicros);
+}
+
+// takes exclusive use of the bus for the calling task (recursive, does nothing without an RTOS)
+// tasks sharing the bus must wrap each transaction - from beginTransmission/requestFrom to stop
+void TwoWire::lock(void)
+{
+  hal_mutexLock(&busMutex);
+}
+
+// releases the bus taken by lock()
+void TwoWire::unlock(void)
+{
+  hal_mutexUnlock(&busMutex);
+}
+
 // Preinstantiate Objects //////////////////////////////////////////////////////
 
 TwoWire Wire = TwoWire();
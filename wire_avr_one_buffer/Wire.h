@@ -25,6 +25,7 @@
 
 #include <inttypes.h>
 #include "Stream.h"
+#include "hal_os.h"
 
 #define BUFFER_LENGTH 160
 
@@ -38,7 +39,7 @@ class TwoWire : public Stream
     static uint8_t rxBufferIndex;
     static uint8_t rxBufferLength;
 
-    static uint8_t txAddress;
+    static uint16_t txAddress;
     static uint8_t* txBuffer;
     static uint8_t txBufferIndex;
     static uint8_t txBufferLength;
@@ -46,8 +47,13 @@ class TwoWire : public Stream
     static uint8_t transmitting;
     static void (*user_onRequest)(void);
     static void (*user_onReceive)(int);
+    static void (*user_onGeneralCall)(int);
     static void onRequestService(void);
     static void onReceiveService(uint8_t*, int);
+    static void onGeneralCallService(uint8_t*, int);
+    static void receiveService(uint8_t*, int, void (*)(int));
+    static hal_mutex_t busMutex;
+    uint8_t requestFromAddress(uint16_t, uint8_t, uint8_t);
   public:
     TwoWire();
     void begin();
@@ -60,6 +66,7 @@ class TwoWire : public Stream
     void clearWireTimeoutFlag(void);
     void beginTransmission(uint8_t);
     void beginTransmission(int);
+    void beginTransmission10(uint16_t);
     uint8_t endTransmission(void);
     uint8_t endTransmission(uint8_t);
     uint8_t requestFrom(uint8_t, uint8_t);
@@ -67,6 +74,7 @@ class TwoWire : public Stream
     uint8_t requestFrom(uint8_t, uint8_t, uint32_t, uint8_t, uint8_t);
     uint8_t requestFrom(int, int);
     uint8_t requestFrom(int, int, int);
+    uint8_t requestFrom10(uint16_t, uint8_t, uint8_t);
     virtual size_t write(uint8_t);
     virtual size_t write(const uint8_t *, size_t);
     virtual int available(void);
@@ -75,6 +83,12 @@ class TwoWire : public Stream
     virtual void flush(void);
     void onReceive( void (*)(int) );
     void onRequest( void (*)(void) );
+    void setGeneralCall(bool);
+    void onGeneralCall( void (*)(int) );
+    void setReceiveFlowControl(bool);
+    void lock(void);
+    void unlock(void);
+    void getReadTimestamps(uint32_t&, uint32_t&);
 
     inline size_t write(unsigned long n) { return write((uint8_t)n); }
     inline size_t write(long n) { return write((uint8_t)n); }
@@ -25,25 +25,40 @@
 #include <inttypes.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
-#include <util/delay.h>
 #include <compat/twi.h>
-#include "Arduino.h" // for digitalWrite and micros
-
-#ifndef cbi
-#define cbi(sfr, bit) (_SFR_BYTE(sfr) &= ~_BV(bit))
-#endif
-
-#ifndef sbi
-#define sbi(sfr, bit) (_SFR_BYTE(sfr) |= _BV(bit))
-#endif
+#include "hal.h" // for pins, delays, micros and TWI registers
+#include "profiler.h" // compiles to nothing unless PROFILER_ENABLED is defined
+#include "hal_os.h" // lets waiting tasks sleep under an RTOS
 
 #include "pins_arduino.h"
 #include "twi.h"
 
+#ifndef TWI_BACKEND_MEGA0
+
 static volatile uint8_t twi_state;
 static volatile uint8_t twi_slarw;
+static volatile uint8_t twi_address10Low;		// second byte of 10-bit address
+static volatile uint8_t twi_address10Phase;		// progress of 10-bit address phase
+
+#define TWI_ADDR10_NONE     0	// 7-bit address, or 10-bit address phase done
+#define TWI_ADDR10_LOW      1	// first byte acked, second one to be sent
+#define TWI_ADDR10_LOW_SENT 2	// second byte sent, device is selected when it is acked
+#define TWI_ADDR10_PREFIX   0xF0	// first byte of 10-bit address: 11110 A9 A8 R/W
 static volatile uint8_t twi_sendStop;			// should the transaction end with a stop
 static volatile uint8_t twi_inRepStart;			// in the middle of a repeated start
+static volatile uint8_t twi_repStartAsync;		// the repeated start belongs to a background transaction
+static volatile uint8_t twi_async;			// transaction started by twi_startReadFrom()/twi_startWriteTo()
+static uint8_t twi_polledLength = TWI_POLLED_LENGTH;	// longest blocking transaction run without the ISR
+
+#define TWI_DEFER_MASTER_COMPLETE 0x01	// background transaction finished, master complete event to be called
+#define TWI_DEFER_SLAVE_RX        0x02	// slave received whole message, rx event to be called
+#define TWI_DEFER_SLAVE_RX_CHUNK  0x04	// slave rx buffer is full (flow control), rx event to be called
+#define TWI_DEFER_SLAVE_TX        0x08	// slave addressed for read, tx event to be called (SCL held)
+static volatile uint8_t twi_deferred;			// work left by the ISR to the bottom half (TWI_SPLIT_ISR)
+static volatile uint8_t twi_completeResult;		// master complete event arguments kept for the bottom half
+static volatile uint8_t twi_completeCount;
+static volatile uint8_t twi_txPrepared;		// tx event has filled the buffer, the replayed ISR sends it
+static volatile uint8_t twi_inBottomHalf;		// bottom half runs as soft interrupt
 
 // twi_timeout_us > 0 prevents the code from getting stuck in various while loops here
 // if twi_timeout_us == 0 then timeout checking is disabled (the previous Wire lib behavior)
@@ -57,6 +72,12 @@ static volatile bool twi_do_reset_on_timeout = false;  // reset the TWI register
 
 static void (*twi_onSlaveTransmit)(void);
 static void (*twi_onSlaveReceive)(uint8_t*, int);
+static void (*twi_onSlaveGeneralCall)(uint8_t*, int);
+static void (*twi_onMasterComplete)(uint8_t, uint8_t);
+static volatile uint8_t twi_generalCall;		// slave receiver was addressed by general call
+static volatile uint8_t twi_rxFlowControl;	// hold SCL instead of nacking when rx buffer is full
+static volatile uint8_t twi_rxHeld;		// SCL is held low until twi_releaseSlaveRx()
+static volatile uint8_t twi_rxChunked;		// part of the current message was already delivered
 
 static uint8_t twi_masterBuffer[TWI_BUFFER_LENGTH];
 static volatile uint8_t twi_masterBufferIndex;
@@ -71,6 +92,13 @@ static volatile uint8_t twi_rxBufferIndex;
 
 static volatile uint8_t twi_error;
 
+#ifndef TWI_NO_TIMESTAMPS
+static volatile uint32_t twi_addressAckMicros;	// SLA+R acknowledged by the slave
+static volatile uint32_t twi_firstDataMicros;	// first data byte of the read received
+#endif
+
+static hal_event_t twi_event; // signalled by the ISR whenever twi becomes ready
+
 /* 
  * Function twi_init
  * Desc     readys twi pins and sets twi bitrate
@@ -83,15 +111,21 @@ void twi_init(void)
   twi_state = TWI_READY;
   twi_sendStop = true;		// default value
   twi_inRepStart = false;
+  twi_repStartAsync = false;
+  twi_async = false;
+  twi_rxHeld = false;
+  twi_rxChunked = false;
+  twi_deferred = 0;
+  twi_txPrepared = false;
+  hal_eventInit(&twi_event);
   
   // activate internal pullups for twi.
-  digitalWrite(SDA, 1);
-  digitalWrite(SCL, 1);
+  hal_digitalWrite(SDA, 1);
+  hal_digitalWrite(SCL, 1);
 
   // initialize twi prescaler and bit rate
-  cbi(TWSR, TWPS0);
-  cbi(TWSR, TWPS1);
-  TWBR = ((F_CPU / TWI_FREQ) - 16) / 2;
+  hal_twiWrite(HAL_TWSR, hal_twiRead(HAL_TWSR) & ~(_BV(TWPS0) | _BV(TWPS1)));
+  hal_twiWrite(HAL_TWBR, ((F_CPU / TWI_FREQ) - 16) / 2);
 
   /* twi bit rate formula from atmega128 manual pg 204
   SCL Frequency = CPU Clock Frequency / (16 + (2 * TWBR))
@@ -99,7 +133,7 @@ void twi_init(void)
   It is 72 for a 16mhz Wiring board with 100kHz TWI */
 
   // enable twi module, acks, and twi interrupt
-  TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA);
+  hal_twiWrite(HAL_TWCR, _BV(TWEN) | _BV(TWIE) | _BV(TWEA));
 }
 
 /* 
@@ -111,11 +145,11 @@ void twi_init(void)
 void twi_disable(void)
 {
   // disable twi module, acks, and twi interrupt
-  TWCR &= ~(_BV(TWEN) | _BV(TWIE) | _BV(TWEA));
+  hal_twiWrite(HAL_TWCR, hal_twiRead(HAL_TWCR) & ~(_BV(TWEN) | _BV(TWIE) | _BV(TWEA)));
 
   // deactivate internal pullups for twi.
-  digitalWrite(SDA, 0);
-  digitalWrite(SCL, 0);
+  hal_digitalWrite(SDA, 0);
+  hal_digitalWrite(SCL, 0);
 }
 
 /* 
@@ -126,8 +160,56 @@ void twi_disable(void)
  */
 void twi_setAddress(uint8_t address)
 {
-  // set twi slave address (skip over TWGCE bit)
-  TWAR = address << 1;
+  // set twi slave address (skip over TWGCE bit, keeping its setting)
+  hal_twiWrite(HAL_TWAR, (address << 1) | (hal_twiRead(HAL_TWAR) & _BV(TWGCE)));
+}
+
+/* 
+ * Function twi_setGeneralCall
+ * Desc     enables or disables recognition of general call address (0x00) in slave mode
+ * Input    enable: true to answer general calls
+ * Output   none
+ */
+void twi_setGeneralCall(uint8_t enable)
+{
+  if(enable){
+    hal_twiWrite(HAL_TWAR, hal_twiRead(HAL_TWAR) | _BV(TWGCE));
+  }else{
+    hal_twiWrite(HAL_TWAR, hal_twiRead(HAL_TWAR) & ~_BV(TWGCE));
+  }
+}
+
+/* 
+ * Function twi_setSlaveRxFlowControl
+ * Desc     selects what slave receiver does when its buffer is full: without flow control
+ *          further bytes are nacked and lost; with flow control the full buffer is delivered
+ *          to the rx event and SCL is held low (TWINT is not cleared) until the consumer
+ *          calls twi_releaseSlaveRx(), so the master continues at the consumer's pace
+ * Input    enable: true to hold the bus instead of nacking
+ * Output   none
+ */
+void twi_setSlaveRxFlowControl(uint8_t enable)
+{
+  twi_rxFlowControl = enable;
+}
+
+/* 
+ * Function twi_releaseSlaveRx
+ * Desc     lets the master continue after the delivered part of the message was consumed;
+ *          does nothing when the bus is not held
+ * Input    none
+ * Output   none
+ */
+void twi_releaseSlaveRx(void)
+{
+#ifndef TWI_MASTER_ONLY
+  if(twi_rxHeld){
+    twi_rxHeld = false;
+    twi_rxBufferIndex = 0;
+    // clear TWINT and enable interrupt again: SCL is released
+    twi_reply(1);
+  }
+#endif
 }
 
 /* 
@@ -138,7 +220,7 @@ void twi_setAddress(uint8_t address)
  */
 void twi_setFrequency(uint32_t frequency)
 {
-  TWBR = ((F_CPU / frequency) - 16) / 2;
+  hal_twiWrite(HAL_TWBR, ((F_CPU / frequency) - 16) / 2);
   
   /* twi bit rate formula from atmega128 manual pg 204
   SCL Frequency = CPU Clock Frequency / (16 + (2 * TWBR))
@@ -147,48 +229,111 @@ void twi_setFrequency(uint32_t frequency)
 }
 
 /* 
- * Function twi_readFrom
- * Desc     attempts to become twi bus master and read a
- *          series of bytes from a device on the bus
- * Input    address: 7bit i2c device address
- *          data: pointer to byte array
- *          length: number of bytes to read into array
- *          sendStop: Boolean indicating whether to send a stop at the end
- * Output   number of bytes read
+ * Function twi_setPolledLength
+ * Desc     sets the longest blocking transaction run by polling TWINT instead of the ISR
+ * Input    length: number of data bytes (0 disables polling)
+ * Output   none
  */
-uint8_t twi_readFrom(uint8_t address, uint8_t* data, uint8_t length, uint8_t sendStop)
+void twi_setPolledLength(uint8_t length)
 {
-  // ensure data will fit into buffer
-  if(TWI_BUFFER_LENGTH < length){
-    return 0;
+  twi_polledLength = length;
+}
+
+/* 
+ * Function twi_buildAddress
+ * Desc     prepares address phase of master transaction; 10-bit address is sent
+ *          as two bytes with write direction, a read turns around with repeated start
+ * Input    address: 7bit i2c device address, or 10bit one or-ed with TWI_ADDRESS_10BIT
+ *          direction: TW_READ or TW_WRITE
+ * Output   none
+ */
+static void twi_buildAddress(uint16_t address, uint8_t direction)
+{
+  if(address & TWI_ADDRESS_10BIT){
+    twi_slarw = TWI_ADDR10_PREFIX | ((address >> 7) & 0x06) | TW_WRITE;
+    twi_address10Low = (uint8_t)address;
+    twi_address10Phase = TWI_ADDR10_LOW;
+  }else{
+    // build sla+r/w, slave device address + r/w bit
+    twi_slarw = direction;
+    twi_slarw |= (uint8_t)(address << 1);
+    twi_address10Phase = TWI_ADDR10_NONE;
   }
+}
 
-  // wait until twi is ready, become master receiver
-  uint32_t startMicros = micros();
-  while(TWI_READY != twi_state){
-    if((twi_timeout_us > 0ul) && ((micros() - startMicros) > twi_timeout_us)) {
+/* 
+ * Function twi_claim
+ * Desc     atomically takes ready twi for a master transaction; a repeated start is
+ *          taken only by the side (foreground or background) which has left it, so
+ *          neither one gets between the register write and the read of the other
+ * Input    state: TWI_MRX or TWI_MTX
+ *          async: true for transaction started by twi_startReadFrom()/twi_startWriteTo()
+ * Output   true if taken, false when twi is busy
+ */
+static bool twi_claim(uint8_t state, uint8_t async)
+{
+  bool claimed;
+  uint8_t irq = hal_irqSave();
+
+  // the buffer still holds the result of a background transaction until its bottom half has run
+  claimed = (TWI_READY == twi_state) && !(twi_deferred & TWI_DEFER_MASTER_COMPLETE) &&
+            (!twi_inRepStart || (async ? twi_repStartAsync : !twi_repStartAsync));
+  if(claimed){
+    twi_state = state;
+    twi_async = async;
+    // reset error state (0xFF.. no error occurred)
+    twi_error = 0xFF;
+  }
+  hal_irqRestore(irq);
+
+  return claimed;
+}
+
+/* 
+ * Function twi_waitStopSent
+ * Desc     waits until the stop condition left by the ISR has been sent; with TWI_SPLIT_ISR
+ *          the ISR does not wait for it, so the next start does
+ * Input    none
+ * Output   false on timeout
+ */
+static bool twi_waitStopSent(void)
+{
+#ifdef TWI_SPLIT_ISR
+  uint32_t startMicros = hal_micros();
+  PROFILE_BEGIN(PROFILER_ZONE_TWI_WAIT_STOP);
+  while(hal_twiRead(HAL_TWCR) & _BV(TWSTO)){
+    hal_spin();
+    if((twi_timeout_us > 0ul) && ((hal_micros() - startMicros) > twi_timeout_us)) {
       twi_handleTimeout(twi_do_reset_on_timeout);
-      return 0;
+      return false;
     }
   }
-  twi_state = TWI_MRX;
-  twi_sendStop = sendStop;
-  // reset error state (0xFF.. no error occurred)
-  twi_error = 0xFF;
-
-  // initialize buffer iteration vars
-  twi_masterBufferIndex = 0;
-  twi_masterBufferLength = length-1;  // This is not intuitive, read on...
-  // On receive, the previously configured ACK/NACK setting is transmitted in
-  // response to the received byte before the interrupt is signalled. 
-  // Therefore we must actually set NACK when the _next_ to last byte is
-  // received, causing that NACK to be sent in response to receiving the last
-  // expected byte of data.
+  PROFILE_END(PROFILER_ZONE_TWI_WAIT_STOP);
+#endif
+  return true;
+}
 
-  // build sla+w, slave device address + w bit
-  twi_slarw = TW_READ;
-  twi_slarw |= address << 1;
+/* 
+ * Function twi_abandonClaim
+ * Desc     gives up the claim of twi_claim() when the transaction could not be started,
+ *          after the timeout has been handled, so the next transaction can claim twi
+ * Input    none
+ * Output   none
+ */
+static void twi_abandonClaim(void)
+{
+  twi_state = TWI_READY;
+  hal_eventSignal(&twi_event);
+}
 
+/* 
+ * Function twi_startTransaction
+ * Desc     sends start, or the address when a repeated start has already been sent
+ * Input    none
+ * Output   false on timeout
+ */
+static bool twi_startTransaction(void)
+{
   if (true == twi_inRepStart) {
     // if we're in the repeated start state, then we've already sent the start,
     // (@@@ we hope), and the TWI statemachine is just waiting for the address byte.
@@ -197,28 +342,308 @@ uint8_t twi_readFrom(uint8_t address, uint8_t* data, uint8_t length, uint8_t sen
     // up. Also, don't enable the START interrupt. There may be one pending from the 
     // repeated start that we sent ourselves, and that would really confuse things.
     twi_inRepStart = false;			// remember, we're dealing with an ASYNC ISR
-    startMicros = micros();
+    twi_repStartAsync = false;
+    uint32_t startMicros = hal_micros();
     do {
-      TWDR = twi_slarw;
-      if((twi_timeout_us > 0ul) && ((micros() - startMicros) > twi_timeout_us)) {
+      hal_spin();
+      hal_twiWrite(HAL_TWDR, twi_slarw);
+      if((twi_timeout_us > 0ul) && ((hal_micros() - startMicros) > twi_timeout_us)) {
         twi_handleTimeout(twi_do_reset_on_timeout);
-        return 0;
+        twi_abandonClaim();
+        return false;
       }
-    } while(TWCR & _BV(TWWC));
-    TWCR = _BV(TWINT) | _BV(TWEA) | _BV(TWEN) | _BV(TWIE);	// enable INTs, but not START
+    } while(hal_twiRead(HAL_TWCR) & _BV(TWWC));
+    hal_twiWrite(HAL_TWCR, _BV(TWINT) | _BV(TWEA) | _BV(TWEN) | _BV(TWIE));	// enable INTs, but not START
   } else {
+    if(!twi_waitStopSent()){
+      twi_abandonClaim();
+      return false;
+    }
     // send start condition
-    TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA) | _BV(TWINT) | _BV(TWSTA);
+    hal_twiWrite(HAL_TWCR, _BV(TWEN) | _BV(TWIE) | _BV(TWEA) | _BV(TWINT) | _BV(TWSTA));
+  }
+
+  return true;
+}
+
+/* 
+ * Function twi_beginRead
+ * Desc     starts read of twi taken by twi_claim()
+ * Input    address: 7bit i2c device address, or 10bit one or-ed with TWI_ADDRESS_10BIT
+ *          length: number of bytes to read
+ *          sendStop: Boolean indicating whether to send a stop at the end
+ * Output   false on timeout
+ */
+static bool twi_beginRead(uint16_t address, uint8_t length, uint8_t sendStop)
+{
+  twi_sendStop = sendStop;
+#ifndef TWI_NO_TIMESTAMPS
+  // no stamps unless the slave answers
+  twi_addressAckMicros = 0;
+  twi_firstDataMicros = 0;
+#endif
+
+  // initialize buffer iteration vars
+  twi_masterBufferIndex = 0;
+  twi_masterBufferLength = length-1;  // This is not intuitive, read on...
+  // On receive, the previously configured ACK/NACK setting is transmitted in
+  // response to the received byte before the interrupt is signalled. 
+  // Therefore we must actually set NACK when the _next_ to last byte is
+  // received, causing that NACK to be sent in response to receiving the last
+  // expected byte of data.
+
+  twi_buildAddress(address, TW_READ);
+
+  return twi_startTransaction();
+}
+
+/* 
+ * Function twi_beginWrite
+ * Desc     starts write of twi taken by twi_claim()
+ * Input    address: 7bit i2c device address, or 10bit one or-ed with TWI_ADDRESS_10BIT
+ *          data: pointer to byte array
+ *          length: number of bytes in array
+ *          sendStop: boolean indicating whether or not to send a stop at the end
+ * Output   false on timeout
+ */
+static bool twi_beginWrite(uint16_t address, const uint8_t* data, uint8_t length, uint8_t sendStop)
+{
+  twi_sendStop = sendStop;
+
+  // initialize buffer iteration vars
+  twi_masterBufferIndex = 0;
+  twi_masterBufferLength = length;
+  
+  // copy data to twi buffer
+  if (twi_masterBuffer != data)
+  {
+    for(uint8_t i = 0; i < length; ++i)
+    {
+      twi_masterBuffer[i] = data[i];
+    }
+  }
+
+  twi_buildAddress(address, TW_WRITE);
+
+  return twi_startTransaction();
+}
+
+/* 
+ * Function twi_result
+ * Desc     translates error state of finished master transaction
+ * Input    none
+ * Output   0 .. success
+ *          2 .. address send, NACK received
+ *          3 .. data send, NACK received
+ *          4 .. other twi error (lost bus arbitration, bus error, ..)
+ */
+static uint8_t twi_result(void)
+{
+  if (twi_error == 0xFF)
+    return 0;	// success
+  else if ((twi_error == TW_MT_SLA_NACK) || (twi_error == TW_MR_SLA_NACK))
+    return 2;	// error: address send, nack received
+  else if (twi_error == TW_MT_DATA_NACK)
+    return 3;	// error: data send, nack received
+  else
+    return 4;	// other twi error
+}
+
+/* 
+ * Function twi_waitPolled
+ * Desc     spins until TWINT is set
+ * Input    startMicros: hal_micros() at the start of the transaction
+ * Output   twi status, TW_NO_INFO on timeout
+ */
+static uint8_t twi_waitPolled(uint32_t startMicros)
+{
+  while(!(hal_twiRead(HAL_TWCR) & _BV(TWINT))){
+    hal_spin();
+    if((twi_timeout_us > 0ul) && ((hal_micros() - startMicros) > twi_timeout_us)) {
+      return TW_NO_INFO;
+    }
+  }
+  return hal_twiRead(HAL_TWSR) & TW_STATUS_MASK;
+}
+
+/* 
+ * Function twi_transferPolled
+ * Desc     runs whole master transaction of twi taken by twi_claim() by polling TWINT,
+ *          with the twi interrupt disabled; short transactions skip the cost of
+ *          entering the ISR and of its state machine for every bus event.
+ *          The ISR takes over again when the bus is released
+ * Input    address: 7bit i2c device address
+ *          data: pointer to byte array, read into when twi_state is TWI_MRX
+ *          length: number of bytes to transfer (1 .. twi_polledLength)
+ *          sendStop: boolean indicating whether or not to send a stop at the end
+ * Output   number of bytes transferred; error is left in twi_error, 0xFE on timeout
+ */
+static uint8_t twi_transferPolled(uint16_t address, uint8_t* data, uint8_t length, uint8_t sendStop)
+{
+  const uint8_t read = (TWI_MRX == twi_state);
+  const uint8_t expected = read ? TW_MR_SLA_ACK : TW_MT_SLA_ACK;
+  uint32_t startMicros = (twi_timeout_us > 0ul) ? hal_micros() : 0ul;
+  uint8_t status;
+  uint8_t index = 0;
+
+#ifndef TWI_NO_TIMESTAMPS
+  twi_addressAckMicros = 0;
+  twi_firstDataMicros = 0;
+#endif
+
+  if(twi_inRepStart){
+    // start has been sent by the previous transaction, TWINT reports it
+    twi_inRepStart = false;
+    twi_repStartAsync = false;
+  }else if(!twi_waitStopSent()){
+    // the timeout has been handled while waiting, nothing has been sent
+    twi_error = 0xFE;
+    twi_masterBufferIndex = 0;
+    twi_abandonClaim();
+    return 0;
+  }else{
+    hal_twiWrite(HAL_TWCR, _BV(TWEN) | _BV(TWEA) | _BV(TWINT) | _BV(TWSTA));
+  }
+  status = twi_waitPolled(startMicros);
+  if((TW_START == status) || (TW_REP_START == status)){
+    hal_twiWrite(HAL_TWDR, (uint8_t)(address << 1) | (read ? TW_READ : TW_WRITE));
+    hal_twiWrite(HAL_TWCR, _BV(TWEN) | _BV(TWEA) | _BV(TWINT));
+    status = twi_waitPolled(startMicros);
+  }
+  if(expected == status){
+#ifndef TWI_NO_TIMESTAMPS
+    if(read){
+      twi_addressAckMicros = hal_micros();
+    }
+#endif
+    while((index < length) && (TW_NO_INFO != status)){
+      if(read){
+        // ack all bytes but the last one
+        hal_twiWrite(HAL_TWCR, (index < (uint8_t)(length - 1)) ? (_BV(TWEN) | _BV(TWEA) | _BV(TWINT)) : (_BV(TWEN) | _BV(TWINT)));
+        status = twi_waitPolled(startMicros);
+        if((TW_MR_DATA_ACK != status) && (TW_MR_DATA_NACK != status)){
+          break;
+        }
+#ifndef TWI_NO_TIMESTAMPS
+        if(0 == index){
+          twi_firstDataMicros = hal_micros();
+        }
+#endif
+        data[index++] = hal_twiRead(HAL_TWDR);
+      }else{
+        hal_twiWrite(HAL_TWDR, data[index]);
+        hal_twiWrite(HAL_TWCR, _BV(TWEN) | _BV(TWEA) | _BV(TWINT));
+        status = twi_waitPolled(startMicros);
+        if(TW_MT_DATA_ACK != status){
+          break;
+        }
+        index++;
+      }
+    }
+  }
+
+  if(TW_NO_INFO == status){
+    twi_error = 0xFE;
+    twi_handleTimeout(twi_do_reset_on_timeout);
+    if(!twi_do_reset_on_timeout){
+      // the interrupt is back on, so a late event is handled by the ISR
+      twi_releaseBus();
+    }
+  }else if((TW_MT_ARB_LOST == status) || (TW_SR_ARB_LOST_SLA_ACK == status) ||
+           (TW_SR_ARB_LOST_GCALL_ACK == status) || (TW_ST_ARB_LOST_SLA_ACK == status)){
+    // lost arbitration, maybe addressed as slave: the ISR takes the pending event
+    twi_error = TW_MT_ARB_LOST;
+    twi_state = TWI_READY;
+    hal_twiWrite(HAL_TWCR, _BV(TWEN) | _BV(TWIE) | _BV(TWEA));
+  }else if((index < length) || sendStop){
+    if(index < length){
+      twi_error = ((TW_MR_SLA_NACK == status) || (TW_MT_SLA_NACK == status)) ? TW_MT_SLA_NACK : status;
+    }
+    twi_stop();
+  }else{
+    // same as the ISR: the interrupt stays off until the next transaction sends the address
+    twi_inRepStart = true;
+    hal_twiWrite(HAL_TWCR, _BV(TWINT) | _BV(TWSTA) | _BV(TWEN));
+    twi_state = TWI_READY;
+  }
+  twi_masterBufferIndex = index;
+
+  // wake tasks waiting for twi
+  hal_eventSignal(&twi_event);
+
+  return index;
+}
+
+/* 
+ * Function twi_isPolled
+ * Desc     selects the polled fast path for blocking transaction
+ * Input    address: 7bit i2c device address, or 10bit one or-ed with TWI_ADDRESS_10BIT
+ *          length: number of data bytes
+ * Output   true when the transaction is to be run by twi_transferPolled()
+ */
+static inline bool twi_isPolled(uint16_t address, uint8_t length)
+{
+#if 0 < TWI_POLLED_LENGTH
+  return (0 < length) && (length <= twi_polledLength) && !(address & TWI_ADDRESS_10BIT);
+#else
+  // polled path is compiled out
+  (void)address;
+  (void)length;
+  return false;
+#endif
+}
+
+/* 
+ * Function twi_readFrom
+ * Desc     attempts to become twi bus master and read a
+ *          series of bytes from a device on the bus
+ * Input    address: 7bit i2c device address, or 10bit one or-ed with TWI_ADDRESS_10BIT
+ *          data: pointer to byte array
+ *          length: number of bytes to read into array
+ *          sendStop: Boolean indicating whether to send a stop at the end
+ * Output   number of bytes read
+ */
+uint8_t twi_readFrom(uint16_t address, uint8_t* data, uint8_t length, uint8_t sendStop)
+{
+  // ensure data will fit into buffer
+  if(TWI_BUFFER_LENGTH < length){
+    return 0;
+  }
+
+  // wait until twi is ready, become master receiver
+  uint32_t startMicros = hal_micros();
+  PROFILE_BEGIN(PROFILER_ZONE_TWI_WAIT_READY);
+  while(!twi_claim(TWI_MRX, false)){
+    hal_eventWait(&twi_event, twi_timeout_us);
+    if((twi_timeout_us > 0ul) && ((hal_micros() - startMicros) > twi_timeout_us)) {
+      twi_handleTimeout(twi_do_reset_on_timeout);
+      return 0;
+    }
+  }
+  PROFILE_END(PROFILER_ZONE_TWI_WAIT_READY);
+
+  if(twi_isPolled(address, length)){
+    PROFILE_BEGIN(PROFILER_ZONE_TWI_WAIT_READ);
+    length = twi_transferPolled(address, data, length, sendStop);
+    PROFILE_END(PROFILER_ZONE_TWI_WAIT_READ);
+    return (0xFE == twi_error) ? 0 : length;
+  }
+
+  if(!twi_beginRead(address, length, sendStop)){
+    return 0;
   }
 
   // wait for read operation to complete
-  startMicros = micros();
+  startMicros = hal_micros();
+  PROFILE_BEGIN(PROFILER_ZONE_TWI_WAIT_READ);
   while(TWI_MRX == twi_state){
-    if((twi_timeout_us > 0ul) && ((micros() - startMicros) > twi_timeout_us)) {
+    hal_eventWait(&twi_event, twi_timeout_us);
+    if((twi_timeout_us > 0ul) && ((hal_micros() - startMicros) > twi_timeout_us)) {
       twi_handleTimeout(twi_do_reset_on_timeout);
       return 0;
     }
   }
+  PROFILE_END(PROFILER_ZONE_TWI_WAIT_READ);
 
   if (twi_masterBufferIndex < length) {
     length = twi_masterBufferIndex;
@@ -241,7 +666,7 @@ uint8_t twi_readFrom(uint8_t address, uint8_t* data, uint8_t length, uint8_t sen
  * Function twi_writeTo
  * Desc     attempts to become twi bus master and write a
  *          series of bytes to a device on the bus
- * Input    address: 7bit i2c device address
+ * Input    address: 7bit i2c device address, or 10bit one or-ed with TWI_ADDRESS_10BIT
  *          data: pointer to byte array
  *          length: number of bytes in array
  *          wait: boolean indicating to wait for write or not
@@ -253,7 +678,7 @@ uint8_t twi_readFrom(uint8_t address, uint8_t* data, uint8_t length, uint8_t sen
  *          4 .. other twi error (lost bus arbitration, bus error, ..)
  *          5 .. timeout
  */
-uint8_t twi_writeTo(uint8_t address, uint8_t* data, uint8_t length, uint8_t wait, uint8_t sendStop)
+uint8_t twi_writeTo(uint16_t address, uint8_t* data, uint8_t length, uint8_t wait, uint8_t sendStop)
 {
   // ensure data will fit into buffer
   if(TWI_BUFFER_LENGTH < length){
@@ -261,77 +686,105 @@ uint8_t twi_writeTo(uint8_t address, uint8_t* data, uint8_t length, uint8_t wait
   }
 
   // wait until twi is ready, become master transmitter
-  uint32_t startMicros = micros();
-  while(TWI_READY != twi_state){
-    if((twi_timeout_us > 0ul) && ((micros() - startMicros) > twi_timeout_us)) {
+  uint32_t startMicros = hal_micros();
+  PROFILE_BEGIN(PROFILER_ZONE_TWI_WAIT_READY);
+  while(!twi_claim(TWI_MTX, false)){
+    hal_eventWait(&twi_event, twi_timeout_us);
+    if((twi_timeout_us > 0ul) && ((hal_micros() - startMicros) > twi_timeout_us)) {
       twi_handleTimeout(twi_do_reset_on_timeout);
       return (5);
     }
   }
-  twi_state = TWI_MTX;
-  twi_sendStop = sendStop;
-  // reset error state (0xFF.. no error occurred)
-  twi_error = 0xFF;
+  PROFILE_END(PROFILER_ZONE_TWI_WAIT_READY);
 
-  // initialize buffer iteration vars
-  twi_masterBufferIndex = 0;
-  twi_masterBufferLength = length;
-  
-  // copy data to twi buffer
-  if (twi_masterBuffer != data)
-  {
-    for(uint8_t i = 0; i < length; ++i)
-    {
-      twi_masterBuffer[i] = data[i];
-    }
+  if(wait && twi_isPolled(address, length)){
+    PROFILE_BEGIN(PROFILER_ZONE_TWI_WAIT_WRITE);
+    twi_transferPolled(address, data, length, sendStop);
+    PROFILE_END(PROFILER_ZONE_TWI_WAIT_WRITE);
+    return (0xFE == twi_error) ? 5 : twi_result();
   }
 
-  // build sla+w, slave device address + w bit
-  twi_slarw = TW_WRITE;
-  twi_slarw |= address << 1;
-  
-  // if we're in a repeated start, then we've already sent the START
-  // in the ISR. Don't do it again.
-  //
-  if (true == twi_inRepStart) {
-    // if we're in the repeated start state, then we've already sent the start,
-    // (@@@ we hope), and the TWI statemachine is just waiting for the address byte.
-    // We need to remove ourselves from the repeated start state before we enable interrupts,
-    // since the ISR is ASYNC, and we could get confused if we hit the ISR before cleaning
-    // up. Also, don't enable the START interrupt. There may be one pending from the 
-    // repeated start that we sent ourselves, and that would really confuse things.
-    twi_inRepStart = false;			// remember, we're dealing with an ASYNC ISR
-    startMicros = micros();
-    do {
-      TWDR = twi_slarw;
-      if((twi_timeout_us > 0ul) && ((micros() - startMicros) > twi_timeout_us)) {
-        twi_handleTimeout(twi_do_reset_on_timeout);
-        return (5);
-      }
-    } while(TWCR & _BV(TWWC));
-    TWCR = _BV(TWINT) | _BV(TWEA) | _BV(TWEN) | _BV(TWIE);	// enable INTs, but not START
-  } else {
-    // send start condition
-    TWCR = _BV(TWINT) | _BV(TWEA) | _BV(TWEN) | _BV(TWIE) | _BV(TWSTA);	// enable INTs
+  if(!twi_beginWrite(address, data, length, sendStop)){
+    return (5);
   }
 
   // wait for write operation to complete
-  startMicros = micros();
+  startMicros = hal_micros();
+  PROFILE_BEGIN(PROFILER_ZONE_TWI_WAIT_WRITE);
   while(wait && (TWI_MTX == twi_state)){
-    if((twi_timeout_us > 0ul) && ((micros() - startMicros) > twi_timeout_us)) {
+    hal_eventWait(&twi_event, twi_timeout_us);
+    if((twi_timeout_us > 0ul) && ((hal_micros() - startMicros) > twi_timeout_us)) {
       twi_handleTimeout(twi_do_reset_on_timeout);
       return (5);
     }
   }
+  PROFILE_END(PROFILER_ZONE_TWI_WAIT_WRITE);
   
-  if (twi_error == 0xFF)
-    return 0;	// success
-  else if (twi_error == TW_MT_SLA_NACK)
-    return 2;	// error: address send, nack received
-  else if (twi_error == TW_MT_DATA_NACK)
-    return 3;	// error: data send, nack received
-  else
-    return 4;	// other twi error
+  return twi_result();
+}
+
+/* 
+ * Function twi_startReadFrom
+ * Desc     starts read in background and returns at once; may be called from interrupts,
+ *          including the master complete event. Read data is in twi_getBufferHandle()
+ *          when the master complete event reports the transaction
+ * Input    address: 7bit i2c device address, or 10bit one or-ed with TWI_ADDRESS_10BIT
+ *          length: number of bytes to read
+ *          sendStop: Boolean indicating whether to send a stop at the end
+ * Output   0 .. started
+ *          1 .. length to long for buffer
+ *          4 .. twi is busy, try again later
+ *          5 .. timeout
+ */
+uint8_t twi_startReadFrom(uint16_t address, uint8_t length, uint8_t sendStop)
+{
+  if((0 == length) || (TWI_BUFFER_LENGTH < length)){
+    return 1;
+  }
+  if(!twi_claim(TWI_MRX, true)){
+    return 4;
+  }
+
+  return twi_beginRead(address, length, sendStop) ? 0 : 5;
+}
+
+/* 
+ * Function twi_startWriteTo
+ * Desc     starts write in background and returns at once; may be called from interrupts,
+ *          including the master complete event. Passing twi_getBufferHandle() as data
+ *          avoids copying
+ * Input    address: 7bit i2c device address, or 10bit one or-ed with TWI_ADDRESS_10BIT
+ *          data: pointer to byte array
+ *          length: number of bytes in array
+ *          sendStop: boolean indicating whether or not to send a stop at the end
+ * Output   0 .. started
+ *          1 .. length to long for buffer
+ *          4 .. twi is busy, try again later
+ *          5 .. timeout
+ */
+uint8_t twi_startWriteTo(uint16_t address, const uint8_t* data, uint8_t length, uint8_t sendStop)
+{
+  if(TWI_BUFFER_LENGTH < length){
+    return 1;
+  }
+  if(!twi_claim(TWI_MTX, true)){
+    return 4;
+  }
+
+  return twi_beginWrite(address, data, length, sendStop) ? 0 : 5;
+}
+
+/* 
+ * Function twi_attachMasterCompleteEvent
+ * Desc     sets function called from the ISR when a transaction started by
+ *          twi_startReadFrom()/twi_startWriteTo() has finished
+ * Input    function: callback function to use; it gets result (as twi_writeTo(),
+ *          without 1 and 5) and number of bytes transferred
+ * Output   none
+ */
+void twi_attachMasterCompleteEvent( void (*function)(uint8_t, uint8_t) )
+{
+  twi_onMasterComplete = function;
 }
 
 /* 
@@ -346,6 +799,12 @@ uint8_t twi_writeTo(uint8_t address, uint8_t* data, uint8_t length, uint8_t wait
  */
 uint8_t twi_transmit(const uint8_t* data, uint8_t length)
 {
+#ifdef TWI_MASTER_ONLY
+  // slave transmitter is not available
+  (void)data;
+  (void)length;
+  return 2;
+#else
   // ensure data will fit into buffer
   if(TWI_BUFFER_LENGTH < (twi_txBufferLength+length)){
     return 1;
@@ -363,6 +822,7 @@ uint8_t twi_transmit(const uint8_t* data, uint8_t length)
   twi_txBufferLength += length;
   
   return 0;
+#endif
 }
 
 /* 
@@ -376,6 +836,18 @@ void twi_attachSlaveRxEvent( void (*function)(uint8_t*, int) )
   twi_onSlaveReceive = function;
 }
 
+/* 
+ * Function twi_attachSlaveGeneralCallEvent
+ * Desc     sets function called after data was received by general call;
+ *          without it general call data goes to the slave rx event
+ * Input    function: callback function to use, or NULL
+ * Output   none
+ */
+void twi_attachSlaveGeneralCallEvent( void (*function)(uint8_t*, int) )
+{
+  twi_onSlaveGeneralCall = function;
+}
+
 /* 
  * Function twi_attachSlaveTxEvent
  * Desc     sets function called before a slave write operation
@@ -397,9 +869,9 @@ void twi_reply(uint8_t ack)
 {
   // transmit master read ready signal, with or without ack
   if(ack){
-    TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWINT) | _BV(TWEA);
+    hal_twiWrite(HAL_TWCR, _BV(TWEN) | _BV(TWIE) | _BV(TWINT) | _BV(TWEA));
   }else{
-    TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWINT);
+    hal_twiWrite(HAL_TWCR, _BV(TWEN) | _BV(TWIE) | _BV(TWINT));
   }
 }
 
@@ -412,17 +884,19 @@ void twi_reply(uint8_t ack)
 void twi_stop(void)
 {
   // send stop condition
-  TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA) | _BV(TWINT) | _BV(TWSTO);
+  hal_twiWrite(HAL_TWCR, _BV(TWEN) | _BV(TWIE) | _BV(TWEA) | _BV(TWINT) | _BV(TWSTO));
 
   // wait for stop condition to be executed on bus
   // TWINT is not set after a stop condition!
-  // We cannot use micros() from an ISR, so approximate the timeout with cycle-counted delays
+  // We cannot use hal_micros() from an ISR, so approximate the timeout with cycle-counted delays
   const uint8_t us_per_loop = 8;
   uint32_t counter = (twi_timeout_us + us_per_loop - 1)/us_per_loop; // Round up
-  while(TWCR & _BV(TWSTO)){
+  PROFILE_BEGIN(PROFILER_ZONE_TWI_WAIT_STOP);
+  while(hal_twiRead(HAL_TWCR) & _BV(TWSTO)){
+    hal_spin();
     if(twi_timeout_us > 0ul){
       if (counter > 0ul){
-        _delay_us(us_per_loop);
+        hal_delayMicroseconds(us_per_loop);
         counter--;
       } else {
         twi_handleTimeout(twi_do_reset_on_timeout);
@@ -430,6 +904,7 @@ void twi_stop(void)
       }
     }
   }
+  PROFILE_END(PROFILER_ZONE_TWI_WAIT_STOP);
 
   // update twi state
   twi_state = TWI_READY;
@@ -444,7 +919,7 @@ void twi_stop(void)
 void twi_releaseBus(void)
 {
   // release bus
-  TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA) | _BV(TWINT);
+  hal_twiWrite(HAL_TWCR, _BV(TWEN) | _BV(TWIE) | _BV(TWEA) | _BV(TWINT));
 
   // update twi state
   twi_state = TWI_READY;
@@ -475,16 +950,16 @@ void twi_handleTimeout(bool reset){
 
   if (reset) {
     // remember bitrate and address settings
-    uint8_t previous_TWBR = TWBR;
-    uint8_t previous_TWAR = TWAR;
+    uint8_t previous_TWBR = hal_twiRead(HAL_TWBR);
+    uint8_t previous_TWAR = hal_twiRead(HAL_TWAR);
 
     // reset the interface
     twi_disable();
     twi_init();
 
     // reapply the previous register values
-    TWAR = previous_TWAR;
-    TWBR = previous_TWBR;
+    hal_twiWrite(HAL_TWAR, previous_TWAR);
+    hal_twiWrite(HAL_TWBR, previous_TWBR);
   }
 }
 
@@ -503,45 +978,172 @@ bool twi_manageTimeoutFlag(bool clear_flag){
   return(flag);
 }
 
+#ifndef TWI_MASTER_ONLY
+/* 
+ * Function twi_deliverSlaveRx
+ * Desc     passes received data to the general call or slave rx event
+ * Input    none
+ * Output   none
+ */
+static void twi_deliverSlaveRx(void)
+{
+  if(twi_generalCall && twi_onSlaveGeneralCall){
+    twi_onSlaveGeneralCall(twi_rxBuffer, twi_rxBufferIndex);
+  }else{
+    twi_onSlaveReceive(twi_rxBuffer, twi_rxBufferIndex);
+  }
+}
+#endif
+
+/* 
+ * Function twi_stopFromIsr
+ * Desc     sends stop condition from the ISR; with TWI_SPLIT_ISR it does not wait
+ *          for the stop to be executed on bus (the next start does)
+ * Input    none
+ * Output   none
+ */
+static inline void twi_stopFromIsr(void)
+{
+#ifdef TWI_SPLIT_ISR
+  hal_twiWrite(HAL_TWCR, _BV(TWEN) | _BV(TWIE) | _BV(TWEA) | _BV(TWINT) | _BV(TWSTO));
+  twi_state = TWI_READY;
+#else
+  twi_stop();
+#endif
+}
+
+/* 
+ * Function twi_resumeIsr
+ * Desc     enables twi interrupt again without clearing TWINT: an event held
+ *          by the ISR for the bottom half is handled by the ISR again
+ * Input    none
+ * Output   none
+ */
+static inline void twi_resumeIsr(void)
+{
+  hal_twiWrite(HAL_TWCR, _BV(TWEN) | _BV(TWIE) | _BV(TWEA));
+}
+
+/* 
+ * Function twi_bottomHalf
+ * Desc     calls the events deferred by the ISR built with TWI_SPLIT_ISR (master complete,
+ *          slave rx and tx) with interrupts enabled; runs at the end of the ISR as soft interrupt,
+ *          or, with TWI_BOTTOM_HALF_POLLED, has to be called by the application
+ *          (loop, scheduler task); SCL is held while a slave event waits for it
+ * Input    none
+ * Output   none
+ */
+void twi_bottomHalf(void)
+{
+#ifdef TWI_SPLIT_ISR
+  uint8_t irq;
+  uint8_t pending;
+
+  while(0 != (pending = twi_deferred)){
+    if(pending & TWI_DEFER_MASTER_COMPLETE){
+      irq = hal_irqSave();
+      uint8_t result = twi_completeResult;
+      uint8_t count = twi_completeCount;
+      twi_deferred &= ~TWI_DEFER_MASTER_COMPLETE;
+      hal_irqRestore(irq);
+      if(twi_onMasterComplete){
+        twi_onMasterComplete(result, count);
+      }
+    }
+#ifndef TWI_MASTER_ONLY
+    if(pending & TWI_DEFER_SLAVE_RX_CHUNK){
+      // SCL stays held until the consumer calls twi_releaseSlaveRx()
+      irq = hal_irqSave();
+      twi_deferred &= ~TWI_DEFER_SLAVE_RX_CHUNK;
+      hal_irqRestore(irq);
+      twi_deliverSlaveRx();
+    }
+    if(pending & TWI_DEFER_SLAVE_RX){
+      twi_deliverSlaveRx();
+      // give the buffer back, an addressing held meanwhile is handled now
+      irq = hal_irqSave();
+      twi_rxBufferIndex = 0;
+      twi_state = TWI_READY;
+      twi_deferred &= ~TWI_DEFER_SLAVE_RX;
+      twi_resumeIsr();
+      hal_irqRestore(irq);
+    }
+    if(pending & TWI_DEFER_SLAVE_TX){
+      twi_onSlaveTransmit();
+      irq = hal_irqSave();
+      twi_txPrepared = true;
+      twi_deferred &= ~TWI_DEFER_SLAVE_TX;
+      twi_resumeIsr();
+      hal_irqRestore(irq);
+    }
+#endif
+    // wake tasks waiting for the bus given back by the bottom half
+#ifdef TWI_BOTTOM_HALF_POLLED
+    hal_eventSignal(&twi_event);
+#else
+    hal_eventSignalFromIsr(&twi_event);
+#endif
+  }
+#endif
+}
+
 ISR(TWI_vect)
 {
-  switch(TW_STATUS){
+  PROFILE_BEGIN(PROFILER_ZONE_TWI_ISR);
+  switch(hal_twiRead(HAL_TWSR) & TW_STATUS_MASK){
     // All Master
     case TW_START:     // sent start condition
     case TW_REP_START: // sent repeated start condition
       // copy device address and r/w bit to output register and ack
-      TWDR = twi_slarw;
+      hal_twiWrite(HAL_TWDR, twi_slarw);
       twi_reply(1);
       break;
 
     // Master Transmitter
     case TW_MT_SLA_ACK:  // slave receiver acked address
     case TW_MT_DATA_ACK: // slave receiver acked data
-      // if there is data to send, send it, otherwise stop 
-      if(twi_masterBufferIndex < twi_masterBufferLength){
-        // copy data to output register and ack
-        TWDR = twi_masterBuffer[twi_masterBufferIndex++];
+      if(TWI_ADDR10_LOW == twi_address10Phase){
+        // send second byte of 10-bit address
+        hal_twiWrite(HAL_TWDR, twi_address10Low);
+        twi_address10Phase = TWI_ADDR10_LOW_SENT;
         twi_reply(1);
+      }else if((TWI_ADDR10_LOW_SENT == twi_address10Phase) && (TWI_MRX == twi_state)){
+        // device selected: repeated start, then first address byte with read bit
+        twi_address10Phase = TWI_ADDR10_NONE;
+        twi_slarw |= TW_READ;
+        hal_twiWrite(HAL_TWCR, _BV(TWEN) | _BV(TWIE) | _BV(TWEA) | _BV(TWINT) | _BV(TWSTA));
       }else{
-        if (twi_sendStop){
-          twi_stop();
-       } else {
-         twi_inRepStart = true;	// we're gonna send the START
-         // don't enable the interrupt. We'll generate the start, but we
-         // avoid handling the interrupt until we're in the next transaction,
-         // at the point where we would normally issue the start.
-         TWCR = _BV(TWINT) | _BV(TWSTA)| _BV(TWEN) ;
-         twi_state = TWI_READY;
+        twi_address10Phase = TWI_ADDR10_NONE;
+        // if there is data to send, send it, otherwise stop 
+        if(twi_masterBufferIndex < twi_masterBufferLength){
+          // copy data to output register and ack
+          hal_twiWrite(HAL_TWDR, twi_masterBuffer[twi_masterBufferIndex++]);
+          twi_reply(1);
+        }else{
+          if (twi_sendStop){
+            twi_stopFromIsr();
+         } else {
+           twi_inRepStart = true;	// we're gonna send the START
+           twi_repStartAsync = twi_async;
+           // don't enable the interrupt. We'll generate the start, but we
+           // avoid handling the interrupt until we're in the next transaction,
+           // at the point where we would normally issue the start.
+           hal_twiWrite(HAL_TWCR, _BV(TWINT) | _BV(TWSTA)| _BV(TWEN));
+           twi_state = TWI_READY;
+          }
         }
       }
       break;
     case TW_MT_SLA_NACK:  // address sent, nack received
       twi_error = TW_MT_SLA_NACK;
-      twi_stop();
+      twi_address10Phase = TWI_ADDR10_NONE;
+      twi_stopFromIsr();
       break;
     case TW_MT_DATA_NACK: // data sent, nack received
-      twi_error = TW_MT_DATA_NACK;
-      twi_stop();
+      // nack of the second byte of 10-bit address means there is no such device
+      twi_error = (TWI_ADDR10_LOW_SENT == twi_address10Phase) ? TW_MT_SLA_NACK : TW_MT_DATA_NACK;
+      twi_address10Phase = TWI_ADDR10_NONE;
+      twi_stopFromIsr();
       break;
     case TW_MT_ARB_LOST: // lost bus arbitration
       twi_error = TW_MT_ARB_LOST;
@@ -550,10 +1152,21 @@ ISR(TWI_vect)
 
     // Master Receiver
     case TW_MR_DATA_ACK: // data received, ack sent
+#ifndef TWI_NO_TIMESTAMPS
+      if(0 == twi_masterBufferIndex){
+        twi_firstDataMicros = hal_micros();
+      }
+#endif
       // put byte into buffer
-      twi_masterBuffer[twi_masterBufferIndex++] = TWDR;
+      twi_masterBuffer[twi_masterBufferIndex++] = hal_twiRead(HAL_TWDR);
       __attribute__ ((fallthrough));
     case TW_MR_SLA_ACK:  // address sent, ack received
+#ifndef TWI_NO_TIMESTAMPS
+      // nothing received yet, so the slave has just acked its address
+      if(0 == twi_masterBufferIndex){
+        twi_addressAckMicros = hal_micros();
+      }
+#endif
       // ack if more bytes are expected, otherwise nack
       if(twi_masterBufferIndex < twi_masterBufferLength){
         twi_reply(1);
@@ -562,33 +1175,52 @@ ISR(TWI_vect)
       }
       break;
     case TW_MR_DATA_NACK: // data received, nack sent
+#ifndef TWI_NO_TIMESTAMPS
+      if(0 == twi_masterBufferIndex){
+        twi_firstDataMicros = hal_micros();
+      }
+#endif
       // put final byte into buffer
-      twi_masterBuffer[twi_masterBufferIndex++] = TWDR;
+      twi_masterBuffer[twi_masterBufferIndex++] = hal_twiRead(HAL_TWDR);
       if (twi_sendStop){
-        twi_stop();
+        twi_stopFromIsr();
       } else {
         twi_inRepStart = true;	// we're gonna send the START
+        twi_repStartAsync = twi_async;
         // don't enable the interrupt. We'll generate the start, but we
         // avoid handling the interrupt until we're in the next transaction,
         // at the point where we would normally issue the start.
-        TWCR = _BV(TWINT) | _BV(TWSTA)| _BV(TWEN) ;
+        hal_twiWrite(HAL_TWCR, _BV(TWINT) | _BV(TWSTA)| _BV(TWEN));
         twi_state = TWI_READY;
       }
       break;
     case TW_MR_SLA_NACK: // address sent, nack received
-      twi_stop();
+      twi_error = TW_MR_SLA_NACK;
+      twi_stopFromIsr();
       break;
     // TW_MR_ARB_LOST handled by TW_MT_ARB_LOST case
 
+#ifndef TWI_MASTER_ONLY
     // Slave Receiver
     case TW_SR_SLA_ACK:   // addressed, returned ack
     case TW_SR_GCALL_ACK: // addressed generally, returned ack
     case TW_SR_ARB_LOST_SLA_ACK:   // lost arbitration, returned ack
     case TW_SR_ARB_LOST_GCALL_ACK: // lost arbitration, returned ack
+#ifdef TWI_SPLIT_ISR
+      if(twi_deferred & TWI_DEFER_SLAVE_RX){
+        // previous message not delivered yet: hold SCL, twi_bottomHalf() resumes
+        hal_twiWrite(HAL_TWCR, _BV(TWEN) | _BV(TWEA));
+        break;
+      }
+#endif
       // enter slave receiver mode
       twi_state = TWI_SRX;
+      // remember how we were addressed to pick the callback at stop
+      twi_generalCall = (TW_SR_GCALL_ACK == (hal_twiRead(HAL_TWSR) & TW_STATUS_MASK)) ||
+                        (TW_SR_ARB_LOST_GCALL_ACK == (hal_twiRead(HAL_TWSR) & TW_STATUS_MASK));
       // indicate that rx buffer can be overwritten and ack
       twi_rxBufferIndex = 0;
+      twi_rxChunked = false;
       twi_reply(1);
       break;
     case TW_SR_DATA_ACK:       // data received, returned ack
@@ -596,8 +1228,21 @@ ISR(TWI_vect)
       // if there is still room in the rx buffer
       if(twi_rxBufferIndex < TWI_BUFFER_LENGTH){
         // put byte in buffer and ack
-        twi_rxBuffer[twi_rxBufferIndex++] = TWDR;
-        twi_reply(1);
+        twi_rxBuffer[twi_rxBufferIndex++] = hal_twiRead(HAL_TWDR);
+        if(twi_rxFlowControl && (TWI_BUFFER_LENGTH == twi_rxBufferIndex)){
+          // buffer full: leave TWINT set and interrupt off, so SCL is stretched
+          // until the consumer has taken the data and called twi_releaseSlaveRx()
+          twi_rxHeld = true;
+          twi_rxChunked = true;
+          hal_twiWrite(HAL_TWCR, _BV(TWEN) | _BV(TWEA));
+#ifdef TWI_SPLIT_ISR
+          twi_deferred |= TWI_DEFER_SLAVE_RX_CHUNK;
+#else
+          twi_deliverSlaveRx();
+#endif
+        }else{
+          twi_reply(1);
+        }
       }else{
         // otherwise nack
         twi_reply(0);
@@ -610,8 +1255,20 @@ ISR(TWI_vect)
       if(twi_rxBufferIndex < TWI_BUFFER_LENGTH){
         twi_rxBuffer[twi_rxBufferIndex] = '\0';
       }
-      // callback to user defined callback
-      twi_onSlaveReceive(twi_rxBuffer, twi_rxBufferIndex);
+      // callback to user defined callback, unless the message ended exactly
+      // with a part already delivered under flow control
+      if(!twi_rxChunked || (0 < twi_rxBufferIndex)){
+#ifdef TWI_SPLIT_ISR
+        // the buffer belongs to the message until twi_bottomHalf() has delivered it
+        twi_state = TWI_SRX;
+        twi_deferred |= TWI_DEFER_SLAVE_RX;
+        twi_rxChunked = false;
+        break;
+#else
+        twi_deliverSlaveRx();
+#endif
+      }
+      twi_rxChunked = false;
       // since we submit rx buffer to "wire" library, we can reset it
       twi_rxBufferIndex = 0;
       break;
@@ -624,15 +1281,33 @@ ISR(TWI_vect)
     // Slave Transmitter
     case TW_ST_SLA_ACK:          // addressed, returned ack
     case TW_ST_ARB_LOST_SLA_ACK: // arbitration lost, returned ack
+#ifdef TWI_SPLIT_ISR
+      if(twi_deferred & TWI_DEFER_SLAVE_RX){
+        // previous message not delivered yet: hold SCL, twi_bottomHalf() resumes
+        hal_twiWrite(HAL_TWCR, _BV(TWEN) | _BV(TWEA));
+        break;
+      }
+#endif
       // enter slave transmitter mode
       twi_state = TWI_STX;
       // ready the tx buffer index for iteration
       twi_txBufferIndex = 0;
+#ifdef TWI_SPLIT_ISR
+      if(!twi_txPrepared){
+        // hold SCL until twi_bottomHalf() has called the tx event, the event is handled again then
+        twi_txBufferLength = 0;
+        twi_deferred |= TWI_DEFER_SLAVE_TX;
+        hal_twiWrite(HAL_TWCR, _BV(TWEN) | _BV(TWEA));
+        break;
+      }
+      twi_txPrepared = false;
+#else
       // set tx buffer length to be zero, to verify if user changes it
       twi_txBufferLength = 0;
       // request for txBuffer to be filled and length to be set
       // note: user must call twi_transmit(bytes, length) to do this
       twi_onSlaveTransmit();
+#endif
       // if they didn't change buffer & length, initialize it
       if(0 == twi_txBufferLength){
         twi_txBufferLength = 1;
@@ -642,7 +1317,7 @@ ISR(TWI_vect)
       // transmit first byte from buffer, fall
     case TW_ST_DATA_ACK: // byte sent, ack returned
       // copy data to output register
-      TWDR = twi_txBuffer[twi_txBufferIndex++];
+      hal_twiWrite(HAL_TWDR, twi_txBuffer[twi_txBufferIndex++]);
       // if there is more to send, ack, otherwise nack
       if(twi_txBufferIndex < twi_txBufferLength){
         twi_reply(1);
@@ -657,18 +1332,74 @@ ISR(TWI_vect)
       // leave slave receiver state
       twi_state = TWI_READY;
       break;
+#endif
 
     // All
     case TW_NO_INFO:   // no state information
       break;
     case TW_BUS_ERROR: // bus error, illegal stop/start
       twi_error = TW_BUS_ERROR;
-      twi_stop();
+      twi_stopFromIsr();
       break;
   }
+
+  // wake the task waiting for the end of transaction
+  if(TWI_READY == twi_state){
+    hal_eventSignalFromIsr(&twi_event);
+    // or report the end of background transaction; the callback may start the next one
+    if(twi_async){
+      twi_async = false;
+      if(twi_onMasterComplete){
+#ifdef TWI_SPLIT_ISR
+        twi_completeResult = twi_result();
+        twi_completeCount = twi_masterBufferIndex;
+        twi_deferred |= TWI_DEFER_MASTER_COMPLETE;
+#else
+        twi_onMasterComplete(twi_result(), twi_masterBufferIndex);
+#endif
+      }
+    }
+  }
+  PROFILE_END(PROFILER_ZONE_TWI_ISR);
+
+#if defined(TWI_SPLIT_ISR) && !defined(TWI_BOTTOM_HALF_POLLED)
+  // soft interrupt: deferred work runs with interrupts enabled, other interrupts (and the
+  // top half of this one) preempt it; work deferred by a nested top half is picked up here
+  if(!twi_inBottomHalf){
+    twi_inBottomHalf = true;
+    while(twi_deferred){
+      sei();
+      twi_bottomHalf();
+      cli();
+    }
+    twi_inBottomHalf = false;
+  }
+#endif
+}
+
+/* 
+ * Function twi_getReadTimestamps
+ * Desc     returns micros() latched by the ISR during the last master read
+ * Input    addressAck: pointer to time when the slave acked SLA+R (0 if it did not)
+ *          firstData: pointer to time when the first data byte was received (0 if none)
+ * Output   none
+ */
+void twi_getReadTimestamps(uint32_t* addressAck, uint32_t* firstData)
+{
+#ifndef TWI_NO_TIMESTAMPS
+  // every master read (twi_readFrom(), twi_startReadFrom(), polled or not) clears the stamps
+  // when it starts and latches them on the way, so they are stable once the read has completed
+  *addressAck = twi_addressAckMicros;
+  *firstData = twi_firstDataMicros;
+#else
+  *addressAck = 0;
+  *firstData = 0;
+#endif
 }
 
 uint8_t* twi_getBufferHandle(void)
 {
   return twi_masterBuffer;
 }
+
+#endif // TWI_BACKEND_MEGA0
@@ -34,6 +34,45 @@
   #define TWI_BUFFER_LENGTH 160
   #endif
 
+  // define TWI_MASTER_ONLY to remove slave receiver/transmitter handling
+  // (saves flash when the device is never addressed by another master)
+  //#define TWI_MASTER_ONLY
+
+  // define TWI_NO_TIMESTAMPS to remove micros() stamps latched by the ISR during master reads
+  //#define TWI_NO_TIMESTAMPS
+
+  // blocking transactions of up to TWI_POLLED_LENGTH data bytes (7-bit address) poll TWINT
+  // instead of running the ISR for every bus event; 0 removes the polled path.
+  // With HAL_OS_FREERTOS or HAL_OS_PTHREAD it defaults to 0: the task sleeps on the ISR event
+  // instead of polling the bus
+  #ifndef TWI_POLLED_LENGTH
+  #if defined(HAL_OS_FREERTOS) || defined(HAL_OS_PTHREAD)
+  #define TWI_POLLED_LENGTH 0
+  #else
+  #define TWI_POLLED_LENGTH 2
+  #endif
+  #endif
+
+  // define TWI_SPLIT_ISR to bound the time ISR(TWI_vect) keeps other interrupts blocked:
+  // the ISR only serves the hardware (no wait for stop condition, SCL is held while slave
+  // data waits), event callbacks run in twi_bottomHalf() with interrupts enabled, as soft
+  // interrupt at the end of the ISR, or, with TWI_BOTTOM_HALF_POLLED also defined, when
+  // the application calls it (loop, scheduler task)
+  //#define TWI_SPLIT_ISR
+  //#define TWI_BOTTOM_HALF_POLLED
+
+  // megaAVR-0, tinyAVR-0/1/2 and AVR-Dx parts have the TWI peripheral with separate master
+  // and slave (MSTATUS/MDATA registers), served by twi_mega0.c instead of twi.c: smart mode
+  // acknowledges received bytes, a zero length read is a quick command (its result is
+  // reported by the master complete event); TWI_SPLIT_ISR is not available there.
+  // Define TWI_BACKEND_MEGA0 to select it explicitly, e.g. for host builds
+  #if !defined(TWI_BACKEND_MEGA0) && defined(TWI0_MCTRLA)
+  #define TWI_BACKEND_MEGA0
+  #endif
+
+  // or-ed with address passed to twi_readFrom()/twi_writeTo() selects 10-bit addressing
+  #define TWI_ADDRESS_10BIT 0x8000
+
   #define TWI_READY 0
   #define TWI_MRX   1
   #define TWI_MTX   2
@@ -43,11 +82,19 @@
   void twi_init(void);
   void twi_disable(void);
   void twi_setAddress(uint8_t);
+  void twi_setGeneralCall(uint8_t);
+  void twi_setSlaveRxFlowControl(uint8_t);
+  void twi_releaseSlaveRx(void);
   void twi_setFrequency(uint32_t);
-  uint8_t twi_readFrom(uint8_t, uint8_t*, uint8_t, uint8_t);
-  uint8_t twi_writeTo(uint8_t, uint8_t*, uint8_t, uint8_t, uint8_t);
+  void twi_setPolledLength(uint8_t);
+  uint8_t twi_readFrom(uint16_t, uint8_t*, uint8_t, uint8_t);
+  uint8_t twi_writeTo(uint16_t, uint8_t*, uint8_t, uint8_t, uint8_t);
+  uint8_t twi_startReadFrom(uint16_t, uint8_t, uint8_t);
+  uint8_t twi_startWriteTo(uint16_t, const uint8_t*, uint8_t, uint8_t);
+  void twi_attachMasterCompleteEvent( void (*)(uint8_t, uint8_t) );
   uint8_t twi_transmit(const uint8_t*, uint8_t);
   void twi_attachSlaveRxEvent( void (*)(uint8_t*, int) );
+  void twi_attachSlaveGeneralCallEvent( void (*)(uint8_t*, int) );
   void twi_attachSlaveTxEvent( void (*)(void) );
   void twi_reply(uint8_t);
   void twi_stop(void);
@@ -56,5 +103,8 @@
   void twi_handleTimeout(bool);
   bool twi_manageTimeoutFlag(bool);
 
+  void twi_bottomHalf(void);
+  void twi_getReadTimestamps(uint32_t*, uint32_t*);
+
   uint8_t* twi_getBufferHandle(void);
 #endif
@@ -0,0 +1,1146 @@
+/*
+  twi_mega0.c - TWI/I2C library for Wiring & Arduino, backend for the TWI peripheral
+  of megaAVR-0, tinyAVR-0/1/2 and AVR-Dx parts (MSTATUS/MDATA registers)
+  Copyright (c) 2006 Nicholas Zambetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+  Modified 2012 by Todd Krein (todd@krein.org) to implement repeated starts
+  Modified 2020 by Greyson Christoforo (grey@christoforo.net) to implement timeouts
+*/
+
+#include <stdlib.h>
+#include <inttypes.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <compat/twi.h>
+#include "hal.h" // for pins, micros and TWI0 registers
+#include "profiler.h" // compiles to nothing unless PROFILER_ENABLED is defined
+#include "hal_os.h" // lets waiting tasks sleep under an RTOS
+
+#include "pins_arduino.h"
+#include "twi.h"
+
+#ifdef TWI_BACKEND_MEGA0
+
+#ifdef TWI_SPLIT_ISR
+#error "TWI_SPLIT_ISR is not available with the megaAVR-0 TWI backend"
+#endif
+
+// master: read and write interrupts, smart mode (reading MDATA sends ACKACT and reads the next byte)
+#define TWI_MASTER_CONTROL (TWI_RIEN_bm | TWI_WIEN_bm | TWI_SMEN_bm | TWI_ENABLE_bm)
+#define TWI_MASTER_POLLED  (TWI_SMEN_bm | TWI_ENABLE_bm)
+// slave: data, address and stop interrupts
+#define TWI_SLAVE_CONTROL  (TWI_DIEN_bm | TWI_APIEN_bm | TWI_PIEN_bm | TWI_ENABLE_bm)
+#define TWI_MASTER_FLAGS   (TWI_RIF_bm | TWI_WIF_bm | TWI_ARBLOST_bm | TWI_BUSERR_bm)
+
+// twi_error values, twi_result() returns them unless there was no error
+#define TWI_ERROR_NONE         0xFF
+#define TWI_ERROR_TIMEOUT      0xFE
+#define TWI_ERROR_ADDRESS_NACK 2
+#define TWI_ERROR_DATA_NACK    3
+#define TWI_ERROR_OTHER        4
+
+static volatile uint8_t twi_state;
+static volatile uint8_t twi_slarw;
+static volatile uint8_t twi_address10Low;		// second byte of 10-bit address
+static volatile uint8_t twi_address10Phase;		// progress of 10-bit address phase
+
+#define TWI_ADDR10_NONE     0	// 7-bit address, or 10-bit address phase done
+#define TWI_ADDR10_LOW      1	// first byte acked, second one to be sent
+#define TWI_ADDR10_LOW_SENT 2	// second byte sent, device is selected when it is acked
+#define TWI_ADDR10_PREFIX   0xF0	// first byte of 10-bit address: 11110 A9 A8 R/W
+static volatile uint8_t twi_addressed;			// slave has acked its address in this transaction
+static volatile uint8_t twi_sendStop;			// should the transaction end with a stop
+static volatile uint8_t twi_inRepStart;			// bus kept for repeated start, MADDR sends it
+static volatile uint8_t twi_repStartAsync;		// the repeated start belongs to a background transaction
+static volatile uint8_t twi_async;			// transaction started by twi_startReadFrom()/twi_startWriteTo()
+static uint8_t twi_polledLength = TWI_POLLED_LENGTH;	// longest blocking transaction run without the ISR
+static uint8_t twi_masterControl;			// MCTRLA as last written
+
+// twi_timeout_us > 0 prevents the code from getting stuck in various while loops here
+// if twi_timeout_us == 0 then timeout checking is disabled (the previous Wire lib behavior)
+static volatile uint32_t twi_timeout_us = 0ul;
+static volatile bool twi_timed_out_flag = false;  // a timeout has been seen
+static volatile bool twi_do_reset_on_timeout = false;  // reset the TWI registers on timeout
+
+static void (*twi_onSlaveTransmit)(void);
+static void (*twi_onSlaveReceive)(uint8_t*, int);
+static void (*twi_onSlaveGeneralCall)(uint8_t*, int);
+static void (*twi_onMasterComplete)(uint8_t, uint8_t);
+static volatile uint8_t twi_generalCall;		// slave receiver was addressed by general call
+static volatile uint8_t twi_rxFlowControl;	// hold SCL instead of nacking when rx buffer is full
+static volatile uint8_t twi_rxHeld;		// SCL is held low until twi_releaseSlaveRx()
+static volatile uint8_t twi_rxChunked;		// part of the current message was already delivered
+
+static uint8_t twi_masterBuffer[TWI_BUFFER_LENGTH];
+static uint8_t* twi_masterData = &twi_masterBuffer[0];	// caller's data during polled transaction
+static volatile uint8_t twi_masterBufferIndex;
+static volatile uint8_t twi_masterBufferLength;
+
+static uint8_t* twi_txBuffer = &twi_masterBuffer[0];
+static volatile uint8_t twi_txBufferIndex;
+static volatile uint8_t twi_txBufferLength;
+
+static uint8_t* twi_rxBuffer = &twi_masterBuffer[0];
+static volatile uint8_t twi_rxBufferIndex;
+
+static volatile uint8_t twi_error;
+
+#ifndef TWI_NO_TIMESTAMPS
+static volatile uint32_t twi_addressAckMicros;	// SLA+R acknowledged by the slave
+static volatile uint32_t twi_firstDataMicros;	// first data byte of the read received
+#endif
+
+static hal_event_t twi_event; // signalled by the ISR whenever twi becomes ready
+
+/*
+ * Function twi_writeControl
+ * Desc     writes MCTRLA unless it already has the value
+ * Input    control: MCTRLA value
+ * Output   none
+ */
+static inline void twi_writeControl(uint8_t control)
+{
+  if(control != twi_masterControl){
+    twi_masterControl = control;
+    hal_twi0Write(HAL_TWI0_MCTRLA, control);
+  }
+}
+
+/*
+ * Function twi_writeBaud
+ * Desc     sets MBAUD with the master disabled, as required by the peripheral;
+ *          the bus state is forced to idle again afterwards
+ * Input    baud: MBAUD value
+ * Output   none
+ */
+static void twi_writeBaud(uint8_t baud)
+{
+  uint8_t control = twi_masterControl;
+
+  hal_twi0Write(HAL_TWI0_MCTRLA, control & ~TWI_ENABLE_bm);
+  hal_twi0Write(HAL_TWI0_MBAUD, baud);
+  hal_twi0Write(HAL_TWI0_MCTRLA, control);
+  if(control & TWI_ENABLE_bm){
+    hal_twi0Write(HAL_TWI0_MSTATUS, TWI_BUSSTATE_IDLE_gc);
+  }
+}
+
+/*
+ * Function twi_baud
+ * Desc     computes MBAUD for the bit rate, rise time neglected
+ * Input    frequency: SCL frequency
+ * Output   MBAUD value
+ */
+static uint8_t twi_baud(uint32_t frequency)
+{
+  /* SCL Frequency = CPU Clock Frequency / (10 + (2 * MBAUD) + CPU Clock Frequency * Trise)
+  It is 75 for a 16mhz board with 100kHz TWI */
+  uint32_t divider = F_CPU / frequency;
+
+  return (divider > 10) ? (uint8_t)((divider - 10) / 2) : 0;
+}
+
+/*
+ * Function twi_init
+ * Desc     readys twi pins, sets twi bitrate and enables master (and slave)
+ * Input    none
+ * Output   none
+ */
+void twi_init(void)
+{
+  // initialize state
+  twi_state = TWI_READY;
+  twi_sendStop = true;		// default value
+  twi_inRepStart = false;
+  twi_repStartAsync = false;
+  twi_async = false;
+  twi_rxHeld = false;
+  twi_rxChunked = false;
+  twi_masterData = twi_masterBuffer;
+  hal_eventInit(&twi_event);
+
+  // activate internal pullups for twi; on these parts they are PULLUPEN in PINnCTRL,
+  // the OUT register does not switch them
+  hal_pinMode(SDA, INPUT_PULLUP);
+  hal_pinMode(SCL, INPUT_PULLUP);
+
+  // enable master with interrupts and smart mode, at the default bit rate;
+  // the bus state is unknown after enabling until it is forced to idle
+  twi_masterControl = TWI_MASTER_CONTROL;
+  twi_writeBaud(twi_baud(TWI_FREQ));
+
+#ifndef TWI_MASTER_ONLY
+  // enable slave, it acks its address
+  hal_twi0Write(HAL_TWI0_SCTRLA, TWI_SLAVE_CONTROL);
+#endif
+}
+
+/*
+ * Function twi_disable
+ * Desc     disables twi pins
+ * Input    none
+ * Output   none
+ */
+void twi_disable(void)
+{
+  // disable master, slave and their interrupts
+  twi_masterControl = 0;
+  hal_twi0Write(HAL_TWI0_MCTRLA, 0);
+  hal_twi0Write(HAL_TWI0_SCTRLA, 0);
+
+  // deactivate internal pullups for twi.
+  hal_pinMode(SDA, INPUT);
+  hal_pinMode(SCL, INPUT);
+}
+
+/*
+ * Function twi_setAddress
+ * Desc     sets slave address
+ * Input    address: 7bit slave address
+ * Output   none
+ */
+void twi_setAddress(uint8_t address)
+{
+  // set twi slave address (skip over general call enable bit, keeping its setting)
+  hal_twi0Write(HAL_TWI0_SADDR, (address << 1) | (hal_twi0Read(HAL_TWI0_SADDR) & 0x01));
+}
+
+/*
+ * Function twi_setGeneralCall
+ * Desc     enables or disables recognition of general call address (0x00) in slave mode
+ * Input    enable: true to answer general calls
+ * Output   none
+ */
+void twi_setGeneralCall(uint8_t enable)
+{
+  if(enable){
+    hal_twi0Write(HAL_TWI0_SADDR, hal_twi0Read(HAL_TWI0_SADDR) | 0x01);
+  }else{
+    hal_twi0Write(HAL_TWI0_SADDR, hal_twi0Read(HAL_TWI0_SADDR) & ~0x01);
+  }
+}
+
+/*
+ * Function twi_setSlaveRxFlowControl
+ * Desc     selects what slave receiver does when its buffer is full: without flow control
+ *          further bytes are nacked and lost; with flow control the full buffer is delivered
+ *          to the rx event and SCL is held low (the last byte is not answered) until the
+ *          consumer calls twi_releaseSlaveRx(), so the master continues at the consumer's pace
+ * Input    enable: true to hold the bus instead of nacking
+ * Output   none
+ */
+void twi_setSlaveRxFlowControl(uint8_t enable)
+{
+  twi_rxFlowControl = enable;
+}
+
+/*
+ * Function twi_releaseSlaveRx
+ * Desc     lets the master continue after the delivered part of the message was consumed;
+ *          does nothing when the bus is not held
+ * Input    none
+ * Output   none
+ */
+void twi_releaseSlaveRx(void)
+{
+#ifndef TWI_MASTER_ONLY
+  if(twi_rxHeld){
+    twi_rxHeld = false;
+    twi_rxBufferIndex = 0;
+    // ack the byte which filled the buffer: SCL is released, data interrupt is on again
+    twi_reply(1);
+    hal_twi0Write(HAL_TWI0_SCTRLA, TWI_SLAVE_CONTROL);
+  }
+#endif
+}
+
+/*
+ * Function twi_setFrequency
+ * Desc     sets twi bit rate
+ * Input    Clock Frequency
+ * Output   none
+ */
+void twi_setFrequency(uint32_t frequency)
+{
+  twi_writeBaud(twi_baud(frequency));
+}
+
+/*
+ * Function twi_setPolledLength
+ * Desc     sets the longest blocking transaction run by polling MSTATUS instead of the ISR
+ * Input    length: number of data bytes (0 disables polling)
+ * Output   none
+ */
+void twi_setPolledLength(uint8_t length)
+{
+  twi_polledLength = length;
+}
+
+/*
+ * Function twi_buildAddress
+ * Desc     prepares address phase of master transaction; 10-bit address is sent
+ *          as two bytes with write direction, a read turns around with repeated start
+ * Input    address: 7bit i2c device address, or 10bit one or-ed with TWI_ADDRESS_10BIT
+ *          direction: TW_READ or TW_WRITE
+ * Output   none
+ */
+static void twi_buildAddress(uint16_t address, uint8_t direction)
+{
+  if(address & TWI_ADDRESS_10BIT){
+    twi_slarw = TWI_ADDR10_PREFIX | ((address >> 7) & 0x06) | TW_WRITE;
+    twi_address10Low = (uint8_t)address;
+    twi_address10Phase = TWI_ADDR10_LOW;
+  }else{
+    // build sla+r/w, slave device address + r/w bit
+    twi_slarw = direction;
+    twi_slarw |= (uint8_t)(address << 1);
+    twi_address10Phase = TWI_ADDR10_NONE;
+  }
+}
+
+/*
+ * Function twi_claim
+ * Desc     atomically takes ready twi for a master transaction; a repeated start is
+ *          taken only by the side (foreground or background) which has left it, so
+ *          neither one gets between the register write and the read of the other
+ * Input    state: TWI_MRX or TWI_MTX
+ *          async: true for transaction started by twi_startReadFrom()/twi_startWriteTo()
+ * Output   true if taken, false when twi (or the buffer, used by the slave) is busy
+ */
+static bool twi_claim(uint8_t state, uint8_t async)
+{
+  bool claimed;
+  uint8_t irq = hal_irqSave();
+
+  claimed = (TWI_READY == twi_state) && (!twi_inRepStart || (async ? twi_repStartAsync : !twi_repStartAsync));
+  if(claimed){
+    twi_state = state;
+    twi_async = async;
+    twi_error = TWI_ERROR_NONE;
+  }
+  hal_irqRestore(irq);
+
+  return claimed;
+}
+
+/*
+ * Function twi_startTransaction
+ * Desc     sends start and address with a single MADDR write; the peripheral sends
+ *          repeated start instead when the bus was kept by the previous transaction,
+ *          and waits for the end of a stop condition still being sent
+ * Input    control: MCTRLA value (TWI_MASTER_CONTROL or TWI_MASTER_POLLED)
+ * Output   none
+ */
+static void twi_startTransaction(uint8_t control)
+{
+  twi_inRepStart = false;
+  twi_repStartAsync = false;
+  twi_addressed = false;
+  // zero length read is a quick command: RIF is set right after the address is acked
+  if((0 == twi_masterBufferLength) && (twi_slarw & TW_READ)){
+    control |= TWI_QCEN_bm;
+  }
+  twi_writeControl(control);
+  // ack received bytes until the last one
+  hal_twi0Write(HAL_TWI0_MCTRLB, TWI_ACKACT_ACK_gc);
+  hal_twi0Write(HAL_TWI0_MADDR, twi_slarw);
+}
+
+/*
+ * Function twi_beginRead
+ * Desc     starts read of twi taken by twi_claim()
+ * Input    address: 7bit i2c device address, or 10bit one or-ed with TWI_ADDRESS_10BIT
+ *          length: number of bytes to read (0 for quick command)
+ *          sendStop: Boolean indicating whether to send a stop at the end
+ * Output   none
+ */
+static void twi_beginRead(uint16_t address, uint8_t length, uint8_t sendStop)
+{
+  twi_sendStop = sendStop;
+#ifndef TWI_NO_TIMESTAMPS
+  // no stamps unless the slave answers
+  twi_addressAckMicros = 0;
+  twi_firstDataMicros = 0;
+#endif
+
+  // initialize buffer iteration vars
+  twi_masterBufferIndex = 0;
+  twi_masterBufferLength = length;
+
+  twi_buildAddress(address, TW_READ);
+  twi_startTransaction(TWI_MASTER_CONTROL);
+}
+
+/*
+ * Function twi_beginWrite
+ * Desc     starts write of twi taken by twi_claim()
+ * Input    address: 7bit i2c device address, or 10bit one or-ed with TWI_ADDRESS_10BIT
+ *          data: pointer to byte array
+ *          length: number of bytes in array
+ *          sendStop: boolean indicating whether or not to send a stop at the end
+ * Output   none
+ */
+static void twi_beginWrite(uint16_t address, const uint8_t* data, uint8_t length, uint8_t sendStop)
+{
+  twi_sendStop = sendStop;
+
+  // initialize buffer iteration vars
+  twi_masterBufferIndex = 0;
+  twi_masterBufferLength = length;
+
+  // copy data to twi buffer
+  if (twi_masterBuffer != data)
+  {
+    for(uint8_t i = 0; i < length; ++i)
+    {
+      twi_masterBuffer[i] = data[i];
+    }
+  }
+
+  twi_buildAddress(address, TW_WRITE);
+  twi_startTransaction(TWI_MASTER_CONTROL);
+}
+
+/*
+ * Function twi_result
+ * Desc     translates error state of finished master transaction
+ * Input    none
+ * Output   0 .. success
+ *          2 .. address send, NACK received
+ *          3 .. data send, NACK received
+ *          4 .. other twi error (lost bus arbitration, bus error, ..)
+ */
+static uint8_t twi_result(void)
+{
+  return (TWI_ERROR_NONE == twi_error) ? 0 : twi_error;
+}
+
+/*
+ * Function twi_masterDone
+ * Desc     ends master transaction after its last byte: stop, or the bus is kept
+ *          (clock released, nothing sent) and the next MADDR write sends repeated start
+ * Input    none
+ * Output   none
+ */
+static void twi_masterDone(void)
+{
+  if(twi_sendStop){
+    hal_twi0Write(HAL_TWI0_MCTRLB, TWI_ACKACT_NACK_gc | TWI_MCMD_STOP_gc);
+  }else{
+    twi_inRepStart = true;
+    twi_repStartAsync = twi_async;
+    hal_twi0Write(HAL_TWI0_MSTATUS, TWI_RIF_bm | TWI_WIF_bm);
+  }
+  twi_state = TWI_READY;
+}
+
+/*
+ * Function twi_masterEvent
+ * Desc     serves one master event (RIF, WIF, lost arbitration, bus error); called by the
+ *          ISR, or by twi_transferPolled() with the master interrupts disabled
+ * Input    none
+ * Output   none
+ */
+static void twi_masterEvent(void)
+{
+  uint8_t status = hal_twi0Read(HAL_TWI0_MSTATUS);
+
+  if(status & (TWI_ARBLOST_bm | TWI_BUSERR_bm)){
+    // the peripheral has given the bus up
+    twi_error = TWI_ERROR_OTHER;
+    twi_address10Phase = TWI_ADDR10_NONE;
+    twi_releaseBus();
+  }else if(status & TWI_RIF_bm){
+    uint8_t index = twi_masterBufferIndex;
+
+    twi_addressed = true;
+#ifndef TWI_NO_TIMESTAMPS
+    // the peripheral reports the address ack together with the first data byte
+    if(0 == index){
+      twi_addressAckMicros = hal_micros();
+      twi_firstDataMicros = twi_addressAckMicros;
+    }
+#endif
+    if((uint8_t)(index + 1) < twi_masterBufferLength){
+      // smart mode: reading the byte acks it and starts reception of the next one
+      twi_masterData[index] = hal_twi0Read(HAL_TWI0_MDATA);
+      twi_masterBufferIndex = index + 1;
+    }else if(0 == twi_masterBufferLength){
+      // quick command: the acked address was all
+      twi_masterDone();
+    }else if(twi_sendStop){
+      // nack and stop, then take the last byte
+      hal_twi0Write(HAL_TWI0_MCTRLB, TWI_ACKACT_NACK_gc | TWI_MCMD_STOP_gc);
+      twi_masterData[index] = hal_twi0Read(HAL_TWI0_MDATA);
+      twi_masterBufferIndex = index + 1;
+      twi_state = TWI_READY;
+    }else{
+      // reading the last byte nacks it, the bus is kept for repeated start
+      hal_twi0Write(HAL_TWI0_MCTRLB, TWI_ACKACT_NACK_gc);
+      twi_masterData[index] = hal_twi0Read(HAL_TWI0_MDATA);
+      twi_masterBufferIndex = index + 1;
+      twi_inRepStart = true;
+      twi_repStartAsync = twi_async;
+      twi_state = TWI_READY;
+    }
+  }else if(status & TWI_WIF_bm){
+    if(status & TWI_RXACK_bm){
+      // nack of the address (also of the second byte of 10-bit address) means there is no such device
+      twi_error = twi_addressed ? TWI_ERROR_DATA_NACK : TWI_ERROR_ADDRESS_NACK;
+      twi_address10Phase = TWI_ADDR10_NONE;
+      hal_twi0Write(HAL_TWI0_MCTRLB, TWI_MCMD_STOP_gc);
+      twi_state = TWI_READY;
+    }else if(TWI_ADDR10_LOW == twi_address10Phase){
+      // send second byte of 10-bit address
+      twi_address10Phase = TWI_ADDR10_LOW_SENT;
+      hal_twi0Write(HAL_TWI0_MDATA, twi_address10Low);
+    }else if((TWI_ADDR10_LOW_SENT == twi_address10Phase) && (TWI_MRX == twi_state)){
+      // device selected: repeated start, then first address byte with read bit
+      twi_address10Phase = TWI_ADDR10_NONE;
+      twi_slarw |= TW_READ;
+      hal_twi0Write(HAL_TWI0_MADDR, twi_slarw);
+    }else{
+      twi_address10Phase = TWI_ADDR10_NONE;
+      twi_addressed = true;
+      // if there is data to send, send it, otherwise stop
+      if(twi_masterBufferIndex < twi_masterBufferLength){
+        hal_twi0Write(HAL_TWI0_MDATA, twi_masterData[twi_masterBufferIndex++]);
+      }else{
+        twi_masterDone();
+      }
+    }
+  }
+}
+
+/*
+ * Function twi_waitPolled
+ * Desc     spins until a master event is flagged
+ * Input    startMicros: hal_micros() at the start of the transaction
+ * Output   false on timeout
+ */
+static bool twi_waitPolled(uint32_t startMicros)
+{
+  while(!(hal_twi0Read(HAL_TWI0_MSTATUS) & TWI_MASTER_FLAGS)){
+    hal_spin();
+    if((twi_timeout_us > 0ul) && ((hal_micros() - startMicros) > twi_timeout_us)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Function twi_transferPolled
+ * Desc     runs whole master transaction of twi taken by twi_claim() by polling MSTATUS,
+ *          with the master interrupts disabled; the events are served by the same code
+ *          as in the ISR, on the caller's data instead of the twi buffer
+ * Input    address: 7bit i2c device address
+ *          data: pointer to byte array, read into when twi_state is TWI_MRX
+ *          length: number of bytes to transfer (1 .. twi_polledLength)
+ *          sendStop: boolean indicating whether or not to send a stop at the end
+ * Output   number of bytes transferred; error is left in twi_error, TWI_ERROR_TIMEOUT on timeout
+ */
+static uint8_t twi_transferPolled(uint16_t address, uint8_t* data, uint8_t length, uint8_t sendStop)
+{
+  uint32_t startMicros = (twi_timeout_us > 0ul) ? hal_micros() : 0ul;
+
+  twi_masterData = data;
+  twi_sendStop = sendStop;
+  twi_masterBufferIndex = 0;
+  twi_masterBufferLength = length;
+#ifndef TWI_NO_TIMESTAMPS
+  twi_addressAckMicros = 0;
+  twi_firstDataMicros = 0;
+#endif
+  twi_buildAddress(address, (TWI_MRX == twi_state) ? TW_READ : TW_WRITE);
+  twi_startTransaction(TWI_MASTER_POLLED);
+
+  while(TWI_READY != twi_state){
+    if(!twi_waitPolled(startMicros)){
+      twi_error = TWI_ERROR_TIMEOUT;
+      break;
+    }
+    twi_masterEvent();
+  }
+  twi_masterData = twi_masterBuffer;
+  twi_writeControl(TWI_MASTER_CONTROL);
+
+  if(TWI_ERROR_TIMEOUT == twi_error){
+    twi_handleTimeout(twi_do_reset_on_timeout);
+    if(!twi_do_reset_on_timeout){
+      // the interrupt is back on, so a late event is handled by the ISR
+      twi_releaseBus();
+    }
+  }
+
+  // wake tasks waiting for twi
+  hal_eventSignal(&twi_event);
+
+  return twi_masterBufferIndex;
+}
+
+/*
+ * Function twi_isPolled
+ * Desc     selects the polled fast path for blocking transaction
+ * Input    address: 7bit i2c device address, or 10bit one or-ed with TWI_ADDRESS_10BIT
+ *          length: number of data bytes
+ * Output   true when the transaction is to be run by twi_transferPolled()
+ */
+static inline bool twi_isPolled(uint16_t address, uint8_t length)
+{
+#if 0 < TWI_POLLED_LENGTH
+  return (0 < length) && (length <= twi_polledLength) && !(address & TWI_ADDRESS_10BIT);
+#else
+  // polled path is compiled out
+  (void)address;
+  (void)length;
+  return false;
+#endif
+}
+
+/*
+ * Function twi_readFrom
+ * Desc     attempts to become twi bus master and read a
+ *          series of bytes from a device on the bus
+ * Input    address: 7bit i2c device address, or 10bit one or-ed with TWI_ADDRESS_10BIT
+ *          data: pointer to byte array
+ *          length: number of bytes to read into array (0 sends quick command)
+ *          sendStop: Boolean indicating whether to send a stop at the end
+ * Output   number of bytes read
+ */
+uint8_t twi_readFrom(uint16_t address, uint8_t* data, uint8_t length, uint8_t sendStop)
+{
+  // ensure data will fit into buffer
+  if(TWI_BUFFER_LENGTH < length){
+    return 0;
+  }
+
+  // wait until twi is ready, become master receiver
+  uint32_t startMicros = hal_micros();
+  PROFILE_BEGIN(PROFILER_ZONE_TWI_WAIT_READY);
+  while(!twi_claim(TWI_MRX, false)){
+    hal_eventWait(&twi_event, twi_timeout_us);
+    if((twi_timeout_us > 0ul) && ((hal_micros() - startMicros) > twi_timeout_us)) {
+      twi_handleTimeout(twi_do_reset_on_timeout);
+      return 0;
+    }
+  }
+  PROFILE_END(PROFILER_ZONE_TWI_WAIT_READY);
+
+  if(twi_isPolled(address, length)){
+    PROFILE_BEGIN(PROFILER_ZONE_TWI_WAIT_READ);
+    length = twi_transferPolled(address, data, length, sendStop);
+    PROFILE_END(PROFILER_ZONE_TWI_WAIT_READ);
+    return (TWI_ERROR_TIMEOUT == twi_error) ? 0 : length;
+  }
+
+  twi_beginRead(address, length, sendStop);
+
+  // wait for read operation to complete
+  startMicros = hal_micros();
+  PROFILE_BEGIN(PROFILER_ZONE_TWI_WAIT_READ);
+  while(TWI_MRX == twi_state){
+    hal_eventWait(&twi_event, twi_timeout_us);
+    if((twi_timeout_us > 0ul) && ((hal_micros() - startMicros) > twi_timeout_us)) {
+      twi_handleTimeout(twi_do_reset_on_timeout);
+      return 0;
+    }
+  }
+  PROFILE_END(PROFILER_ZONE_TWI_WAIT_READ);
+
+  if (twi_masterBufferIndex < length) {
+    length = twi_masterBufferIndex;
+  }
+
+  // copy twi buffer to data
+  if (twi_masterBuffer != data)
+  {
+    for(uint8_t i = 0; i < length; ++i)
+    {
+      data[i] = twi_masterBuffer[i];
+    }
+  }
+
+  return length;
+}
+
+/*
+ * Function twi_writeTo
+ * Desc     attempts to become twi bus master and write a
+ *          series of bytes to a device on the bus
+ * Input    address: 7bit i2c device address, or 10bit one or-ed with TWI_ADDRESS_10BIT
+ *          data: pointer to byte array
+ *          length: number of bytes in array
+ *          wait: boolean indicating to wait for write or not
+ *          sendStop: boolean indicating whether or not to send a stop at the end
+ * Output   0 .. success
+ *          1 .. length to long for buffer
+ *          2 .. address send, NACK received
+ *          3 .. data send, NACK received
+ *          4 .. other twi error (lost bus arbitration, bus error, ..)
+ *          5 .. timeout
+ */
+uint8_t twi_writeTo(uint16_t address, uint8_t* data, uint8_t length, uint8_t wait, uint8_t sendStop)
+{
+  // ensure data will fit into buffer
+  if(TWI_BUFFER_LENGTH < length){
+    return 1;
+  }
+
+  // wait until twi is ready, become master transmitter
+  uint32_t startMicros = hal_micros();
+  PROFILE_BEGIN(PROFILER_ZONE_TWI_WAIT_READY);
+  while(!twi_claim(TWI_MTX, false)){
+    hal_eventWait(&twi_event, twi_timeout_us);
+    if((twi_timeout_us > 0ul) && ((hal_micros() - startMicros) > twi_timeout_us)) {
+      twi_handleTimeout(twi_do_reset_on_timeout);
+      return (5);
+    }
+  }
+  PROFILE_END(PROFILER_ZONE_TWI_WAIT_READY);
+
+  if(wait && twi_isPolled(address, length)){
+    PROFILE_BEGIN(PROFILER_ZONE_TWI_WAIT_WRITE);
+    twi_transferPolled(address, data, length, sendStop);
+    PROFILE_END(PROFILER_ZONE_TWI_WAIT_WRITE);
+    return (TWI_ERROR_TIMEOUT == twi_error) ? 5 : twi_result();
+  }
+
+  twi_beginWrite(address, data, length, sendStop);
+
+  // wait for write operation to complete
+  startMicros = hal_micros();
+  PROFILE_BEGIN(PROFILER_ZONE_TWI_WAIT_WRITE);
+  while(wait && (TWI_MTX == twi_state)){
+    hal_eventWait(&twi_event, twi_timeout_us);
+    if((twi_timeout_us > 0ul) && ((hal_micros() - startMicros) > twi_timeout_us)) {
+      twi_handleTimeout(twi_do_reset_on_timeout);
+      return (5);
+    }
+  }
+  PROFILE_END(PROFILER_ZONE_TWI_WAIT_WRITE);
+
+  return twi_result();
+}
+
+/*
+ * Function twi_startReadFrom
+ * Desc     starts read in background and returns at once; may be called from interrupts,
+ *          including the master complete event. Read data is in twi_getBufferHandle()
+ *          when the master complete event reports the transaction
+ * Input    address: 7bit i2c device address, or 10bit one or-ed with TWI_ADDRESS_10BIT
+ *          length: number of bytes to read (0 sends quick command)
+ *          sendStop: Boolean indicating whether to send a stop at the end
+ * Output   0 .. started
+ *          1 .. length to long for buffer
+ *          4 .. twi is busy, try again later
+ */
+uint8_t twi_startReadFrom(uint16_t address, uint8_t length, uint8_t sendStop)
+{
+  if(TWI_BUFFER_LENGTH < length){
+    return 1;
+  }
+  if(!twi_claim(TWI_MRX, true)){
+    return 4;
+  }
+
+  twi_beginRead(address, length, sendStop);
+  return 0;
+}
+
+/*
+ * Function twi_startWriteTo
+ * Desc     starts write in background and returns at once; may be called from interrupts,
+ *          including the master complete event. Passing twi_getBufferHandle() as data
+ *          avoids copying
+ * Input    address: 7bit i2c device address, or 10bit one or-ed with TWI_ADDRESS_10BIT
+ *          data: pointer to byte array
+ *          length: number of bytes in array
+ *          sendStop: boolean indicating whether or not to send a stop at the end
+ * Output   0 .. started
+ *          1 .. length to long for buffer
+ *          4 .. twi is busy, try again later
+ */
+uint8_t twi_startWriteTo(uint16_t address, const uint8_t* data, uint8_t length, uint8_t sendStop)
+{
+  if(TWI_BUFFER_LENGTH < length){
+    return 1;
+  }
+  if(!twi_claim(TWI_MTX, true)){
+    return 4;
+  }
+
+  twi_beginWrite(address, data, length, sendStop);
+  return 0;
+}
+
+/*
+ * Function twi_attachMasterCompleteEvent
+ * Desc     sets function called from the ISR when a transaction started by
+ *          twi_startReadFrom()/twi_startWriteTo() has finished
+ * Input    function: callback function to use; it gets result (as twi_writeTo(),
+ *          without 1 and 5) and number of bytes transferred
+ * Output   none
+ */
+void twi_attachMasterCompleteEvent( void (*function)(uint8_t, uint8_t) )
+{
+  twi_onMasterComplete = function;
+}
+
+/*
+ * Function twi_transmit
+ * Desc     fills slave tx buffer with data
+ *          must be called in slave tx event callback
+ * Input    data: pointer to byte array
+ *          length: number of bytes in array
+ * Output   1 length too long for buffer
+ *          2 not slave transmitter
+ *          0 ok
+ */
+uint8_t twi_transmit(const uint8_t* data, uint8_t length)
+{
+#ifdef TWI_MASTER_ONLY
+  // slave transmitter is not available
+  (void)data;
+  (void)length;
+  return 2;
+#else
+  // ensure data will fit into buffer
+  if(TWI_BUFFER_LENGTH < (twi_txBufferLength+length)){
+    return 1;
+  }
+
+  // ensure we are currently a slave transmitter
+  if(TWI_STX != twi_state){
+    return 2;
+  }
+
+  // set length and copy data into tx buffer
+  for(uint8_t i = 0; i < length; ++i){
+    twi_txBuffer[twi_txBufferLength+i] = data[i];
+  }
+  twi_txBufferLength += length;
+
+  return 0;
+#endif
+}
+
+/*
+ * Function twi_attachSlaveRxEvent
+ * Desc     sets function called before a slave read operation
+ * Input    function: callback function to use
+ * Output   none
+ */
+void twi_attachSlaveRxEvent( void (*function)(uint8_t*, int) )
+{
+  twi_onSlaveReceive = function;
+}
+
+/*
+ * Function twi_attachSlaveGeneralCallEvent
+ * Desc     sets function called after data was received by general call;
+ *          without it general call data goes to the slave rx event
+ * Input    function: callback function to use, or NULL
+ * Output   none
+ */
+void twi_attachSlaveGeneralCallEvent( void (*function)(uint8_t*, int) )
+{
+  twi_onSlaveGeneralCall = function;
+}
+
+/*
+ * Function twi_attachSlaveTxEvent
+ * Desc     sets function called before a slave write operation
+ * Input    function: callback function to use
+ * Output   none
+ */
+void twi_attachSlaveTxEvent( void (*function)(void) )
+{
+  twi_onSlaveTransmit = function;
+}
+
+/*
+ * Function twi_reply
+ * Desc     answers the slave event held by the peripheral (address or data byte)
+ * Input    ack: byte indicating to ack or to nack
+ * Output   none
+ */
+void twi_reply(uint8_t ack)
+{
+  if(ack){
+    hal_twi0Write(HAL_TWI0_SCTRLB, TWI_ACKACT_ACK_gc | TWI_SCMD_RESPONSE_gc);
+  }else{
+    hal_twi0Write(HAL_TWI0_SCTRLB, TWI_ACKACT_NACK_gc | TWI_SCMD_RESPONSE_gc);
+  }
+}
+
+/*
+ * Function twi_stop
+ * Desc     relinquishes bus master status; the peripheral sends the stop condition
+ *          on its own and a following start waits for it, so there is nothing to wait for
+ * Input    none
+ * Output   none
+ */
+void twi_stop(void)
+{
+  hal_twi0Write(HAL_TWI0_MCTRLB, TWI_MCMD_STOP_gc);
+
+  // update twi state
+  twi_state = TWI_READY;
+}
+
+/*
+ * Function twi_releaseBus
+ * Desc     releases bus control
+ * Input    none
+ * Output   none
+ */
+void twi_releaseBus(void)
+{
+  // clear master flags, the clock is released
+  hal_twi0Write(HAL_TWI0_MSTATUS, TWI_MASTER_FLAGS);
+  twi_inRepStart = false;
+
+  // update twi state
+  twi_state = TWI_READY;
+}
+
+/*
+ * Function twi_setTimeoutInMicros
+ * Desc     set a timeout for while loops that twi might get stuck in
+ * Input    timeout value in microseconds (0 means never time out)
+ * Input    reset_with_timeout: true causes timeout events to reset twi
+ * Output   none
+ */
+void twi_setTimeoutInMicros(uint32_t timeout, bool reset_with_timeout){
+  twi_timed_out_flag = false;
+  twi_timeout_us = timeout;
+  twi_do_reset_on_timeout = reset_with_timeout;
+}
+
+/*
+ * Function twi_handleTimeout
+ * Desc     this gets called whenever a while loop here has lasted longer than
+ *          twi_timeout_us microseconds. always sets twi_timed_out_flag
+ * Input    reset: true causes this function to reset the twi hardware interface
+ * Output   none
+ */
+void twi_handleTimeout(bool reset){
+  twi_timed_out_flag = true;
+
+  if (reset) {
+    // remember bitrate and address settings
+    uint8_t previous_MBAUD = hal_twi0Read(HAL_TWI0_MBAUD);
+    uint8_t previous_SADDR = hal_twi0Read(HAL_TWI0_SADDR);
+
+    // reset the interface
+    twi_disable();
+    twi_init();
+
+    // reapply the previous register values
+    hal_twi0Write(HAL_TWI0_SADDR, previous_SADDR);
+    twi_writeBaud(previous_MBAUD);
+  }
+}
+
+/*
+ * Function twi_manageTimeoutFlag
+ * Desc     returns true if twi has seen a timeout
+ *          optionally clears the timeout flag
+ * Input    clear_flag: true if we should reset the hardware
+ * Output   the value of twi_timed_out_flag when the function was called
+ */
+bool twi_manageTimeoutFlag(bool clear_flag){
+  bool flag = twi_timed_out_flag;
+  if (clear_flag){
+    twi_timed_out_flag = false;
+  }
+  return(flag);
+}
+
+/*
+ * Function twi_bottomHalf
+ * Desc     nothing is deferred by this backend (TWI_SPLIT_ISR is not available),
+ *          the events are called from the ISRs
+ * Input    none
+ * Output   none
+ */
+void twi_bottomHalf(void)
+{
+}
+
+ISR(TWI0_TWIM_vect)
+{
+  PROFILE_BEGIN(PROFILER_ZONE_TWI_ISR);
+  twi_masterEvent();
+
+  // wake the task waiting for the end of transaction
+  if(TWI_READY == twi_state){
+    hal_eventSignalFromIsr(&twi_event);
+    // or report the end of background transaction; the callback may start the next one
+    if(twi_async){
+      twi_async = false;
+      if(twi_onMasterComplete){
+        twi_onMasterComplete(twi_result(), twi_masterBufferIndex);
+      }
+    }
+  }
+  PROFILE_END(PROFILER_ZONE_TWI_ISR);
+}
+
+#ifndef TWI_MASTER_ONLY
+/*
+ * Function twi_deliverSlaveRx
+ * Desc     passes received data to the general call or slave rx event
+ * Input    none
+ * Output   none
+ */
+static void twi_deliverSlaveRx(void)
+{
+  if(twi_generalCall && twi_onSlaveGeneralCall){
+    twi_onSlaveGeneralCall(twi_rxBuffer, twi_rxBufferIndex);
+  }else{
+    twi_onSlaveReceive(twi_rxBuffer, twi_rxBufferIndex);
+  }
+}
+
+ISR(TWI0_TWIS_vect)
+{
+  uint8_t status = hal_twi0Read(HAL_TWI0_SSTATUS);
+
+  if(status & (TWI_COLL_bm | TWI_BUSERR_bm)){
+    // collision or bus error: drop the transfer
+    hal_twi0Write(HAL_TWI0_SSTATUS, TWI_COLL_bm | TWI_BUSERR_bm);
+    hal_twi0Write(HAL_TWI0_SCTRLB, TWI_SCMD_COMPTRANS_gc);
+    if((TWI_SRX == twi_state) || (TWI_STX == twi_state)){
+      twi_state = TWI_READY;
+    }
+  }else if((status & TWI_APIF_bm) && (status & TWI_AP_bm)){
+    if(TWI_READY != twi_state){
+      // the buffer is used by a master transaction of this device
+      twi_reply(0);
+    }else if(status & TWI_DIR_bm){
+      // enter slave transmitter mode
+      twi_state = TWI_STX;
+      // ready the tx buffer index for iteration
+      twi_txBufferIndex = 0;
+      // set tx buffer length to be zero, to verify if user changes it
+      twi_txBufferLength = 0;
+      // request for txBuffer to be filled and length to be set
+      // note: user must call twi_transmit(bytes, length) to do this
+      twi_onSlaveTransmit();
+      // if they didn't change buffer & length, initialize it
+      if(0 == twi_txBufferLength){
+        twi_txBufferLength = 1;
+        twi_txBuffer[0] = 0x00;
+      }
+      // ack the address, the data interrupt asks for the first byte
+      twi_reply(1);
+    }else{
+      // enter slave receiver mode
+      twi_state = TWI_SRX;
+      // remember how we were addressed to pick the callback at stop
+      twi_generalCall = (0 == (hal_twi0Read(HAL_TWI0_SDATA) >> 1));
+      // indicate that rx buffer can be overwritten and ack
+      twi_rxBufferIndex = 0;
+      twi_rxChunked = false;
+      twi_reply(1);
+    }
+  }else if(status & TWI_APIF_bm){
+    // stop condition
+    hal_twi0Write(HAL_TWI0_SCTRLB, TWI_SCMD_COMPTRANS_gc);
+    if(TWI_SRX == twi_state){
+      twi_state = TWI_READY;
+      // put a null char after data if there's room
+      if(twi_rxBufferIndex < TWI_BUFFER_LENGTH){
+        twi_rxBuffer[twi_rxBufferIndex] = '\0';
+      }
+      // callback to user defined callback, unless the message ended exactly
+      // with a part already delivered under flow control
+      if(!twi_rxChunked || (0 < twi_rxBufferIndex)){
+        twi_deliverSlaveRx();
+      }
+      twi_rxChunked = false;
+      // since we submit rx buffer to "wire" library, we can reset it
+      twi_rxBufferIndex = 0;
+    }else if(TWI_STX == twi_state){
+      twi_state = TWI_READY;
+    }
+  }else if(status & TWI_DIF_bm){
+    if(status & TWI_DIR_bm){
+      if((0 < twi_txBufferIndex) && (status & TWI_RXACK_bm)){
+        // master nacked the previous byte, we are done
+        hal_twi0Write(HAL_TWI0_SCTRLB, TWI_SCMD_COMPTRANS_gc);
+        twi_state = TWI_READY;
+      }else{
+        // copy data to output register, 0xFF when master reads more than prepared
+        hal_twi0Write(HAL_TWI0_SDATA, (twi_txBufferIndex < twi_txBufferLength) ? twi_txBuffer[twi_txBufferIndex++] : 0xFF);
+        hal_twi0Write(HAL_TWI0_SCTRLB, TWI_SCMD_RESPONSE_gc);
+      }
+    }else if(twi_rxBufferIndex < TWI_BUFFER_LENGTH){
+      // put byte in buffer and ack
+      twi_rxBuffer[twi_rxBufferIndex++] = hal_twi0Read(HAL_TWI0_SDATA);
+      if(twi_rxFlowControl && (TWI_BUFFER_LENGTH == twi_rxBufferIndex)){
+        // buffer full: the byte is not answered and the data interrupt is off, so SCL is
+        // stretched until the consumer has taken the data and called twi_releaseSlaveRx()
+        twi_rxHeld = true;
+        twi_rxChunked = true;
+        hal_twi0Write(HAL_TWI0_SCTRLA, TWI_SLAVE_CONTROL & ~TWI_DIEN_bm);
+        twi_deliverSlaveRx();
+      }else{
+        twi_reply(1);
+      }
+    }else{
+      // otherwise nack
+      twi_reply(0);
+    }
+  }
+
+  // wake a task waiting for the buffer used by the slave
+  if(TWI_READY == twi_state){
+    hal_eventSignalFromIsr(&twi_event);
+  }
+}
+#endif
+
+/*
+ * Function twi_getReadTimestamps
+ * Desc     returns micros() latched by the ISR during the last master read; the peripheral
+ *          reports the address ack with the first data byte, so both stamps are equal
+ * Input    addressAck: pointer to time when the slave acked SLA+R (0 if it did not)
+ *          firstData: pointer to time when the first data byte was received (0 if none)
+ * Output   none
+ */
+void twi_getReadTimestamps(uint32_t* addressAck, uint32_t* firstData)
+{
+#ifndef TWI_NO_TIMESTAMPS
+  // every master read (twi_readFrom(), twi_startReadFrom(), polled or not) clears the stamps
+  // when it starts and latches them on the way, so they are stable once the read has completed
+  *addressAck = twi_addressAckMicros;
+  *firstData = twi_firstDataMicros;
+#else
+  *addressAck = 0;
+  *firstData = 0;
+#endif
+}
+
+uint8_t* twi_getBufferHandle(void)
+{
+  return twi_masterBuffer;
+}
+
+#endif // TWI_BACKEND_MEGA0